@@ -0,0 +1,193 @@
+//
+// Created by David Yang on 2026-10-17.
+//
+
+// Gao_Bench: drives create_gaolette, fetch_state and destroy_gaolette through one Orchestrator from a fixed number
+// of threads, optionally at a fixed rate, and prints throughput and latency percentiles as a single JSON object.
+//
+// The Gao process is looked up through GAO_BIN_DIR like for any Orchestrator. Unset, it defaults to the stand-in
+// runtime built next to the benchmark, which answers without touching memory and only speaks over the socket;
+// the benchmark fails instead of measuring another transport than the one asked for.
+//
+// usage: Gao_Bench [--concurrency=N] [--rate=ITERATIONS_PER_SECOND] [--duration=SECONDS] [--size=BYTES]
+//                  [--transport=socket|shm]
+// an iteration is one create, fetch and destroy; a rate of 0 runs every thread flat out. At a fixed rate
+// latencies count from when an iteration was due, so falling behind shows up in them instead of being hidden.
+
+#include <single_include/Gao.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct Options {
+        unsigned concurrency = 4;
+        double rate = 0;
+        double duration = 5;
+        std::size_t size = 1 << 20;
+        Gao::protocol::Transport transport = Gao::protocol::Transport::SOCKET;
+    };
+
+    struct Results {
+        Gao::stats::Histogram create;
+        Gao::stats::Histogram fetch;
+        Gao::stats::Histogram destroy;
+        std::atomic<std::uint64_t> failures = 0;
+    };
+
+    bool parse(const int argc, char** argv, Options& options) {
+        for (int i = 1; i < argc; ++i) {
+            const char* arg = argv[i];
+            if (std::strncmp(arg, "--concurrency=", 14) == 0) {
+                options.concurrency = static_cast<unsigned>(std::strtoul(arg + 14, nullptr, 10));
+            } else if (std::strncmp(arg, "--rate=", 7) == 0) {
+                options.rate = std::strtod(arg + 7, nullptr);
+            } else if (std::strncmp(arg, "--duration=", 11) == 0) {
+                options.duration = std::strtod(arg + 11, nullptr);
+            } else if (std::strncmp(arg, "--size=", 7) == 0) {
+                options.size = std::strtoull(arg + 7, nullptr, 10);
+            } else if (std::strcmp(arg, "--transport=shm") == 0) {
+                options.transport = Gao::protocol::Transport::SHARED_MEMORY;
+            } else if (std::strcmp(arg, "--transport=socket") != 0) {
+                std::fprintf(stderr, "unknown option %s\n", arg);
+                return false;
+            }
+        }
+        return options.concurrency != 0 && options.duration > 0 && options.rate >= 0;
+    }
+
+    const char* transport_name(const Gao::protocol::Transport transport) {
+        return transport == Gao::protocol::Transport::SHARED_MEMORY ? "shm" : "socket";
+    }
+
+    // value as a JSON string, null if there is none
+    void print_json_string(const char* value) {
+        if (value == nullptr) {
+            std::fputs("null", stdout);
+            return;
+        }
+        std::putchar('"');
+        for (const char* c = value; *c != '\0'; ++c) {
+            const auto byte = static_cast<unsigned char>(*c);
+            if (byte == '"' || byte == '\\') {
+                std::printf("\\%c", byte);
+            } else if (byte < 0x20) {
+                std::printf("\\u%04x", byte);
+            } else {
+                std::putchar(byte);
+            }
+        }
+        std::putchar('"');
+    }
+
+    void sleep_until(const std::uint64_t deadline) {
+        const std::uint64_t now = Gao::stats::now();
+        if (deadline > now) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(deadline - now));
+        }
+    }
+
+    void drive(const Gao::Orchestrator& gao, const Options& options, const std::uint64_t start,
+               const std::uint64_t end, Results& results) {
+        Gao::Perf_Spec spec{};
+        spec.size_ = options.size;
+        spec.memory_policy_ = Gao::Memory_Policy::STATIC;
+        spec.max_memory_usage_ = options.size;
+        spec.max_cpu_cores_ = 1;
+        // every thread takes an equal share of the rate
+        const std::uint64_t interval = options.rate > 0
+            ? static_cast<std::uint64_t>(1e9 * options.concurrency / options.rate) : 0;
+
+        std::uint64_t due = start;
+        while (true) {
+            if (interval != 0) {
+                sleep_until(due);
+            } else {
+                due = Gao::stats::now();
+            }
+            if (due >= end) {
+                return;
+            }
+            try {
+                Gao::Gaolette gaolette = Gao::create_gaolette(spec, gao);
+                results.create.record_since(due);
+
+                std::uint64_t begin = Gao::stats::now();
+                Gao::fetch_state(gaolette, gao);
+                results.fetch.record_since(begin);
+
+                begin = Gao::stats::now();
+                if (Gao::destroy_gaolette(gaolette, gao) != 0) {
+                    results.failures.fetch_add(1, std::memory_order_relaxed);
+                }
+                results.destroy.record_since(begin);
+            } catch (const std::exception&) {
+                results.failures.fetch_add(1, std::memory_order_relaxed);
+            }
+            due += interval;
+        }
+    }
+
+    void print_operation(const char* name, const Gao::stats::Histogram& histogram, const double elapsed,
+                         const bool last) {
+        const Gao::protocol::Latency_Summary summary = histogram.summary();
+        std::printf("    \"%s\": {\"count\": %llu, \"throughput\": %.1f, \"mean_ns\": %llu, \"min_ns\": %llu, "
+                    "\"p50_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu, \"max_ns\": %llu}%s\n",
+                    name, static_cast<unsigned long long>(summary.count), static_cast<double>(summary.count) / elapsed,
+                    static_cast<unsigned long long>(summary.count != 0 ? summary.total_ns / summary.count : 0),
+                    static_cast<unsigned long long>(summary.min_ns), static_cast<unsigned long long>(summary.p50_ns),
+                    static_cast<unsigned long long>(summary.p99_ns), static_cast<unsigned long long>(summary.p999_ns),
+                    static_cast<unsigned long long>(summary.max_ns), last ? "" : ",");
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse(argc, argv, options)) {
+        std::fprintf(stderr, "usage: %s [--concurrency=N] [--rate=ITERATIONS_PER_SECOND] [--duration=SECONDS] "
+                             "[--size=BYTES] [--transport=socket|shm]\n", argv[0]);
+        return 2;
+    }
+#ifdef GAO_BENCH_STUB_DIR
+    ::setenv("GAO_BIN_DIR", GAO_BENCH_STUB_DIR, 0);
+#endif
+    try {
+        const Gao::Orchestrator gao(true, options.transport);
+        if (gao.transport() != options.transport) {
+            std::fprintf(stderr, "Gao_Bench: asked for the %s transport, the Gao process only offered %s\n",
+                         transport_name(options.transport), transport_name(gao.transport()));
+            return 1;
+        }
+        auto results = std::make_unique<Results>();
+
+        const std::uint64_t start = Gao::stats::now();
+        const std::uint64_t end = start + static_cast<std::uint64_t>(options.duration * 1e9);
+        std::vector<std::thread> threads;
+        threads.reserve(options.concurrency);
+        for (unsigned i = 0; i < options.concurrency; ++i) {
+            threads.emplace_back(drive, std::cref(gao), std::cref(options), start, end, std::ref(*results));
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        const double elapsed = static_cast<double>(Gao::stats::now() - start) / 1e9;
+
+        std::fputs("{\n  \"bin_dir\": ", stdout);
+        print_json_string(std::getenv("GAO_BIN_DIR"));
+        std::printf(",\n  \"transport\": \"%s\",\n  \"concurrency\": %u,\n"
+                    "  \"rate\": %.1f,\n  \"elapsed_s\": %.3f,\n  \"failures\": %llu,\n  \"operations\": {\n",
+                    transport_name(gao.transport()), options.concurrency, options.rate, elapsed,
+                    static_cast<unsigned long long>(results->failures.load()));
+        print_operation("create", results->create, elapsed, false);
+        print_operation("fetch_state", results->fetch, elapsed, false);
+        print_operation("destroy", results->destroy, elapsed, true);
+        std::printf("  }\n}\n");
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "Gao_Bench: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,135 @@
+//
+// Created by David Yang on 2026-10-17.
+//
+
+// Stand-in Gao runtime for Gao_Bench.
+// Speaks the protocol over the socket on stdin/stdout like the real runtime, but answers CREATE, DESTROY and
+// GET_STATE without mapping any memory, so the benchmark measures the Orchestrator and the transport alone.
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <Gao_Protocol.hpp>
+
+using namespace Gao::protocol;
+
+namespace {
+    constexpr size_t IN_SIZE = 64 * 1024;
+    constexpr size_t OUT_SIZE = 64 * 1024;
+
+    alignas(8) char in[IN_SIZE];
+    size_t in_begin = 0;
+    size_t in_end = 0;
+    char out[OUT_SIZE];
+    size_t out_length = 0;
+    int32_t next_id = 0;
+
+    int flush() noexcept {
+        size_t written = 0;
+        while (written < out_length) {
+            const ssize_t n = ::write(STDOUT_FILENO, out + written, out_length - written);
+            if (n == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -1;
+            }
+            written += static_cast<size_t>(n);
+        }
+        out_length = 0;
+        return 0;
+    }
+
+    // replies are batched until the input runs dry, like the runtime's send queue
+    int reply(const Frame_Header& request, Status status, const void* payload = nullptr, uint32_t length = 0) noexcept {
+        if (OUT_SIZE - out_length < sizeof(Frame_Header) + length && flush() == -1) {
+            return -1;
+        }
+        const Frame_Header header = make_header(static_cast<Opcode>(request.opcode), request.request_id, length,
+                                                FLAG_REPLY, status);
+        memcpy(out + out_length, &header, sizeof(header));
+        if (length != 0) {
+            memcpy(out + out_length + sizeof(header), payload, length);
+        }
+        out_length += sizeof(header) + length;
+        return 0;
+    }
+
+    int answer(const Frame_Header& header) noexcept {
+        if (validate(header) != Status::OK) {
+            return reply(header, validate(header));
+        }
+        switch (static_cast<Opcode>(header.opcode)) {
+            case Opcode::CREATE: {
+                if (header.length != sizeof(Perf_Spec_Payload)) {
+                    return reply(header, Status::BAD_REQUEST);
+                }
+                Perf_Spec_Payload spec{};
+                memcpy(&spec, in + in_begin + sizeof(header), sizeof(spec));
+                const Created_Payload created{next_id++, spec.page_size, {}};
+                return reply(header, Status::OK, &created, sizeof(created));
+            }
+            case Opcode::DESTROY:
+                return reply(header, header.length == sizeof(Id_Payload) ? Status::OK : Status::BAD_REQUEST);
+            case Opcode::GET_STATE: {
+                if (header.length != sizeof(Id_Payload)) {
+                    return reply(header, Status::BAD_REQUEST);
+                }
+                const State_Payload state{static_cast<uint8_t>(State_Code::OPERATIONAL), {}};
+                return reply(header, Status::OK, &state, sizeof(state));
+            }
+            default:
+                return reply(header, Status::BAD_REQUEST);
+        }
+    }
+}
+
+int main() {
+    // the shared memory transport is never offered, the Orchestrator falls back to the socket and Gao_Bench
+    // refuses to run on it when asked for shm
+    const Hello_Payload hello{static_cast<uint8_t>(Transport::SOCKET), {}};
+    const Frame_Header header = make_header(Opcode::HELLO, 0, sizeof(hello));
+    memcpy(out, &header, sizeof(header));
+    memcpy(out + sizeof(header), &hello, sizeof(hello));
+    out_length = sizeof(header) + sizeof(hello);
+    if (flush() == -1) {
+        return 1;
+    }
+
+    while (true) {
+        const ssize_t n = ::read(STDIN_FILENO, in + in_end, IN_SIZE - in_end);
+        if (n == 0) {
+            return 0;
+        }
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 1;
+        }
+        in_end += static_cast<size_t>(n);
+
+        Frame_Header request{};
+        while (in_end - in_begin >= sizeof(request)) {
+            memcpy(&request, in + in_begin, sizeof(request));
+            if (request.length > IN_SIZE - sizeof(request)) {
+                return 1;   // nothing the benchmark sends, batches are not served
+            }
+            if (in_end - in_begin < sizeof(request) + request.length) {
+                break;
+            }
+            if (answer(request) == -1) {
+                return 1;
+            }
+            in_begin += sizeof(request) + request.length;
+        }
+        // keeps payloads 8 byte aligned and makes room for the rest of a partial frame
+        memmove(in, in + in_begin, in_end - in_begin);
+        in_end -= in_begin;
+        in_begin = 0;
+        if (flush() == -1) {
+            return 1;
+        }
+    }
+}
@@ -5,6 +5,31 @@
 #ifndef GAO_HPP
 #define GAO_HPP
 
+#include <spawn.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Gao_Embedded.hpp"
+#include "Gao_Log.hpp"
+#include "Gao_Protocol.hpp"
+#include "Gao_Ring.hpp"
+#include "Gao_Stats.hpp"
+
+extern char **environ;
+
 namespace Gao::exceptions {
     ///
     /// @class Failed_To_Create_Gaolette
@@ -44,10 +69,10 @@ namespace Gao {
         constexpr auto BG_RESET = "\033[49m";
 
 
-        constexpr inline auto ERROR = std::string("\033[31m") + "\033[1m";
-        constexpr inline auto SUCCESS = std::string("\033[32m") + "\033[1m";
-        constexpr inline auto WARNING = std::string("\033[33m") + "\033[1m";
-        constexpr inline auto NOTICE = std::string("\033[34m") + "\033[1m";
+        inline const auto ERROR = std::string("\033[31m") + "\033[1m";
+        inline const auto SUCCESS = std::string("\033[32m") + "\033[1m";
+        inline const auto WARNING = std::string("\033[33m") + "\033[1m";
+        inline const auto NOTICE = std::string("\033[34m") + "\033[1m";
     }
 
     /// @enum State
@@ -71,7 +96,27 @@ namespace Gao {
     enum class Memory_Policy {
         // defines contraction/expansion policies of the Gaolette's memory
         STATIC,    ///< fixed size, no contraction/expansion
-        DYNAMIC    ///< allow contraction/expansion within limits
+        DYNAMIC    ///< allow contraction/expansion up to max_memory_usage_, see resize_gaolette
+    };
+
+    /// @enum Page_Size
+    /// @brief Pages backing a Gaolette's memory, larger pages mean fewer TLB misses on random access
+    enum class Page_Size {
+        DEFAULT,            ///< the system's base pages
+        TRANSPARENT_HUGE,   ///< transparent huge pages, sizes are rounded up to whole huge pages
+        EXPLICIT_HUGE       ///< pages from the preallocated huge page pool, falls back to TRANSPARENT_HUGE
+    };
+
+    /// @enum Numa_Policy
+    /// @brief NUMA node a Gaolette's memory comes from, every policy is first touch on single node hosts.
+    ///
+    /// The Gaolette's tasks, copying and scrubbing its memory, run on workers of that node once the Gao process
+    /// pins its workers over several nodes, see Runtime_Options; otherwise any worker runs them.
+    enum class Numa_Policy {
+        FIRST_TOUCH,        ///< whichever node faults a page in first, the kernel's default
+        PREFERRED,          ///< numa_node_ while it has free memory, the Gaolette's tasks prefer its CPUs too
+        INTERLEAVE,         ///< round-robin over every node, for Gaolettes used from the whole machine
+        LOCAL_TO_WORKERS    ///< a node the Gao process has pinned workers on, first touch while none are pinned
     };
 
     /// @struct Perf_Spec
@@ -83,8 +128,11 @@ namespace Gao {
         // basic performance specification
         std::size_t size_;           ///< total memory delegated to the sandbox in bytes
         Memory_Policy memory_policy_;
-        std::size_t max_memory_usage_;    ///< in bytes
-        std::size_t max_cpu_cores_;
+        std::size_t max_memory_usage_;    ///< in bytes, address space reserved up front for DYNAMIC Gaolettes
+        std::size_t max_cpu_cores_;  ///< threads copying or scrubbing the Gaolette's memory at once, 0 for no cap
+        Page_Size page_size_;   ///< requested pages, the created Gaolette's perf_spec holds the ones actually used
+        Numa_Policy numa_policy_;
+        std::uint8_t numa_node_;    ///< node for Numa_Policy::PREFERRED, a node that isn't online means FIRST_TOUCH
 
         // extended process/resource limits
         /*std::size_t max_open_files_;
@@ -126,7 +174,100 @@ namespace Gao {
         Perf_Spec perf_spec;
     };
 
-    extern char **environ;
+    /// @struct Batch_Entry
+    /// @brief Outcome of a single item of create_gaolettes.
+    struct Batch_Entry {
+        Gaolette gaolette;  ///< id is -1 and state Illformed if the item failed
+        int error_code;     ///< 0 on success, otherwise a code understood by exceptions::Failed_To_Create_Gaolette
+    };
+
+    /// @struct Warm_Pool_Class
+    /// @brief Gaolette size the Gao process keeps prefaulted memory ready for.
+    ///
+    /// Creating a STATIC Gaolette of exactly size_ bytes with Page_Size::DEFAULT then takes no page faults,
+    /// destroying one scrubs its memory and hands it back to the pool.
+    struct Warm_Pool_Class {
+        std::size_t size_;      ///< Gaolette size in bytes
+        std::uint32_t count_;   ///< regions kept ready
+    };
+
+    /// @struct Runtime_Options
+    /// @brief How the Gao process runs the requests it is sent.
+    ///
+    /// The defaults run every request on the Gao process' single control loop.
+    struct Runtime_Options {
+        std::uint32_t workers_ = 0;     ///< threads requests and Gaolette memory work run on, 0 for none
+        bool pin_workers_ = false;      ///< one worker per CPU the Gao process may use, see LOCAL_TO_WORKERS
+        bool io_uring_ = false;         ///< serves the transport through io_uring, epoll where the kernel lacks it
+    };
+
+    /// @class Gaolette_Window
+    /// @brief Part of a Gaolette's memory mapped into this process, see Gaolette_Memory::map.
+    ///
+    /// Reads and writes go straight to the Gaolette's pages, the mapping is dropped on destruction.
+    class Gaolette_Window {
+        void* mapping_ = nullptr;       ///< page aligned start of the mapping
+        std::size_t mapping_size_ = 0;
+        std::byte* data_ = nullptr;     ///< the offset asked for, inside the mapping's first page
+        std::size_t size_ = 0;
+
+    public:
+        Gaolette_Window() = default;
+        Gaolette_Window(void* mapping, std::size_t mapping_size, std::size_t skew, std::size_t size) noexcept;
+        Gaolette_Window(Gaolette_Window&& other) noexcept;
+        Gaolette_Window& operator=(Gaolette_Window&& other) noexcept;
+        Gaolette_Window(const Gaolette_Window&) = delete;
+        Gaolette_Window& operator=(const Gaolette_Window&) = delete;
+        ~Gaolette_Window();
+
+        [[nodiscard]] std::byte* data() const noexcept;
+        [[nodiscard]] std::size_t size() const noexcept;
+    };
+
+    /// @class Gaolette_Memory
+    /// @brief The memfd backing a Gaolette, handed over by share_gaolette.
+    ///
+    /// Data is moved in and out of the Gaolette at memory bandwidth instead of through requests: map a window of
+    /// it, or stream into it with splice_from. The memfd stays valid once the Gaolette is destroyed, but is no
+    /// longer its memory then.
+    class Gaolette_Memory {
+        int fd_ = -1;
+        std::size_t size_ = 0;
+        bool writable_ = false;
+
+    public:
+        Gaolette_Memory() = default;
+        Gaolette_Memory(int fd, std::size_t size, bool writable) noexcept;
+        Gaolette_Memory(Gaolette_Memory&& other) noexcept;
+        Gaolette_Memory& operator=(Gaolette_Memory&& other) noexcept;
+        Gaolette_Memory(const Gaolette_Memory&) = delete;
+        Gaolette_Memory& operator=(const Gaolette_Memory&) = delete;
+        ~Gaolette_Memory();
+
+        ///@brief the memfd itself, for pread, pwrite, sendfile and the like; owned by this instance.
+        [[nodiscard]] int fd() const noexcept;
+
+        ///@brief the Gaolette's size when it was shared, resizing it later doesn't change this.
+        [[nodiscard]] std::size_t size() const noexcept;
+
+        ///@brief false for locked Gaolettes, their memfd is sealed against writes.
+        [[nodiscard]] bool writable() const noexcept;
+
+        ///@brief maps length bytes from offset, shared with the Gaolette and read-only unless writable().
+        ///
+        /// offset needs no alignment. Mapping is independent of length, pages are only faulted in as they are used.
+        /// @throws std::out_of_range if the window reaches past size().
+        /// @throws std::runtime_error if the mapping fails.
+        [[nodiscard]] Gaolette_Window map(std::size_t offset, std::size_t length) const;
+
+        ///@brief moves length bytes read from fd into the Gaolette at offset without copying them through this
+        /// process, with splice; fd may be a pipe, file or socket.
+        ///
+        /// @return bytes moved, less than length only if fd ran out first.
+        /// @throws std::out_of_range if the bytes would reach past size().
+        /// @throws std::runtime_error if the Gaolette isn't writable() or splicing fails.
+        std::size_t splice_from(int fd, std::size_t offset, std::size_t length) const;
+    };
 
     /// @class Orchestrator
     /// @brief Low-level controller for a Gao process, aka the gateway API that links Gao processes to the Gao API.
@@ -136,51 +277,155 @@ namespace Gao {
     class Orchestrator {
         pid_t pid_ = 0;
         int status_ = 0;
-        static const char* arch_;
+        static inline const char* arch_ = nullptr;
         posix_spawn_file_actions_t actions_;
         int socket_;
-        bool logging_ = false;
+        int descriptors_ = -1;      ///< SOCK_SEQPACKET socket the memfds of share_gaolette arrive on
+        std::atomic<bool> logging_ = false;
+        mutable std::atomic<std::uint32_t> request_id_ = 1;
+
+        protocol::Transport transport_ = protocol::Transport::SOCKET;
+        void* shared_ = nullptr;    ///< mapping holding the rings of the SHARED_MEMORY and EMBEDDED transports
+        int doorbells_[ring::DOORBELL_COUNT] = {-1, -1, -1, -1};
+        mutable ring::Channel channel_;
+
+        // the EMBEDDED transport's runtime thread, told to stop through embedded_hangup_; it writes to
+        // embedded_exit_ once it returned, which reads as the Gao process hanging up
+        std::thread embedded_;
+        int embedded_hangup_ = -1;
+        int embedded_exit_ = -1;
+        int embedded_descriptors_ = -1;     ///< the runtime thread's end of descriptors_
+        static inline std::atomic<bool> embedded_in_use_ = false;  ///< the runtime serves one Orchestrator per process
+
+        ///@brief creates the memfd, its mapping and the doorbells for the SHARED_MEMORY and EMBEDDED transports.
+        /// @param memfd receives the memfd to hand to the Gao process.
+        /// @param hangup_fd turns readable once the Gao process is gone, the channel stops waiting then.
+        /// @return false if any of it could not be set up, nothing is left open in that case.
+        bool open_shared_memory(int& memfd, int hangup_fd);
+
+        ///@brief serves the rings from a runtime thread in this process instead of spawning a Gao process.
+        /// @throws std::runtime_error if the Gao_Embedded library isn't linked in, already serves another
+        /// Orchestrator, or the rings or the runtime thread can't be set up; nothing is left open then.
+        void start_embedded(std::span<const Warm_Pool_Class> warm_pool, std::string_view listen_name,
+                            const Runtime_Options& runtime);
+
+        ///@brief releases everything open_shared_memory set up, safe to call more than once.
+        void close_shared_memory(int& memfd) noexcept;
+
+        static constexpr std::size_t IN_BUFFER_SIZE = 64 * 1024;
+
+        // input buffer of read_frame, every read pulls in as much as the transport has ready and bytes past a
+        // frame are kept as lookahead for the next call
+        mutable std::vector<char> in_buffer_ = std::vector<char>(IN_BUFFER_SIZE);
+        mutable std::size_t in_begin_ = 0;
+        mutable std::size_t in_end_ = 0;
+
+        ///@brief reads at least one byte from the active transport.
+        /// @return number of bytes read, 0 if the Gao process hung up.
+        /// @throws std::runtime_error on read failure.
+        std::size_t read_some(void* dst, std::size_t len) const;
+
+        ///@brief reads from the transport until at least want bytes are buffered, growing in_buffer_ if needed.
+        /// @return false if the Gao process hung up first.
+        bool fill(std::size_t want) const;
+
+        ///@brief drops n buffered bytes from the front of in_buffer_.
+        void consume(std::size_t n) const noexcept;
+
+        ///@brief whether a read would return without blocking.
+        [[nodiscard]] bool readable() const;
+
+    public:
+        /// @struct Reply
+        /// @brief A reply frame received from the Gao process.
+        struct Reply {
+            protocol::Frame_Header header;
+            std::string payload;
+        };
+
+        /// Called with the id and latest state of a Gaolette a subscription covers, see subscribe.
+        using State_Callback = std::function<void(gaolette_id_t, State)>;
+
+    private:
+        // several callers may have requests in flight at once, whoever waits for a reply
+        // reads frames off socket_ (reading_) and files other callers' replies in replies_
+        mutable std::mutex write_mutex_;
+        mutable std::mutex reply_mutex_;
+        mutable std::condition_variable reply_cv_;
+        mutable bool reading_ = false;
+        mutable std::unordered_map<std::uint32_t, Reply> replies_;  ///< arrived but not yet claimed
+        mutable std::unordered_set<std::uint32_t> discarded_;       ///< replies nobody will claim
+        // pushed state changes not yet dispatched, coalesced per Gaolette as the Gao process does: one entry per
+        // Gaolette, plus one per Gaolette that shut down before its id was reused
+        mutable std::vector<protocol::State_Change> notifications_;
+        mutable std::unordered_map<gaolette_id_t, std::size_t> notified_;  ///< id to its latest entry
+
+        // when the requests in flight were sent, by request id, so replies are timed without allocating;
+        // a slot reused before its reply arrived costs that one sample
+        struct Send_Stamp {
+            std::atomic<std::uint32_t> request_id;
+            std::atomic<std::uint64_t> sent;
+        };
+        static constexpr std::size_t SEND_STAMPS = 4096;
+        std::unique_ptr<Send_Stamp[]> send_stamps_ = std::make_unique<Send_Stamp[]>(SEND_STAMPS);
+        std::unique_ptr<stats::Histogram[]> round_trips_ =
+            std::make_unique<stats::Histogram[]>(protocol::STATS_OPCODES);    ///< by opcode
+
+        struct Subscriber {
+            std::uint64_t handle;
+            std::shared_ptr<const State_Callback> callback;
+        };
+
+        // subscribe and unsubscribe hold subscription_mutex_ through their round trip, so the SUBSCRIBE and
+        // UNSUBSCRIBE requests for a Gaolette go out in the order its subscriber list changed in
+        mutable std::mutex subscription_mutex_;
+        mutable std::uint64_t next_subscription_ = 1;
+        mutable std::unordered_map<gaolette_id_t, std::vector<Subscriber>> subscribers_;
+        mutable std::unordered_map<std::uint64_t, gaolette_id_t> subscriptions_;   ///< handle to subscribed id
+
+        // memfds read off descriptors_ by whoever waited for one, filed here until their request claims them
+        mutable std::mutex descriptor_mutex_;
+        mutable std::unordered_map<std::uint32_t, int> descriptors_received_;
+
+        ///@brief reads one frame off socket_ and files it, replies in replies_ and pushed state changes in
+        /// notifications_; reply_mutex_ must be held through lock.
+        ///
+        /// @param block whether to wait for a frame if none is readable yet.
+        /// @return whether a frame was read.
+        bool pump(std::unique_lock<std::mutex>& lock, bool block) const;
 
         static std::filesystem::path get_gao_binary();
 
-        // NOTICE improve logging, its so ass rn
+        ///@brief takes over a connected socket_, see connect.
+        explicit Orchestrator(int socket);
 
-        enum class Log_Type {
-            GENERIC_SUCCESS,
-            GENERIC_FAILURE,
-            GENERIC_NOTICE,
-            GENERIC_WARNING,
+        ///@brief reads the HELLO frame the Gao process opens every connection with.
+        /// @return whether it arrived, payload receives its payload.
+        bool await_hello(protocol::Hello_Payload& hello) const;
 
-        };
+        using Log_Type = logging::Log_Type;
 
         /// Log priority, specifies whether a log is to be printed regardless of the logging_ member
         enum class Log_Prio {
-            ONLY_IF_LOGGING, /// only if logging_ is true
-            ANY /// will always be printed if dump_logs/print_log is invoked
-        };
-
-        struct Log {
-            std::string msg;
-            std::string time;
-            Log_Type type;
-            Log_Prio prio;
-
-            explicit Log(Log_Type type, const std::string& msg_, Log_Prio p);
+            ONLY_IF_LOGGING, /// only if logging_ is true, costs nothing otherwise
+            ANY /// will always be printed, by the drainer or once dump_logs is invoked
         };
 
-        std::vector<Log> logs_;
+        mutable logging::Logger logs_;
 
-        ///@brief Add to logs_ regardless of logging_ because of Log_Prio
-        /// @param log Log object that would be added to logs_
-        void log(const Log& log);
-
-        ///@brief Dumps all logs in logs_
-        /// @param clear whether to clear logs_ after execution
-        void dump_logs(bool clear = true);
+        ///@brief Records an entry in logs_, never allocates or blocks.
+        ///
+        /// format and arguments are only formatted once drained, see logging::Logger::push for what they may be.
+        template <typename... Args>
+        void log(const Log_Type type, const Log_Prio prio, const char* format, const Args... args) const noexcept {
+            if (prio == Log_Prio::ONLY_IF_LOGGING && !logging_.load(std::memory_order_relaxed)) {
+                return;
+            }
+            logs_.push(type, format, args...);
+        }
 
         ///@brief Prints oldest log in logs_
-        ///@param clear whether to clear logs_ after execution
-        void print_log(bool clear = true);
+        void print_log() const noexcept;
 
 
     public:
@@ -189,22 +434,311 @@ namespace Gao {
         /// Initializes and modifies Gao processes on launch to ensure IPC
         /// @param terminate_with_parent whether the child process should after the death of the parent
         /// continue and become an orphan (possibly adopted by reaper) or terminate with the parent.
-        explicit Orchestrator(bool terminate_with_parent = true);
+        /// @param transport preferred transport, falls back to the socket if the Gao process can't use it.
+        /// EMBEDDED never falls back: the runtime is served from a thread of this process, see Gao_Embedded.hpp.
+        /// @param warm_pool size classes the Gao process keeps prefaulted memory ready for.
+        /// @param listen_name if not empty, further Orchestrators can connect() to the Gao process under this name.
+        /// @param runtime worker threads and I/O backend of the Gao process, see Runtime_Options.
+        /// @throws std::runtime_error if the Gao process can't be spawned or doesn't complete the handshake.
+        explicit Orchestrator(bool terminate_with_parent = true,
+                              protocol::Transport transport = protocol::Transport::SOCKET,
+                              std::span<const Warm_Pool_Class> warm_pool = {},
+                              std::string_view listen_name = {},
+                              const Runtime_Options& runtime = {});
+
+        ///@brief connects to a Gao process spawned by another Orchestrator with a listen_name.
+        ///
+        /// The Gao process and its Gaolettes are shared by everyone connected to it, it keeps running for as long
+        /// as the Orchestrator that spawned it does. Only processes of the same user can connect.
+        /// @throws std::runtime_error if nothing listens under listen_name or the handshake fails.
+        [[nodiscard]] static std::unique_ptr<Orchestrator> connect(std::string_view listen_name);
 
         /// Destructor for Orchestrator instances and Gao processes.
         ~Orchestrator();
 
-        ///@brief reads from socket_ into a buffer until either the buffer is maxed out or it hits a newline.
-        ///@return the read line as a std::string, empty string on error.
-        [[nodiscard]] std::string read_line() const;
+        ///@brief the transport negotiated with the Gao process at spawn time.
+        [[nodiscard]] protocol::Transport transport() const noexcept;
 
-        ///@brief writes a line to the Gao process via writing to socket_.
+        ///@brief turns logging of this Orchestrator's activity on or off.
         ///
-        /// @param line the line to write, a newline is appended automatically.
+        /// While on, a background thread writes entries to fd shortly after they are made. While off only failures
+        /// are recorded, they wait in a bounded buffer for dump_logs and the newest are dropped once it is full.
+        /// @param sink whether to write text lines or binary records, see logging::Binary_Record.
+        /// @throws std::system_error if the background thread can't be started.
+        void set_logging(bool enabled, logging::Sink sink = logging::Sink::TEXT, int fd = STDERR_FILENO);
+
+        ///@brief writes every recorded entry to the sink set_logging chose (text on stderr by default).
+        void dump_logs() const noexcept;
+
+        ///@brief writes a single frame (header and payload) to the Gao process in one syscall.
+        ///
+        /// @param header the frame's header, header.length bytes are taken from payload.
+        /// @param payload the frame's payload, may be nullptr if header.length is 0.
         /// @return number of bytes written, -1 on error.
-        int write_line(const std::string& line) const; // NOLINT
+        int write_frame(const protocol::Frame_Header& header, const void* payload) const;
+
+        ///@brief writes len bytes to the ring of the SHARED_MEMORY and EMBEDDED transports.
+        /// @return 0 on success, -1 if the Gao process hung up or on error.
+        int write_ring(const void* src, std::size_t len) const;
+
+        ///@brief waits for room in the ring write_ring found full. The Gao process may be waiting for room for
+        /// its replies in turn, so they are read into in_buffer_ meanwhile unless another caller is reading them.
+        /// @return false if the Gao process hung up or on error.
+        bool await_ring_space() const;
+
+        ///@brief reads exactly one frame from socket_.
+        ///
+        /// @param payload receives the frame's payload, resized to the header's length.
+        /// @return the frame's header.
+        /// @throws std::runtime_error on read failure, EOF or a malformed header.
+        protocol::Frame_Header read_frame(std::string& payload) const;
+
+        ///@brief sends a request to the Gao process without waiting for its reply.
+        ///
+        /// @param opcode command to send.
+        /// @param payload request payload, may be nullptr if length is 0.
+        /// @param length size of payload in bytes.
+        /// @return the request id to claim the reply with.
+        /// @throws std::runtime_error if the request could not be written.
+        std::uint32_t send_request(protocol::Opcode opcode, const void* payload, std::uint32_t length) const;
+
+        ///@brief blocks until the reply to request_id arrives, replies may arrive in any order.
+        ///
+        /// @param request_id id returned by send_request, each reply can only be claimed once.
+        /// @return the reply, its header's status field carries the result of the command.
+        /// @throws std::runtime_error on read failure or if the Gao process hangs up.
+        Reply wait_reply(std::uint32_t request_id) const;
+
+        ///@brief checks whether the reply to request_id has arrived, never blocks.
+        [[nodiscard]] bool reply_ready(std::uint32_t request_id) const;
+
+        ///@brief drops the reply to request_id, now or whenever it arrives.
+        void discard_reply(std::uint32_t request_id) const noexcept;
+
+        ///@brief sends a request to the Gao process and blocks until its reply arrives.
+        ///
+        /// @return the reply, see wait_reply.
+        Reply request(protocol::Opcode opcode, const void* payload, std::uint32_t length) const;
+
+        ///@brief takes the memfd the Gao process sent ahead of its reply to the SHARE request request_id.
+        ///
+        /// Only call once that reply came back OK, the memfd is there by then; the caller owns it.
+        /// @throws std::runtime_error if this Orchestrator has no descriptor socket or it fails.
+        [[nodiscard]] int take_descriptor(std::uint32_t request_id) const;
+
+        ///@brief has the Gao process push the state changes of the Gaolette id, or of every Gaolette for
+        /// protocol::ALL_GAOLETTES, instead of them being polled with fetch_state.
+        ///
+        /// The Gao process coalesces changes, callback sees the latest state of a Gaolette whenever it changed since
+        /// the last push. A subscription to a single Gaolette ends with it, after reporting State::ShutDown.
+        /// Callbacks run from dispatch_notifications, on the thread calling it.
+        /// @return handle to unsubscribe with.
+        /// @throws std::runtime_error if id doesn't name a live Gaolette or the Gao process has no room for
+        /// another subscriber.
+        std::uint64_t subscribe(gaolette_id_t id, State_Callback callback) const;
+
+        ///@brief ends a subscription, unknown or ended subscriptions are ignored.
+        void unsubscribe(std::uint64_t subscription) const;
+
+        ///@brief runs the callbacks of every state change pushed so far.
+        ///
+        /// Changes are read along with replies, they wait here until dispatched. Those of one Gaolette are coalesced
+        /// meanwhile, so at most one change per Gaolette and one per Gaolette that shut down is kept.
+        /// @param block whether to wait for at least one change if none arrived yet.
+        /// @return number of state changes dispatched.
+        /// @throws std::runtime_error on read failure or if the Gao process hangs up while blocking.
+        std::size_t dispatch_notifications(bool block = false) const;
+
+        ///@brief round trips of this Orchestrator's requests, from writing one to reading its reply.
+        [[nodiscard]] protocol::Latency_Summary round_trip_stats(protocol::Opcode opcode) const noexcept;
+
+        ///@brief what the Gao process measured since it started, shared by everyone connected to it.
+        /// @throws std::runtime_error if the Gao process fails the request.
+        [[nodiscard]] protocol::Stats_Payload fetch_stats() const;
+    };
+
+    /// @class Orchestrator_Pool
+    /// @brief Keeps Gao processes spawned and handshaken ahead of time, so acquiring one skips the spawn.
+    ///
+    /// Leased Orchestrators are never handed back, every lease gets a Gao process nobody used before.
+    /// A background thread spawns replacements as processes are leased out.
+    class Orchestrator_Pool {
+        std::size_t capacity_;
+        bool terminate_with_parent_;
+        protocol::Transport transport_;
+        std::vector<Warm_Pool_Class> warm_pool_;
+        Runtime_Options runtime_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable refill_cv_;
+        std::vector<std::unique_ptr<Orchestrator>> ready_;
+        bool stopping_ = false;
+        std::thread refiller_;
+
+        [[nodiscard]] std::unique_ptr<Orchestrator> spawn() const;
+
+        ///@brief body of refiller_, keeps ready_ at capacity_ until the pool is destroyed.
+        void refill();
+
+    public:
+        ///@brief Spawns capacity Gao processes, each configured like Orchestrator's constructor would.
+        /// @throws std::runtime_error if any of them can't be spawned, the ones already spawned are shut down.
+        explicit Orchestrator_Pool(std::size_t capacity, bool terminate_with_parent = true,
+                                   protocol::Transport transport = protocol::Transport::SOCKET,
+                                   std::span<const Warm_Pool_Class> warm_pool = {},
+                                   const Runtime_Options& runtime = {});
+
+        /// Stops the refiller and shuts down every Gao process that was never leased.
+        ~Orchestrator_Pool();
+
+        Orchestrator_Pool(const Orchestrator_Pool&) = delete;
+        Orchestrator_Pool& operator=(const Orchestrator_Pool&) = delete;
+
+        ///@brief leases a ready Orchestrator, spawning one on the spot if the pool ran dry.
+        /// @throws std::runtime_error if the pool is empty and spawning fails.
+        [[nodiscard]] std::unique_ptr<Orchestrator> acquire();
+
+        ///@brief number of Orchestrators that can be acquired without spawning.
+        [[nodiscard]] std::size_t ready() const;
     };
 
+    /// @enum Placement
+    /// @brief How an Orchestrator_Group picks the Gao process a new Gaolette lives on.
+    enum class Placement {
+        LEAST_LOADED,   ///< the process holding the fewest live Gaolettes
+        MOST_HEADROOM,  ///< the process with the fewest bytes delegated to its Gaolettes
+        HASHED          ///< consistent hash of a caller supplied key, LEAST_LOADED for Gaolettes created without one
+    };
+
+    /// @class Orchestrator_Group
+    /// @brief Several Gao processes behind one set of Gaolette functions, spreading Gaolettes across them.
+    ///
+    /// Every Gao process runs its own control loop, so control plane throughput grows with the number of shards.
+    /// Gaolettes created through the group carry a group wide id encoding the shard they live on, every later call
+    /// taking the group routes to that shard.
+    class Orchestrator_Group {
+        struct Shard {
+            std::unique_ptr<Orchestrator> orchestrator;
+            std::atomic<std::size_t> live = 0;      ///< Gaolettes placed here and not destroyed yet
+            std::atomic<std::size_t> bytes = 0;     ///< address space delegated to them
+        };
+
+        std::vector<std::unique_ptr<Shard>> shards_;
+        Placement placement_;
+
+        static constexpr int SHARD_BITS = 8;
+
+    public:
+        static constexpr std::size_t MAX_SHARDS = std::size_t{1} << SHARD_BITS;
+
+        ///@brief Spawns shards Gao processes, each configured like Orchestrator's constructor would.
+        /// @throws std::invalid_argument if shards is 0 or above MAX_SHARDS.
+        /// @throws std::runtime_error if a Gao process can't be spawned.
+        explicit Orchestrator_Group(std::size_t shards, Placement placement = Placement::LEAST_LOADED,
+                                    bool terminate_with_parent = true,
+                                    protocol::Transport transport = protocol::Transport::SOCKET,
+                                    std::span<const Warm_Pool_Class> warm_pool = {},
+                                    const Runtime_Options& runtime = {});
+
+        ///@brief Builds a group from already running Orchestrators, e.g. leased from an Orchestrator_Pool.
+        /// @throws std::invalid_argument if orchestrators is empty, larger than MAX_SHARDS or holds nullptr.
+        explicit Orchestrator_Group(std::vector<std::unique_ptr<Orchestrator>> orchestrators,
+                                    Placement placement = Placement::LEAST_LOADED);
+
+        [[nodiscard]] std::size_t size() const noexcept;
+
+        [[nodiscard]] const Orchestrator& shard(std::size_t index) const;
+
+        ///@brief shard the group's placement policy picks for a new Gaolette.
+        [[nodiscard]] std::size_t place(const Perf_Spec& spec) const noexcept;
+
+        ///@brief shard a key maps to, stable for a given group size and moving as few keys as possible across sizes.
+        [[nodiscard]] std::size_t place(std::uint64_t key) const noexcept;
+
+        ///@brief records that a Gaolette with spec was placed on (delta 1) or removed from (delta -1) a shard.
+        void account(std::size_t shard, const Perf_Spec& spec, int delta) const noexcept;
+
+        ///@brief live Gaolettes placed on a shard through this group.
+        [[nodiscard]] std::size_t load(std::size_t shard) const noexcept;
+
+        /// group wide id of the Gaolette with id local on shard.
+        /// @throws std::runtime_error if local doesn't fit next to the shard.
+        static gaolette_id_t global_id(std::size_t shard, gaolette_id_t local);
+
+        /// shard a group wide id lives on.
+        static std::size_t shard_of(gaolette_id_t id) noexcept;
+
+        /// id the Gaolette has on its shard.
+        static gaolette_id_t local_id(gaolette_id_t id) noexcept;
+    };
+
+    /// @class Pending
+    /// @brief Handle to a request in flight on an Orchestrator.
+    ///
+    /// Any number of requests may be in flight on one Orchestrator, get() returns once this one's reply
+    /// has arrived regardless of the order the Gao process answers in.
+    /// Destroying a Pending without calling get() discards its reply.
+    template <typename T>
+    class Pending {
+        const Orchestrator* gao_p_;
+        std::uint32_t request_id_;
+        std::function<T(Orchestrator::Reply&)> complete_;
+    public:
+        Pending(const Orchestrator& gao_p, std::uint32_t request_id, std::function<T(Orchestrator::Reply&)> complete);
+        Pending(Pending&& other) noexcept;
+        Pending(const Pending&) = delete;
+        Pending& operator=(const Pending&) = delete;
+        Pending& operator=(Pending&&) = delete;
+        ~Pending();
+
+        [[nodiscard]] std::uint32_t request_id() const noexcept;
+
+        ///@brief whether get() would return without blocking.
+        [[nodiscard]] bool ready() const;
+
+        ///@brief blocks until the reply arrives and decodes it, may only be called once.
+        /// @throws whatever the synchronous counterpart of the request throws.
+        T get();
+    };
+
+    template <typename T>
+    Pending<T>::Pending(const Orchestrator& gao_p, const std::uint32_t request_id,
+                        std::function<T(Orchestrator::Reply&)> complete)
+        : gao_p_(&gao_p), request_id_(request_id), complete_(std::move(complete)) {}
+
+    template <typename T>
+    Pending<T>::Pending(Pending&& other) noexcept
+        : gao_p_(other.gao_p_), request_id_(other.request_id_), complete_(std::move(other.complete_)) {
+        other.gao_p_ = nullptr;
+    }
+
+    template <typename T>
+    Pending<T>::~Pending() {
+        if (gao_p_ != nullptr) {
+            gao_p_->discard_reply(request_id_);
+        }
+    }
+
+    template <typename T>
+    std::uint32_t Pending<T>::request_id() const noexcept {
+        return request_id_;
+    }
+
+    template <typename T>
+    bool Pending<T>::ready() const {
+        return gao_p_ != nullptr && gao_p_->reply_ready(request_id_);
+    }
+
+    template <typename T>
+    T Pending<T>::get() {
+        if (gao_p_ == nullptr) {
+            throw std::logic_error("Pending::get called on a consumed request");
+        }
+        Orchestrator::Reply reply = gao_p_->wait_reply(request_id_);
+        gao_p_ = nullptr;
+        return complete_(reply);
+    }
+
     ///@brief Creates a Gaolette on the Gao process held by the gao_p Orchestrator instance.
     ///
     /// @param spec Performance specification for the Gaolette to be created.
@@ -226,6 +760,102 @@ namespace Gao {
     ///@param gao_p Orchestrator instance holding the Gao process to query the Gaolette state from.
     ///@return void, gaolette.state is updated in place.
     inline void fetch_state(Gaolette& gaolette, const Orchestrator& gao_p);
+
+    ///@brief Grows or shrinks a Memory_Policy::DYNAMIC Gaolette in place, its memory never moves.
+    ///
+    /// Shrinking hands the pages past the new size back to the system.
+    /// @param gaolette the Gaolette instance to resize, perf_spec.size_ is updated on success.
+    /// @param size new size in bytes, at most perf_spec.max_memory_usage_.
+    /// @param gao_p Orchestrator instance holding the Gao process the Gaolette lives on.
+    /// @return 0 on success, -1 on failure.
+    inline int resize_gaolette(Gaolette& gaolette, std::size_t size, const Orchestrator& gao_p);
+
+    ///@brief Creates a Gaolette sharing the memory of source copy-on-write, it starts out with source's contents.
+    ///
+    /// Takes about as long as creating an empty Gaolette, whatever source's size: the clone only gets pages of its
+    /// own once it writes to them. The first clone of a Gaolette copies the pages it touched into a shared image
+    /// once and turns it State::Locked, read-only for the rest of its life, so every clone starts from the same
+    /// contents; see fetch_state. Gaolettes backed by Page_Size::EXPLICIT_HUGE can't be cloned.
+    /// @param source the Gaolette to clone, held by gao_p.
+    /// @param gao_p Orchestrator instance holding the Gao process source lives on.
+    /// @return the clone, with source's perf_spec.
+    /// @throws exceptions::Failed_To_Create_Gaolette if cloning fails.
+    inline Gaolette clone_gaolette(const Gaolette& source, const Orchestrator& gao_p);
+
+    ///@brief Hands over the memfd backing gaolette, so its memory can be read and written without requests.
+    ///
+    /// The first share moves the Gaolette's memory into a memfd, copying the pages it touched once; from then on
+    /// the memfd is its memory, writes through a window are the Gaolette's. A locked Gaolette, see
+    /// clone_gaolette, is shared read-only. Cloning a shared Gaolette leaves the memfd to this process and gives
+    /// the Gaolette a copy to lock. Only the Orchestrator that spawned the Gao process can share, and not for
+    /// Gaolettes backed by Page_Size::EXPLICIT_HUGE.
+    /// @param gaolette the Gaolette to share, held by gao_p.
+    /// @param gao_p Orchestrator instance that spawned the Gao process gaolette lives on.
+    /// @return the memfd along with the Gaolette's current size.
+    /// @throws std::runtime_error if the Gaolette can't be shared.
+    inline Gaolette_Memory share_gaolette(const Gaolette& gaolette, const Orchestrator& gao_p);
+
+    ///@brief Asynchronous create_gaolette, the request is sent before returning.
+    ///
+    /// @return handle whose get() yields the created Gaolette instance.
+    inline Pending<Gaolette> create_gaolette_async(Perf_Spec spec, const Orchestrator& gao_p);
+
+    ///@brief Asynchronous destroy_gaolette, the request is sent before returning.
+    ///
+    /// gaolette is updated when get() is called and must outlive the returned handle.
+    /// @return handle whose get() yields 0 on success, -1 on failure.
+    inline Pending<int> destroy_gaolette_async(Gaolette& gaolette, const Orchestrator& gao_p);
+
+    ///@brief Asynchronous fetch_state, the request is sent before returning.
+    ///
+    /// gaolette.state is updated when get() is called, gaolette must outlive the returned handle.
+    inline Pending<void> fetch_state_async(Gaolette& gaolette, const Orchestrator& gao_p);
+
+    ///@brief Creates one Gaolette per spec in a single round trip, the Gao process maps the whole batch at once.
+    ///
+    /// Batches larger than protocol::MAX_BATCH are split into several requests that are all in flight together.
+    /// @param specs Performance specifications of the Gaolettes to be created.
+    /// @param gao_p Orchestrator instance holding the Gao process to create the Gaolettes on.
+    /// @return one entry per spec, in the same order; a failed item does not fail the batch.
+    inline std::vector<Batch_Entry> create_gaolettes(std::span<const Perf_Spec> specs, const Orchestrator& gao_p);
+
+    ///@brief Destroys every Gaolette in gaolettes in a single round trip.
+    ///
+    /// Destroyed Gaolettes are updated in place like destroy_gaolette does.
+    /// @param gaolettes the Gaolette instances to destroy.
+    /// @param gao_p Orchestrator instance holding the Gao process to destroy the Gaolettes on.
+    /// @return one code per Gaolette, in the same order; 0 on success, otherwise the protocol::Status of the failure.
+    inline std::vector<int> destroy_gaolettes(std::span<Gaolette> gaolettes, const Orchestrator& gao_p);
+
+    ///@brief Creates a Gaolette on the shard of group picked by its placement policy.
+    ///
+    /// @return the created Gaolette instance, its id is group wide.
+    /// @throws exceptions::Failed_To_Create_Gaolette if creation fails.
+    inline Gaolette create_gaolette(Perf_Spec spec, const Orchestrator_Group& group);
+
+    ///@brief Creates a Gaolette on the shard key hashes to, so related Gaolettes can be kept together.
+    inline Gaolette create_gaolette(Perf_Spec spec, const Orchestrator_Group& group, std::uint64_t key);
+
+    ///@brief destroy_gaolette routed to the shard gaolette lives on.
+    inline int destroy_gaolette(Gaolette& gaolette, const Orchestrator_Group& group);
+
+    ///@brief fetch_state routed to the shard gaolette lives on.
+    inline void fetch_state(Gaolette& gaolette, const Orchestrator_Group& group);
+
+    ///@brief resize_gaolette routed to the shard gaolette lives on.
+    inline int resize_gaolette(Gaolette& gaolette, std::size_t size, const Orchestrator_Group& group);
+
+    ///@brief clone_gaolette on the shard source lives on, the clone's id is group wide.
+    inline Gaolette clone_gaolette(const Gaolette& source, const Orchestrator_Group& group);
+
+    ///@brief share_gaolette routed to the shard gaolette lives on.
+    inline Gaolette_Memory share_gaolette(const Gaolette& gaolette, const Orchestrator_Group& group);
+
+    ///@brief create_gaolettes spread over the shards of group, every shard's batch is in flight at the same time.
+    inline std::vector<Batch_Entry> create_gaolettes(std::span<const Perf_Spec> specs, const Orchestrator_Group& group);
+
+    ///@brief destroy_gaolettes routed to the shards the Gaolettes live on, all shards work at the same time.
+    inline std::vector<int> destroy_gaolettes(std::span<Gaolette> gaolettes, const Orchestrator_Group& group);
 }
 
 #endif //GAO_HPP
@@ -0,0 +1,48 @@
+//
+// Created by David Yang on 2026-10-17.
+//
+
+#ifndef GAO_EMBEDDED_HPP
+#define GAO_EMBEDDED_HPP
+
+#include <cstdint>
+
+#include "Gao_Ring.hpp"
+
+/// @brief Entry point of a Gao runtime linked into the Orchestrator's own process.
+///
+/// An Orchestrator built with Transport::EMBEDDED skips the spawn: it sets up the same rings as for
+/// Transport::SHARED_MEMORY in its own memory and serves them from a thread that calls gao_embedded_run.
+/// The runtime is only there when the program links the Gao_Embedded library, otherwise gao_embedded_run
+/// stays null and the Orchestrator refuses the transport.
+///
+/// Shared with the Gao runtime, nothing in here allocates or throws.
+namespace Gao::embedded {
+    /// @brief A size class the runtime keeps prefaulted memory ready for, see Warm_Pool_Class.
+    struct Warm_Class {
+        std::uint64_t size;
+        std::uint32_t count;
+    };
+
+    /// @brief Everything a hosted runtime is handed instead of descriptors and command line arguments.
+    struct Options {
+        ring::Shared_Block* block;              ///< rings initialized by the Orchestrator
+        int doorbells[ring::DOORBELL_COUNT];    ///< ordered as the *_FILENO constants
+        int hangup_fd;                          ///< eventfd the Orchestrator writes to once it is done
+        int descriptor_fd;                      ///< SOCK_SEQPACKET socket memfds are shared over, see SHARE
+        const char* listen_name;                ///< nullptr, or the name further Orchestrators connect() to
+        const Warm_Class* warm_pool;
+        std::uint32_t warm_pool_count;
+        std::uint32_t workers;                  ///< worker threads, see Runtime_Options
+        bool pin_workers;                       ///< one per CPU the runtime thread may run on
+        bool io_uring;                          ///< waits on the doorbells through io_uring instead of epoll
+    };
+}
+
+/// @brief Serves options->block on the calling thread until options->hangup_fd turns readable.
+/// Only one runtime runs per process, a second caller is turned away while the first one serves.
+/// Defined by the Gao_Embedded library, null unless it is linked in.
+/// @return 0 once the Orchestrator hung up, -1 if the runtime is busy or can't be set up.
+extern "C" int gao_embedded_run(const Gao::embedded::Options* options) noexcept __attribute__((weak));
+
+#endif //GAO_EMBEDDED_HPP
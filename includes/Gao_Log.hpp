@@ -0,0 +1,439 @@
+//
+// Created by David Yang on 2026-10-17.
+//
+
+#ifndef GAO_LOG_HPP
+#define GAO_LOG_HPP
+
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+
+/// @brief Asynchronous logging for the Orchestrator.
+///
+/// Entries are compact binary records pushed into a bounded lock-free ring: a timestamp, a type, a format string and
+/// up to MAX_ARGS scalar arguments. Nothing is formatted or allocated when an entry is made, a background drainer (or
+/// whoever calls drain) turns the records into text or binary output later. Entries made while the ring is full are
+/// dropped and counted instead of blocking.
+namespace Gao::logging {
+    constexpr std::size_t DEFAULT_CAPACITY = 512;   ///< records in the ring, must be a power of two
+    constexpr std::uint32_t MAX_ARGS = 4;           ///< arguments a record carries, extra ones are ignored
+    constexpr std::size_t LINE_SIZE = 512;          ///< longest formatted entry, longer ones are cut
+    constexpr std::size_t OUT_BUFFER_SIZE = 16 * 1024;
+
+    enum class Log_Type : std::uint8_t {
+        GENERIC_SUCCESS,
+        GENERIC_FAILURE,
+        GENERIC_NOTICE,
+        GENERIC_WARNING,
+    };
+
+    /// What the drainer writes.
+    enum class Sink : std::uint8_t {
+        TEXT,   ///< one line per entry, colored if the descriptor is a terminal
+        BINARY  ///< a Binary_Record per entry followed by its format and string arguments, see Binary_Record
+    };
+
+    enum class Arg_Kind : std::uint8_t {
+        NONE,
+        SIGNED,
+        UNSIGNED,
+        FLOAT,
+        STRING  ///< a const char* that outlives the entry, i.e. a string literal
+    };
+
+    /// @struct Record
+    /// @brief A log entry as it sits in the ring, formatted only once it is drained.
+    struct Record {
+        std::uint64_t time;                 ///< CLOCK_REALTIME in nanoseconds
+        const char* format;                 ///< "{}" is replaced by the next argument
+        std::uint64_t args[MAX_ARGS];       ///< bit patterns of the arguments, see kinds
+        Arg_Kind kinds[MAX_ARGS];
+        Log_Type type;
+        std::uint8_t count;
+    };
+
+    /// @struct Binary_Record
+    /// @brief Header of an entry written to a BINARY sink.
+    ///
+    /// Followed by format_length bytes of format, then the bytes of every STRING argument, whose args slot holds its
+    /// length instead of a pointer. All fields are in host byte order.
+    struct Binary_Record {
+        std::uint64_t time;
+        std::uint64_t args[MAX_ARGS];
+        Log_Type type;
+        std::uint8_t count;
+        Arg_Kind kinds[MAX_ARGS];
+        std::uint16_t format_length;
+    };
+
+    static_assert(sizeof(Binary_Record) == 48, "Binary_Record layout is part of the BINARY sink format");
+
+    /// @class Logger
+    /// @brief Bounded multi-producer ring of Records with a single consumer at a time.
+    ///
+    /// push never blocks, locks or allocates; the ring and the output buffer are allocated up front.
+    class Logger {
+        // slot of the ring, sequence tells producers and the consumer whose turn it is (Vyukov's bounded queue)
+        struct alignas(64) Cell {
+            std::atomic<std::uint64_t> sequence;
+            Record record;
+        };
+
+        static constexpr std::uint32_t IDLE = 0;
+        static constexpr std::uint32_t ASLEEP = 1;      // the drainer waits for a push to wake it
+        static constexpr std::uint32_t STOPPING = 2;
+
+        std::unique_ptr<Cell[]> cells_;
+        std::uint64_t mask_;
+        alignas(64) std::atomic<std::uint64_t> head_ = 0;   ///< records ever claimed by producers
+        alignas(64) std::atomic<std::uint32_t> drainer_state_ = IDLE;
+        std::atomic<std::uint64_t> dropped_ = 0;
+
+        // consumer side, guarded by drain_mutex_ so the drainer and explicit drains take turns
+        std::mutex drain_mutex_;
+        std::uint64_t tail_ = 0;
+        std::unique_ptr<char[]> out_;
+        std::size_t out_length_ = 0;
+        Sink sink_ = Sink::TEXT;
+        int fd_ = STDERR_FILENO;
+        bool colored_ = false;
+        std::thread drainer_;
+
+        template <typename T>
+        static void encode(const T value, std::uint64_t& arg, Arg_Kind& kind) noexcept {
+            if constexpr (std::is_same_v<T, bool>) {
+                arg = value;
+                kind = Arg_Kind::UNSIGNED;
+            } else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+                if constexpr (std::is_signed_v<T>) {
+                    arg = static_cast<std::uint64_t>(static_cast<std::int64_t>(value));
+                    kind = Arg_Kind::SIGNED;
+                } else {
+                    arg = static_cast<std::uint64_t>(value);
+                    kind = Arg_Kind::UNSIGNED;
+                }
+            } else if constexpr (std::is_floating_point_v<T>) {
+                arg = std::bit_cast<std::uint64_t>(static_cast<double>(value));
+                kind = Arg_Kind::FLOAT;
+            } else {
+                static_assert(std::is_convertible_v<T, const char*>, "log arguments must be scalars or literals");
+                arg = reinterpret_cast<std::uint64_t>(static_cast<const char*>(value));
+                kind = Arg_Kind::STRING;
+            }
+        }
+
+        static const char* label(const Log_Type type) noexcept {
+            switch (type) {
+                case Log_Type::GENERIC_SUCCESS: return "SUCCESS";
+                case Log_Type::GENERIC_FAILURE: return "FAILURE";
+                case Log_Type::GENERIC_NOTICE:  return "NOTICE";
+                case Log_Type::GENERIC_WARNING: return "WARNING";
+            }
+            return "?";
+        }
+
+        // same escapes as the colors namespace, which isn't usable from a noexcept drainer as it holds std::strings
+        static const char* color(const Log_Type type) noexcept {
+            switch (type) {
+                case Log_Type::GENERIC_SUCCESS: return "\033[32m\033[1m";
+                case Log_Type::GENERIC_FAILURE: return "\033[31m\033[1m";
+                case Log_Type::GENERIC_NOTICE:  return "\033[34m\033[1m";
+                case Log_Type::GENERIC_WARNING: return "\033[33m\033[1m";
+            }
+            return "";
+        }
+
+        void flush() noexcept {
+            std::size_t written = 0;
+            while (written < out_length_) {
+                const ssize_t n = ::write(fd_, out_.get() + written, out_length_ - written);
+                if (n <= 0) {
+                    if (n == -1 && errno == EINTR) {
+                        continue;
+                    }
+                    break;  // nowhere to report it, the entries are lost
+                }
+                written += static_cast<std::size_t>(n);
+            }
+            out_length_ = 0;
+        }
+
+        // reserves n bytes of out_, flushing first if they don't fit
+        char* reserve(const std::size_t n) noexcept {
+            if (OUT_BUFFER_SIZE - out_length_ < n) {
+                flush();
+            }
+            char* at = out_.get() + out_length_;
+            out_length_ += n;
+            return at;
+        }
+
+        void write_text(const Record& record) noexcept {
+            char line[LINE_SIZE];
+            std::size_t length = 0;
+            const auto append = [&](const char* text, std::size_t n) {
+                n = n < LINE_SIZE - 1 - length ? n : LINE_SIZE - 1 - length;
+                std::memcpy(line + length, text, n);
+                length += n;
+            };
+            const auto append_number = [&](const char* format, auto value) {
+                const int n = std::snprintf(line + length, LINE_SIZE - length, format, value);
+                if (n > 0) {
+                    length += static_cast<std::size_t>(n) < LINE_SIZE - 1 - length
+                                  ? static_cast<std::size_t>(n) : LINE_SIZE - 1 - length;
+                }
+            };
+
+            const std::time_t seconds = static_cast<std::time_t>(record.time / 1000000000);
+            std::tm local{};
+            ::localtime_r(&seconds, &local);
+            length = std::strftime(line, LINE_SIZE, "%Y-%m-%d %H:%M:%S", &local);
+            append_number(".%06u [", static_cast<unsigned>(record.time % 1000000000 / 1000));
+            if (colored_) {
+                append(color(record.type), std::strlen(color(record.type)));
+            }
+            append(label(record.type), std::strlen(label(record.type)));
+            if (colored_) {
+                append("\033[0m", 4);
+            }
+            append("] ", 2);
+
+            std::uint32_t next = 0;
+            for (const char* c = record.format; *c != '\0'; ++c) {
+                if (c[0] != '{' || c[1] != '}' || next >= record.count) {
+                    append(c, 1);
+                    continue;
+                }
+                const std::uint64_t arg = record.args[next];
+                switch (record.kinds[next++]) {
+                    case Arg_Kind::SIGNED:
+                        append_number("%lld", static_cast<long long>(static_cast<std::int64_t>(arg)));
+                        break;
+                    case Arg_Kind::UNSIGNED:
+                        append_number("%llu", static_cast<unsigned long long>(arg));
+                        break;
+                    case Arg_Kind::FLOAT:
+                        append_number("%g", std::bit_cast<double>(arg));
+                        break;
+                    case Arg_Kind::STRING: {
+                        const auto* text = reinterpret_cast<const char*>(arg);
+                        append(text, std::strlen(text));
+                        break;
+                    }
+                    case Arg_Kind::NONE:
+                        break;
+                }
+                ++c;
+            }
+            line[length++] = '\n';
+            std::memcpy(reserve(length), line, length);
+        }
+
+        void write_binary(const Record& record) noexcept {
+            Binary_Record header{};
+            header.time = record.time;
+            header.type = record.type;
+            header.count = record.count;
+            const std::size_t format_length = std::strlen(record.format);
+            header.format_length = static_cast<std::uint16_t>(format_length < UINT16_MAX ? format_length : UINT16_MAX);
+            std::size_t total = sizeof(header) + header.format_length;
+            for (std::uint32_t i = 0; i < record.count; ++i) {
+                header.kinds[i] = record.kinds[i];
+                header.args[i] = record.args[i];
+                if (record.kinds[i] == Arg_Kind::STRING) {
+                    header.args[i] = std::strlen(reinterpret_cast<const char*>(record.args[i]));
+                    total += header.args[i];
+                }
+            }
+            if (total > OUT_BUFFER_SIZE) {
+                return;     // only possible with absurd literals, dropping it keeps the stream parseable
+            }
+
+            char* at = reserve(total);
+            std::memcpy(at, &header, sizeof(header));
+            at += sizeof(header);
+            std::memcpy(at, record.format, header.format_length);
+            at += header.format_length;
+            for (std::uint32_t i = 0; i < record.count; ++i) {
+                if (record.kinds[i] == Arg_Kind::STRING) {
+                    std::memcpy(at, reinterpret_cast<const char*>(record.args[i]), header.args[i]);
+                    at += header.args[i];
+                }
+            }
+        }
+
+        // drain_mutex_ must be held
+        std::size_t drain_locked(const std::size_t max) noexcept {
+            std::size_t drained = 0;
+            if (const std::uint64_t dropped = dropped_.exchange(0, std::memory_order_relaxed); dropped != 0) {
+                Record note{};
+                note.time = now();
+                note.format = "{} log entries dropped, the log ring was full";
+                note.type = Log_Type::GENERIC_WARNING;
+                note.count = 1;
+                encode(dropped, note.args[0], note.kinds[0]);
+                sink_ == Sink::TEXT ? write_text(note) : write_binary(note);
+            }
+            while (drained < max) {
+                Cell& cell = cells_[tail_ & mask_];
+                if (cell.sequence.load(std::memory_order_acquire) != tail_ + 1) {
+                    break;  // empty, or the next producer hasn't finished its record yet
+                }
+                const Record record = cell.record;
+                cell.sequence.store(tail_ + mask_ + 1, std::memory_order_release);
+                ++tail_;
+                ++drained;
+                sink_ == Sink::TEXT ? write_text(record) : write_binary(record);
+            }
+            flush();
+            return drained;
+        }
+
+        [[nodiscard]] bool ready() const noexcept {
+            return cells_[tail_ & mask_].sequence.load(std::memory_order_acquire) == tail_ + 1;
+        }
+
+        void run() noexcept {
+            std::unique_lock lock(drain_mutex_);
+            while (true) {
+                if (drain_locked(SIZE_MAX) != 0) {
+                    continue;
+                }
+                // announce we are about to sleep, then look again so a concurrent push can't be missed
+                std::uint32_t state = IDLE;
+                if (!drainer_state_.compare_exchange_strong(state, ASLEEP, std::memory_order_seq_cst)) {
+                    break;  // STOPPING
+                }
+                if (ready()) {
+                    state = ASLEEP;
+                    drainer_state_.compare_exchange_strong(state, IDLE, std::memory_order_seq_cst);
+                    continue;
+                }
+                lock.unlock();
+                drainer_state_.wait(ASLEEP, std::memory_order_seq_cst);
+                lock.lock();
+                if (drainer_state_.load(std::memory_order_relaxed) == STOPPING) {
+                    break;
+                }
+            }
+            drain_locked(SIZE_MAX);
+        }
+
+    public:
+        /// @param capacity records the ring holds, rounded up to a power of two.
+        explicit Logger(const std::size_t capacity = DEFAULT_CAPACITY)
+            : cells_(std::make_unique<Cell[]>(std::bit_ceil(capacity))), mask_(std::bit_ceil(capacity) - 1),
+              out_(std::make_unique<char[]>(OUT_BUFFER_SIZE)) {
+            for (std::uint64_t i = 0; i <= mask_; ++i) {
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        Logger(const Logger&) = delete;
+        Logger& operator=(const Logger&) = delete;
+
+        ~Logger() {
+            stop();
+        }
+
+        static std::uint64_t now() noexcept {
+            timespec time{};
+            ::clock_gettime(CLOCK_REALTIME, &time);
+            return static_cast<std::uint64_t>(time.tv_sec) * 1000000000 + static_cast<std::uint64_t>(time.tv_nsec);
+        }
+
+        /// @brief Records an entry, format is kept by pointer and must outlive it, as must STRING arguments.
+        /// @return false if the ring was full and the entry was dropped.
+        template <typename... Args>
+        bool push(const Log_Type type, const char* format, const Args... args) noexcept {
+            std::uint64_t position = head_.load(std::memory_order_relaxed);
+            Cell* cell;
+            while (true) {
+                cell = &cells_[position & mask_];
+                const std::uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+                const auto difference = static_cast<std::int64_t>(sequence - position);
+                if (difference == 0) {
+                    if (head_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (difference < 0) {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                } else {
+                    position = head_.load(std::memory_order_relaxed);
+                }
+            }
+
+            Record& record = cell->record;
+            record.time = now();
+            record.format = format;
+            record.type = type;
+            record.count = 0;
+            const auto add = [&record](const auto arg) noexcept {
+                if (record.count < MAX_ARGS) {
+                    encode(arg, record.args[record.count], record.kinds[record.count]);
+                    ++record.count;
+                }
+            };
+            (add(args), ...);
+            cell->sequence.store(position + 1, std::memory_order_release);
+
+            if (drainer_state_.load(std::memory_order_seq_cst) == ASLEEP) {
+                std::uint32_t state = ASLEEP;
+                if (drainer_state_.compare_exchange_strong(state, IDLE, std::memory_order_seq_cst)) {
+                    drainer_state_.notify_one();
+                }
+            }
+            return true;
+        }
+
+        /// @brief Sets where entries are written, also used by drain while no drainer runs.
+        void set_sink(const Sink sink, const int fd) noexcept {
+            std::lock_guard lock(drain_mutex_);
+            flush();
+            sink_ = sink;
+            fd_ = fd;
+            colored_ = sink == Sink::TEXT && ::isatty(fd) == 1;
+        }
+
+        /// @brief Formats and writes up to max entries on the calling thread.
+        /// @return entries written.
+        std::size_t drain(const std::size_t max = SIZE_MAX) noexcept {
+            std::lock_guard lock(drain_mutex_);
+            return drain_locked(max);
+        }
+
+        /// @brief Starts the background drainer, entries are then written shortly after they are made.
+        /// @throws std::system_error if the thread can't be started.
+        void start() {
+            if (drainer_.joinable()) {
+                return;
+            }
+            drainer_state_.store(IDLE, std::memory_order_relaxed);
+            drainer_ = std::thread(&Logger::run, this);
+        }
+
+        /// @brief Stops the background drainer after it wrote every entry made so far.
+        void stop() noexcept {
+            if (!drainer_.joinable()) {
+                return;
+            }
+            drainer_state_.store(STOPPING, std::memory_order_seq_cst);
+            drainer_state_.notify_one();
+            drainer_.join();
+        }
+    };
+}
+
+#endif //GAO_LOG_HPP
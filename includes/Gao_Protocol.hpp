@@ -0,0 +1,270 @@
+//
+// Created by David Yang on 2026-10-17.
+//
+
+#ifndef GAO_PROTOCOL_HPP
+#define GAO_PROTOCOL_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+/// @brief Binary wire format spoken between the Orchestrator and the Gao runtime's Comm.
+///
+/// Every message is a fixed size Frame_Header followed by exactly `length` bytes of payload.
+/// Both ends always live on the same host, so all fields are in host byte order.
+///
+/// This header is shared with the Gao runtime and must not pull in anything that allocates or throws.
+namespace Gao::protocol {
+    constexpr std::uint16_t MAGIC = 0x4761;             ///< "Ga"
+    constexpr std::uint8_t VERSION = 1;
+    constexpr std::uint32_t MAX_PAYLOAD = 1u << 20;     ///< frames larger than this are rejected
+    constexpr std::uint32_t MAX_BATCH = 16384;          ///< items carried by a single batch request
+    constexpr std::int32_t ALL_GAOLETTES = -1;          ///< SUBSCRIBE/UNSUBSCRIBE id covering every Gaolette
+
+    /// @enum Opcode
+    /// @brief Command carried by a frame, replies echo the opcode of their request.
+    enum class Opcode : std::uint16_t {
+        CREATE = 1,     ///< payload: Perf_Spec_Payload, reply: Created_Payload
+        DESTROY = 2,    ///< payload: Id_Payload, reply: empty
+        GET_STATE = 3,  ///< payload: Id_Payload, reply: State_Payload
+        CREATE_BATCH = 4,   ///< payload: up to MAX_BATCH Perf_Spec_Payload, reply: one Batch_Result per item
+        DESTROY_BATCH = 5,  ///< payload: up to MAX_BATCH Id_Payload, reply: one Batch_Result per item
+        HELLO = 6,          ///< sent once by the Gao process over the socket on startup, payload: Hello_Payload
+        RESIZE = 7,         ///< payload: Resize_Payload, reply: empty, only valid for Memory_Policy::DYNAMIC
+        SUBSCRIBE = 8,      ///< payload: Id_Payload or ALL_GAOLETTES, reply: empty; STATE_CHANGED frames follow
+        UNSUBSCRIBE = 9,    ///< payload: Id_Payload or ALL_GAOLETTES, reply: empty
+        STATE_CHANGED = 10, ///< sent unasked to subscribers, request_id 0, payload: one State_Change per Gaolette
+        GET_STATS = 11,     ///< payload: empty, reply: Stats_Payload
+        CLONE = 12,         ///< payload: Id_Payload of the source, reply: Created_Payload of the copy-on-write clone
+        SHARE = 13,         ///< payload: Id_Payload, reply: Shared_Payload; the memfd comes as a Descriptor_Message
+    };
+
+    /// Opcode values statistics are kept for, per opcode arrays are indexed by the opcode's value.
+    constexpr std::uint32_t STATS_OPCODES = 16;
+
+    /// Descriptor the Gao process finds its end of a SOCK_SEQPACKET socketpair on when started with DESCRIPTOR_FLAG.
+    /// Memfds the host asked for with SHARE arrive on the host's end, one Descriptor_Message each.
+    constexpr int DESCRIPTOR_FILENO = 8;
+    constexpr const char* DESCRIPTOR_FLAG = "--descriptors";
+
+    /// @enum Transport
+    /// @brief How frames travel between the Orchestrator and the Gao process.
+    enum class Transport : std::uint8_t {
+        SOCKET = 0,         ///< the AF_UNIX socketpair set up at spawn time
+        SHARED_MEMORY = 1,  ///< memfd backed rings, see Gao_Ring.hpp
+        EMBEDDED = 2        ///< the same rings served by a runtime thread in the Orchestrator's process, no HELLO
+    };
+
+    /// @enum Frame_Flags
+    /// @brief Bit flags carried in Frame_Header::flags.
+    enum Frame_Flags : std::uint8_t {
+        FLAG_REPLY = 1 << 0 ///< frame is a reply to the request with the same request_id
+    };
+
+    /// @enum Status
+    /// @brief Result carried in Frame_Header::status of a reply, always OK in requests.
+    ///
+    /// Values 1-3 match the codes understood by exceptions::Failed_To_Create_Gaolette.
+    enum class Status : std::uint16_t {
+        OK = 0,
+        INVALID_SPEC = 1,       ///< invalid performance specification
+        NO_RESOURCES = 2,       ///< insufficient system resources
+        PERMISSION_DENIED = 3,
+        UNKNOWN_GAOLETTE = 4,   ///< the referenced gaolette id does not exist
+        BAD_REQUEST = 5,        ///< malformed frame or unknown opcode
+        UNSUPPORTED_VERSION = 6
+    };
+
+    /// @enum State_Code
+    /// @brief Wire representation of Gao::State, values match its declaration order.
+    enum class State_Code : std::uint8_t {
+        OPERATIONAL = 0,
+        SHUT_DOWN = 1,
+        LOCKED = 2,
+        OPERATING = 3,
+        ILLFORMED = 4
+    };
+
+    /// @enum Memory_Policy_Code
+    /// @brief Wire representation of Gao::Memory_Policy, values match its declaration order.
+    enum class Memory_Policy_Code : std::uint8_t {
+        STATIC = 0,
+        DYNAMIC = 1     ///< address space up to max_memory_usage is reserved, only size bytes are accessible
+    };
+
+    /// @enum Page_Size_Code
+    /// @brief Wire representation of Gao::Page_Size, values match its declaration order.
+    enum class Page_Size_Code : std::uint8_t {
+        DEFAULT = 0,
+        TRANSPARENT_HUGE = 1,   ///< regular mapping advised with MADV_HUGEPAGE
+        EXPLICIT_HUGE = 2       ///< MAP_HUGETLB mapping from the preallocated huge page pool
+    };
+
+    /// @enum Numa_Policy_Code
+    /// @brief Wire representation of Gao::Numa_Policy, values match its declaration order.
+    enum class Numa_Policy_Code : std::uint8_t {
+        FIRST_TOUCH = 0,
+        PREFERRED = 1,          ///< pages come from numa_node while it has free memory
+        INTERLEAVE = 2,         ///< pages are spread round-robin over every online node
+        LOCAL_TO_WORKERS = 3    ///< pages come from the node of the workers running the Gaolette's tasks
+    };
+
+    /// @struct Frame_Header
+    /// @brief Fixed size header preceding every payload.
+    struct Frame_Header {
+        std::uint16_t magic;
+        std::uint8_t version;
+        std::uint8_t flags;
+        std::uint16_t opcode;
+        std::uint16_t status;
+        std::uint32_t length;       ///< payload length in bytes, excluding the header
+        std::uint32_t request_id;   ///< chosen by the sender of a request, echoed verbatim in the reply
+    };
+
+    /// @struct Perf_Spec_Payload
+    /// @brief Packed form of Gao::Perf_Spec.
+    struct Perf_Spec_Payload {
+        std::uint64_t size;
+        std::uint64_t max_memory_usage;
+        std::uint32_t max_cpu_cores;
+        std::uint8_t memory_policy;     ///< a Memory_Policy_Code
+        std::uint8_t page_size;         ///< a Page_Size_Code, the runtime falls back to smaller pages if needed
+        std::uint8_t numa_policy;       ///< a Numa_Policy_Code, ignored on single node hosts
+        std::uint8_t numa_node;         ///< node of Numa_Policy_Code::PREFERRED
+    };
+
+    /// @struct Id_Payload
+    /// @brief Payload naming a single Gaolette.
+    struct Id_Payload {
+        std::int32_t id;
+    };
+
+    /// @struct Created_Payload
+    /// @brief Reply to CREATE and CLONE.
+    struct Created_Payload {
+        std::int32_t id;
+        std::uint8_t page_size;     ///< Page_Size_Code actually backing the Gaolette
+        std::uint8_t reserved[3];
+    };
+
+    /// @struct Shared_Payload
+    /// @brief Reply to SHARE, describing the memfd sent ahead of it.
+    struct Shared_Payload {
+        std::uint64_t size;         ///< accessible bytes at the start of the memfd, the Gaolette's size
+        std::uint8_t writable;      ///< 0 for a locked Gaolette, whose memfd is sealed against writes
+        std::uint8_t reserved[7];
+    };
+
+    /// @struct Descriptor_Message
+    /// @brief Sent over the descriptor socket with a memfd attached as SCM_RIGHTS, before the reply it belongs to.
+    struct Descriptor_Message {
+        std::uint32_t request_id;   ///< of the SHARE request
+    };
+
+    /// @struct State_Payload
+    /// @brief Payload carrying a State_Code.
+    struct State_Payload {
+        std::uint8_t state;
+        std::uint8_t reserved[3];
+    };
+
+    /// @struct Hello_Payload
+    /// @brief Transport the Gao process attached to, every later frame travels over it.
+    struct Hello_Payload {
+        std::uint8_t transport;
+        std::uint8_t reserved[3];
+    };
+
+    /// @struct Resize_Payload
+    /// @brief Payload growing or shrinking a DYNAMIC Gaolette in place.
+    struct Resize_Payload {
+        std::int32_t id;
+        std::uint32_t reserved;
+        std::uint64_t size;     ///< new size in bytes, at most the Gaolette's max_memory_usage
+    };
+
+    /// @struct State_Change
+    /// @brief Latest state of a Gaolette a STATE_CHANGED frame reports on.
+    ///
+    /// Transitions are coalesced, a Gaolette that changed several times since the last frame appears once.
+    /// A subscription to a single Gaolette ends with the Gaolette, after reporting State_Code::SHUT_DOWN.
+    struct State_Change {
+        std::int32_t id;
+        std::uint8_t state;     ///< a State_Code
+        std::uint8_t reserved[3];
+    };
+
+    /// @struct Batch_Result
+    /// @brief Outcome of a single item of a batch request.
+    struct Batch_Result {
+        std::int32_t id;        ///< id of the created/destroyed Gaolette, -1 if the item failed
+        std::uint16_t status;   ///< Status of this item
+        std::uint8_t page_size; ///< Page_Size_Code actually backing a created Gaolette
+        std::uint8_t reserved;
+    };
+
+    /// @struct Latency_Summary
+    /// @brief Distribution of the latencies of one operation, in nanoseconds.
+    ///
+    /// Percentiles are read off a log-linear histogram and overstate the exact value by at most 1/16th.
+    struct Latency_Summary {
+        std::uint64_t count;
+        std::uint64_t total_ns;     ///< sum of every sample, total_ns / count is the mean
+        std::uint64_t min_ns;
+        std::uint64_t max_ns;
+        std::uint64_t p50_ns;
+        std::uint64_t p99_ns;
+        std::uint64_t p999_ns;
+    };
+
+    /// @struct Stats_Payload
+    /// @brief Reply to GET_STATS, everything the Gao process measured since it started.
+    struct Stats_Payload {
+        Latency_Summary queue[STATS_OPCODES];       ///< from a request being read until it starts executing
+        Latency_Summary execute[STATS_OPCODES];     ///< from a request starting to execute until its reply is out
+        Latency_Summary map;                        ///< sectioning off memory for a Gaolette, mmap or commit
+        Latency_Summary unmap;                      ///< releasing a Gaolette's memory, munmap or decommit
+        std::uint64_t requests;                     ///< frames received
+        std::uint64_t failures;                     ///< replies carrying a Status other than OK
+        std::uint64_t offloaded;                    ///< requests run on a worker instead of the control loop
+    };
+
+    static_assert(sizeof(Frame_Header) == 16);
+    static_assert(sizeof(Perf_Spec_Payload) == 24);
+    static_assert(sizeof(Id_Payload) == 4);
+    static_assert(sizeof(Created_Payload) == 8);
+    static_assert(sizeof(State_Payload) == 4);
+    static_assert(sizeof(Shared_Payload) == 16);
+    static_assert(sizeof(Descriptor_Message) == 4);
+    static_assert(sizeof(Batch_Result) == 8);
+    static_assert(sizeof(Hello_Payload) == 4);
+    static_assert(sizeof(Resize_Payload) == 16);
+    static_assert(sizeof(State_Change) == 8);
+    static_assert(sizeof(Latency_Summary) == 56);
+    static_assert(sizeof(Stats_Payload) <= MAX_PAYLOAD);
+    static_assert(MAX_BATCH * sizeof(Perf_Spec_Payload) <= MAX_PAYLOAD);
+
+    /// @brief Builds the header for a frame.
+    constexpr Frame_Header make_header(Opcode opcode, std::uint32_t request_id, std::uint32_t length,
+                                       std::uint8_t flags = 0, Status status = Status::OK) noexcept {
+        return Frame_Header{MAGIC, VERSION, flags, static_cast<std::uint16_t>(opcode),
+                            static_cast<std::uint16_t>(status), length, request_id};
+    }
+
+    /// @brief Checks magic, version and length of a received header.
+    /// @return Status::OK if the header can be processed.
+    constexpr Status validate(const Frame_Header& header) noexcept {
+        if (header.magic != MAGIC) {
+            return Status::BAD_REQUEST;
+        }
+        if (header.version != VERSION) {
+            return Status::UNSUPPORTED_VERSION;
+        }
+        if (header.length > MAX_PAYLOAD) {
+            return Status::BAD_REQUEST;
+        }
+        return Status::OK;
+    }
+}
+
+#endif //GAO_PROTOCOL_HPP
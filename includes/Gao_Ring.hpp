@@ -0,0 +1,320 @@
+//
+// Created by David Yang on 2026-10-17.
+//
+
+#ifndef GAO_RING_HPP
+#define GAO_RING_HPP
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+/// @brief Shared memory transport between the Orchestrator and the Gao runtime.
+///
+/// A memfd holds one single-producer/single-consumer byte ring per direction. Frames are streamed through the
+/// rings exactly as they would be through the socket. A side that finds its ring empty (or full) spins briefly,
+/// then sleeps on an eventfd doorbell that the other side only rings when it knows someone is asleep.
+/// Both rings may be full at once, so a side waiting for room keeps reading meanwhile.
+/// The socketpair stays open next to the rings so either side notices when the other goes away.
+///
+/// Shared with the Gao runtime, nothing in here allocates or throws.
+namespace Gao::ring {
+    constexpr std::uint32_t MAGIC = 0x52616f47;                 ///< "GaoR"
+    constexpr std::uint32_t VERSION = 1;
+    constexpr std::uint64_t DEFAULT_CAPACITY = 1u << 18;        ///< bytes per direction, must be a power of two
+    constexpr int SPIN_LIMIT = 4096;    ///< polls of the ring before going to sleep, only done on multi-core hosts
+
+    // descriptors the Gao process finds its end of the transport on, installed at spawn time
+    constexpr int MEMFD_FILENO = 3;
+    constexpr int TO_GAO_DATA_FILENO = 4;       ///< rung by the host after writing, Gao sleeps on it when empty
+    constexpr int TO_GAO_SPACE_FILENO = 5;      ///< rung by Gao after reading, the host sleeps on it when full
+    constexpr int TO_HOST_DATA_FILENO = 6;      ///< rung by Gao after writing, the host sleeps on it when empty
+    constexpr int TO_HOST_SPACE_FILENO = 7;     ///< rung by the host after reading, Gao sleeps on it when full
+    constexpr int DOORBELL_COUNT = 4;
+
+    /// Command line flag asking the Gao process to attach to the descriptors above.
+    constexpr const char* SHARED_MEMORY_FLAG = "--transport=shm";
+
+    /// @struct Ring_Header
+    /// @brief Positions of one ring, head and tail only ever grow and are reduced modulo the capacity.
+    struct Ring_Header {
+        alignas(64) std::atomic<std::uint64_t> head;    ///< bytes ever written, stored by the producer only
+        alignas(64) std::atomic<std::uint64_t> tail;    ///< bytes ever read, stored by the consumer only
+        alignas(64) std::atomic<std::uint32_t> consumer_waiting;
+        std::atomic<std::uint32_t> producer_waiting;
+    };
+
+    /// @struct Shared_Block
+    /// @brief Start of the memfd, the ring data follows at data_offset().
+    struct Shared_Block {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint64_t capacity;
+        Ring_Header to_gao;
+        Ring_Header to_host;
+    };
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "ring positions must be address free");
+    static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "ring flags must be address free");
+
+    constexpr std::size_t data_offset() noexcept {
+        return (sizeof(Shared_Block) + 4095) & ~static_cast<std::size_t>(4095);
+    }
+
+    /// @brief Bytes of memfd needed for rings of the given capacity.
+    constexpr std::size_t shared_size(const std::uint64_t capacity) noexcept {
+        return data_offset() + 2 * capacity;
+    }
+
+    /// @brief Lays out a fresh Shared_Block at the start of memory, which must be shared_size(capacity) bytes.
+    inline Shared_Block* initialize(void* memory, const std::uint64_t capacity) noexcept {
+        auto* block = new (memory) Shared_Block{};
+        block->magic = MAGIC;
+        block->version = VERSION;
+        block->capacity = capacity;
+        return block;
+    }
+
+    /// @brief Checks that a mapped memfd of size bytes holds a usable Shared_Block.
+    inline Shared_Block* attach(void* memory, const std::size_t size) noexcept {
+        auto* block = static_cast<Shared_Block*>(memory);
+        if (size < data_offset() || block->magic != MAGIC || block->version != VERSION) {
+            return nullptr;
+        }
+        if (block->capacity == 0 || (block->capacity & (block->capacity - 1)) != 0
+            || shared_size(block->capacity) > size) {
+            return nullptr;
+        }
+        return block;
+    }
+
+    /// @class Channel
+    /// @brief One side's view of both rings, owns neither the mapping nor the descriptors.
+    class Channel {
+        Ring_Header* in_ = nullptr;
+        const char* in_data_ = nullptr;
+        Ring_Header* out_ = nullptr;
+        char* out_data_ = nullptr;
+        std::uint64_t capacity_ = 0;
+
+        int in_data_fd_ = -1;       // waited on while in_ is empty
+        int in_space_fd_ = -1;      // rung after freeing space in in_
+        int out_data_fd_ = -1;      // rung after writing to out_
+        int out_space_fd_ = -1;     // waited on while out_ is full
+        int hangup_fd_ = -1;        // becomes readable once the other side is gone
+        int spin_limit_ = 0;        // spinning is pointless when the other side can't run meanwhile
+
+        Channel(Shared_Block* block, Ring_Header& in, const char* in_data, Ring_Header& out, char* out_data,
+                const int (&doorbells)[DOORBELL_COUNT], int hangup_fd) noexcept
+            : in_(&in), in_data_(in_data), out_(&out), out_data_(out_data), capacity_(block->capacity),
+              in_data_fd_(doorbells[0]), in_space_fd_(doorbells[1]), out_data_fd_(doorbells[2]),
+              out_space_fd_(doorbells[3]), hangup_fd_(hangup_fd),
+              spin_limit_(::sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SPIN_LIMIT : 0) {}
+
+        /// sleeps until doorbell is rung, returns 1 when woken, 0 if the other side hung up, -1 on error
+        int wait(const int doorbell) const noexcept {
+            pollfd fds[2] = {{doorbell, POLLIN, 0}, {hangup_fd_, POLLIN, 0}};
+            while (true) {
+                if (::poll(fds, 2, -1) == -1) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return -1;
+                }
+                if (fds[0].revents & POLLIN) {
+                    eventfd_t count;
+                    ::eventfd_read(doorbell, &count);
+                    return 1;
+                }
+                if (fds[1].revents != 0) {
+                    return 0;
+                }
+            }
+        }
+
+        static void ring(const int doorbell) noexcept {
+            ::eventfd_write(doorbell, 1);
+        }
+
+        // copies up to len of the head - tail readable bytes out and frees their space
+        ssize_t take(void* dst, const std::size_t len, const std::uint64_t tail, const std::uint64_t head) noexcept {
+            const std::size_t n = len < head - tail ? len : static_cast<std::size_t>(head - tail);
+            const std::size_t offset = tail & (capacity_ - 1);
+            const std::size_t first = n < capacity_ - offset ? n : capacity_ - offset;
+            std::memcpy(dst, in_data_ + offset, first);
+            std::memcpy(static_cast<char*>(dst) + first, in_data_, n - first);
+
+            in_->tail.store(tail + n, std::memory_order_seq_cst);
+            if (in_->producer_waiting.exchange(0, std::memory_order_seq_cst) != 0) {
+                ring(in_space_fd_);
+            }
+            return static_cast<ssize_t>(n);
+        }
+
+    public:
+        Channel() = default;
+
+        /// @brief The Orchestrator's view, doorbells are ordered as the *_FILENO constants.
+        static Channel host(Shared_Block* block, const int (&doorbells)[DOORBELL_COUNT], int hangup_fd) noexcept {
+            auto* data = reinterpret_cast<char*>(block) + data_offset();
+            const int fds[DOORBELL_COUNT] = {doorbells[2], doorbells[3], doorbells[0], doorbells[1]};
+            return Channel(block, block->to_host, data + block->capacity, block->to_gao, data, fds, hangup_fd);
+        }
+
+        /// @brief The Gao process's view, using the descriptors installed at spawn time.
+        static Channel gao(Shared_Block* block, int hangup_fd) noexcept {
+            const int fds[DOORBELL_COUNT] = {TO_GAO_DATA_FILENO, TO_GAO_SPACE_FILENO,
+                                             TO_HOST_DATA_FILENO, TO_HOST_SPACE_FILENO};
+            return gao(block, fds, hangup_fd);
+        }
+
+        /// @brief The Gao runtime's view with doorbells ordered as the *_FILENO constants, for a runtime hosted
+        /// in the Orchestrator's own process.
+        static Channel gao(Shared_Block* block, const int (&doorbells)[DOORBELL_COUNT], int hangup_fd) noexcept {
+            auto* data = reinterpret_cast<char*>(block) + data_offset();
+            return Channel(block, block->to_gao, data, block->to_host, data + block->capacity, doorbells, hangup_fd);
+        }
+
+        /// @brief Whether read_some would return data without blocking.
+        [[nodiscard]] bool readable() const noexcept {
+            return in_->head.load(std::memory_order_acquire) != in_->tail.load(std::memory_order_relaxed);
+        }
+
+        /// @brief Reads up to len bytes, blocking until at least one is available.
+        /// @return bytes read, 0 if the other side hung up, -1 on error.
+        ssize_t read_some(void* dst, const std::size_t len) noexcept {
+            const std::uint64_t tail = in_->tail.load(std::memory_order_relaxed);
+            std::uint64_t head = in_->head.load(std::memory_order_acquire);
+
+            for (int spins = 0; head == tail; ++spins) {
+                if (spins >= spin_limit_) {
+                    // announce we are about to sleep, then look again so a concurrent write can't be missed
+                    in_->consumer_waiting.store(1, std::memory_order_seq_cst);
+                    head = in_->head.load(std::memory_order_seq_cst);
+                    if (head == tail) {
+                        const int woke = wait(in_data_fd_);
+                        if (woke <= 0) {
+                            in_->consumer_waiting.store(0, std::memory_order_relaxed);
+                            return woke;
+                        }
+                    }
+                    in_->consumer_waiting.store(0, std::memory_order_relaxed);
+                    spins = 0;
+                }
+                head = in_->head.load(std::memory_order_acquire);
+            }
+
+            return take(dst, len, tail, head);
+        }
+
+        /// @brief Reads up to len bytes without ever sleeping, for a side that watches data_doorbell() itself.
+        /// @return bytes read, or -1 with errno set to EAGAIN if the ring is empty. The doorbell is
+        /// rung by the next write in that case.
+        ssize_t read_available(void* dst, const std::size_t len) noexcept {
+            const std::uint64_t tail = in_->tail.load(std::memory_order_relaxed);
+            std::uint64_t head = in_->head.load(std::memory_order_acquire);
+            if (head == tail) {
+                // same announcement read_some makes before sleeping, then look again so no write is missed
+                in_->consumer_waiting.store(1, std::memory_order_seq_cst);
+                head = in_->head.load(std::memory_order_seq_cst);
+                if (head == tail) {
+                    errno = EAGAIN;
+                    return -1;
+                }
+            }
+            in_->consumer_waiting.store(0, std::memory_order_relaxed);
+            return take(dst, len, tail, head);
+        }
+
+        /// @brief The eventfd rung when data arrives while the reading side announced it is waiting.
+        [[nodiscard]] int data_doorbell() const noexcept {
+            return in_data_fd_;
+        }
+
+        /// @brief The eventfd rung when space frees up while the writing side announced it is waiting.
+        [[nodiscard]] int space_doorbell() const noexcept {
+            return out_space_fd_;
+        }
+
+        /// @brief Whether write_available would take at least one byte.
+        [[nodiscard]] bool writable() const noexcept {
+            return out_->head.load(std::memory_order_relaxed) - out_->tail.load(std::memory_order_acquire) != capacity_;
+        }
+
+        /// @brief Writes up to len bytes without ever sleeping, the rest is for the caller to hold on to.
+        /// @return bytes written, or -1 with errno set to EAGAIN if the ring is full. space_doorbell() is
+        /// rung by the next read in that case.
+        ssize_t write_available(const void* src, const std::size_t len) noexcept {
+            const std::uint64_t head = out_->head.load(std::memory_order_relaxed);
+            std::uint64_t tail = out_->tail.load(std::memory_order_acquire);
+            if (head - tail == capacity_) {
+                // the producer's side of the announcement read_available makes
+                out_->producer_waiting.store(1, std::memory_order_seq_cst);
+                tail = out_->tail.load(std::memory_order_seq_cst);
+                if (head - tail == capacity_) {
+                    errno = EAGAIN;
+                    return -1;
+                }
+            }
+            out_->producer_waiting.store(0, std::memory_order_relaxed);
+
+            const std::size_t free = capacity_ - (head - tail);
+            const std::size_t n = len < free ? len : free;
+            const std::size_t offset = head & (capacity_ - 1);
+            const std::size_t first = n < capacity_ - offset ? n : capacity_ - offset;
+            std::memcpy(out_data_ + offset, src, first);
+            std::memcpy(out_data_, static_cast<const char*>(src) + first, n - first);
+
+            out_->head.store(head + n, std::memory_order_seq_cst);
+            if (out_->consumer_waiting.exchange(0, std::memory_order_seq_cst) != 0) {
+                ring(out_data_fd_);
+            }
+            return static_cast<ssize_t>(n);
+        }
+
+        /// @brief Sleeps until there is room to write or data to read, once write_available and read_available
+        /// both came back with EAGAIN. The other side may be waiting for room itself, so a writer that stops
+        /// reading while its ring is full can deadlock with it.
+        /// @return 1 when woken, 0 if the other side hung up, -1 on error.
+        int wait_writable() const noexcept {
+            for (int spins = 0; spins < spin_limit_; ++spins) {
+                if (writable() || readable()) {
+                    return 1;
+                }
+            }
+
+            pollfd fds[3] = {{out_space_fd_, POLLIN, 0}, {in_data_fd_, POLLIN, 0}, {hangup_fd_, POLLIN, 0}};
+            while (true) {
+                if (::poll(fds, 3, -1) == -1) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return -1;
+                }
+                bool woke = false;
+                for (int i = 0; i < 2; ++i) {
+                    if (fds[i].revents & POLLIN) {
+                        eventfd_t count;
+                        ::eventfd_read(fds[i].fd, &count);
+                        woke = true;
+                    }
+                }
+                if (woke) {
+                    return 1;
+                }
+                if (fds[2].revents != 0) {
+                    return 0;
+                }
+            }
+        }
+    };
+}
+
+#endif //GAO_RING_HPP
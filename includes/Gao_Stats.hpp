@@ -0,0 +1,119 @@
+//
+// Created by David Yang on 2026-10-17.
+//
+
+#ifndef GAO_STATS_HPP
+#define GAO_STATS_HPP
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <ctime>
+
+#include "Gao_Protocol.hpp"
+
+/// @brief Latency histograms kept by the Orchestrator and the Gao runtime.
+///
+/// Shared with the Gao runtime, nothing in here allocates or throws.
+namespace Gao::stats {
+    constexpr std::uint32_t SUB_BUCKET_BITS = 4;    ///< 16 buckets per power of two, at most 1/16th off
+    constexpr std::uint32_t MAX_EXPONENT = 40;      ///< samples from 2^40 ns (18 minutes) on share the last bucket
+    constexpr std::uint32_t BUCKETS = (MAX_EXPONENT - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS;
+
+    /// @brief Nanoseconds on CLOCK_MONOTONIC, served by the vDSO.
+    inline std::uint64_t now() noexcept {
+        timespec time{};
+        ::clock_gettime(CLOCK_MONOTONIC, &time);
+        return static_cast<std::uint64_t>(time.tv_sec) * 1000000000 + static_cast<std::uint64_t>(time.tv_nsec);
+    }
+
+    /// @brief Bucket a sample falls into, exact below 2^SUB_BUCKET_BITS and log-linear above.
+    constexpr std::uint32_t bucket_of(std::uint64_t value) noexcept {
+        constexpr std::uint64_t largest = (static_cast<std::uint64_t>(1) << MAX_EXPONENT) - 1;
+        value = value < largest ? value : largest;
+        if (value < (1u << SUB_BUCKET_BITS)) {
+            return static_cast<std::uint32_t>(value);
+        }
+        const std::uint32_t exponent = static_cast<std::uint32_t>(std::bit_width(value)) - 1;
+        const std::uint32_t shift = exponent - SUB_BUCKET_BITS;
+        return ((shift + 1) << SUB_BUCKET_BITS)
+               + static_cast<std::uint32_t>((value >> shift) - (1u << SUB_BUCKET_BITS));
+    }
+
+    /// @brief Largest sample that falls into bucket.
+    constexpr std::uint64_t highest_in(const std::uint32_t bucket) noexcept {
+        if (bucket < (1u << SUB_BUCKET_BITS)) {
+            return bucket;
+        }
+        const std::uint32_t shift = (bucket >> SUB_BUCKET_BITS) - 1;
+        const std::uint64_t sub = (1u << SUB_BUCKET_BITS) + (bucket & ((1u << SUB_BUCKET_BITS) - 1));
+        return ((sub + 1) << shift) - 1;
+    }
+
+    static_assert(bucket_of(15) == 15 && bucket_of(16) == 16 && bucket_of(31) == 31 && bucket_of(32) == 32);
+    static_assert(highest_in(bucket_of(1000)) >= 1000 && highest_in(bucket_of(1000)) < 1000 + 1000 / 16 + 1);
+    static_assert(bucket_of(~static_cast<std::uint64_t>(0)) == BUCKETS - 1);
+
+    /// @class Histogram
+    /// @brief Latency histogram any number of threads record into concurrently.
+    ///
+    /// record is a handful of relaxed atomic adds, summary reads a snapshot that may be torn by concurrent records.
+    class Histogram {
+        std::atomic<std::uint64_t> buckets_[BUCKETS] = {};
+        std::atomic<std::uint64_t> count_ = 0;
+        std::atomic<std::uint64_t> total_ = 0;
+        std::atomic<std::uint64_t> min_ = ~static_cast<std::uint64_t>(0);
+        std::atomic<std::uint64_t> max_ = 0;
+
+    public:
+        void record(const std::uint64_t nanoseconds) noexcept {
+            buckets_[bucket_of(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+            count_.fetch_add(1, std::memory_order_relaxed);
+            total_.fetch_add(nanoseconds, std::memory_order_relaxed);
+            // the extremes are rarely beaten, so they are only written when they are
+            std::uint64_t min = min_.load(std::memory_order_relaxed);
+            while (nanoseconds < min && !min_.compare_exchange_weak(min, nanoseconds, std::memory_order_relaxed)) {}
+            std::uint64_t max = max_.load(std::memory_order_relaxed);
+            while (nanoseconds > max && !max_.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed)) {}
+        }
+
+        /// @brief Records the time elapsed since start, a value returned by now().
+        void record_since(const std::uint64_t start) noexcept {
+            record(now() - start);
+        }
+
+        [[nodiscard]] protocol::Latency_Summary summary() const noexcept {
+            protocol::Latency_Summary summary{};
+            std::uint64_t counts[BUCKETS];
+            for (std::uint32_t i = 0; i < BUCKETS; ++i) {
+                counts[i] = buckets_[i].load(std::memory_order_relaxed);
+                summary.count += counts[i];
+            }
+            if (summary.count == 0) {
+                return summary;
+            }
+            summary.total_ns = total_.load(std::memory_order_relaxed);
+            summary.min_ns = min_.load(std::memory_order_relaxed);
+            summary.max_ns = max_.load(std::memory_order_relaxed);
+
+            // rank of a percentile is rounded up, so p999 of fewer than 1000 samples is the largest one
+            const auto rank = [&](const std::uint64_t per_mille) {
+                return (summary.count * per_mille + 999) / 1000;
+            };
+            const std::uint64_t ranks[3] = {rank(500), rank(990), rank(999)};
+            std::uint64_t* results[3] = {&summary.p50_ns, &summary.p99_ns, &summary.p999_ns};
+            std::uint64_t seen = 0;
+            std::uint32_t next = 0;
+            for (std::uint32_t i = 0; i < BUCKETS && next < 3; ++i) {
+                seen += counts[i];
+                while (next < 3 && seen >= ranks[next]) {
+                    const std::uint64_t highest = highest_in(i);
+                    *results[next++] = highest < summary.max_ns ? highest : summary.max_ns;
+                }
+            }
+            return summary;
+        }
+    };
+}
+
+#endif //GAO_STATS_HPP
@@ -5,12 +5,26 @@
 #include <spawn.h>
 #include <sys/wait.h>
 #include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <csignal>
+#include <cstring>
+#include <cerrno>
+#include <cstddef>
 #include <unistd.h>
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
 #include <iostream>
+#include <limits>
 #include <string>
 #include <stdexcept>
+#include <utility>
 #include <Gao.hpp>
 
 namespace Gao::exceptions {
@@ -32,190 +46,1183 @@ namespace Gao::exceptions {
 }
 
 namespace Gao {
+    inline State unpack_state(std::uint8_t state_code);
+
     std::filesystem::path Orchestrator::get_gao_binary() {
+        // the environment is only consulted once, every later spawn reuses the resolved path
+        static const std::filesystem::path binary = [] {
+            const char* dir = std::getenv("GAO_BIN_DIR");
+            if (dir == nullptr) {
+                throw std::runtime_error("GAO_BIN_DIR is not set");
+            }
 #if defined(__x86_64__)
-        arch_ = "x86_64";
-        return std::string(std::getenv("GAO_BIN_DIR")) + std::string("/x86_64");
+            arch_ = "x86_64";
 #elif defined(__i386__)
-        arch_ = "i386";
-        return std::string(std::getenv("GAO_BIN_DIR")) + std::string("/i386");
+            arch_ = "i386";
 #elif defined(__arm__)
-        arch_ = "arm";
-        return {std::getenv("GAO_BIN_DIR") + std::string("/arm")};
+            arch_ = "arm";
 #elif defined(__aarch64__)
-        arch_ = "aarch64";
-        return {std::getenv("GAO_BIN_DIR") + std::string("/aarch64")};
+            arch_ = "aarch64";
 #endif
+            return std::filesystem::path(dir) / arch_;
+        }();
+        return binary;
     }
 
-    Orchestrator::Log::Log(const Log_Type type, const std::string &msg_, const Log_Prio p) : msg(msg_), type(type), prio(p) {
-        switch (type) {
-            case Log_Type::GENERIC_SUCCESS:
-                msg = "[" + colors::SUCCESS + "SUCCESS" + colors::RESET + "] " + msg_;
-                break;
-            case Log_Type::GENERIC_FAILURE:
-                msg = "[" + colors::ERROR + "FAILURE" + colors::RESET + "] " + msg_;
-                break;
-            case Log_Type::GENERIC_NOTICE:
-                msg = "[" + colors::NOTICE + "NOTICE" + colors::RESET + "] " + msg_;
-                break;
-            case Log_Type::GENERIC_WARNING:
-                msg = "[" + colors::WARNING + "WARNING" + colors::RESET + "] " + msg_;
-                break;
+    void Orchestrator::set_logging(const bool enabled, const logging::Sink sink, const int fd) {
+        logs_.stop();
+        logs_.set_sink(sink, fd);
+        logging_.store(enabled, std::memory_order_relaxed);
+        if (enabled) {
+            logs_.start();
         }
     }
 
-    void Orchestrator::log(const Log &log) {
-        logs_.emplace_back(log);
+    void Orchestrator::dump_logs() const noexcept {
+        logs_.drain();
     }
 
-    void Orchestrator::dump_logs(const bool clear) {
-        for (const auto& log : logs_) {
-            if (log.prio == Log_Prio::ANY || (log.prio == Log_Prio::ONLY_IF_LOGGING && logging_)) {
-                std::cout << log.msg << "\n";
-            }
+    void Orchestrator::print_log() const noexcept {
+        logs_.drain(1);
+    }
+
+    bool Orchestrator::open_shared_memory(int& memfd, const int hangup_fd) {
+        constexpr std::size_t size = ring::shared_size(ring::DEFAULT_CAPACITY);
+
+        memfd = ::memfd_create("gao-transport", MFD_CLOEXEC);
+        if (memfd == -1) {
+            return false;
         }
-        if (clear) {
-            logs_.clear();
+        if (::ftruncate(memfd, static_cast<off_t>(size)) == -1) {
+            close_shared_memory(memfd);
+            return false;
         }
+
+        shared_ = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+        if (shared_ == MAP_FAILED) {
+            shared_ = nullptr;
+            close_shared_memory(memfd);
+            return false;
+        }
+
+        for (int& doorbell : doorbells_) {
+            doorbell = ::eventfd(0, EFD_CLOEXEC);
+            if (doorbell == -1) {
+                close_shared_memory(memfd);
+                return false;
+            }
+        }
+
+        channel_ = ring::Channel::host(ring::initialize(shared_, ring::DEFAULT_CAPACITY), doorbells_, hangup_fd);
+        return true;
     }
 
-    void Orchestrator::print_log(bool clear) {
-        if (logs_[0].prio == Log_Prio::ANY || (logs_[0].prio == Log_Prio::ONLY_IF_LOGGING && logging_)) {
-            std::cout << logs_[0].msg << "\n";
+    void Orchestrator::close_shared_memory(int& memfd) noexcept {
+        if (memfd != -1) {
+            close(memfd);
+            memfd = -1;
         }
-        if (clear) {
-            // erase logs_[0]
-            logs_.erase(logs_.begin());
+        if (shared_ != nullptr) {
+            ::munmap(shared_, ring::shared_size(ring::DEFAULT_CAPACITY));
+            shared_ = nullptr;
+        }
+        for (int& doorbell : doorbells_) {
+            if (doorbell != -1) {
+                close(doorbell);
+                doorbell = -1;
+            }
         }
     }
 
-    Orchestrator::Orchestrator(bool terminate_with_parent) {    // NOLINT : issue with actions_ initialization
+    Orchestrator::Orchestrator(bool terminate_with_parent, protocol::Transport transport,
+                               const std::span<const Warm_Pool_Class> warm_pool,
+                               const std::string_view listen_name,
+                               const Runtime_Options& runtime) {    // NOLINT : issue with actions_ initialization
+        posix_spawn_file_actions_init(&actions_);
+        if (transport == protocol::Transport::EMBEDDED) {
+            socket_ = -1;
+            start_embedded(warm_pool, listen_name, runtime);
+            return;
+        }
+
         int sv[2]; // socket pair
-        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1) {
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) == -1) {
+            posix_spawn_file_actions_destroy(&actions_);
             throw std::runtime_error("socketpair failed");
         }
-        posix_spawn_file_actions_init(&actions_);
+        socket_ = sv[0];
 
         // duplicate the child's socket to stdin/stdout
         posix_spawn_file_actions_adddup2(&actions_, sv[1], STDIN_FILENO);
         posix_spawn_file_actions_adddup2(&actions_, sv[1], STDOUT_FILENO);
 
-        status_ = posix_spawn(&pid_, get_gao_binary().c_str(),
+        const std::string binary = get_gao_binary().string();
+        std::vector<char*> argv = {const_cast<char*>(binary.c_str())};
+
+        // the socket stays the fallback whenever the rings can't be set up on our side
+        int memfd = -1;
+        if (transport == protocol::Transport::SHARED_MEMORY && open_shared_memory(memfd, socket_)) {
+            posix_spawn_file_actions_adddup2(&actions_, memfd, ring::MEMFD_FILENO);
+            posix_spawn_file_actions_adddup2(&actions_, doorbells_[0], ring::TO_GAO_DATA_FILENO);
+            posix_spawn_file_actions_adddup2(&actions_, doorbells_[1], ring::TO_GAO_SPACE_FILENO);
+            posix_spawn_file_actions_adddup2(&actions_, doorbells_[2], ring::TO_HOST_DATA_FILENO);
+            posix_spawn_file_actions_adddup2(&actions_, doorbells_[3], ring::TO_HOST_SPACE_FILENO);
+            argv.push_back(const_cast<char*>(ring::SHARED_MEMORY_FLAG));
+        }
+
+        // without the descriptor socket the Gao process refuses share_gaolette, everything else still works
+        int descriptors[2] = {-1, -1};
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, descriptors) == 0) {
+            descriptors_ = descriptors[0];
+            posix_spawn_file_actions_adddup2(&actions_, descriptors[1], protocol::DESCRIPTOR_FILENO);
+            argv.push_back(const_cast<char*>(protocol::DESCRIPTOR_FLAG));
+        }
+
+        std::vector<std::string> options;
+        options.reserve(warm_pool.size() + 4);
+        for (const Warm_Pool_Class& warm : warm_pool) {
+            options.push_back("--warm-pool=" + std::to_string(warm.size_) + ":" + std::to_string(warm.count_));
+            argv.push_back(options.back().data());
+        }
+        if (!listen_name.empty()) {
+            options.push_back("--listen=" + std::string(listen_name));
+            argv.push_back(options.back().data());
+        }
+        if (runtime.workers_ != 0) {
+            options.push_back("--workers=" + std::to_string(runtime.workers_));
+            argv.push_back(options.back().data());
+        }
+        if (runtime.pin_workers_) {
+            options.push_back("--pin-workers");
+            argv.push_back(options.back().data());
+        }
+        if (runtime.io_uring_) {
+            options.push_back("--io-uring");
+            argv.push_back(options.back().data());
+        }
+        argv.push_back(nullptr);
+
+        status_ = posix_spawn(&pid_, binary.c_str(),
                              &actions_, nullptr,
-                             nullptr, environ);
+                             argv.data(), environ);
+
+        // we can now close the child's end on the parent as it only needs it's end of the socket
+        close(sv[1]);
+        if (descriptors[1] != -1) {
+            close(descriptors[1]);
+        }
+        if (memfd != -1) {
+            close(memfd);   // the mapping keeps the memfd alive
+        }
+
         if (status_ != 0) {
+            pid_ = 0;
+            close_shared_memory(memfd);
+            close(socket_);
+            if (descriptors_ != -1) {
+                close(descriptors_);
+            }
+            posix_spawn_file_actions_destroy(&actions_);
             throw std::runtime_error("posix_spawn failed");
         }
 
-        socket_ = sv[0];
+        // the Gao process always announces the transport it attached to over the socket
+        protocol::Hello_Payload accepted{};
+        if (!await_hello(accepted)) {
+            close_shared_memory(memfd);
+            close(socket_);
+            if (descriptors_ != -1) {
+                close(descriptors_);
+            }
+            waitpid(pid_, &status_, 0);
+            posix_spawn_file_actions_destroy(&actions_);
+            throw std::runtime_error("handshake with Gao process failed");
+        }
 
-        // we can now close the child's end on the parent as it only needs it's end of the socket
-        close(sv[1]);
+        if (accepted.transport == static_cast<std::uint8_t>(protocol::Transport::SHARED_MEMORY) && shared_ != nullptr) {
+            transport_ = protocol::Transport::SHARED_MEMORY;
+        } else {
+            if (transport == protocol::Transport::SHARED_MEMORY) {
+                log(Log_Type::GENERIC_WARNING, Log_Prio::ANY,
+                    "Gao process {} can't use the shared memory transport, falling back to the socket", pid_);
+            }
+            close_shared_memory(memfd);
+        }
+    }
+
+    void Orchestrator::start_embedded(const std::span<const Warm_Pool_Class> warm_pool,
+                                      const std::string_view listen_name, const Runtime_Options& runtime) {
+        if (gao_embedded_run == nullptr) {
+            posix_spawn_file_actions_destroy(&actions_);
+            throw std::runtime_error("the embedded Gao runtime is not linked in");
+        }
+        if (embedded_in_use_.exchange(true, std::memory_order_acquire)) {
+            posix_spawn_file_actions_destroy(&actions_);
+            throw std::runtime_error("the embedded Gao runtime already serves another Orchestrator");
+        }
+
+        embedded_hangup_ = ::eventfd(0, EFD_CLOEXEC);
+        embedded_exit_ = ::eventfd(0, EFD_CLOEXEC);
+        int memfd = -1;
+        if (embedded_hangup_ == -1 || embedded_exit_ == -1 || !open_shared_memory(memfd, embedded_exit_)) {
+            for (const int fd : {embedded_hangup_, embedded_exit_}) {
+                if (fd != -1) {
+                    close(fd);
+                }
+            }
+            embedded_in_use_.store(false, std::memory_order_release);
+            posix_spawn_file_actions_destroy(&actions_);
+            throw std::runtime_error("setting up the embedded Gao runtime failed");
+        }
+        close(memfd);   // only ever mapped here, the mapping keeps it alive
+        transport_ = protocol::Transport::EMBEDDED;
+
+        int descriptors[2] = {-1, -1};
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, descriptors) == 0) {
+            descriptors_ = descriptors[0];
+            embedded_descriptors_ = descriptors[1];
+        }
+
+        // the destructor only tears down a running thread, anything failing up to its start is undone here
+        try {
+            // the thread keeps its own copies, the caller's spans may be gone before it reads them
+            std::vector<embedded::Warm_Class> warm;
+            warm.reserve(warm_pool.size());
+            for (const Warm_Pool_Class& each : warm_pool) {
+                warm.push_back(embedded::Warm_Class{each.size_, each.count_});
+            }
+            embedded::Options options{};
+            options.block = static_cast<ring::Shared_Block*>(shared_);
+            std::copy(std::begin(doorbells_), std::end(doorbells_), options.doorbells);
+            options.hangup_fd = embedded_hangup_;
+            options.descriptor_fd = embedded_descriptors_;
+            options.workers = runtime.workers_;
+            options.pin_workers = runtime.pin_workers_;
+            options.io_uring = runtime.io_uring_;
+
+            embedded_ = std::thread([options, warm = std::move(warm), name = std::string(listen_name),
+                                     exit = embedded_exit_]() mutable {
+                options.warm_pool = warm.data();
+                options.warm_pool_count = static_cast<std::uint32_t>(warm.size());
+                options.listen_name = name.empty() ? nullptr : name.c_str();
+                if (gao_embedded_run(&options) == -1) {
+                    std::cerr << "embedded Gao runtime failed" << std::endl;
+                }
+                ::eventfd_write(exit, 1);
+            });
+        } catch (...) {
+            for (int* fd : {&descriptors_, &embedded_descriptors_, &embedded_hangup_, &embedded_exit_}) {
+                if (*fd != -1) {
+                    close(*fd);
+                    *fd = -1;
+                }
+            }
+            memfd = -1;
+            close_shared_memory(memfd);
+            embedded_in_use_.store(false, std::memory_order_release);
+            posix_spawn_file_actions_destroy(&actions_);
+            throw;
+        }
+    }
+
+    Orchestrator::Orchestrator(const int socket) : socket_(socket) {
+        posix_spawn_file_actions_init(&actions_);
+    }
+
+    std::unique_ptr<Orchestrator> Orchestrator::connect(const std::string_view listen_name) {
+        sockaddr_un address{};
+        if (listen_name.empty() || listen_name.size() >= sizeof(address.sun_path) - 1) {
+            throw std::runtime_error("invalid listen name");
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path + 1, listen_name.data(), listen_name.size());   // abstract namespace
+
+        const int socket = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (socket == -1) {
+            throw std::runtime_error("socket failed");
+        }
+        const auto length = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + listen_name.size());
+        if (::connect(socket, reinterpret_cast<sockaddr*>(&address), length) == -1) {
+            close(socket);
+            throw std::runtime_error("connecting to Gao process failed");
+        }
+
+        // owns socket from here on, the destructor closes it if the handshake fails
+        std::unique_ptr<Orchestrator> orchestrator(new Orchestrator(socket));
+        protocol::Hello_Payload hello{};
+        if (!orchestrator->await_hello(hello)) {
+            throw std::runtime_error("handshake with Gao process failed");
+        }
+        return orchestrator;
+    }
+
+    bool Orchestrator::await_hello(protocol::Hello_Payload& hello) const {
+        std::string payload;
+        protocol::Frame_Header header{};
+        try {
+            header = read_frame(payload);
+        } catch (const std::runtime_error&) {
+            return false;
+        }
+        if (header.opcode != static_cast<std::uint16_t>(protocol::Opcode::HELLO)
+            || payload.size() != sizeof(protocol::Hello_Payload)) {
+            return false;
+        }
+        std::memcpy(&hello, payload.data(), sizeof(hello));
+        return true;
     }
 
     Orchestrator::~Orchestrator() {
         posix_spawn_file_actions_destroy(&actions_);
+        if (embedded_.joinable()) {
+            // the runtime finishes what it is running, its last replies are never read
+            ::eventfd_write(embedded_hangup_, 1);
+            embedded_.join();
+            close(embedded_hangup_);
+            close(embedded_exit_);
+            if (embedded_descriptors_ != -1) {
+                close(embedded_descriptors_);
+            }
+            embedded_in_use_.store(false, std::memory_order_release);
+        }
         if (socket_ != -1) {
             close(socket_);
         }
+        if (descriptors_ != -1) {
+            close(descriptors_);
+        }
+        for (const auto& [request_id, fd] : descriptors_received_) {
+            close(fd);
+        }
         if (pid_ > 0) {
+            // on stderr, stdout belongs to the program the Orchestrator is part of
             if (waitpid(pid_, &status_, 0) > 0) {
                 if (WIFEXITED(status_)) {
-                    std::cout << "Exited with status " << WEXITSTATUS(status_) << std::endl;
+                    std::cerr << "Exited with status " << WEXITSTATUS(status_) << std::endl;
                 } else if (WIFSIGNALED(status_)) {
-                    std::cout << "Killed by signal " << WTERMSIG(status_) << std::endl;
+                    std::cerr << "Killed by signal " << WTERMSIG(status_) << std::endl;
                 } else {
-                    std::cout << "Exited with unknown status" << std::endl;
+                    std::cerr << "Exited with unknown status" << std::endl;
                 }
             }
         }
+        int memfd = -1;
+        close_shared_memory(memfd);
     }
 
+    protocol::Transport Orchestrator::transport() const noexcept {
+        return transport_;
+    }
 
-    std::string Orchestrator::read_line() const {
-        constexpr size_t BUF_SIZE = 1024;
-        char* buf = new char[BUF_SIZE];  // caller must delete[]
-        size_t len = 0;
-
+    std::size_t Orchestrator::read_some(void *dst, const std::size_t len) const {
         while (true) {
-            ssize_t nread = ::read(socket_, buf + len, BUF_SIZE - len - 1);
+            const ssize_t nread = transport_ != protocol::Transport::SOCKET
+                ? channel_.read_some(dst, len)
+                : ::read(socket_, dst, len);
             if (nread == -1) {
-                delete[] buf;
+                if (errno == EINTR) {
+                    continue;
+                }
                 throw std::runtime_error("read failed");
             }
+            return static_cast<std::size_t>(nread);
+        }
+    }
+
+    bool Orchestrator::fill(const std::size_t want) const {
+        while (in_end_ - in_begin_ < want) {
+            // out of room behind in_begin_, move the lookahead to the front and grow if that's not enough
+            if (in_buffer_.size() - in_begin_ < want) {
+                std::memmove(in_buffer_.data(), in_buffer_.data() + in_begin_, in_end_ - in_begin_);
+                in_end_ -= in_begin_;
+                in_begin_ = 0;
+                if (in_buffer_.size() < want) {
+                    in_buffer_.resize(std::max(want, in_buffer_.size() * 2));
+                }
+            }
+
+            const std::size_t nread = read_some(in_buffer_.data() + in_end_, in_buffer_.size() - in_end_);
             if (nread == 0) {  // EOF
+                return false;
+            }
+            in_end_ += nread;
+        }
+        return true;
+    }
+
+    void Orchestrator::consume(const std::size_t n) const noexcept {
+        in_begin_ += n;
+        if (in_begin_ == in_end_) {
+            in_begin_ = in_end_ = 0;
+        }
+    }
+
+    bool Orchestrator::readable() const {
+        if (in_end_ != in_begin_) {
+            return true;
+        }
+        if (transport_ != protocol::Transport::SOCKET) {
+            return channel_.readable();
+        }
+        pollfd pfd{socket_, POLLIN, 0};
+        return ::poll(&pfd, 1, 0) > 0;
+    }
+
+    int Orchestrator::write_frame(const protocol::Frame_Header& header, const void* payload) const {
+        if (transport_ != protocol::Transport::SOCKET) {
+            if (write_ring(&header, sizeof(header)) == -1 || write_ring(payload, header.length) == -1) {
+                return -1;
+            }
+            return static_cast<int>(sizeof(header) + header.length);
+        }
+
+        iovec iov[2] = {
+            {const_cast<protocol::Frame_Header*>(&header), sizeof(header)},
+            {const_cast<void*>(payload), header.length}
+        };
+        const size_t total = sizeof(header) + header.length;
+        size_t written = 0;
+        int iov_idx = 0;
+
+        while (written < total) {
+            ssize_t n = ::writev(socket_, iov + iov_idx, 2 - iov_idx);
+            if (n == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -1;
+            }
+            written += n;
+
+            // advance past whatever writev managed to flush
+            while (iov_idx < 2 && static_cast<size_t>(n) >= iov[iov_idx].iov_len) {
+                n -= static_cast<ssize_t>(iov[iov_idx].iov_len);
+                ++iov_idx;
+            }
+            if (iov_idx < 2) {
+                iov[iov_idx].iov_base = static_cast<char*>(iov[iov_idx].iov_base) + n;
+                iov[iov_idx].iov_len -= n;
+            }
+        }
+        return static_cast<int>(written);
+    }
+
+    int Orchestrator::write_ring(const void* src, std::size_t len) const {
+        const auto* bytes = static_cast<const char*>(src);
+        while (len > 0) {
+            const ssize_t n = channel_.write_available(bytes, len);
+            if (n > 0) {
+                bytes += n;
+                len -= static_cast<std::size_t>(n);
+            } else if (!await_ring_space()) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    bool Orchestrator::await_ring_space() const {
+        std::unique_lock lock(reply_mutex_);
+        // whoever reads takes one frame at a time, the ring may have room again after any of them
+        reply_cv_.wait(lock, [this] { return !reading_ || channel_.writable(); });
+        if (reading_) {
+            return true;
+        }
+        reading_ = true;
+        lock.unlock();
+
+        int woke = -1;
+        try {
+            while (true) {
+                if (in_end_ == in_buffer_.size()) {
+                    std::memmove(in_buffer_.data(), in_buffer_.data() + in_begin_, in_end_ - in_begin_);
+                    in_end_ -= in_begin_;
+                    in_begin_ = 0;
+                    if (in_end_ == in_buffer_.size()) {
+                        in_buffer_.resize(in_buffer_.size() * 2);
+                    }
+                }
+                const ssize_t nread = channel_.read_available(in_buffer_.data() + in_end_,
+                                                              in_buffer_.size() - in_end_);
+                if (nread == -1) {
+                    break;
+                }
+                in_end_ += static_cast<std::size_t>(nread);
+            }
+            // both rings had their doorbells announced by the calls that came back empty handed
+            woke = channel_.wait_writable();
+        } catch (...) {
+            lock.lock();
+            reading_ = false;
+            reply_cv_.notify_all();
+            throw;
+        }
+
+        // the frames read are filed by the next pump of whoever waits for them
+        lock.lock();
+        reading_ = false;
+        reply_cv_.notify_all();
+        return woke > 0;
+    }
+
+    protocol::Frame_Header Orchestrator::read_frame(std::string &payload) const {
+        protocol::Frame_Header header{};
+        if (!fill(sizeof(header))) {
+            log(Log_Type::GENERIC_FAILURE, Log_Prio::ANY, "Gao process {} closed the connection", pid_);
+            throw std::runtime_error("Gao process closed the connection");
+        }
+        std::memcpy(&header, in_buffer_.data() + in_begin_, sizeof(header));
+        if (protocol::validate(header) != protocol::Status::OK) {
+            log(Log_Type::GENERIC_FAILURE, Log_Prio::ANY, "malformed frame (opcode {}, {} bytes) from Gao process {}",
+                header.opcode, header.length, pid_);
+            throw std::runtime_error("malformed frame received from Gao process");
+        }
+
+        if (!fill(sizeof(header) + header.length)) {
+            log(Log_Type::GENERIC_FAILURE, Log_Prio::ANY, "Gao process {} closed the connection", pid_);
+            throw std::runtime_error("Gao process closed the connection");
+        }
+        payload.assign(in_buffer_.data() + in_begin_ + sizeof(header), header.length);
+        consume(sizeof(header) + header.length);
+        return header;
+    }
+
+    bool Orchestrator::pump(std::unique_lock<std::mutex>& lock, const bool block) const {
+        if (!block && !readable()) {
+            return false;
+        }
+
+        reading_ = true;
+        lock.unlock();
+
+        Reply reply;
+        try {
+            reply.header = read_frame(reply.payload);
+        } catch (...) {
+            lock.lock();
+            reading_ = false;
+            reply_cv_.notify_all();
+            throw;
+        }
+
+        lock.lock();
+        reading_ = false;
+        log(Log_Type::GENERIC_NOTICE, Log_Prio::ONLY_IF_LOGGING, "received frame {} (opcode {}, status {}, {} bytes)",
+            reply.header.request_id, reply.header.opcode, reply.header.status, reply.header.length);
+        if (reply.header.flags & protocol::FLAG_REPLY) {
+            const Send_Stamp& stamp = send_stamps_[reply.header.request_id % SEND_STAMPS];
+            if (stamp.request_id.load(std::memory_order_acquire) == reply.header.request_id) {
+                round_trips_[std::min<std::uint32_t>(reply.header.opcode, protocol::STATS_OPCODES - 1)]
+                    .record_since(stamp.sent.load(std::memory_order_relaxed));
+            }
+            if (discarded_.erase(reply.header.request_id) == 0) {
+                replies_.insert_or_assign(reply.header.request_id, std::move(reply));
+            }
+        } else if (reply.header.opcode == static_cast<std::uint16_t>(protocol::Opcode::STATE_CHANGED)) {
+            const std::size_t count = reply.payload.size() / sizeof(protocol::State_Change);
+            for (std::size_t i = 0; i < count; ++i) {
+                protocol::State_Change change{};
+                std::memcpy(&change, reply.payload.data() + i * sizeof(change), sizeof(change));
+                // a shut down Gaolette is never folded into what follows, that is a new Gaolette reusing the id
+                const auto [it, fresh] = notified_.try_emplace(change.id, notifications_.size());
+                if (!fresh && notifications_[it->second].state
+                              != static_cast<std::uint8_t>(protocol::State_Code::SHUT_DOWN)) {
+                    notifications_[it->second].state = change.state;
+                    continue;
+                }
+                it->second = notifications_.size();
+                notifications_.push_back(change);
+            }
+        }
+        reply_cv_.notify_all();
+        return true;
+    }
+
+    std::uint32_t Orchestrator::send_request(const protocol::Opcode opcode, const void *payload,
+                                             const std::uint32_t length) const {
+        std::uint32_t id = request_id_.fetch_add(1, std::memory_order_relaxed);
+        if (id == 0) {  // 0 is never used as a request id, skip it on wrap around
+            id = request_id_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // stamped before the write, the reply may be read before write_frame even returns
+        Send_Stamp& stamp = send_stamps_[id % SEND_STAMPS];
+        stamp.sent.store(stats::now(), std::memory_order_relaxed);
+        stamp.request_id.store(id, std::memory_order_release);
+
+        std::lock_guard lock(write_mutex_);
+        if (write_frame(protocol::make_header(opcode, id, length), payload) == -1) {
+            log(Log_Type::GENERIC_FAILURE, Log_Prio::ANY, "writing request {} (opcode {}) failed with errno {}",
+                id, static_cast<std::uint16_t>(opcode), errno);
+            throw std::runtime_error("write failed");
+        }
+        log(Log_Type::GENERIC_NOTICE, Log_Prio::ONLY_IF_LOGGING, "sent request {} (opcode {}, {} bytes)",
+            id, static_cast<std::uint16_t>(opcode), length);
+        return id;
+    }
+
+    Orchestrator::Reply Orchestrator::wait_reply(const std::uint32_t request_id) const {
+        std::unique_lock lock(reply_mutex_);
+        while (true) {
+            if (auto it = replies_.find(request_id); it != replies_.end()) {
+                Reply reply = std::move(it->second);
+                replies_.erase(it);
+                return reply;
+            }
+
+            // somebody else is already reading, they will wake us once they filed their frame
+            if (reading_) {
+                reply_cv_.wait(lock);
+            } else {
+                pump(lock, true);
+            }
+        }
+    }
+
+    bool Orchestrator::reply_ready(const std::uint32_t request_id) const {
+        std::unique_lock lock(reply_mutex_);
+        while (!replies_.contains(request_id) && !reading_ && pump(lock, false)) {}
+        return replies_.contains(request_id);
+    }
+
+    void Orchestrator::discard_reply(const std::uint32_t request_id) const noexcept {
+        std::lock_guard lock(reply_mutex_);
+        if (replies_.erase(request_id) == 0) {
+            discarded_.insert(request_id);
+        }
+    }
+
+    Orchestrator::Reply Orchestrator::request(const protocol::Opcode opcode, const void *payload,
+                                              const std::uint32_t length) const {
+        return wait_reply(send_request(opcode, payload, length));
+    }
+
+    std::uint64_t Orchestrator::subscribe(const gaolette_id_t id, State_Callback callback) const {
+        std::lock_guard lock(subscription_mutex_);
+        std::vector<Subscriber>& subscribers = subscribers_[id];
+
+        // the Gao process only needs to hear about the first subscriber of a Gaolette
+        if (subscribers.empty()) {
+            const protocol::Id_Payload payload{id};
+            const Reply reply = request(protocol::Opcode::SUBSCRIBE, &payload, sizeof(payload));
+            if (reply.header.status != static_cast<std::uint16_t>(protocol::Status::OK)) {
+                subscribers_.erase(id);
+                log(Log_Type::GENERIC_WARNING, Log_Prio::ONLY_IF_LOGGING, "subscribing to Gaolette {} failed with status {}",
+                    id, reply.header.status);
+                throw std::runtime_error("Failed to subscribe to Gaolette state changes");
+            }
+        }
+
+        const std::uint64_t handle = next_subscription_++;
+        subscribers.push_back(Subscriber{handle, std::make_shared<const State_Callback>(std::move(callback))});
+        subscriptions_.emplace(handle, id);
+        return handle;
+    }
+
+    void Orchestrator::unsubscribe(const std::uint64_t subscription) const {
+        std::lock_guard lock(subscription_mutex_);
+        const auto handle = subscriptions_.find(subscription);
+        if (handle == subscriptions_.end()) {
+            return;
+        }
+        const gaolette_id_t id = handle->second;
+        subscriptions_.erase(handle);
+
+        std::vector<Subscriber>& subscribers = subscribers_[id];
+        std::erase_if(subscribers, [subscription](const Subscriber& s) { return s.handle == subscription; });
+        if (subscribers.empty()) {
+            subscribers_.erase(id);
+            // UNKNOWN_GAOLETTE just means the Gaolette, and with it the subscription, is gone already
+            const protocol::Id_Payload payload{id};
+            request(protocol::Opcode::UNSUBSCRIBE, &payload, sizeof(payload));
+        }
+    }
+
+    std::size_t Orchestrator::dispatch_notifications(const bool block) const {
+        std::vector<protocol::State_Change> changes;
+        {
+            std::unique_lock lock(reply_mutex_);
+            while (!reading_ && pump(lock, false)) {}
+            while (block && notifications_.empty()) {
+                if (reading_) {
+                    reply_cv_.wait(lock);
+                } else {
+                    pump(lock, true);
+                }
+            }
+            changes.swap(notifications_);
+            notified_.clear();
+        }
+
+        std::vector<std::shared_ptr<const State_Callback>> callbacks;
+        for (const protocol::State_Change& change : changes) {
+            const State state = unpack_state(change.state);
+            callbacks.clear();
+            {
+                std::lock_guard lock(subscription_mutex_);
+                for (const gaolette_id_t key : {change.id, protocol::ALL_GAOLETTES}) {
+                    if (auto it = subscribers_.find(key); it != subscribers_.end()) {
+                        for (const Subscriber& subscriber : it->second) {
+                            callbacks.push_back(subscriber.callback);
+                        }
+                    }
+                }
+                // the Gao process ended the subscriptions to this Gaolette along with it
+                if (state == State::ShutDown) {
+                    if (auto it = subscribers_.find(change.id); it != subscribers_.end()) {
+                        for (const Subscriber& subscriber : it->second) {
+                            subscriptions_.erase(subscriber.handle);
+                        }
+                        subscribers_.erase(it);
+                    }
+                }
+            }
+            for (const auto& callback : callbacks) {
+                (*callback)(change.id, state);
+            }
+        }
+        return changes.size();
+    }
+
+    protocol::Latency_Summary Orchestrator::round_trip_stats(const protocol::Opcode opcode) const noexcept {
+        return round_trips_[std::min<std::uint32_t>(static_cast<std::uint16_t>(opcode),
+                                                    protocol::STATS_OPCODES - 1)].summary();
+    }
+
+    protocol::Stats_Payload Orchestrator::fetch_stats() const {
+        const Reply reply = request(protocol::Opcode::GET_STATS, nullptr, 0);
+        if (reply.header.status != static_cast<std::uint16_t>(protocol::Status::OK)
+            || reply.payload.size() != sizeof(protocol::Stats_Payload)) {
+            throw std::runtime_error("Failed to fetch Gao process statistics");
+        }
+        protocol::Stats_Payload stats{};
+        std::memcpy(&stats, reply.payload.data(), sizeof(stats));
+        return stats;
+    }
+
+    int Orchestrator::take_descriptor(const std::uint32_t request_id) const {
+        if (descriptors_ == -1) {
+            throw std::runtime_error("Orchestrator has no descriptor socket");
+        }
+
+        // messages for other requests are filed for them, every one is sent ahead of its reply so this never
+        // waits for long
+        std::lock_guard lock(descriptor_mutex_);
+        while (true) {
+            if (const auto found = descriptors_received_.find(request_id); found != descriptors_received_.end()) {
+                const int fd = found->second;
+                descriptors_received_.erase(found);
+                return fd;
+            }
+
+            protocol::Descriptor_Message message{};
+            iovec data{&message, sizeof(message)};
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+            msghdr header{};
+            header.msg_iov = &data;
+            header.msg_iovlen = 1;
+            header.msg_control = control;
+            header.msg_controllen = sizeof(control);
+            const ssize_t n = ::recvmsg(descriptors_, &header, MSG_CMSG_CLOEXEC);
+            if (n == -1 && errno == EINTR) {
+                continue;
+            }
+            const cmsghdr* rights = n == sizeof(message) ? CMSG_FIRSTHDR(&header) : nullptr;
+            if (rights == nullptr || rights->cmsg_level != SOL_SOCKET || rights->cmsg_type != SCM_RIGHTS
+                || rights->cmsg_len != CMSG_LEN(sizeof(int))) {
+                throw std::runtime_error("Failed to receive a descriptor from Gao process");
+            }
+            int fd = -1;
+            std::memcpy(&fd, CMSG_DATA(rights), sizeof(fd));
+            descriptors_received_.emplace(message.request_id, fd);
+        }
+    }
+
+    Gaolette_Window::Gaolette_Window(void* mapping, const std::size_t mapping_size, const std::size_t skew,
+                                     const std::size_t size) noexcept
+        : mapping_(mapping), mapping_size_(mapping_size), data_(static_cast<std::byte*>(mapping) + skew),
+          size_(size) {}
+
+    Gaolette_Window::Gaolette_Window(Gaolette_Window&& other) noexcept
+        : mapping_(std::exchange(other.mapping_, nullptr)), mapping_size_(std::exchange(other.mapping_size_, 0)),
+          data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+
+    Gaolette_Window& Gaolette_Window::operator=(Gaolette_Window&& other) noexcept {
+        if (this != &other) {
+            if (mapping_ != nullptr) {
+                ::munmap(mapping_, mapping_size_);
+            }
+            mapping_ = std::exchange(other.mapping_, nullptr);
+            mapping_size_ = std::exchange(other.mapping_size_, 0);
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+        }
+        return *this;
+    }
+
+    Gaolette_Window::~Gaolette_Window() {
+        if (mapping_ != nullptr) {
+            ::munmap(mapping_, mapping_size_);
+        }
+    }
+
+    std::byte* Gaolette_Window::data() const noexcept {
+        return data_;
+    }
+
+    std::size_t Gaolette_Window::size() const noexcept {
+        return size_;
+    }
+
+    Gaolette_Memory::Gaolette_Memory(const int fd, const std::size_t size, const bool writable) noexcept
+        : fd_(fd), size_(size), writable_(writable) {}
+
+    Gaolette_Memory::Gaolette_Memory(Gaolette_Memory&& other) noexcept
+        : fd_(std::exchange(other.fd_, -1)), size_(std::exchange(other.size_, 0)),
+          writable_(std::exchange(other.writable_, false)) {}
+
+    Gaolette_Memory& Gaolette_Memory::operator=(Gaolette_Memory&& other) noexcept {
+        if (this != &other) {
+            if (fd_ != -1) {
+                close(fd_);
+            }
+            fd_ = std::exchange(other.fd_, -1);
+            size_ = std::exchange(other.size_, 0);
+            writable_ = std::exchange(other.writable_, false);
+        }
+        return *this;
+    }
+
+    Gaolette_Memory::~Gaolette_Memory() {
+        if (fd_ != -1) {
+            close(fd_);
+        }
+    }
+
+    int Gaolette_Memory::fd() const noexcept {
+        return fd_;
+    }
+
+    std::size_t Gaolette_Memory::size() const noexcept {
+        return size_;
+    }
+
+    bool Gaolette_Memory::writable() const noexcept {
+        return writable_;
+    }
+
+    Gaolette_Window Gaolette_Memory::map(const std::size_t offset, const std::size_t length) const {
+        if (offset > size_ || length > size_ - offset) {
+            throw std::out_of_range("Gaolette window reaches past its memory");
+        }
+        static const auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        const std::size_t skew = offset % page;
+        const std::size_t mapping_size = length + skew == 0 ? page : length + skew;
+        void* mapping = ::mmap(nullptr, mapping_size, PROT_READ | (writable_ ? PROT_WRITE : 0), MAP_SHARED, fd_,
+                               static_cast<off_t>(offset - skew));
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("Failed to map Gaolette memory");
+        }
+        return {mapping, mapping_size, skew, length};
+    }
+
+    std::size_t Gaolette_Memory::splice_from(const int fd, std::size_t offset, const std::size_t length) const {
+        if (offset > size_ || length > size_ - offset) {
+            throw std::out_of_range("Gaolette splice reaches past its memory");
+        }
+        if (!writable_) {
+            throw std::runtime_error("Gaolette memory is read-only");
+        }
+
+        // splice needs a pipe on one end, anything else is routed through one of our own
+        struct stat info{};
+        const bool pipe = ::fstat(fd, &info) == 0 && S_ISFIFO(info.st_mode);
+        int through[2] = {-1, -1};
+        if (!pipe && ::pipe2(through, O_CLOEXEC) == -1) {
+            throw std::runtime_error("Failed to create a pipe for splicing");
+        }
+
+        const auto splice_some = [](const int from, const int to, loff_t* to_offset, const std::size_t count) {
+            ssize_t n;
+            do {
+                n = ::splice(from, nullptr, to, to_offset, count, SPLICE_F_MOVE);
+            } while (n == -1 && errno == EINTR);
+            return n;
+        };
+
+        auto target = static_cast<loff_t>(offset);
+        std::size_t moved = 0;
+        bool failed = false;
+        while (moved < length && !failed) {
+            if (pipe) {
+                const ssize_t n = splice_some(fd, fd_, &target, length - moved);
+                if (n <= 0) {
+                    failed = n == -1;
+                    break;
+                }
+                moved += static_cast<std::size_t>(n);
+                continue;
+            }
+            // whatever went into our pipe is drained into the memfd before reading more
+            ssize_t in = splice_some(fd, through[1], nullptr, length - moved);
+            if (in <= 0) {
+                failed = in == -1;
                 break;
             }
-            len += nread;
+            while (in > 0) {
+                const ssize_t out = splice_some(through[0], fd_, &target, static_cast<std::size_t>(in));
+                if (out <= 0) {
+                    failed = true;
+                    break;
+                }
+                in -= out;
+                moved += static_cast<std::size_t>(out);
+            }
+        }
+        if (!pipe) {
+            close(through[0]);
+            close(through[1]);
+        }
+        if (failed) {
+            throw std::runtime_error("Failed to splice into Gaolette memory");
+        }
+        return moved;
+    }
+
+    Orchestrator_Pool::Orchestrator_Pool(const std::size_t capacity, const bool terminate_with_parent,
+                                         const protocol::Transport transport,
+                                         const std::span<const Warm_Pool_Class> warm_pool,
+                                         const Runtime_Options& runtime)
+        : capacity_(capacity), terminate_with_parent_(terminate_with_parent), transport_(transport),
+          warm_pool_(warm_pool.begin(), warm_pool.end()), runtime_(runtime) {
+        ready_.reserve(capacity_);
+        for (std::size_t i = 0; i < capacity_; ++i) {
+            ready_.push_back(spawn());
+        }
+        refiller_ = std::thread(&Orchestrator_Pool::refill, this);
+    }
+
+    Orchestrator_Pool::~Orchestrator_Pool() {
+        {
+            std::lock_guard lock(mutex_);
+            stopping_ = true;
+        }
+        refill_cv_.notify_all();
+        refiller_.join();
+    }
+
+    std::unique_ptr<Orchestrator> Orchestrator_Pool::spawn() const {
+        return std::make_unique<Orchestrator>(terminate_with_parent_, transport_, warm_pool_, std::string_view{},
+                                              runtime_);
+    }
+
+    void Orchestrator_Pool::refill() {
+        std::unique_lock lock(mutex_);
+        while (true) {
+            refill_cv_.wait(lock, [this] { return stopping_ || ready_.size() < capacity_; });
+            if (stopping_) {
+                return;
+            }
 
-            // stop if newline is seen
-            if (buf[len - 1] == '\n') {
-                buf[len - 1] = '\0';
-                std::string temp = buf;
-                delete[] buf;
-                return temp;
+            // spawning takes milliseconds, acquire() must not wait on it
+            lock.unlock();
+            std::unique_ptr<Orchestrator> spawned;
+            try {
+                spawned = spawn();
+            } catch (const std::exception&) {
+                // the system is out of processes, memory or threads, back off instead of spinning on it
+                lock.lock();
+                refill_cv_.wait_for(lock, std::chrono::milliseconds(100), [this] { return stopping_; });
+                continue;
             }
+            lock.lock();
+            ready_.push_back(std::move(spawned));
+        }
+    }
 
-            // safety: stop if buffer full (no newline)
-            if (len >= BUF_SIZE - 1) {
-                buf[len] = '\0';
-                std::string temp = buf;
-                delete[] buf;
-                return temp;
+    std::unique_ptr<Orchestrator> Orchestrator_Pool::acquire() {
+        {
+            std::lock_guard lock(mutex_);
+            if (!ready_.empty()) {
+                std::unique_ptr<Orchestrator> leased = std::move(ready_.back());
+                ready_.pop_back();
+                refill_cv_.notify_one();
+                return leased;
             }
         }
+        return spawn();
+    }
 
-        // no newline before EOF
-        buf[len] = '\0';
-        std::string temp = buf;
-        delete[] buf;
-        return temp;
+    std::size_t Orchestrator_Pool::ready() const {
+        std::lock_guard lock(mutex_);
+        return ready_.size();
     }
 
-    int Orchestrator::write_line(const std::string &line) const {
-        return static_cast<int>(write(socket_, (line + "\n").c_str(), strlen(line.c_str())));
+    Orchestrator_Group::Orchestrator_Group(const std::size_t shards, const Placement placement,
+                                           const bool terminate_with_parent, const protocol::Transport transport,
+                                           const std::span<const Warm_Pool_Class> warm_pool,
+                                           const Runtime_Options& runtime)
+        : placement_(placement) {
+        if (shards == 0 || shards > MAX_SHARDS) {
+            throw std::invalid_argument("Orchestrator_Group needs between 1 and MAX_SHARDS shards");
+        }
+        shards_.reserve(shards);
+        for (std::size_t i = 0; i < shards; ++i) {
+            shards_.push_back(std::make_unique<Shard>());
+            shards_.back()->orchestrator = std::make_unique<Orchestrator>(terminate_with_parent, transport, warm_pool,
+                                                                          std::string_view{}, runtime);
+        }
     }
 
-    Gaolette create_gaolette(Perf_Spec spec, const Orchestrator &gao_p) {
-        std::string gao_instruction = "crt:";
-        gao_instruction.append(std::to_string(spec.size_) + ",");
-        gao_instruction.append(std::to_string(static_cast<int>(spec.memory_policy_)) + ",");
-        gao_instruction.append(std::to_string(spec.max_memory_usage_) + ",");
-        gao_instruction.append(std::to_string(spec.max_cpu_cores_));
+    Orchestrator_Group::Orchestrator_Group(std::vector<std::unique_ptr<Orchestrator>> orchestrators,
+                                           const Placement placement)
+        : placement_(placement) {
+        if (orchestrators.empty() || orchestrators.size() > MAX_SHARDS) {
+            throw std::invalid_argument("Orchestrator_Group needs between 1 and MAX_SHARDS shards");
+        }
+        shards_.reserve(orchestrators.size());
+        for (std::unique_ptr<Orchestrator>& orchestrator : orchestrators) {
+            if (orchestrator == nullptr) {
+                throw std::invalid_argument("Orchestrator_Group can't shard onto a null Orchestrator");
+            }
+            shards_.push_back(std::make_unique<Shard>());
+            shards_.back()->orchestrator = std::move(orchestrator);
+        }
+    }
 
-        gao_p.write_line(gao_instruction);  // NOLINT
+    std::size_t Orchestrator_Group::size() const noexcept {
+        return shards_.size();
+    }
 
-        // we need to wait until read_line contains valid buffer space that we can read
-        const std::string response = gao_p.read_line();
-        if (response.empty() || response.substr(0, 2) == "-1") {
-            throw std::runtime_error("Gaolette creation failed"); // change to custom error
+    const Orchestrator& Orchestrator_Group::shard(const std::size_t index) const {
+        if (index >= shards_.size()) {
+            throw std::out_of_range("Gaolette does not belong to this Orchestrator_Group");
         }
+        return *shards_[index]->orchestrator;
+    }
 
-        // response comes in the form:
-        // OK:<gaolette_id_t>
-        // or
-        // ERR:<error_code>
-        if (response.substr(0, 3) == "ERR") {
-            int error_code = std::stoi(response.substr(4));
-            throw exceptions::Failed_To_Create_Gaolette(error_code);
+    std::size_t Orchestrator_Group::place(const Perf_Spec&) const noexcept {
+        // a racing placement may pick the same shard, the counters only need to be roughly right
+        std::size_t best = 0;
+        for (std::size_t i = 1; i < shards_.size(); ++i) {
+            if (placement_ == Placement::MOST_HEADROOM) {
+                if (shards_[i]->bytes.load(std::memory_order_relaxed)
+                    < shards_[best]->bytes.load(std::memory_order_relaxed)) {
+                    best = i;
+                }
+            } else if (shards_[i]->live.load(std::memory_order_relaxed)
+                       < shards_[best]->live.load(std::memory_order_relaxed)) {
+                best = i;
+            }
         }
+        return best;
+    }
 
-        if (response.substr(0, 2) == "OK") {
-            //parse until ,
-            gaolette_id_t id = std::stoi(response.substr(3));
-            return Gaolette{id, State::Operational, spec};
+    std::size_t Orchestrator_Group::place(std::uint64_t key) const noexcept {
+        // jump consistent hash (Lamping & Veach)
+        std::int64_t bucket = -1;
+        std::int64_t next = 0;
+        while (next < static_cast<std::int64_t>(shards_.size())) {
+            bucket = next;
+            key = key * 2862933555777941757ULL + 1;
+            next = static_cast<std::int64_t>(static_cast<double>(bucket + 1)
+                                             * (static_cast<double>(std::int64_t{1} << 31)
+                                                / static_cast<double>((key >> 33) + 1)));
         }
+        return static_cast<std::size_t>(bucket);
+    }
 
-        throw std::runtime_error("Invalid response from Gaolette creation");
+    void Orchestrator_Group::account(const std::size_t shard, const Perf_Spec& spec, const int delta) const noexcept {
+        const std::size_t bytes = spec.memory_policy_ == Memory_Policy::DYNAMIC
+            ? std::max(spec.size_, spec.max_memory_usage_) : spec.size_;
+        if (delta > 0) {
+            shards_[shard]->live.fetch_add(1, std::memory_order_relaxed);
+            shards_[shard]->bytes.fetch_add(bytes, std::memory_order_relaxed);
+        } else {
+            shards_[shard]->live.fetch_sub(1, std::memory_order_relaxed);
+            shards_[shard]->bytes.fetch_sub(bytes, std::memory_order_relaxed);
+        }
     }
 
-    inline int destroy_gaolette(Gaolette& gaolette, const Orchestrator& gao_p) {
-        std::string gao_instruction = "del:";
-        gao_instruction.append(std::to_string(gaolette.id));
-        gao_p.write_line(gao_instruction);  // NOLINT
-        std::string response = gao_p.read_line();
-        if (response.substr(0, 2) == "OK") {
+    std::size_t Orchestrator_Group::load(const std::size_t shard) const noexcept {
+        return shards_[shard]->live.load(std::memory_order_relaxed);
+    }
+
+    gaolette_id_t Orchestrator_Group::global_id(const std::size_t shard, const gaolette_id_t local) {
+        if (local < 0 || local > (std::numeric_limits<gaolette_id_t>::max() >> SHARD_BITS)) {
+            throw std::runtime_error("Gaolette id does not fit a group wide id");
+        }
+        return static_cast<gaolette_id_t>((static_cast<unsigned>(local) << SHARD_BITS) | shard);
+    }
+
+    std::size_t Orchestrator_Group::shard_of(const gaolette_id_t id) noexcept {
+        return static_cast<std::size_t>(static_cast<unsigned>(id) & (MAX_SHARDS - 1));
+    }
+
+    gaolette_id_t Orchestrator_Group::local_id(const gaolette_id_t id) noexcept {
+        return id < 0 ? -1 : id >> SHARD_BITS;
+    }
+
+    inline protocol::Perf_Spec_Payload pack_perf_spec(const Perf_Spec& spec) {
+        protocol::Perf_Spec_Payload packed{};
+        packed.size = spec.size_;
+        packed.max_memory_usage = spec.max_memory_usage_;
+        packed.max_cpu_cores = static_cast<std::uint32_t>(spec.max_cpu_cores_);
+        packed.memory_policy = static_cast<std::uint8_t>(spec.memory_policy_);
+        packed.page_size = static_cast<std::uint8_t>(spec.page_size_);
+        packed.numa_policy = static_cast<std::uint8_t>(spec.numa_policy_);
+        packed.numa_node = spec.numa_node_;
+        return packed;
+    }
+
+    inline Page_Size unpack_page_size(const std::uint8_t page_size_code) {
+        switch (page_size_code) {
+            case 0: return Page_Size::DEFAULT;
+            case 1: return Page_Size::TRANSPARENT_HUGE;
+            case 2: return Page_Size::EXPLICIT_HUGE;
+            default:
+                throw std::runtime_error("Unknown page size code received from Gaolette");
+        }
+    }
+
+    inline State unpack_state(const std::uint8_t state_code) {
+        switch (state_code) {
+            case 0: return State::Operational;
+            case 1: return State::ShutDown;
+            case 2: return State::Locked;
+            case 3: return State::Operating;
+            case 4: return State::Illformed;
+            default:
+                throw std::runtime_error("Unknown state code received from Gaolette");
+        }
+    }
+
+    inline void expect_reply(const Orchestrator::Reply& reply, const protocol::Opcode opcode) {
+        if (reply.header.opcode != static_cast<std::uint16_t>(opcode)) {
+            throw std::runtime_error("Invalid response from Gao process");
+        }
+    }
+
+    inline Gaolette finish_create_gaolette(const Orchestrator::Reply& reply, const Perf_Spec& spec,
+                                           const protocol::Opcode opcode = protocol::Opcode::CREATE) {
+        expect_reply(reply, opcode);
+        if (reply.header.status != static_cast<std::uint16_t>(protocol::Status::OK)) {
+            throw exceptions::Failed_To_Create_Gaolette(reply.header.status);
+        }
+        if (reply.payload.size() != sizeof(protocol::Created_Payload)) {
+            throw std::runtime_error("Invalid response from Gaolette creation");
+        }
+
+        protocol::Created_Payload created{};
+        std::memcpy(&created, reply.payload.data(), sizeof(created));
+        Gaolette gaolette{created.id, State::Operational, spec};
+        gaolette.perf_spec.page_size_ = unpack_page_size(created.page_size);
+        return gaolette;
+    }
+
+    inline int finish_destroy_gaolette(const Orchestrator::Reply& reply, Gaolette& gaolette) {
+        expect_reply(reply, protocol::Opcode::DESTROY);
+        if (reply.header.status == static_cast<std::uint16_t>(protocol::Status::OK)) {
             gaolette.id = -1;
             gaolette.state = State::ShutDown;
             return 0; // success
@@ -224,32 +1231,351 @@ namespace Gao {
         return -1; // failure
     }
 
+    inline void finish_fetch_state(const Orchestrator::Reply& reply, Gaolette& gaolette) {
+        expect_reply(reply, protocol::Opcode::GET_STATE);
+        if (reply.header.status != static_cast<std::uint16_t>(protocol::Status::OK)
+            || reply.payload.size() != sizeof(protocol::State_Payload)) {
+            throw std::runtime_error("Failed to fetch Gaolette state");
+        }
+
+        protocol::State_Payload state{};
+        std::memcpy(&state, reply.payload.data(), sizeof(state));
+        gaolette.state = unpack_state(state.state);
+    }
+
+    inline Gaolette create_gaolette(Perf_Spec spec, const Orchestrator &gao_p) {
+        const protocol::Perf_Spec_Payload packed = pack_perf_spec(spec);
+        return finish_create_gaolette(gao_p.request(protocol::Opcode::CREATE, &packed, sizeof(packed)), spec);
+    }
+
+    inline int destroy_gaolette(Gaolette& gaolette, const Orchestrator& gao_p) {
+        const protocol::Id_Payload id{gaolette.id};
+        return finish_destroy_gaolette(gao_p.request(protocol::Opcode::DESTROY, &id, sizeof(id)), gaolette);
+    }
+
+    inline int resize_gaolette(Gaolette& gaolette, const std::size_t size, const Orchestrator& gao_p) {
+        const protocol::Resize_Payload resize{gaolette.id, 0, size};
+        const Orchestrator::Reply reply = gao_p.request(protocol::Opcode::RESIZE, &resize, sizeof(resize));
+        expect_reply(reply, protocol::Opcode::RESIZE);
+        if (reply.header.status != static_cast<std::uint16_t>(protocol::Status::OK)) {
+            return -1; // failure
+        }
+
+        gaolette.perf_spec.size_ = size;
+        return 0; // success
+    }
+
     inline void fetch_state(Gaolette& gaolette, const Orchestrator& gao_p) {
-        gao_p.write_line(std::string("get:state"));
-        std::string response = gao_p.read_line();
-        if (response.substr(0, 2) == "OK") {
-            switch (int state_code = std::stoi(response.substr(3))) { //NOLINT
-                case 0:
-                    gaolette.state = State::Operational;
-                    break;
-                case 1:
-                    gaolette.state = State::ShutDown;
-                    break;
-                case 2:
-                    gaolette.state = State::Locked;
-                    break;
-                case 3:
-                    gaolette.state = State::Operating;
-                    break;
-                case 4:
-                    gaolette.state = State::Illformed;
-                    break;
-                default:
-                    throw std::runtime_error("Unknown state code received from Gaolette");
+        const protocol::Id_Payload id{gaolette.id};
+        finish_fetch_state(gao_p.request(protocol::Opcode::GET_STATE, &id, sizeof(id)), gaolette);
+    }
+
+    inline Gaolette clone_gaolette(const Gaolette& source, const Orchestrator& gao_p) {
+        const protocol::Id_Payload id{source.id};
+        return finish_create_gaolette(gao_p.request(protocol::Opcode::CLONE, &id, sizeof(id)), source.perf_spec,
+                                      protocol::Opcode::CLONE);
+    }
+
+    inline Gaolette_Memory share_gaolette(const Gaolette& gaolette, const Orchestrator& gao_p) {
+        const protocol::Id_Payload id{gaolette.id};
+        const std::uint32_t request_id = gao_p.send_request(protocol::Opcode::SHARE, &id, sizeof(id));
+        const Orchestrator::Reply reply = gao_p.wait_reply(request_id);
+        expect_reply(reply, protocol::Opcode::SHARE);
+        if (reply.header.status != static_cast<std::uint16_t>(protocol::Status::OK)
+            || reply.payload.size() != sizeof(protocol::Shared_Payload)) {
+            throw std::runtime_error("Failed to share Gaolette memory");
+        }
+
+        protocol::Shared_Payload shared{};
+        std::memcpy(&shared, reply.payload.data(), sizeof(shared));
+        return {gao_p.take_descriptor(request_id), shared.size, shared.writable != 0};
+    }
+
+    inline Pending<Gaolette> create_gaolette_async(Perf_Spec spec, const Orchestrator& gao_p) {
+        const protocol::Perf_Spec_Payload packed = pack_perf_spec(spec);
+        const std::uint32_t id = gao_p.send_request(protocol::Opcode::CREATE, &packed, sizeof(packed));
+        return Pending<Gaolette>(gao_p, id, [spec](Orchestrator::Reply& reply) {
+            return finish_create_gaolette(reply, spec);
+        });
+    }
+
+    inline Pending<int> destroy_gaolette_async(Gaolette& gaolette, const Orchestrator& gao_p) {
+        const protocol::Id_Payload id{gaolette.id};
+        const std::uint32_t request_id = gao_p.send_request(protocol::Opcode::DESTROY, &id, sizeof(id));
+        return Pending<int>(gao_p, request_id, [&gaolette](Orchestrator::Reply& reply) {
+            return finish_destroy_gaolette(reply, gaolette);
+        });
+    }
+
+    inline Pending<void> fetch_state_async(Gaolette& gaolette, const Orchestrator& gao_p) {
+        const protocol::Id_Payload id{gaolette.id};
+        const std::uint32_t request_id = gao_p.send_request(protocol::Opcode::GET_STATE, &id, sizeof(id));
+        return Pending<void>(gao_p, request_id, [&gaolette](Orchestrator::Reply& reply) {
+            finish_fetch_state(reply, gaolette);
+        });
+    }
+
+    inline std::vector<Pending<void>> send_create_gaolettes(const std::span<const Perf_Spec> specs,
+                                                            const Orchestrator& gao_p,
+                                                            const std::span<Batch_Entry> entries) {
+        std::vector<protocol::Perf_Spec_Payload> packed;
+        packed.reserve(specs.size());
+        for (const Perf_Spec& spec : specs) {
+            packed.push_back(pack_perf_spec(spec));
+        }
+
+        std::vector<Pending<void>> chunks;
+        for (std::size_t first = 0; first < packed.size(); first += protocol::MAX_BATCH) {
+            const std::size_t count = std::min<std::size_t>(protocol::MAX_BATCH, packed.size() - first);
+            const std::uint32_t request_id = gao_p.send_request(protocol::Opcode::CREATE_BATCH, packed.data() + first,
+                                                                count * sizeof(protocol::Perf_Spec_Payload));
+
+            chunks.emplace_back(gao_p, request_id, [entries, specs, first, count](Orchestrator::Reply& reply) {
+                expect_reply(reply, protocol::Opcode::CREATE_BATCH);
+                if (reply.header.status != static_cast<std::uint16_t>(protocol::Status::OK)
+                    || reply.payload.size() != count * sizeof(protocol::Batch_Result)) {
+                    throw std::runtime_error("Invalid response from batch Gaolette creation");
+                }
+
+                for (std::size_t i = 0; i < count; ++i) {
+                    protocol::Batch_Result result{};
+                    std::memcpy(&result, reply.payload.data() + i * sizeof(result), sizeof(result));
+                    if (result.status == static_cast<std::uint16_t>(protocol::Status::OK)) {
+                        entries[first + i] = Batch_Entry{Gaolette{result.id, State::Operational, specs[first + i]}, 0};
+                        entries[first + i].gaolette.perf_spec.page_size_ = unpack_page_size(result.page_size);
+                    } else {
+                        entries[first + i] = Batch_Entry{Gaolette{-1, State::Illformed, specs[first + i]}, result.status};
+                    }
+                }
+            });
+        }
+        return chunks;
+    }
+
+    inline std::vector<Batch_Entry> create_gaolettes(const std::span<const Perf_Spec> specs, const Orchestrator& gao_p) {
+        std::vector<Batch_Entry> entries(specs.size());
+
+        // every chunk is sent before waiting on any of them
+        for (Pending<void>& chunk : send_create_gaolettes(specs, gao_p, entries)) {
+            chunk.get();
+        }
+        return entries;
+    }
+
+    inline std::vector<Pending<void>> send_destroy_gaolettes(const std::span<Gaolette> gaolettes,
+                                                             const Orchestrator& gao_p, const std::span<int> codes) {
+        std::vector<protocol::Id_Payload> ids;
+        ids.reserve(gaolettes.size());
+        for (const Gaolette& gaolette : gaolettes) {
+            ids.push_back(protocol::Id_Payload{gaolette.id});
+        }
+
+        std::vector<Pending<void>> chunks;
+        for (std::size_t first = 0; first < ids.size(); first += protocol::MAX_BATCH) {
+            const std::size_t count = std::min<std::size_t>(protocol::MAX_BATCH, ids.size() - first);
+            const std::uint32_t request_id = gao_p.send_request(protocol::Opcode::DESTROY_BATCH, ids.data() + first,
+                                                                count * sizeof(protocol::Id_Payload));
+
+            chunks.emplace_back(gao_p, request_id, [codes, gaolettes, first, count](Orchestrator::Reply& reply) {
+                expect_reply(reply, protocol::Opcode::DESTROY_BATCH);
+                if (reply.header.status != static_cast<std::uint16_t>(protocol::Status::OK)
+                    || reply.payload.size() != count * sizeof(protocol::Batch_Result)) {
+                    throw std::runtime_error("Invalid response from batch Gaolette destruction");
+                }
+
+                for (std::size_t i = 0; i < count; ++i) {
+                    protocol::Batch_Result result{};
+                    std::memcpy(&result, reply.payload.data() + i * sizeof(result), sizeof(result));
+                    codes[first + i] = result.status;
+                    if (result.status == static_cast<std::uint16_t>(protocol::Status::OK)) {
+                        gaolettes[first + i].id = -1;
+                        gaolettes[first + i].state = State::ShutDown;
+                    }
+                }
+            });
+        }
+        return chunks;
+    }
+
+    inline std::vector<int> destroy_gaolettes(const std::span<Gaolette> gaolettes, const Orchestrator& gao_p) {
+        std::vector<int> codes(gaolettes.size());
+        for (Pending<void>& chunk : send_destroy_gaolettes(gaolettes, gao_p, codes)) {
+            chunk.get();
+        }
+        return codes;
+    }
+
+    inline Gaolette create_gaolette_on_shard(const Perf_Spec& spec, const Orchestrator_Group& group,
+                                             const std::size_t shard) {
+        group.account(shard, spec, 1);
+        Gaolette gaolette;
+        try {
+            gaolette = create_gaolette(spec, group.shard(shard));
+        } catch (...) {
+            group.account(shard, spec, -1);
+            throw;
+        }
+        gaolette.id = Orchestrator_Group::global_id(shard, gaolette.id);
+        return gaolette;
+    }
+
+    inline Gaolette create_gaolette(Perf_Spec spec, const Orchestrator_Group& group) {
+        return create_gaolette_on_shard(spec, group, group.place(spec));
+    }
+
+    inline Gaolette create_gaolette(Perf_Spec spec, const Orchestrator_Group& group, const std::uint64_t key) {
+        return create_gaolette_on_shard(spec, group, group.place(key));
+    }
+
+    inline int destroy_gaolette(Gaolette& gaolette, const Orchestrator_Group& group) {
+        const std::size_t shard = Orchestrator_Group::shard_of(gaolette.id);
+        if (gaolette.id < 0 || shard >= group.size()) {
+            return -1; // failure
+        }
+
+        Gaolette local = gaolette;
+        local.id = Orchestrator_Group::local_id(gaolette.id);
+        if (destroy_gaolette(local, group.shard(shard)) == -1) {
+            return -1; // failure
+        }
+        group.account(shard, gaolette.perf_spec, -1);
+        gaolette.id = local.id;
+        gaolette.state = local.state;
+        return 0; // success
+    }
+
+    inline void fetch_state(Gaolette& gaolette, const Orchestrator_Group& group) {
+        Gaolette local = gaolette;
+        local.id = Orchestrator_Group::local_id(gaolette.id);
+        fetch_state(local, group.shard(Orchestrator_Group::shard_of(gaolette.id)));
+        gaolette.state = local.state;
+    }
+
+    inline int resize_gaolette(Gaolette& gaolette, const std::size_t size, const Orchestrator_Group& group) {
+        const std::size_t shard = Orchestrator_Group::shard_of(gaolette.id);
+        if (gaolette.id < 0 || shard >= group.size()) {
+            return -1; // failure
+        }
+
+        Gaolette local = gaolette;
+        local.id = Orchestrator_Group::local_id(gaolette.id);
+        if (resize_gaolette(local, size, group.shard(shard)) == -1) {
+            return -1; // failure
+        }
+        gaolette.perf_spec.size_ = local.perf_spec.size_;
+        return 0; // success
+    }
+
+    inline Gaolette clone_gaolette(const Gaolette& source, const Orchestrator_Group& group) {
+        const std::size_t shard = Orchestrator_Group::shard_of(source.id);
+        if (source.id < 0 || shard >= group.size()) {
+            throw exceptions::Failed_To_Create_Gaolette(static_cast<int>(protocol::Status::UNKNOWN_GAOLETTE));
+        }
+
+        Gaolette local = source;
+        local.id = Orchestrator_Group::local_id(source.id);
+        group.account(shard, source.perf_spec, 1);
+        Gaolette clone;
+        try {
+            clone = clone_gaolette(local, group.shard(shard));
+        } catch (...) {
+            group.account(shard, source.perf_spec, -1);
+            throw;
+        }
+        clone.id = Orchestrator_Group::global_id(shard, clone.id);
+        return clone;
+    }
+
+    inline Gaolette_Memory share_gaolette(const Gaolette& gaolette, const Orchestrator_Group& group) {
+        const std::size_t shard = Orchestrator_Group::shard_of(gaolette.id);
+        if (gaolette.id < 0 || shard >= group.size()) {
+            throw std::runtime_error("Failed to share Gaolette memory");
+        }
+
+        Gaolette local = gaolette;
+        local.id = Orchestrator_Group::local_id(gaolette.id);
+        return share_gaolette(local, group.shard(shard));
+    }
+
+    inline std::vector<Batch_Entry> create_gaolettes(const std::span<const Perf_Spec> specs,
+                                                     const Orchestrator_Group& group) {
+        // place every item first, then hand each shard its share in one go
+        std::vector<std::vector<Perf_Spec>> shard_specs(group.size());
+        std::vector<std::vector<std::size_t>> shard_items(group.size());
+        for (std::size_t i = 0; i < specs.size(); ++i) {
+            const std::size_t shard = group.place(specs[i]);
+            group.account(shard, specs[i], 1);
+            shard_specs[shard].push_back(specs[i]);
+            shard_items[shard].push_back(i);
+        }
+
+        std::vector<std::vector<Batch_Entry>> shard_entries(group.size());
+        std::vector<Pending<void>> chunks;
+        for (std::size_t shard = 0; shard < group.size(); ++shard) {
+            shard_entries[shard].resize(shard_specs[shard].size());
+            for (Pending<void>& chunk : send_create_gaolettes(shard_specs[shard], group.shard(shard),
+                                                              shard_entries[shard])) {
+                chunks.push_back(std::move(chunk));
+            }
+        }
+        for (Pending<void>& chunk : chunks) {
+            chunk.get();
+        }
+
+        std::vector<Batch_Entry> entries(specs.size());
+        for (std::size_t shard = 0; shard < group.size(); ++shard) {
+            for (std::size_t i = 0; i < shard_items[shard].size(); ++i) {
+                Batch_Entry& entry = shard_entries[shard][i];
+                if (entry.error_code == 0) {
+                    entry.gaolette.id = Orchestrator_Group::global_id(shard, entry.gaolette.id);
+                } else {
+                    group.account(shard, shard_specs[shard][i], -1);
+                }
+                entries[shard_items[shard][i]] = entry;
             }
-        } else {
-            throw std::runtime_error("Failed to fetch Gaolette state");
         }
+        return entries;
     }
 
-}
\ No newline at end of file
+    inline std::vector<int> destroy_gaolettes(const std::span<Gaolette> gaolettes, const Orchestrator_Group& group) {
+        std::vector<int> codes(gaolettes.size(), static_cast<int>(protocol::Status::UNKNOWN_GAOLETTE));
+        std::vector<std::vector<Gaolette>> shard_gaolettes(group.size());
+        std::vector<std::vector<std::size_t>> shard_items(group.size());
+        for (std::size_t i = 0; i < gaolettes.size(); ++i) {
+            const std::size_t shard = Orchestrator_Group::shard_of(gaolettes[i].id);
+            if (gaolettes[i].id < 0 || shard >= group.size()) {
+                continue;
+            }
+            Gaolette local = gaolettes[i];
+            local.id = Orchestrator_Group::local_id(gaolettes[i].id);
+            shard_gaolettes[shard].push_back(local);
+            shard_items[shard].push_back(i);
+        }
+
+        std::vector<std::vector<int>> shard_codes(group.size());
+        std::vector<Pending<void>> chunks;
+        for (std::size_t shard = 0; shard < group.size(); ++shard) {
+            shard_codes[shard].resize(shard_gaolettes[shard].size());
+            for (Pending<void>& chunk : send_destroy_gaolettes(shard_gaolettes[shard], group.shard(shard),
+                                                               shard_codes[shard])) {
+                chunks.push_back(std::move(chunk));
+            }
+        }
+        for (Pending<void>& chunk : chunks) {
+            chunk.get();
+        }
+
+        for (std::size_t shard = 0; shard < group.size(); ++shard) {
+            for (std::size_t i = 0; i < shard_items[shard].size(); ++i) {
+                Gaolette& gaolette = gaolettes[shard_items[shard][i]];
+                codes[shard_items[shard][i]] = shard_codes[shard][i];
+                if (shard_codes[shard][i] == static_cast<int>(protocol::Status::OK)) {
+                    group.account(shard, gaolette.perf_spec, -1);
+                    gaolette.id = -1;
+                    gaolette.state = State::ShutDown;
+                }
+            }
+        }
+        return codes;
+    }
+}
@@ -5,468 +5,3546 @@
 #ifndef GAO_HPP
 #define GAO_HPP
 
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+#include <new>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/types.h>
 #include <spawn.h>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <sys/wait.h>
 #include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <csignal>
-#include <unistd.h>
-#include <filesystem>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
-#include <string>
-#include <stdexcept>
-#include <vector>
+#include <limits>
+#include <utility>
+
+/// @brief Binary wire format spoken between the Orchestrator and the Gao runtime's Comm.
+///
+/// Every message is a fixed size Frame_Header followed by exactly `length` bytes of payload.
+/// Both ends always live on the same host, so all fields are in host byte order.
+///
+/// This header is shared with the Gao runtime and must not pull in anything that allocates or throws.
+namespace Gao::protocol {
+    constexpr std::uint16_t MAGIC = 0x4761;             ///< "Ga"
+    constexpr std::uint8_t VERSION = 1;
+    constexpr std::uint32_t MAX_PAYLOAD = 1u << 20;     ///< frames larger than this are rejected
+    constexpr std::uint32_t MAX_BATCH = 16384;          ///< items carried by a single batch request
+    constexpr std::int32_t ALL_GAOLETTES = -1;          ///< SUBSCRIBE/UNSUBSCRIBE id covering every Gaolette
+
+    /// @enum Opcode
+    /// @brief Command carried by a frame, replies echo the opcode of their request.
+    enum class Opcode : std::uint16_t {
+        CREATE = 1,     ///< payload: Perf_Spec_Payload, reply: Created_Payload
+        DESTROY = 2,    ///< payload: Id_Payload, reply: empty
+        GET_STATE = 3,  ///< payload: Id_Payload, reply: State_Payload
+        CREATE_BATCH = 4,   ///< payload: up to MAX_BATCH Perf_Spec_Payload, reply: one Batch_Result per item
+        DESTROY_BATCH = 5,  ///< payload: up to MAX_BATCH Id_Payload, reply: one Batch_Result per item
+        HELLO = 6,          ///< sent once by the Gao process over the socket on startup, payload: Hello_Payload
+        RESIZE = 7,         ///< payload: Resize_Payload, reply: empty, only valid for Memory_Policy::DYNAMIC
+        SUBSCRIBE = 8,      ///< payload: Id_Payload or ALL_GAOLETTES, reply: empty; STATE_CHANGED frames follow
+        UNSUBSCRIBE = 9,    ///< payload: Id_Payload or ALL_GAOLETTES, reply: empty
+        STATE_CHANGED = 10, ///< sent unasked to subscribers, request_id 0, payload: one State_Change per Gaolette
+        GET_STATS = 11,     ///< payload: empty, reply: Stats_Payload
+        CLONE = 12,         ///< payload: Id_Payload of the source, reply: Created_Payload of the copy-on-write clone
+        SHARE = 13,         ///< payload: Id_Payload, reply: Shared_Payload; the memfd comes as a Descriptor_Message
+    };
 
-namespace Gao::exceptions {
+    /// Opcode values statistics are kept for, per opcode arrays are indexed by the opcode's value.
+    constexpr std::uint32_t STATS_OPCODES = 16;
+
+    /// Descriptor the Gao process finds its end of a SOCK_SEQPACKET socketpair on when started with DESCRIPTOR_FLAG.
+    /// Memfds the host asked for with SHARE arrive on the host's end, one Descriptor_Message each.
+    constexpr int DESCRIPTOR_FILENO = 8;
+    constexpr const char* DESCRIPTOR_FLAG = "--descriptors";
+
+    /// @enum Transport
+    /// @brief How frames travel between the Orchestrator and the Gao process.
+    enum class Transport : std::uint8_t {
+        SOCKET = 0,         ///< the AF_UNIX socketpair set up at spawn time
+        SHARED_MEMORY = 1,  ///< memfd backed rings, see Gao_Ring.hpp
+        EMBEDDED = 2        ///< the same rings served by a runtime thread in the Orchestrator's process, no HELLO
+    };
+
+    /// @enum Frame_Flags
+    /// @brief Bit flags carried in Frame_Header::flags.
+    enum Frame_Flags : std::uint8_t {
+        FLAG_REPLY = 1 << 0 ///< frame is a reply to the request with the same request_id
+    };
+
+    /// @enum Status
+    /// @brief Result carried in Frame_Header::status of a reply, always OK in requests.
     ///
-    /// @class Failed_To_Create_Gaolette
-    /// @brief Exception thrown with added context based off code.
+    /// Values 1-3 match the codes understood by exceptions::Failed_To_Create_Gaolette.
+    enum class Status : std::uint16_t {
+        OK = 0,
+        INVALID_SPEC = 1,       ///< invalid performance specification
+        NO_RESOURCES = 2,       ///< insufficient system resources
+        PERMISSION_DENIED = 3,
+        UNKNOWN_GAOLETTE = 4,   ///< the referenced gaolette id does not exist
+        BAD_REQUEST = 5,        ///< malformed frame or unknown opcode
+        UNSUPPORTED_VERSION = 6
+    };
+
+    /// @enum State_Code
+    /// @brief Wire representation of Gao::State, values match its declaration order.
+    enum class State_Code : std::uint8_t {
+        OPERATIONAL = 0,
+        SHUT_DOWN = 1,
+        LOCKED = 2,
+        OPERATING = 3,
+        ILLFORMED = 4
+    };
+
+    /// @enum Memory_Policy_Code
+    /// @brief Wire representation of Gao::Memory_Policy, values match its declaration order.
+    enum class Memory_Policy_Code : std::uint8_t {
+        STATIC = 0,
+        DYNAMIC = 1     ///< address space up to max_memory_usage is reserved, only size bytes are accessible
+    };
+
+    /// @enum Page_Size_Code
+    /// @brief Wire representation of Gao::Page_Size, values match its declaration order.
+    enum class Page_Size_Code : std::uint8_t {
+        DEFAULT = 0,
+        TRANSPARENT_HUGE = 1,   ///< regular mapping advised with MADV_HUGEPAGE
+        EXPLICIT_HUGE = 2       ///< MAP_HUGETLB mapping from the preallocated huge page pool
+    };
+
+    /// @enum Numa_Policy_Code
+    /// @brief Wire representation of Gao::Numa_Policy, values match its declaration order.
+    enum class Numa_Policy_Code : std::uint8_t {
+        FIRST_TOUCH = 0,
+        PREFERRED = 1,          ///< pages come from numa_node while it has free memory
+        INTERLEAVE = 2,         ///< pages are spread round-robin over every online node
+        LOCAL_TO_WORKERS = 3    ///< pages come from the node of the workers running the Gaolette's tasks
+    };
+
+    /// @struct Frame_Header
+    /// @brief Fixed size header preceding every payload.
+    struct Frame_Header {
+        std::uint16_t magic;
+        std::uint8_t version;
+        std::uint8_t flags;
+        std::uint16_t opcode;
+        std::uint16_t status;
+        std::uint32_t length;       ///< payload length in bytes, excluding the header
+        std::uint32_t request_id;   ///< chosen by the sender of a request, echoed verbatim in the reply
+    };
+
+    /// @struct Perf_Spec_Payload
+    /// @brief Packed form of Gao::Perf_Spec.
+    struct Perf_Spec_Payload {
+        std::uint64_t size;
+        std::uint64_t max_memory_usage;
+        std::uint32_t max_cpu_cores;
+        std::uint8_t memory_policy;     ///< a Memory_Policy_Code
+        std::uint8_t page_size;         ///< a Page_Size_Code, the runtime falls back to smaller pages if needed
+        std::uint8_t numa_policy;       ///< a Numa_Policy_Code, ignored on single node hosts
+        std::uint8_t numa_node;         ///< node of Numa_Policy_Code::PREFERRED
+    };
+
+    /// @struct Id_Payload
+    /// @brief Payload naming a single Gaolette.
+    struct Id_Payload {
+        std::int32_t id;
+    };
+
+    /// @struct Created_Payload
+    /// @brief Reply to CREATE and CLONE.
+    struct Created_Payload {
+        std::int32_t id;
+        std::uint8_t page_size;     ///< Page_Size_Code actually backing the Gaolette
+        std::uint8_t reserved[3];
+    };
+
+    /// @struct Shared_Payload
+    /// @brief Reply to SHARE, describing the memfd sent ahead of it.
+    struct Shared_Payload {
+        std::uint64_t size;         ///< accessible bytes at the start of the memfd, the Gaolette's size
+        std::uint8_t writable;      ///< 0 for a locked Gaolette, whose memfd is sealed against writes
+        std::uint8_t reserved[7];
+    };
+
+    /// @struct Descriptor_Message
+    /// @brief Sent over the descriptor socket with a memfd attached as SCM_RIGHTS, before the reply it belongs to.
+    struct Descriptor_Message {
+        std::uint32_t request_id;   ///< of the SHARE request
+    };
+
+    /// @struct State_Payload
+    /// @brief Payload carrying a State_Code.
+    struct State_Payload {
+        std::uint8_t state;
+        std::uint8_t reserved[3];
+    };
+
+    /// @struct Hello_Payload
+    /// @brief Transport the Gao process attached to, every later frame travels over it.
+    struct Hello_Payload {
+        std::uint8_t transport;
+        std::uint8_t reserved[3];
+    };
+
+    /// @struct Resize_Payload
+    /// @brief Payload growing or shrinking a DYNAMIC Gaolette in place.
+    struct Resize_Payload {
+        std::int32_t id;
+        std::uint32_t reserved;
+        std::uint64_t size;     ///< new size in bytes, at most the Gaolette's max_memory_usage
+    };
+
+    /// @struct State_Change
+    /// @brief Latest state of a Gaolette a STATE_CHANGED frame reports on.
     ///
-    /// Gaolette creation may result in failure, in such cases this exception handles
-    /// all known error codes with added context based off the code.
-    class Failed_To_Create_Gaolette : public std::exception {
-        std::vector<std::string> msg_;
-        int code = -1;
-    public:
-        explicit Failed_To_Create_Gaolette(int code);
+    /// Transitions are coalesced, a Gaolette that changed several times since the last frame appears once.
+    /// A subscription to a single Gaolette ends with the Gaolette, after reporting State_Code::SHUT_DOWN.
+    struct State_Change {
+        std::int32_t id;
+        std::uint8_t state;     ///< a State_Code
+        std::uint8_t reserved[3];
+    };
 
-        [[nodiscard]] const char* what() const noexcept override;
+    /// @struct Batch_Result
+    /// @brief Outcome of a single item of a batch request.
+    struct Batch_Result {
+        std::int32_t id;        ///< id of the created/destroyed Gaolette, -1 if the item failed
+        std::uint16_t status;   ///< Status of this item
+        std::uint8_t page_size; ///< Page_Size_Code actually backing a created Gaolette
+        std::uint8_t reserved;
     };
 
-    Failed_To_Create_Gaolette::Failed_To_Create_Gaolette(int code) : code(code) {
-        msg_.emplace_back("Gaolette creation failed with error code: " + std::to_string(code));
+    /// @struct Latency_Summary
+    /// @brief Distribution of the latencies of one operation, in nanoseconds.
+    ///
+    /// Percentiles are read off a log-linear histogram and overstate the exact value by at most 1/16th.
+    struct Latency_Summary {
+        std::uint64_t count;
+        std::uint64_t total_ns;     ///< sum of every sample, total_ns / count is the mean
+        std::uint64_t min_ns;
+        std::uint64_t max_ns;
+        std::uint64_t p50_ns;
+        std::uint64_t p99_ns;
+        std::uint64_t p999_ns;
+    };
 
-        switch (code) {
-            case -1: msg_.emplace_back("Unknown error occurred during Gaolette creation.");
-            case 1:  msg_.emplace_back("Invalid performance specification provided.");
-            case 2:  msg_.emplace_back("Insufficient system resources to create Gaolette.");
-            case 3:  msg_.emplace_back("Permission denied to create Gaolette.");
-            default: msg_.emplace_back("Unrecognized error code.");
-        };
+    /// @struct Stats_Payload
+    /// @brief Reply to GET_STATS, everything the Gao process measured since it started.
+    struct Stats_Payload {
+        Latency_Summary queue[STATS_OPCODES];       ///< from a request being read until it starts executing
+        Latency_Summary execute[STATS_OPCODES];     ///< from a request starting to execute until its reply is out
+        Latency_Summary map;                        ///< sectioning off memory for a Gaolette, mmap or commit
+        Latency_Summary unmap;                      ///< releasing a Gaolette's memory, munmap or decommit
+        std::uint64_t requests;                     ///< frames received
+        std::uint64_t failures;                     ///< replies carrying a Status other than OK
+        std::uint64_t offloaded;                    ///< requests run on a worker instead of the control loop
+    };
+
+    static_assert(sizeof(Frame_Header) == 16);
+    static_assert(sizeof(Perf_Spec_Payload) == 24);
+    static_assert(sizeof(Id_Payload) == 4);
+    static_assert(sizeof(Created_Payload) == 8);
+    static_assert(sizeof(State_Payload) == 4);
+    static_assert(sizeof(Shared_Payload) == 16);
+    static_assert(sizeof(Descriptor_Message) == 4);
+    static_assert(sizeof(Batch_Result) == 8);
+    static_assert(sizeof(Hello_Payload) == 4);
+    static_assert(sizeof(Resize_Payload) == 16);
+    static_assert(sizeof(State_Change) == 8);
+    static_assert(sizeof(Latency_Summary) == 56);
+    static_assert(sizeof(Stats_Payload) <= MAX_PAYLOAD);
+    static_assert(MAX_BATCH * sizeof(Perf_Spec_Payload) <= MAX_PAYLOAD);
+
+    /// @brief Builds the header for a frame.
+    constexpr Frame_Header make_header(Opcode opcode, std::uint32_t request_id, std::uint32_t length,
+                                       std::uint8_t flags = 0, Status status = Status::OK) noexcept {
+        return Frame_Header{MAGIC, VERSION, flags, static_cast<std::uint16_t>(opcode),
+                            static_cast<std::uint16_t>(status), length, request_id};
     }
 
-    const char *Failed_To_Create_Gaolette::what() const noexcept {
-            return msg_.data()->c_str();
+    /// @brief Checks magic, version and length of a received header.
+    /// @return Status::OK if the header can be processed.
+    constexpr Status validate(const Frame_Header& header) noexcept {
+        if (header.magic != MAGIC) {
+            return Status::BAD_REQUEST;
+        }
+        if (header.version != VERSION) {
+            return Status::UNSUPPORTED_VERSION;
+        }
+        if (header.length > MAX_PAYLOAD) {
+            return Status::BAD_REQUEST;
+        }
+        return Status::OK;
     }
 }
 
-namespace Gao {
-    inline namespace colors {
-        constexpr auto RESET = "\033[0m";
-        constexpr auto RED = "\033[31m";
-        constexpr auto GREEN = "\033[32m";
-        constexpr auto YELLOW = "\033[33m";
-        constexpr auto BLUE = "\033[34m";
-        constexpr auto MAGENTA = "\033[35m";
-        constexpr auto CYAN = "\033[36m";
-        constexpr auto BOLD = "\033[1m";
-        constexpr auto UNDERLINE = "\033[4m";
+/// @brief Asynchronous logging for the Orchestrator.
+///
+/// Entries are compact binary records pushed into a bounded lock-free ring: a timestamp, a type, a format string and
+/// up to MAX_ARGS scalar arguments. Nothing is formatted or allocated when an entry is made, a background drainer (or
+/// whoever calls drain) turns the records into text or binary output later. Entries made while the ring is full are
+/// dropped and counted instead of blocking.
+namespace Gao::logging {
+    constexpr std::size_t DEFAULT_CAPACITY = 512;   ///< records in the ring, must be a power of two
+    constexpr std::uint32_t MAX_ARGS = 4;           ///< arguments a record carries, extra ones are ignored
+    constexpr std::size_t LINE_SIZE = 512;          ///< longest formatted entry, longer ones are cut
+    constexpr std::size_t OUT_BUFFER_SIZE = 16 * 1024;
+
+    enum class Log_Type : std::uint8_t {
+        GENERIC_SUCCESS,
+        GENERIC_FAILURE,
+        GENERIC_NOTICE,
+        GENERIC_WARNING,
+    };
 
-        constexpr auto BG_RED = "\033[41m";
-        constexpr auto BG_GREEN = "\033[42m";
-        constexpr auto BG_YELLOW = "\033[43m";
-        constexpr auto BG_BLUE = "\033[44m";
-        constexpr auto BG_MAGENTA = "\033[45m";
-        constexpr auto BG_CYAN = "\033[46m";
-        constexpr auto BG_WHITE = "\033[47m";
-        constexpr auto BG_RESET = "\033[49m";
+    /// What the drainer writes.
+    enum class Sink : std::uint8_t {
+        TEXT,   ///< one line per entry, colored if the descriptor is a terminal
+        BINARY  ///< a Binary_Record per entry followed by its format and string arguments, see Binary_Record
+    };
+
+    enum class Arg_Kind : std::uint8_t {
+        NONE,
+        SIGNED,
+        UNSIGNED,
+        FLOAT,
+        STRING  ///< a const char* that outlives the entry, i.e. a string literal
+    };
+
+    /// @struct Record
+    /// @brief A log entry as it sits in the ring, formatted only once it is drained.
+    struct Record {
+        std::uint64_t time;                 ///< CLOCK_REALTIME in nanoseconds
+        const char* format;                 ///< "{}" is replaced by the next argument
+        std::uint64_t args[MAX_ARGS];       ///< bit patterns of the arguments, see kinds
+        Arg_Kind kinds[MAX_ARGS];
+        Log_Type type;
+        std::uint8_t count;
+    };
+
+    /// @struct Binary_Record
+    /// @brief Header of an entry written to a BINARY sink.
+    ///
+    /// Followed by format_length bytes of format, then the bytes of every STRING argument, whose args slot holds its
+    /// length instead of a pointer. All fields are in host byte order.
+    struct Binary_Record {
+        std::uint64_t time;
+        std::uint64_t args[MAX_ARGS];
+        Log_Type type;
+        std::uint8_t count;
+        Arg_Kind kinds[MAX_ARGS];
+        std::uint16_t format_length;
+    };
+
+    static_assert(sizeof(Binary_Record) == 48, "Binary_Record layout is part of the BINARY sink format");
+
+    /// @class Logger
+    /// @brief Bounded multi-producer ring of Records with a single consumer at a time.
+    ///
+    /// push never blocks, locks or allocates; the ring and the output buffer are allocated up front.
+    class Logger {
+        // slot of the ring, sequence tells producers and the consumer whose turn it is (Vyukov's bounded queue)
+        struct alignas(64) Cell {
+            std::atomic<std::uint64_t> sequence;
+            Record record;
+        };
+
+        static constexpr std::uint32_t IDLE = 0;
+        static constexpr std::uint32_t ASLEEP = 1;      // the drainer waits for a push to wake it
+        static constexpr std::uint32_t STOPPING = 2;
+
+        std::unique_ptr<Cell[]> cells_;
+        std::uint64_t mask_;
+        alignas(64) std::atomic<std::uint64_t> head_ = 0;   ///< records ever claimed by producers
+        alignas(64) std::atomic<std::uint32_t> drainer_state_ = IDLE;
+        std::atomic<std::uint64_t> dropped_ = 0;
+
+        // consumer side, guarded by drain_mutex_ so the drainer and explicit drains take turns
+        std::mutex drain_mutex_;
+        std::uint64_t tail_ = 0;
+        std::unique_ptr<char[]> out_;
+        std::size_t out_length_ = 0;
+        Sink sink_ = Sink::TEXT;
+        int fd_ = STDERR_FILENO;
+        bool colored_ = false;
+        std::thread drainer_;
+
+        template <typename T>
+        static void encode(const T value, std::uint64_t& arg, Arg_Kind& kind) noexcept {
+            if constexpr (std::is_same_v<T, bool>) {
+                arg = value;
+                kind = Arg_Kind::UNSIGNED;
+            } else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+                if constexpr (std::is_signed_v<T>) {
+                    arg = static_cast<std::uint64_t>(static_cast<std::int64_t>(value));
+                    kind = Arg_Kind::SIGNED;
+                } else {
+                    arg = static_cast<std::uint64_t>(value);
+                    kind = Arg_Kind::UNSIGNED;
+                }
+            } else if constexpr (std::is_floating_point_v<T>) {
+                arg = std::bit_cast<std::uint64_t>(static_cast<double>(value));
+                kind = Arg_Kind::FLOAT;
+            } else {
+                static_assert(std::is_convertible_v<T, const char*>, "log arguments must be scalars or literals");
+                arg = reinterpret_cast<std::uint64_t>(static_cast<const char*>(value));
+                kind = Arg_Kind::STRING;
+            }
+        }
+
+        static const char* label(const Log_Type type) noexcept {
+            switch (type) {
+                case Log_Type::GENERIC_SUCCESS: return "SUCCESS";
+                case Log_Type::GENERIC_FAILURE: return "FAILURE";
+                case Log_Type::GENERIC_NOTICE:  return "NOTICE";
+                case Log_Type::GENERIC_WARNING: return "WARNING";
+            }
+            return "?";
+        }
+
+        // same escapes as the colors namespace, which isn't usable from a noexcept drainer as it holds std::strings
+        static const char* color(const Log_Type type) noexcept {
+            switch (type) {
+                case Log_Type::GENERIC_SUCCESS: return "\033[32m\033[1m";
+                case Log_Type::GENERIC_FAILURE: return "\033[31m\033[1m";
+                case Log_Type::GENERIC_NOTICE:  return "\033[34m\033[1m";
+                case Log_Type::GENERIC_WARNING: return "\033[33m\033[1m";
+            }
+            return "";
+        }
+
+        void flush() noexcept {
+            std::size_t written = 0;
+            while (written < out_length_) {
+                const ssize_t n = ::write(fd_, out_.get() + written, out_length_ - written);
+                if (n <= 0) {
+                    if (n == -1 && errno == EINTR) {
+                        continue;
+                    }
+                    break;  // nowhere to report it, the entries are lost
+                }
+                written += static_cast<std::size_t>(n);
+            }
+            out_length_ = 0;
+        }
+
+        // reserves n bytes of out_, flushing first if they don't fit
+        char* reserve(const std::size_t n) noexcept {
+            if (OUT_BUFFER_SIZE - out_length_ < n) {
+                flush();
+            }
+            char* at = out_.get() + out_length_;
+            out_length_ += n;
+            return at;
+        }
+
+        void write_text(const Record& record) noexcept {
+            char line[LINE_SIZE];
+            std::size_t length = 0;
+            const auto append = [&](const char* text, std::size_t n) {
+                n = n < LINE_SIZE - 1 - length ? n : LINE_SIZE - 1 - length;
+                std::memcpy(line + length, text, n);
+                length += n;
+            };
+            const auto append_number = [&](const char* format, auto value) {
+                const int n = std::snprintf(line + length, LINE_SIZE - length, format, value);
+                if (n > 0) {
+                    length += static_cast<std::size_t>(n) < LINE_SIZE - 1 - length
+                                  ? static_cast<std::size_t>(n) : LINE_SIZE - 1 - length;
+                }
+            };
+
+            const std::time_t seconds = static_cast<std::time_t>(record.time / 1000000000);
+            std::tm local{};
+            ::localtime_r(&seconds, &local);
+            length = std::strftime(line, LINE_SIZE, "%Y-%m-%d %H:%M:%S", &local);
+            append_number(".%06u [", static_cast<unsigned>(record.time % 1000000000 / 1000));
+            if (colored_) {
+                append(color(record.type), std::strlen(color(record.type)));
+            }
+            append(label(record.type), std::strlen(label(record.type)));
+            if (colored_) {
+                append("\033[0m", 4);
+            }
+            append("] ", 2);
+
+            std::uint32_t next = 0;
+            for (const char* c = record.format; *c != '\0'; ++c) {
+                if (c[0] != '{' || c[1] != '}' || next >= record.count) {
+                    append(c, 1);
+                    continue;
+                }
+                const std::uint64_t arg = record.args[next];
+                switch (record.kinds[next++]) {
+                    case Arg_Kind::SIGNED:
+                        append_number("%lld", static_cast<long long>(static_cast<std::int64_t>(arg)));
+                        break;
+                    case Arg_Kind::UNSIGNED:
+                        append_number("%llu", static_cast<unsigned long long>(arg));
+                        break;
+                    case Arg_Kind::FLOAT:
+                        append_number("%g", std::bit_cast<double>(arg));
+                        break;
+                    case Arg_Kind::STRING: {
+                        const auto* text = reinterpret_cast<const char*>(arg);
+                        append(text, std::strlen(text));
+                        break;
+                    }
+                    case Arg_Kind::NONE:
+                        break;
+                }
+                ++c;
+            }
+            line[length++] = '\n';
+            std::memcpy(reserve(length), line, length);
+        }
+
+        void write_binary(const Record& record) noexcept {
+            Binary_Record header{};
+            header.time = record.time;
+            header.type = record.type;
+            header.count = record.count;
+            const std::size_t format_length = std::strlen(record.format);
+            header.format_length = static_cast<std::uint16_t>(format_length < UINT16_MAX ? format_length : UINT16_MAX);
+            std::size_t total = sizeof(header) + header.format_length;
+            for (std::uint32_t i = 0; i < record.count; ++i) {
+                header.kinds[i] = record.kinds[i];
+                header.args[i] = record.args[i];
+                if (record.kinds[i] == Arg_Kind::STRING) {
+                    header.args[i] = std::strlen(reinterpret_cast<const char*>(record.args[i]));
+                    total += header.args[i];
+                }
+            }
+            if (total > OUT_BUFFER_SIZE) {
+                return;     // only possible with absurd literals, dropping it keeps the stream parseable
+            }
+
+            char* at = reserve(total);
+            std::memcpy(at, &header, sizeof(header));
+            at += sizeof(header);
+            std::memcpy(at, record.format, header.format_length);
+            at += header.format_length;
+            for (std::uint32_t i = 0; i < record.count; ++i) {
+                if (record.kinds[i] == Arg_Kind::STRING) {
+                    std::memcpy(at, reinterpret_cast<const char*>(record.args[i]), header.args[i]);
+                    at += header.args[i];
+                }
+            }
+        }
+
+        // drain_mutex_ must be held
+        std::size_t drain_locked(const std::size_t max) noexcept {
+            std::size_t drained = 0;
+            if (const std::uint64_t dropped = dropped_.exchange(0, std::memory_order_relaxed); dropped != 0) {
+                Record note{};
+                note.time = now();
+                note.format = "{} log entries dropped, the log ring was full";
+                note.type = Log_Type::GENERIC_WARNING;
+                note.count = 1;
+                encode(dropped, note.args[0], note.kinds[0]);
+                sink_ == Sink::TEXT ? write_text(note) : write_binary(note);
+            }
+            while (drained < max) {
+                Cell& cell = cells_[tail_ & mask_];
+                if (cell.sequence.load(std::memory_order_acquire) != tail_ + 1) {
+                    break;  // empty, or the next producer hasn't finished its record yet
+                }
+                const Record record = cell.record;
+                cell.sequence.store(tail_ + mask_ + 1, std::memory_order_release);
+                ++tail_;
+                ++drained;
+                sink_ == Sink::TEXT ? write_text(record) : write_binary(record);
+            }
+            flush();
+            return drained;
+        }
+
+        [[nodiscard]] bool ready() const noexcept {
+            return cells_[tail_ & mask_].sequence.load(std::memory_order_acquire) == tail_ + 1;
+        }
+
+        void run() noexcept {
+            std::unique_lock lock(drain_mutex_);
+            while (true) {
+                if (drain_locked(SIZE_MAX) != 0) {
+                    continue;
+                }
+                // announce we are about to sleep, then look again so a concurrent push can't be missed
+                std::uint32_t state = IDLE;
+                if (!drainer_state_.compare_exchange_strong(state, ASLEEP, std::memory_order_seq_cst)) {
+                    break;  // STOPPING
+                }
+                if (ready()) {
+                    state = ASLEEP;
+                    drainer_state_.compare_exchange_strong(state, IDLE, std::memory_order_seq_cst);
+                    continue;
+                }
+                lock.unlock();
+                drainer_state_.wait(ASLEEP, std::memory_order_seq_cst);
+                lock.lock();
+                if (drainer_state_.load(std::memory_order_relaxed) == STOPPING) {
+                    break;
+                }
+            }
+            drain_locked(SIZE_MAX);
+        }
+
+    public:
+        /// @param capacity records the ring holds, rounded up to a power of two.
+        explicit Logger(const std::size_t capacity = DEFAULT_CAPACITY)
+            : cells_(std::make_unique<Cell[]>(std::bit_ceil(capacity))), mask_(std::bit_ceil(capacity) - 1),
+              out_(std::make_unique<char[]>(OUT_BUFFER_SIZE)) {
+            for (std::uint64_t i = 0; i <= mask_; ++i) {
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        Logger(const Logger&) = delete;
+        Logger& operator=(const Logger&) = delete;
+
+        ~Logger() {
+            stop();
+        }
+
+        static std::uint64_t now() noexcept {
+            timespec time{};
+            ::clock_gettime(CLOCK_REALTIME, &time);
+            return static_cast<std::uint64_t>(time.tv_sec) * 1000000000 + static_cast<std::uint64_t>(time.tv_nsec);
+        }
+
+        /// @brief Records an entry, format is kept by pointer and must outlive it, as must STRING arguments.
+        /// @return false if the ring was full and the entry was dropped.
+        template <typename... Args>
+        bool push(const Log_Type type, const char* format, const Args... args) noexcept {
+            std::uint64_t position = head_.load(std::memory_order_relaxed);
+            Cell* cell;
+            while (true) {
+                cell = &cells_[position & mask_];
+                const std::uint64_t sequence = cell->sequence.load(std::memory_order_acquire);
+                const auto difference = static_cast<std::int64_t>(sequence - position);
+                if (difference == 0) {
+                    if (head_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (difference < 0) {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                } else {
+                    position = head_.load(std::memory_order_relaxed);
+                }
+            }
+
+            Record& record = cell->record;
+            record.time = now();
+            record.format = format;
+            record.type = type;
+            record.count = 0;
+            const auto add = [&record](const auto arg) noexcept {
+                if (record.count < MAX_ARGS) {
+                    encode(arg, record.args[record.count], record.kinds[record.count]);
+                    ++record.count;
+                }
+            };
+            (add(args), ...);
+            cell->sequence.store(position + 1, std::memory_order_release);
+
+            if (drainer_state_.load(std::memory_order_seq_cst) == ASLEEP) {
+                std::uint32_t state = ASLEEP;
+                if (drainer_state_.compare_exchange_strong(state, IDLE, std::memory_order_seq_cst)) {
+                    drainer_state_.notify_one();
+                }
+            }
+            return true;
+        }
+
+        /// @brief Sets where entries are written, also used by drain while no drainer runs.
+        void set_sink(const Sink sink, const int fd) noexcept {
+            std::lock_guard lock(drain_mutex_);
+            flush();
+            sink_ = sink;
+            fd_ = fd;
+            colored_ = sink == Sink::TEXT && ::isatty(fd) == 1;
+        }
+
+        /// @brief Formats and writes up to max entries on the calling thread.
+        /// @return entries written.
+        std::size_t drain(const std::size_t max = SIZE_MAX) noexcept {
+            std::lock_guard lock(drain_mutex_);
+            return drain_locked(max);
+        }
+
+        /// @brief Starts the background drainer, entries are then written shortly after they are made.
+        /// @throws std::system_error if the thread can't be started.
+        void start() {
+            if (drainer_.joinable()) {
+                return;
+            }
+            drainer_state_.store(IDLE, std::memory_order_relaxed);
+            drainer_ = std::thread(&Logger::run, this);
+        }
+
+        /// @brief Stops the background drainer after it wrote every entry made so far.
+        void stop() noexcept {
+            if (!drainer_.joinable()) {
+                return;
+            }
+            drainer_state_.store(STOPPING, std::memory_order_seq_cst);
+            drainer_state_.notify_one();
+            drainer_.join();
+        }
+    };
+}
+
+/// @brief Shared memory transport between the Orchestrator and the Gao runtime.
+///
+/// A memfd holds one single-producer/single-consumer byte ring per direction. Frames are streamed through the
+/// rings exactly as they would be through the socket. A side that finds its ring empty (or full) spins briefly,
+/// then sleeps on an eventfd doorbell that the other side only rings when it knows someone is asleep.
+/// Both rings may be full at once, so a side waiting for room keeps reading meanwhile.
+/// The socketpair stays open next to the rings so either side notices when the other goes away.
+///
+/// Shared with the Gao runtime, nothing in here allocates or throws.
+namespace Gao::ring {
+    constexpr std::uint32_t MAGIC = 0x52616f47;                 ///< "GaoR"
+    constexpr std::uint32_t VERSION = 1;
+    constexpr std::uint64_t DEFAULT_CAPACITY = 1u << 18;        ///< bytes per direction, must be a power of two
+    constexpr int SPIN_LIMIT = 4096;    ///< polls of the ring before going to sleep, only done on multi-core hosts
+
+    // descriptors the Gao process finds its end of the transport on, installed at spawn time
+    constexpr int MEMFD_FILENO = 3;
+    constexpr int TO_GAO_DATA_FILENO = 4;       ///< rung by the host after writing, Gao sleeps on it when empty
+    constexpr int TO_GAO_SPACE_FILENO = 5;      ///< rung by Gao after reading, the host sleeps on it when full
+    constexpr int TO_HOST_DATA_FILENO = 6;      ///< rung by Gao after writing, the host sleeps on it when empty
+    constexpr int TO_HOST_SPACE_FILENO = 7;     ///< rung by the host after reading, Gao sleeps on it when full
+    constexpr int DOORBELL_COUNT = 4;
+
+    /// Command line flag asking the Gao process to attach to the descriptors above.
+    constexpr const char* SHARED_MEMORY_FLAG = "--transport=shm";
+
+    /// @struct Ring_Header
+    /// @brief Positions of one ring, head and tail only ever grow and are reduced modulo the capacity.
+    struct Ring_Header {
+        alignas(64) std::atomic<std::uint64_t> head;    ///< bytes ever written, stored by the producer only
+        alignas(64) std::atomic<std::uint64_t> tail;    ///< bytes ever read, stored by the consumer only
+        alignas(64) std::atomic<std::uint32_t> consumer_waiting;
+        std::atomic<std::uint32_t> producer_waiting;
+    };
+
+    /// @struct Shared_Block
+    /// @brief Start of the memfd, the ring data follows at data_offset().
+    struct Shared_Block {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint64_t capacity;
+        Ring_Header to_gao;
+        Ring_Header to_host;
+    };
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "ring positions must be address free");
+    static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "ring flags must be address free");
 
+    constexpr std::size_t data_offset() noexcept {
+        return (sizeof(Shared_Block) + 4095) & ~static_cast<std::size_t>(4095);
+    }
+
+    /// @brief Bytes of memfd needed for rings of the given capacity.
+    constexpr std::size_t shared_size(const std::uint64_t capacity) noexcept {
+        return data_offset() + 2 * capacity;
+    }
+
+    /// @brief Lays out a fresh Shared_Block at the start of memory, which must be shared_size(capacity) bytes.
+    inline Shared_Block* initialize(void* memory, const std::uint64_t capacity) noexcept {
+        auto* block = new (memory) Shared_Block{};
+        block->magic = MAGIC;
+        block->version = VERSION;
+        block->capacity = capacity;
+        return block;
+    }
+
+    /// @brief Checks that a mapped memfd of size bytes holds a usable Shared_Block.
+    inline Shared_Block* attach(void* memory, const std::size_t size) noexcept {
+        auto* block = static_cast<Shared_Block*>(memory);
+        if (size < data_offset() || block->magic != MAGIC || block->version != VERSION) {
+            return nullptr;
+        }
+        if (block->capacity == 0 || (block->capacity & (block->capacity - 1)) != 0
+            || shared_size(block->capacity) > size) {
+            return nullptr;
+        }
+        return block;
+    }
+
+    /// @class Channel
+    /// @brief One side's view of both rings, owns neither the mapping nor the descriptors.
+    class Channel {
+        Ring_Header* in_ = nullptr;
+        const char* in_data_ = nullptr;
+        Ring_Header* out_ = nullptr;
+        char* out_data_ = nullptr;
+        std::uint64_t capacity_ = 0;
+
+        int in_data_fd_ = -1;       // waited on while in_ is empty
+        int in_space_fd_ = -1;      // rung after freeing space in in_
+        int out_data_fd_ = -1;      // rung after writing to out_
+        int out_space_fd_ = -1;     // waited on while out_ is full
+        int hangup_fd_ = -1;        // becomes readable once the other side is gone
+        int spin_limit_ = 0;        // spinning is pointless when the other side can't run meanwhile
+
+        Channel(Shared_Block* block, Ring_Header& in, const char* in_data, Ring_Header& out, char* out_data,
+                const int (&doorbells)[DOORBELL_COUNT], int hangup_fd) noexcept
+            : in_(&in), in_data_(in_data), out_(&out), out_data_(out_data), capacity_(block->capacity),
+              in_data_fd_(doorbells[0]), in_space_fd_(doorbells[1]), out_data_fd_(doorbells[2]),
+              out_space_fd_(doorbells[3]), hangup_fd_(hangup_fd),
+              spin_limit_(::sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SPIN_LIMIT : 0) {}
+
+        /// sleeps until doorbell is rung, returns 1 when woken, 0 if the other side hung up, -1 on error
+        int wait(const int doorbell) const noexcept {
+            pollfd fds[2] = {{doorbell, POLLIN, 0}, {hangup_fd_, POLLIN, 0}};
+            while (true) {
+                if (::poll(fds, 2, -1) == -1) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return -1;
+                }
+                if (fds[0].revents & POLLIN) {
+                    eventfd_t count;
+                    ::eventfd_read(doorbell, &count);
+                    return 1;
+                }
+                if (fds[1].revents != 0) {
+                    return 0;
+                }
+            }
+        }
+
+        static void ring(const int doorbell) noexcept {
+            ::eventfd_write(doorbell, 1);
+        }
+
+        // copies up to len of the head - tail readable bytes out and frees their space
+        ssize_t take(void* dst, const std::size_t len, const std::uint64_t tail, const std::uint64_t head) noexcept {
+            const std::size_t n = len < head - tail ? len : static_cast<std::size_t>(head - tail);
+            const std::size_t offset = tail & (capacity_ - 1);
+            const std::size_t first = n < capacity_ - offset ? n : capacity_ - offset;
+            std::memcpy(dst, in_data_ + offset, first);
+            std::memcpy(static_cast<char*>(dst) + first, in_data_, n - first);
+
+            in_->tail.store(tail + n, std::memory_order_seq_cst);
+            if (in_->producer_waiting.exchange(0, std::memory_order_seq_cst) != 0) {
+                ring(in_space_fd_);
+            }
+            return static_cast<ssize_t>(n);
+        }
+
+    public:
+        Channel() = default;
+
+        /// @brief The Orchestrator's view, doorbells are ordered as the *_FILENO constants.
+        static Channel host(Shared_Block* block, const int (&doorbells)[DOORBELL_COUNT], int hangup_fd) noexcept {
+            auto* data = reinterpret_cast<char*>(block) + data_offset();
+            const int fds[DOORBELL_COUNT] = {doorbells[2], doorbells[3], doorbells[0], doorbells[1]};
+            return Channel(block, block->to_host, data + block->capacity, block->to_gao, data, fds, hangup_fd);
+        }
+
+        /// @brief The Gao process's view, using the descriptors installed at spawn time.
+        static Channel gao(Shared_Block* block, int hangup_fd) noexcept {
+            const int fds[DOORBELL_COUNT] = {TO_GAO_DATA_FILENO, TO_GAO_SPACE_FILENO,
+                                             TO_HOST_DATA_FILENO, TO_HOST_SPACE_FILENO};
+            return gao(block, fds, hangup_fd);
+        }
+
+        /// @brief The Gao runtime's view with doorbells ordered as the *_FILENO constants, for a runtime hosted
+        /// in the Orchestrator's own process.
+        static Channel gao(Shared_Block* block, const int (&doorbells)[DOORBELL_COUNT], int hangup_fd) noexcept {
+            auto* data = reinterpret_cast<char*>(block) + data_offset();
+            return Channel(block, block->to_gao, data, block->to_host, data + block->capacity, doorbells, hangup_fd);
+        }
+
+        /// @brief Whether read_some would return data without blocking.
+        [[nodiscard]] bool readable() const noexcept {
+            return in_->head.load(std::memory_order_acquire) != in_->tail.load(std::memory_order_relaxed);
+        }
+
+        /// @brief Reads up to len bytes, blocking until at least one is available.
+        /// @return bytes read, 0 if the other side hung up, -1 on error.
+        ssize_t read_some(void* dst, const std::size_t len) noexcept {
+            const std::uint64_t tail = in_->tail.load(std::memory_order_relaxed);
+            std::uint64_t head = in_->head.load(std::memory_order_acquire);
+
+            for (int spins = 0; head == tail; ++spins) {
+                if (spins >= spin_limit_) {
+                    // announce we are about to sleep, then look again so a concurrent write can't be missed
+                    in_->consumer_waiting.store(1, std::memory_order_seq_cst);
+                    head = in_->head.load(std::memory_order_seq_cst);
+                    if (head == tail) {
+                        const int woke = wait(in_data_fd_);
+                        if (woke <= 0) {
+                            in_->consumer_waiting.store(0, std::memory_order_relaxed);
+                            return woke;
+                        }
+                    }
+                    in_->consumer_waiting.store(0, std::memory_order_relaxed);
+                    spins = 0;
+                }
+                head = in_->head.load(std::memory_order_acquire);
+            }
+
+            return take(dst, len, tail, head);
+        }
+
+        /// @brief Reads up to len bytes without ever sleeping, for a side that watches data_doorbell() itself.
+        /// @return bytes read, or -1 with errno set to EAGAIN if the ring is empty. The doorbell is
+        /// rung by the next write in that case.
+        ssize_t read_available(void* dst, const std::size_t len) noexcept {
+            const std::uint64_t tail = in_->tail.load(std::memory_order_relaxed);
+            std::uint64_t head = in_->head.load(std::memory_order_acquire);
+            if (head == tail) {
+                // same announcement read_some makes before sleeping, then look again so no write is missed
+                in_->consumer_waiting.store(1, std::memory_order_seq_cst);
+                head = in_->head.load(std::memory_order_seq_cst);
+                if (head == tail) {
+                    errno = EAGAIN;
+                    return -1;
+                }
+            }
+            in_->consumer_waiting.store(0, std::memory_order_relaxed);
+            return take(dst, len, tail, head);
+        }
+
+        /// @brief The eventfd rung when data arrives while the reading side announced it is waiting.
+        [[nodiscard]] int data_doorbell() const noexcept {
+            return in_data_fd_;
+        }
+
+        /// @brief The eventfd rung when space frees up while the writing side announced it is waiting.
+        [[nodiscard]] int space_doorbell() const noexcept {
+            return out_space_fd_;
+        }
+
+        /// @brief Whether write_available would take at least one byte.
+        [[nodiscard]] bool writable() const noexcept {
+            return out_->head.load(std::memory_order_relaxed) - out_->tail.load(std::memory_order_acquire) != capacity_;
+        }
+
+        /// @brief Writes up to len bytes without ever sleeping, the rest is for the caller to hold on to.
+        /// @return bytes written, or -1 with errno set to EAGAIN if the ring is full. space_doorbell() is
+        /// rung by the next read in that case.
+        ssize_t write_available(const void* src, const std::size_t len) noexcept {
+            const std::uint64_t head = out_->head.load(std::memory_order_relaxed);
+            std::uint64_t tail = out_->tail.load(std::memory_order_acquire);
+            if (head - tail == capacity_) {
+                // the producer's side of the announcement read_available makes
+                out_->producer_waiting.store(1, std::memory_order_seq_cst);
+                tail = out_->tail.load(std::memory_order_seq_cst);
+                if (head - tail == capacity_) {
+                    errno = EAGAIN;
+                    return -1;
+                }
+            }
+            out_->producer_waiting.store(0, std::memory_order_relaxed);
+
+            const std::size_t free = capacity_ - (head - tail);
+            const std::size_t n = len < free ? len : free;
+            const std::size_t offset = head & (capacity_ - 1);
+            const std::size_t first = n < capacity_ - offset ? n : capacity_ - offset;
+            std::memcpy(out_data_ + offset, src, first);
+            std::memcpy(out_data_, static_cast<const char*>(src) + first, n - first);
+
+            out_->head.store(head + n, std::memory_order_seq_cst);
+            if (out_->consumer_waiting.exchange(0, std::memory_order_seq_cst) != 0) {
+                ring(out_data_fd_);
+            }
+            return static_cast<ssize_t>(n);
+        }
+
+        /// @brief Sleeps until there is room to write or data to read, once write_available and read_available
+        /// both came back with EAGAIN. The other side may be waiting for room itself, so a writer that stops
+        /// reading while its ring is full can deadlock with it.
+        /// @return 1 when woken, 0 if the other side hung up, -1 on error.
+        int wait_writable() const noexcept {
+            for (int spins = 0; spins < spin_limit_; ++spins) {
+                if (writable() || readable()) {
+                    return 1;
+                }
+            }
+
+            pollfd fds[3] = {{out_space_fd_, POLLIN, 0}, {in_data_fd_, POLLIN, 0}, {hangup_fd_, POLLIN, 0}};
+            while (true) {
+                if (::poll(fds, 3, -1) == -1) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return -1;
+                }
+                bool woke = false;
+                for (int i = 0; i < 2; ++i) {
+                    if (fds[i].revents & POLLIN) {
+                        eventfd_t count;
+                        ::eventfd_read(fds[i].fd, &count);
+                        woke = true;
+                    }
+                }
+                if (woke) {
+                    return 1;
+                }
+                if (fds[2].revents != 0) {
+                    return 0;
+                }
+            }
+        }
+    };
+}
+
+/// @brief Entry point of a Gao runtime linked into the Orchestrator's own process.
+///
+/// An Orchestrator built with Transport::EMBEDDED skips the spawn: it sets up the same rings as for
+/// Transport::SHARED_MEMORY in its own memory and serves them from a thread that calls gao_embedded_run.
+/// The runtime is only there when the program links the Gao_Embedded library, otherwise gao_embedded_run
+/// stays null and the Orchestrator refuses the transport.
+///
+/// Shared with the Gao runtime, nothing in here allocates or throws.
+namespace Gao::embedded {
+    /// @brief A size class the runtime keeps prefaulted memory ready for, see Warm_Pool_Class.
+    struct Warm_Class {
+        std::uint64_t size;
+        std::uint32_t count;
+    };
 
-        constexpr inline auto ERROR = std::string("\033[31m") + "\033[1m";
-        constexpr inline auto SUCCESS = std::string("\033[32m") + "\033[1m";
-        constexpr inline auto WARNING = std::string("\033[33m") + "\033[1m";
-        constexpr inline auto NOTICE = std::string("\033[34m") + "\033[1m";
+    /// @brief Everything a hosted runtime is handed instead of descriptors and command line arguments.
+    struct Options {
+        ring::Shared_Block* block;              ///< rings initialized by the Orchestrator
+        int doorbells[ring::DOORBELL_COUNT];    ///< ordered as the *_FILENO constants
+        int hangup_fd;                          ///< eventfd the Orchestrator writes to once it is done
+        int descriptor_fd;                      ///< SOCK_SEQPACKET socket memfds are shared over, see SHARE
+        const char* listen_name;                ///< nullptr, or the name further Orchestrators connect() to
+        const Warm_Class* warm_pool;
+        std::uint32_t warm_pool_count;
+        std::uint32_t workers;                  ///< worker threads, see Runtime_Options
+        bool pin_workers;                       ///< one per CPU the runtime thread may run on
+        bool io_uring;                          ///< waits on the doorbells through io_uring instead of epoll
+    };
+}
+
+/// @brief Serves options->block on the calling thread until options->hangup_fd turns readable.
+/// Only one runtime runs per process, a second caller is turned away while the first one serves.
+/// Defined by the Gao_Embedded library, null unless it is linked in.
+/// @return 0 once the Orchestrator hung up, -1 if the runtime is busy or can't be set up.
+extern "C" int gao_embedded_run(const Gao::embedded::Options* options) noexcept __attribute__((weak));
+
+/// @brief Latency histograms kept by the Orchestrator and the Gao runtime.
+///
+/// Shared with the Gao runtime, nothing in here allocates or throws.
+namespace Gao::stats {
+    constexpr std::uint32_t SUB_BUCKET_BITS = 4;    ///< 16 buckets per power of two, at most 1/16th off
+    constexpr std::uint32_t MAX_EXPONENT = 40;      ///< samples from 2^40 ns (18 minutes) on share the last bucket
+    constexpr std::uint32_t BUCKETS = (MAX_EXPONENT - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS;
+
+    /// @brief Nanoseconds on CLOCK_MONOTONIC, served by the vDSO.
+    inline std::uint64_t now() noexcept {
+        timespec time{};
+        ::clock_gettime(CLOCK_MONOTONIC, &time);
+        return static_cast<std::uint64_t>(time.tv_sec) * 1000000000 + static_cast<std::uint64_t>(time.tv_nsec);
+    }
+
+    /// @brief Bucket a sample falls into, exact below 2^SUB_BUCKET_BITS and log-linear above.
+    constexpr std::uint32_t bucket_of(std::uint64_t value) noexcept {
+        constexpr std::uint64_t largest = (static_cast<std::uint64_t>(1) << MAX_EXPONENT) - 1;
+        value = value < largest ? value : largest;
+        if (value < (1u << SUB_BUCKET_BITS)) {
+            return static_cast<std::uint32_t>(value);
+        }
+        const std::uint32_t exponent = static_cast<std::uint32_t>(std::bit_width(value)) - 1;
+        const std::uint32_t shift = exponent - SUB_BUCKET_BITS;
+        return ((shift + 1) << SUB_BUCKET_BITS)
+               + static_cast<std::uint32_t>((value >> shift) - (1u << SUB_BUCKET_BITS));
+    }
+
+    /// @brief Largest sample that falls into bucket.
+    constexpr std::uint64_t highest_in(const std::uint32_t bucket) noexcept {
+        if (bucket < (1u << SUB_BUCKET_BITS)) {
+            return bucket;
+        }
+        const std::uint32_t shift = (bucket >> SUB_BUCKET_BITS) - 1;
+        const std::uint64_t sub = (1u << SUB_BUCKET_BITS) + (bucket & ((1u << SUB_BUCKET_BITS) - 1));
+        return ((sub + 1) << shift) - 1;
+    }
+
+    static_assert(bucket_of(15) == 15 && bucket_of(16) == 16 && bucket_of(31) == 31 && bucket_of(32) == 32);
+    static_assert(highest_in(bucket_of(1000)) >= 1000 && highest_in(bucket_of(1000)) < 1000 + 1000 / 16 + 1);
+    static_assert(bucket_of(~static_cast<std::uint64_t>(0)) == BUCKETS - 1);
+
+    /// @class Histogram
+    /// @brief Latency histogram any number of threads record into concurrently.
+    ///
+    /// record is a handful of relaxed atomic adds, summary reads a snapshot that may be torn by concurrent records.
+    class Histogram {
+        std::atomic<std::uint64_t> buckets_[BUCKETS] = {};
+        std::atomic<std::uint64_t> count_ = 0;
+        std::atomic<std::uint64_t> total_ = 0;
+        std::atomic<std::uint64_t> min_ = ~static_cast<std::uint64_t>(0);
+        std::atomic<std::uint64_t> max_ = 0;
+
+    public:
+        void record(const std::uint64_t nanoseconds) noexcept {
+            buckets_[bucket_of(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+            count_.fetch_add(1, std::memory_order_relaxed);
+            total_.fetch_add(nanoseconds, std::memory_order_relaxed);
+            // the extremes are rarely beaten, so they are only written when they are
+            std::uint64_t min = min_.load(std::memory_order_relaxed);
+            while (nanoseconds < min && !min_.compare_exchange_weak(min, nanoseconds, std::memory_order_relaxed)) {}
+            std::uint64_t max = max_.load(std::memory_order_relaxed);
+            while (nanoseconds > max && !max_.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed)) {}
+        }
+
+        /// @brief Records the time elapsed since start, a value returned by now().
+        void record_since(const std::uint64_t start) noexcept {
+            record(now() - start);
+        }
+
+        [[nodiscard]] protocol::Latency_Summary summary() const noexcept {
+            protocol::Latency_Summary summary{};
+            std::uint64_t counts[BUCKETS];
+            for (std::uint32_t i = 0; i < BUCKETS; ++i) {
+                counts[i] = buckets_[i].load(std::memory_order_relaxed);
+                summary.count += counts[i];
+            }
+            if (summary.count == 0) {
+                return summary;
+            }
+            summary.total_ns = total_.load(std::memory_order_relaxed);
+            summary.min_ns = min_.load(std::memory_order_relaxed);
+            summary.max_ns = max_.load(std::memory_order_relaxed);
+
+            // rank of a percentile is rounded up, so p999 of fewer than 1000 samples is the largest one
+            const auto rank = [&](const std::uint64_t per_mille) {
+                return (summary.count * per_mille + 999) / 1000;
+            };
+            const std::uint64_t ranks[3] = {rank(500), rank(990), rank(999)};
+            std::uint64_t* results[3] = {&summary.p50_ns, &summary.p99_ns, &summary.p999_ns};
+            std::uint64_t seen = 0;
+            std::uint32_t next = 0;
+            for (std::uint32_t i = 0; i < BUCKETS && next < 3; ++i) {
+                seen += counts[i];
+                while (next < 3 && seen >= ranks[next]) {
+                    const std::uint64_t highest = highest_in(i);
+                    *results[next++] = highest < summary.max_ns ? highest : summary.max_ns;
+                }
+            }
+            return summary;
+        }
+    };
+}
+
+extern char **environ;
+
+namespace Gao::exceptions {
+    ///
+    /// @class Failed_To_Create_Gaolette
+    /// @brief Exception thrown with added context based off code.
+    ///
+    /// Gaolette creation may result in failure, in such cases this exception handles
+    /// all known error codes with added context based off the code.
+    class Failed_To_Create_Gaolette : public std::exception {
+        std::vector<std::string> msg_;
+        int code = -1;
+    public:
+        explicit Failed_To_Create_Gaolette(int code);
+
+        [[nodiscard]] const char* what() const noexcept override;
+    };
+}
+
+namespace Gao {
+    inline namespace colors {
+        constexpr auto RESET = "\033[0m";
+        constexpr auto RED = "\033[31m";
+        constexpr auto GREEN = "\033[32m";
+        constexpr auto YELLOW = "\033[33m";
+        constexpr auto BLUE = "\033[34m";
+        constexpr auto MAGENTA = "\033[35m";
+        constexpr auto CYAN = "\033[36m";
+        constexpr auto BOLD = "\033[1m";
+        constexpr auto UNDERLINE = "\033[4m";
+
+        constexpr auto BG_RED = "\033[41m";
+        constexpr auto BG_GREEN = "\033[42m";
+        constexpr auto BG_YELLOW = "\033[43m";
+        constexpr auto BG_BLUE = "\033[44m";
+        constexpr auto BG_MAGENTA = "\033[45m";
+        constexpr auto BG_CYAN = "\033[46m";
+        constexpr auto BG_WHITE = "\033[47m";
+        constexpr auto BG_RESET = "\033[49m";
+
+
+        inline const auto ERROR = std::string("\033[31m") + "\033[1m";
+        inline const auto SUCCESS = std::string("\033[32m") + "\033[1m";
+        inline const auto WARNING = std::string("\033[33m") + "\033[1m";
+        inline const auto NOTICE = std::string("\033[34m") + "\033[1m";
+    }
+
+    /// @enum State
+    /// @brief Possible states a Gaolette may present itself.
+    ///
+    /// Allows Gao to restrict and place constraints on what the user may
+    /// do to a Gaolette at any given time.
+    enum class State {
+        Operational, ///< the Gaolette is open for read/write
+        ShutDown, ///< the Gaolette is closed for read/write (Gaolette has been killed)
+        Locked, ///< the Gaolette is locked and is read-only
+        Operating, ///< the Gaolette is running code and is open for read/write for console
+        Illformed ///< the Gaolette is ill-formed and cannot be used
+    };
+
+    // I kept the State::Operating to write/read in
+    // case the code operating in the Gaolette requires I/O
+
+    /// @enum Memory_Policy
+    /// @brief Specifies ability for Gaolette to expand/contract when needed
+    enum class Memory_Policy {
+        // defines contraction/expansion policies of the Gaolette's memory
+        STATIC,    ///< fixed size, no contraction/expansion
+        DYNAMIC    ///< allow contraction/expansion up to max_memory_usage_, see resize_gaolette
+    };
+
+    /// @enum Page_Size
+    /// @brief Pages backing a Gaolette's memory, larger pages mean fewer TLB misses on random access
+    enum class Page_Size {
+        DEFAULT,            ///< the system's base pages
+        TRANSPARENT_HUGE,   ///< transparent huge pages, sizes are rounded up to whole huge pages
+        EXPLICIT_HUGE       ///< pages from the preallocated huge page pool, falls back to TRANSPARENT_HUGE
+    };
+
+    /// @enum Numa_Policy
+    /// @brief NUMA node a Gaolette's memory comes from, every policy is first touch on single node hosts.
+    ///
+    /// The Gaolette's tasks, copying and scrubbing its memory, run on workers of that node once the Gao process
+    /// pins its workers over several nodes, see Runtime_Options; otherwise any worker runs them.
+    enum class Numa_Policy {
+        FIRST_TOUCH,        ///< whichever node faults a page in first, the kernel's default
+        PREFERRED,          ///< numa_node_ while it has free memory, the Gaolette's tasks prefer its CPUs too
+        INTERLEAVE,         ///< round-robin over every node, for Gaolettes used from the whole machine
+        LOCAL_TO_WORKERS    ///< a node the Gao process has pinned workers on, first touch while none are pinned
+    };
+
+    /// @struct Perf_Spec
+    /// @brief Performance Specification for Gaolette instance.
+    ///
+    /// Specifies constraints for the Gaolette instance if needed.
+    /// All fields have default values if not specified.
+    struct Perf_Spec {
+        // basic performance specification
+        std::size_t size_;           ///< total memory delegated to the sandbox in bytes
+        Memory_Policy memory_policy_;
+        std::size_t max_memory_usage_;    ///< in bytes, address space reserved up front for DYNAMIC Gaolettes
+        std::size_t max_cpu_cores_;  ///< threads copying or scrubbing the Gaolette's memory at once, 0 for no cap
+        Page_Size page_size_;   ///< requested pages, the created Gaolette's perf_spec holds the ones actually used
+        Numa_Policy numa_policy_;
+        std::uint8_t numa_node_;    ///< node for Numa_Policy::PREFERRED, a node that isn't online means FIRST_TOUCH
+
+        // extended process/resource limits
+        /*std::size_t max_open_files_;
+        std::size_t max_threads_;
+        std::size_t max_stack_size_;
+        std::size_t max_runtime_ms_;
+        std::size_t max_cpu_time_ms_;
+
+        // security and isolation
+        bool allow_network_;
+        bool allow_filesystem_;
+        bool restrict_privileges_;
+        std::vector<std::string> allowed_syscalls_;
+        std::vector<std::string> allowed_env_vars_;
+
+        // scheduling and priorities
+        int cpu_priority_;
+        int io_priority_;
+        std::vector<int> cpu_affinity_;
+
+        // sandboxing features
+        std::string chroot_dir_;
+        std::vector<std::string> allowed_mounts_;
+        bool enable_seccomp_;
+        bool enable_cgroups_;*/
+    };
+
+    /// Gaolette ID type used to reference some Gaolette.
+    /// -1 specifies an ill-formed gaolette
+    using gaolette_id_t = int;
+
+    /// @struct Gaolette
+    /// @brief Gaolette instance
+    ///
+    /// Represents a Gaolette instance.
+    struct Gaolette {
+        gaolette_id_t id;
+        State state;
+        Perf_Spec perf_spec;
+    };
+
+    /// @struct Batch_Entry
+    /// @brief Outcome of a single item of create_gaolettes.
+    struct Batch_Entry {
+        Gaolette gaolette;  ///< id is -1 and state Illformed if the item failed
+        int error_code;     ///< 0 on success, otherwise a code understood by exceptions::Failed_To_Create_Gaolette
+    };
+
+    /// @struct Warm_Pool_Class
+    /// @brief Gaolette size the Gao process keeps prefaulted memory ready for.
+    ///
+    /// Creating a STATIC Gaolette of exactly size_ bytes with Page_Size::DEFAULT then takes no page faults,
+    /// destroying one scrubs its memory and hands it back to the pool.
+    struct Warm_Pool_Class {
+        std::size_t size_;      ///< Gaolette size in bytes
+        std::uint32_t count_;   ///< regions kept ready
+    };
+
+    /// @struct Runtime_Options
+    /// @brief How the Gao process runs the requests it is sent.
+    ///
+    /// The defaults run every request on the Gao process' single control loop.
+    struct Runtime_Options {
+        std::uint32_t workers_ = 0;     ///< threads requests and Gaolette memory work run on, 0 for none
+        bool pin_workers_ = false;      ///< one worker per CPU the Gao process may use, see LOCAL_TO_WORKERS
+        bool io_uring_ = false;         ///< serves the transport through io_uring, epoll where the kernel lacks it
+    };
+
+    /// @class Gaolette_Window
+    /// @brief Part of a Gaolette's memory mapped into this process, see Gaolette_Memory::map.
+    ///
+    /// Reads and writes go straight to the Gaolette's pages, the mapping is dropped on destruction.
+    class Gaolette_Window {
+        void* mapping_ = nullptr;       ///< page aligned start of the mapping
+        std::size_t mapping_size_ = 0;
+        std::byte* data_ = nullptr;     ///< the offset asked for, inside the mapping's first page
+        std::size_t size_ = 0;
+
+    public:
+        Gaolette_Window() = default;
+        Gaolette_Window(void* mapping, std::size_t mapping_size, std::size_t skew, std::size_t size) noexcept;
+        Gaolette_Window(Gaolette_Window&& other) noexcept;
+        Gaolette_Window& operator=(Gaolette_Window&& other) noexcept;
+        Gaolette_Window(const Gaolette_Window&) = delete;
+        Gaolette_Window& operator=(const Gaolette_Window&) = delete;
+        ~Gaolette_Window();
+
+        [[nodiscard]] std::byte* data() const noexcept;
+        [[nodiscard]] std::size_t size() const noexcept;
+    };
+
+    /// @class Gaolette_Memory
+    /// @brief The memfd backing a Gaolette, handed over by share_gaolette.
+    ///
+    /// Data is moved in and out of the Gaolette at memory bandwidth instead of through requests: map a window of
+    /// it, or stream into it with splice_from. The memfd stays valid once the Gaolette is destroyed, but is no
+    /// longer its memory then.
+    class Gaolette_Memory {
+        int fd_ = -1;
+        std::size_t size_ = 0;
+        bool writable_ = false;
+
+    public:
+        Gaolette_Memory() = default;
+        Gaolette_Memory(int fd, std::size_t size, bool writable) noexcept;
+        Gaolette_Memory(Gaolette_Memory&& other) noexcept;
+        Gaolette_Memory& operator=(Gaolette_Memory&& other) noexcept;
+        Gaolette_Memory(const Gaolette_Memory&) = delete;
+        Gaolette_Memory& operator=(const Gaolette_Memory&) = delete;
+        ~Gaolette_Memory();
+
+        ///@brief the memfd itself, for pread, pwrite, sendfile and the like; owned by this instance.
+        [[nodiscard]] int fd() const noexcept;
+
+        ///@brief the Gaolette's size when it was shared, resizing it later doesn't change this.
+        [[nodiscard]] std::size_t size() const noexcept;
+
+        ///@brief false for locked Gaolettes, their memfd is sealed against writes.
+        [[nodiscard]] bool writable() const noexcept;
+
+        ///@brief maps length bytes from offset, shared with the Gaolette and read-only unless writable().
+        ///
+        /// offset needs no alignment. Mapping is independent of length, pages are only faulted in as they are used.
+        /// @throws std::out_of_range if the window reaches past size().
+        /// @throws std::runtime_error if the mapping fails.
+        [[nodiscard]] Gaolette_Window map(std::size_t offset, std::size_t length) const;
+
+        ///@brief moves length bytes read from fd into the Gaolette at offset without copying them through this
+        /// process, with splice; fd may be a pipe, file or socket.
+        ///
+        /// @return bytes moved, less than length only if fd ran out first.
+        /// @throws std::out_of_range if the bytes would reach past size().
+        /// @throws std::runtime_error if the Gaolette isn't writable() or splicing fails.
+        std::size_t splice_from(int fd, std::size_t offset, std::size_t length) const;
+    };
+
+    /// @class Orchestrator
+    /// @brief Low-level controller for a Gao process, aka the gateway API that links Gao processes to the Gao API.
+    ///
+    /// Base of all base.
+    /// Handles IPC with the Gao process and manages its lifecycle.
+    class Orchestrator {
+        pid_t pid_ = 0;
+        int status_ = 0;
+        static inline const char* arch_ = nullptr;
+        posix_spawn_file_actions_t actions_;
+        int socket_;
+        int descriptors_ = -1;      ///< SOCK_SEQPACKET socket the memfds of share_gaolette arrive on
+        std::atomic<bool> logging_ = false;
+        mutable std::atomic<std::uint32_t> request_id_ = 1;
+
+        protocol::Transport transport_ = protocol::Transport::SOCKET;
+        void* shared_ = nullptr;    ///< mapping holding the rings of the SHARED_MEMORY and EMBEDDED transports
+        int doorbells_[ring::DOORBELL_COUNT] = {-1, -1, -1, -1};
+        mutable ring::Channel channel_;
+
+        // the EMBEDDED transport's runtime thread, told to stop through embedded_hangup_; it writes to
+        // embedded_exit_ once it returned, which reads as the Gao process hanging up
+        std::thread embedded_;
+        int embedded_hangup_ = -1;
+        int embedded_exit_ = -1;
+        int embedded_descriptors_ = -1;     ///< the runtime thread's end of descriptors_
+        static inline std::atomic<bool> embedded_in_use_ = false;  ///< the runtime serves one Orchestrator per process
+
+        ///@brief creates the memfd, its mapping and the doorbells for the SHARED_MEMORY and EMBEDDED transports.
+        /// @param memfd receives the memfd to hand to the Gao process.
+        /// @param hangup_fd turns readable once the Gao process is gone, the channel stops waiting then.
+        /// @return false if any of it could not be set up, nothing is left open in that case.
+        bool open_shared_memory(int& memfd, int hangup_fd);
+
+        ///@brief serves the rings from a runtime thread in this process instead of spawning a Gao process.
+        /// @throws std::runtime_error if the Gao_Embedded library isn't linked in, already serves another
+        /// Orchestrator, or the rings or the runtime thread can't be set up; nothing is left open then.
+        void start_embedded(std::span<const Warm_Pool_Class> warm_pool, std::string_view listen_name,
+                            const Runtime_Options& runtime);
+
+        ///@brief releases everything open_shared_memory set up, safe to call more than once.
+        void close_shared_memory(int& memfd) noexcept;
+
+        static constexpr std::size_t IN_BUFFER_SIZE = 64 * 1024;
+
+        // input buffer of read_frame, every read pulls in as much as the transport has ready and bytes past a
+        // frame are kept as lookahead for the next call
+        mutable std::vector<char> in_buffer_ = std::vector<char>(IN_BUFFER_SIZE);
+        mutable std::size_t in_begin_ = 0;
+        mutable std::size_t in_end_ = 0;
+
+        ///@brief reads at least one byte from the active transport.
+        /// @return number of bytes read, 0 if the Gao process hung up.
+        /// @throws std::runtime_error on read failure.
+        std::size_t read_some(void* dst, std::size_t len) const;
+
+        ///@brief reads from the transport until at least want bytes are buffered, growing in_buffer_ if needed.
+        /// @return false if the Gao process hung up first.
+        bool fill(std::size_t want) const;
+
+        ///@brief drops n buffered bytes from the front of in_buffer_.
+        void consume(std::size_t n) const noexcept;
+
+        ///@brief whether a read would return without blocking.
+        [[nodiscard]] bool readable() const;
+
+    public:
+        /// @struct Reply
+        /// @brief A reply frame received from the Gao process.
+        struct Reply {
+            protocol::Frame_Header header;
+            std::string payload;
+        };
+
+        /// Called with the id and latest state of a Gaolette a subscription covers, see subscribe.
+        using State_Callback = std::function<void(gaolette_id_t, State)>;
+
+    private:
+        // several callers may have requests in flight at once, whoever waits for a reply
+        // reads frames off socket_ (reading_) and files other callers' replies in replies_
+        mutable std::mutex write_mutex_;
+        mutable std::mutex reply_mutex_;
+        mutable std::condition_variable reply_cv_;
+        mutable bool reading_ = false;
+        mutable std::unordered_map<std::uint32_t, Reply> replies_;  ///< arrived but not yet claimed
+        mutable std::unordered_set<std::uint32_t> discarded_;       ///< replies nobody will claim
+        // pushed state changes not yet dispatched, coalesced per Gaolette as the Gao process does: one entry per
+        // Gaolette, plus one per Gaolette that shut down before its id was reused
+        mutable std::vector<protocol::State_Change> notifications_;
+        mutable std::unordered_map<gaolette_id_t, std::size_t> notified_;  ///< id to its latest entry
+
+        // when the requests in flight were sent, by request id, so replies are timed without allocating;
+        // a slot reused before its reply arrived costs that one sample
+        struct Send_Stamp {
+            std::atomic<std::uint32_t> request_id;
+            std::atomic<std::uint64_t> sent;
+        };
+        static constexpr std::size_t SEND_STAMPS = 4096;
+        std::unique_ptr<Send_Stamp[]> send_stamps_ = std::make_unique<Send_Stamp[]>(SEND_STAMPS);
+        std::unique_ptr<stats::Histogram[]> round_trips_ =
+            std::make_unique<stats::Histogram[]>(protocol::STATS_OPCODES);    ///< by opcode
+
+        struct Subscriber {
+            std::uint64_t handle;
+            std::shared_ptr<const State_Callback> callback;
+        };
+
+        // subscribe and unsubscribe hold subscription_mutex_ through their round trip, so the SUBSCRIBE and
+        // UNSUBSCRIBE requests for a Gaolette go out in the order its subscriber list changed in
+        mutable std::mutex subscription_mutex_;
+        mutable std::uint64_t next_subscription_ = 1;
+        mutable std::unordered_map<gaolette_id_t, std::vector<Subscriber>> subscribers_;
+        mutable std::unordered_map<std::uint64_t, gaolette_id_t> subscriptions_;   ///< handle to subscribed id
+
+        // memfds read off descriptors_ by whoever waited for one, filed here until their request claims them
+        mutable std::mutex descriptor_mutex_;
+        mutable std::unordered_map<std::uint32_t, int> descriptors_received_;
+
+        ///@brief reads one frame off socket_ and files it, replies in replies_ and pushed state changes in
+        /// notifications_; reply_mutex_ must be held through lock.
+        ///
+        /// @param block whether to wait for a frame if none is readable yet.
+        /// @return whether a frame was read.
+        bool pump(std::unique_lock<std::mutex>& lock, bool block) const;
+
+        static std::filesystem::path get_gao_binary();
+
+        ///@brief takes over a connected socket_, see connect.
+        explicit Orchestrator(int socket);
+
+        ///@brief reads the HELLO frame the Gao process opens every connection with.
+        /// @return whether it arrived, payload receives its payload.
+        bool await_hello(protocol::Hello_Payload& hello) const;
+
+        using Log_Type = logging::Log_Type;
+
+        /// Log priority, specifies whether a log is to be printed regardless of the logging_ member
+        enum class Log_Prio {
+            ONLY_IF_LOGGING, /// only if logging_ is true, costs nothing otherwise
+            ANY /// will always be printed, by the drainer or once dump_logs is invoked
+        };
+
+        mutable logging::Logger logs_;
+
+        ///@brief Records an entry in logs_, never allocates or blocks.
+        ///
+        /// format and arguments are only formatted once drained, see logging::Logger::push for what they may be.
+        template <typename... Args>
+        void log(const Log_Type type, const Log_Prio prio, const char* format, const Args... args) const noexcept {
+            if (prio == Log_Prio::ONLY_IF_LOGGING && !logging_.load(std::memory_order_relaxed)) {
+                return;
+            }
+            logs_.push(type, format, args...);
+        }
+
+        ///@brief Prints oldest log in logs_
+        void print_log() const noexcept;
+
+
+    public:
+        /// @brief Constructor and initializer for Orchestrator instances and Gao processes respectively.
+        ///
+        /// Initializes and modifies Gao processes on launch to ensure IPC
+        /// @param terminate_with_parent whether the child process should after the death of the parent
+        /// continue and become an orphan (possibly adopted by reaper) or terminate with the parent.
+        /// @param transport preferred transport, falls back to the socket if the Gao process can't use it.
+        /// EMBEDDED never falls back: the runtime is served from a thread of this process, see Gao_Embedded.hpp.
+        /// @param warm_pool size classes the Gao process keeps prefaulted memory ready for.
+        /// @param listen_name if not empty, further Orchestrators can connect() to the Gao process under this name.
+        /// @param runtime worker threads and I/O backend of the Gao process, see Runtime_Options.
+        /// @throws std::runtime_error if the Gao process can't be spawned or doesn't complete the handshake.
+        explicit Orchestrator(bool terminate_with_parent = true,
+                              protocol::Transport transport = protocol::Transport::SOCKET,
+                              std::span<const Warm_Pool_Class> warm_pool = {},
+                              std::string_view listen_name = {},
+                              const Runtime_Options& runtime = {});
+
+        ///@brief connects to a Gao process spawned by another Orchestrator with a listen_name.
+        ///
+        /// The Gao process and its Gaolettes are shared by everyone connected to it, it keeps running for as long
+        /// as the Orchestrator that spawned it does. Only processes of the same user can connect.
+        /// @throws std::runtime_error if nothing listens under listen_name or the handshake fails.
+        [[nodiscard]] static std::unique_ptr<Orchestrator> connect(std::string_view listen_name);
+
+        /// Destructor for Orchestrator instances and Gao processes.
+        ~Orchestrator();
+
+        ///@brief the transport negotiated with the Gao process at spawn time.
+        [[nodiscard]] protocol::Transport transport() const noexcept;
+
+        ///@brief turns logging of this Orchestrator's activity on or off.
+        ///
+        /// While on, a background thread writes entries to fd shortly after they are made. While off only failures
+        /// are recorded, they wait in a bounded buffer for dump_logs and the newest are dropped once it is full.
+        /// @param sink whether to write text lines or binary records, see logging::Binary_Record.
+        /// @throws std::system_error if the background thread can't be started.
+        void set_logging(bool enabled, logging::Sink sink = logging::Sink::TEXT, int fd = STDERR_FILENO);
+
+        ///@brief writes every recorded entry to the sink set_logging chose (text on stderr by default).
+        void dump_logs() const noexcept;
+
+        ///@brief writes a single frame (header and payload) to the Gao process in one syscall.
+        ///
+        /// @param header the frame's header, header.length bytes are taken from payload.
+        /// @param payload the frame's payload, may be nullptr if header.length is 0.
+        /// @return number of bytes written, -1 on error.
+        int write_frame(const protocol::Frame_Header& header, const void* payload) const;
+
+        ///@brief writes len bytes to the ring of the SHARED_MEMORY and EMBEDDED transports.
+        /// @return 0 on success, -1 if the Gao process hung up or on error.
+        int write_ring(const void* src, std::size_t len) const;
+
+        ///@brief waits for room in the ring write_ring found full. The Gao process may be waiting for room for
+        /// its replies in turn, so they are read into in_buffer_ meanwhile unless another caller is reading them.
+        /// @return false if the Gao process hung up or on error.
+        bool await_ring_space() const;
+
+        ///@brief reads exactly one frame from socket_.
+        ///
+        /// @param payload receives the frame's payload, resized to the header's length.
+        /// @return the frame's header.
+        /// @throws std::runtime_error on read failure, EOF or a malformed header.
+        protocol::Frame_Header read_frame(std::string& payload) const;
+
+        ///@brief sends a request to the Gao process without waiting for its reply.
+        ///
+        /// @param opcode command to send.
+        /// @param payload request payload, may be nullptr if length is 0.
+        /// @param length size of payload in bytes.
+        /// @return the request id to claim the reply with.
+        /// @throws std::runtime_error if the request could not be written.
+        std::uint32_t send_request(protocol::Opcode opcode, const void* payload, std::uint32_t length) const;
+
+        ///@brief blocks until the reply to request_id arrives, replies may arrive in any order.
+        ///
+        /// @param request_id id returned by send_request, each reply can only be claimed once.
+        /// @return the reply, its header's status field carries the result of the command.
+        /// @throws std::runtime_error on read failure or if the Gao process hangs up.
+        Reply wait_reply(std::uint32_t request_id) const;
+
+        ///@brief checks whether the reply to request_id has arrived, never blocks.
+        [[nodiscard]] bool reply_ready(std::uint32_t request_id) const;
+
+        ///@brief drops the reply to request_id, now or whenever it arrives.
+        void discard_reply(std::uint32_t request_id) const noexcept;
+
+        ///@brief sends a request to the Gao process and blocks until its reply arrives.
+        ///
+        /// @return the reply, see wait_reply.
+        Reply request(protocol::Opcode opcode, const void* payload, std::uint32_t length) const;
+
+        ///@brief takes the memfd the Gao process sent ahead of its reply to the SHARE request request_id.
+        ///
+        /// Only call once that reply came back OK, the memfd is there by then; the caller owns it.
+        /// @throws std::runtime_error if this Orchestrator has no descriptor socket or it fails.
+        [[nodiscard]] int take_descriptor(std::uint32_t request_id) const;
+
+        ///@brief has the Gao process push the state changes of the Gaolette id, or of every Gaolette for
+        /// protocol::ALL_GAOLETTES, instead of them being polled with fetch_state.
+        ///
+        /// The Gao process coalesces changes, callback sees the latest state of a Gaolette whenever it changed since
+        /// the last push. A subscription to a single Gaolette ends with it, after reporting State::ShutDown.
+        /// Callbacks run from dispatch_notifications, on the thread calling it.
+        /// @return handle to unsubscribe with.
+        /// @throws std::runtime_error if id doesn't name a live Gaolette or the Gao process has no room for
+        /// another subscriber.
+        std::uint64_t subscribe(gaolette_id_t id, State_Callback callback) const;
+
+        ///@brief ends a subscription, unknown or ended subscriptions are ignored.
+        void unsubscribe(std::uint64_t subscription) const;
+
+        ///@brief runs the callbacks of every state change pushed so far.
+        ///
+        /// Changes are read along with replies, they wait here until dispatched. Those of one Gaolette are coalesced
+        /// meanwhile, so at most one change per Gaolette and one per Gaolette that shut down is kept.
+        /// @param block whether to wait for at least one change if none arrived yet.
+        /// @return number of state changes dispatched.
+        /// @throws std::runtime_error on read failure or if the Gao process hangs up while blocking.
+        std::size_t dispatch_notifications(bool block = false) const;
+
+        ///@brief round trips of this Orchestrator's requests, from writing one to reading its reply.
+        [[nodiscard]] protocol::Latency_Summary round_trip_stats(protocol::Opcode opcode) const noexcept;
+
+        ///@brief what the Gao process measured since it started, shared by everyone connected to it.
+        /// @throws std::runtime_error if the Gao process fails the request.
+        [[nodiscard]] protocol::Stats_Payload fetch_stats() const;
+    };
+
+    /// @class Orchestrator_Pool
+    /// @brief Keeps Gao processes spawned and handshaken ahead of time, so acquiring one skips the spawn.
+    ///
+    /// Leased Orchestrators are never handed back, every lease gets a Gao process nobody used before.
+    /// A background thread spawns replacements as processes are leased out.
+    class Orchestrator_Pool {
+        std::size_t capacity_;
+        bool terminate_with_parent_;
+        protocol::Transport transport_;
+        std::vector<Warm_Pool_Class> warm_pool_;
+        Runtime_Options runtime_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable refill_cv_;
+        std::vector<std::unique_ptr<Orchestrator>> ready_;
+        bool stopping_ = false;
+        std::thread refiller_;
+
+        [[nodiscard]] std::unique_ptr<Orchestrator> spawn() const;
+
+        ///@brief body of refiller_, keeps ready_ at capacity_ until the pool is destroyed.
+        void refill();
+
+    public:
+        ///@brief Spawns capacity Gao processes, each configured like Orchestrator's constructor would.
+        /// @throws std::runtime_error if any of them can't be spawned, the ones already spawned are shut down.
+        explicit Orchestrator_Pool(std::size_t capacity, bool terminate_with_parent = true,
+                                   protocol::Transport transport = protocol::Transport::SOCKET,
+                                   std::span<const Warm_Pool_Class> warm_pool = {},
+                                   const Runtime_Options& runtime = {});
+
+        /// Stops the refiller and shuts down every Gao process that was never leased.
+        ~Orchestrator_Pool();
+
+        Orchestrator_Pool(const Orchestrator_Pool&) = delete;
+        Orchestrator_Pool& operator=(const Orchestrator_Pool&) = delete;
+
+        ///@brief leases a ready Orchestrator, spawning one on the spot if the pool ran dry.
+        /// @throws std::runtime_error if the pool is empty and spawning fails.
+        [[nodiscard]] std::unique_ptr<Orchestrator> acquire();
+
+        ///@brief number of Orchestrators that can be acquired without spawning.
+        [[nodiscard]] std::size_t ready() const;
+    };
+
+    /// @enum Placement
+    /// @brief How an Orchestrator_Group picks the Gao process a new Gaolette lives on.
+    enum class Placement {
+        LEAST_LOADED,   ///< the process holding the fewest live Gaolettes
+        MOST_HEADROOM,  ///< the process with the fewest bytes delegated to its Gaolettes
+        HASHED          ///< consistent hash of a caller supplied key, LEAST_LOADED for Gaolettes created without one
+    };
+
+    /// @class Orchestrator_Group
+    /// @brief Several Gao processes behind one set of Gaolette functions, spreading Gaolettes across them.
+    ///
+    /// Every Gao process runs its own control loop, so control plane throughput grows with the number of shards.
+    /// Gaolettes created through the group carry a group wide id encoding the shard they live on, every later call
+    /// taking the group routes to that shard.
+    class Orchestrator_Group {
+        struct Shard {
+            std::unique_ptr<Orchestrator> orchestrator;
+            std::atomic<std::size_t> live = 0;      ///< Gaolettes placed here and not destroyed yet
+            std::atomic<std::size_t> bytes = 0;     ///< address space delegated to them
+        };
+
+        std::vector<std::unique_ptr<Shard>> shards_;
+        Placement placement_;
+
+        static constexpr int SHARD_BITS = 8;
+
+    public:
+        static constexpr std::size_t MAX_SHARDS = std::size_t{1} << SHARD_BITS;
+
+        ///@brief Spawns shards Gao processes, each configured like Orchestrator's constructor would.
+        /// @throws std::invalid_argument if shards is 0 or above MAX_SHARDS.
+        /// @throws std::runtime_error if a Gao process can't be spawned.
+        explicit Orchestrator_Group(std::size_t shards, Placement placement = Placement::LEAST_LOADED,
+                                    bool terminate_with_parent = true,
+                                    protocol::Transport transport = protocol::Transport::SOCKET,
+                                    std::span<const Warm_Pool_Class> warm_pool = {},
+                                    const Runtime_Options& runtime = {});
+
+        ///@brief Builds a group from already running Orchestrators, e.g. leased from an Orchestrator_Pool.
+        /// @throws std::invalid_argument if orchestrators is empty, larger than MAX_SHARDS or holds nullptr.
+        explicit Orchestrator_Group(std::vector<std::unique_ptr<Orchestrator>> orchestrators,
+                                    Placement placement = Placement::LEAST_LOADED);
+
+        [[nodiscard]] std::size_t size() const noexcept;
+
+        [[nodiscard]] const Orchestrator& shard(std::size_t index) const;
+
+        ///@brief shard the group's placement policy picks for a new Gaolette.
+        [[nodiscard]] std::size_t place(const Perf_Spec& spec) const noexcept;
+
+        ///@brief shard a key maps to, stable for a given group size and moving as few keys as possible across sizes.
+        [[nodiscard]] std::size_t place(std::uint64_t key) const noexcept;
+
+        ///@brief records that a Gaolette with spec was placed on (delta 1) or removed from (delta -1) a shard.
+        void account(std::size_t shard, const Perf_Spec& spec, int delta) const noexcept;
+
+        ///@brief live Gaolettes placed on a shard through this group.
+        [[nodiscard]] std::size_t load(std::size_t shard) const noexcept;
+
+        /// group wide id of the Gaolette with id local on shard.
+        /// @throws std::runtime_error if local doesn't fit next to the shard.
+        static gaolette_id_t global_id(std::size_t shard, gaolette_id_t local);
+
+        /// shard a group wide id lives on.
+        static std::size_t shard_of(gaolette_id_t id) noexcept;
+
+        /// id the Gaolette has on its shard.
+        static gaolette_id_t local_id(gaolette_id_t id) noexcept;
+    };
+
+    /// @class Pending
+    /// @brief Handle to a request in flight on an Orchestrator.
+    ///
+    /// Any number of requests may be in flight on one Orchestrator, get() returns once this one's reply
+    /// has arrived regardless of the order the Gao process answers in.
+    /// Destroying a Pending without calling get() discards its reply.
+    template <typename T>
+    class Pending {
+        const Orchestrator* gao_p_;
+        std::uint32_t request_id_;
+        std::function<T(Orchestrator::Reply&)> complete_;
+    public:
+        Pending(const Orchestrator& gao_p, std::uint32_t request_id, std::function<T(Orchestrator::Reply&)> complete);
+        Pending(Pending&& other) noexcept;
+        Pending(const Pending&) = delete;
+        Pending& operator=(const Pending&) = delete;
+        Pending& operator=(Pending&&) = delete;
+        ~Pending();
+
+        [[nodiscard]] std::uint32_t request_id() const noexcept;
+
+        ///@brief whether get() would return without blocking.
+        [[nodiscard]] bool ready() const;
+
+        ///@brief blocks until the reply arrives and decodes it, may only be called once.
+        /// @throws whatever the synchronous counterpart of the request throws.
+        T get();
+    };
+
+    template <typename T>
+    Pending<T>::Pending(const Orchestrator& gao_p, const std::uint32_t request_id,
+                        std::function<T(Orchestrator::Reply&)> complete)
+        : gao_p_(&gao_p), request_id_(request_id), complete_(std::move(complete)) {}
+
+    template <typename T>
+    Pending<T>::Pending(Pending&& other) noexcept
+        : gao_p_(other.gao_p_), request_id_(other.request_id_), complete_(std::move(other.complete_)) {
+        other.gao_p_ = nullptr;
+    }
+
+    template <typename T>
+    Pending<T>::~Pending() {
+        if (gao_p_ != nullptr) {
+            gao_p_->discard_reply(request_id_);
+        }
+    }
+
+    template <typename T>
+    std::uint32_t Pending<T>::request_id() const noexcept {
+        return request_id_;
+    }
+
+    template <typename T>
+    bool Pending<T>::ready() const {
+        return gao_p_ != nullptr && gao_p_->reply_ready(request_id_);
+    }
+
+    template <typename T>
+    T Pending<T>::get() {
+        if (gao_p_ == nullptr) {
+            throw std::logic_error("Pending::get called on a consumed request");
+        }
+        Orchestrator::Reply reply = gao_p_->wait_reply(request_id_);
+        gao_p_ = nullptr;
+        return complete_(reply);
+    }
+
+    ///@brief Creates a Gaolette on the Gao process held by the gao_p Orchestrator instance.
+    ///
+    /// @param spec Performance specification for the Gaolette to be created.
+    /// @param gao_p Orchestrator instance holding the Gao process to create the Gaolette on.
+    /// @return the created Gaolette instance.
+    /// @throws exceptions::Failed_To_Create_Gaolette if creation fails.
+    inline Gaolette create_gaolette(Perf_Spec spec, const Orchestrator& gao_p);
+
+    ///@brief Destroys a Gaolette held by the gao_p Orchestrator instance.
+    ///
+    /// @param gaolette the Gaolette instance to destroy.
+    /// @param gao_p Orchestrator instance holding the Gao process to destroy the Gaolette on.
+    /// @return 0 on success, -1 on failure.
+    inline int destroy_gaolette(Gaolette& gaolette, const Orchestrator& gao_p);
+
+    ///@brief Updates state of Gaolette instance held by gao_p Orchestrator instance.
+    ///
+    ///@param gaolette the Gaolette instance to update.
+    ///@param gao_p Orchestrator instance holding the Gao process to query the Gaolette state from.
+    ///@return void, gaolette.state is updated in place.
+    inline void fetch_state(Gaolette& gaolette, const Orchestrator& gao_p);
+
+    ///@brief Grows or shrinks a Memory_Policy::DYNAMIC Gaolette in place, its memory never moves.
+    ///
+    /// Shrinking hands the pages past the new size back to the system.
+    /// @param gaolette the Gaolette instance to resize, perf_spec.size_ is updated on success.
+    /// @param size new size in bytes, at most perf_spec.max_memory_usage_.
+    /// @param gao_p Orchestrator instance holding the Gao process the Gaolette lives on.
+    /// @return 0 on success, -1 on failure.
+    inline int resize_gaolette(Gaolette& gaolette, std::size_t size, const Orchestrator& gao_p);
+
+    ///@brief Creates a Gaolette sharing the memory of source copy-on-write, it starts out with source's contents.
+    ///
+    /// Takes about as long as creating an empty Gaolette, whatever source's size: the clone only gets pages of its
+    /// own once it writes to them. The first clone of a Gaolette copies the pages it touched into a shared image
+    /// once and turns it State::Locked, read-only for the rest of its life, so every clone starts from the same
+    /// contents; see fetch_state. Gaolettes backed by Page_Size::EXPLICIT_HUGE can't be cloned.
+    /// @param source the Gaolette to clone, held by gao_p.
+    /// @param gao_p Orchestrator instance holding the Gao process source lives on.
+    /// @return the clone, with source's perf_spec.
+    /// @throws exceptions::Failed_To_Create_Gaolette if cloning fails.
+    inline Gaolette clone_gaolette(const Gaolette& source, const Orchestrator& gao_p);
+
+    ///@brief Hands over the memfd backing gaolette, so its memory can be read and written without requests.
+    ///
+    /// The first share moves the Gaolette's memory into a memfd, copying the pages it touched once; from then on
+    /// the memfd is its memory, writes through a window are the Gaolette's. A locked Gaolette, see
+    /// clone_gaolette, is shared read-only. Cloning a shared Gaolette leaves the memfd to this process and gives
+    /// the Gaolette a copy to lock. Only the Orchestrator that spawned the Gao process can share, and not for
+    /// Gaolettes backed by Page_Size::EXPLICIT_HUGE.
+    /// @param gaolette the Gaolette to share, held by gao_p.
+    /// @param gao_p Orchestrator instance that spawned the Gao process gaolette lives on.
+    /// @return the memfd along with the Gaolette's current size.
+    /// @throws std::runtime_error if the Gaolette can't be shared.
+    inline Gaolette_Memory share_gaolette(const Gaolette& gaolette, const Orchestrator& gao_p);
+
+    ///@brief Asynchronous create_gaolette, the request is sent before returning.
+    ///
+    /// @return handle whose get() yields the created Gaolette instance.
+    inline Pending<Gaolette> create_gaolette_async(Perf_Spec spec, const Orchestrator& gao_p);
+
+    ///@brief Asynchronous destroy_gaolette, the request is sent before returning.
+    ///
+    /// gaolette is updated when get() is called and must outlive the returned handle.
+    /// @return handle whose get() yields 0 on success, -1 on failure.
+    inline Pending<int> destroy_gaolette_async(Gaolette& gaolette, const Orchestrator& gao_p);
+
+    ///@brief Asynchronous fetch_state, the request is sent before returning.
+    ///
+    /// gaolette.state is updated when get() is called, gaolette must outlive the returned handle.
+    inline Pending<void> fetch_state_async(Gaolette& gaolette, const Orchestrator& gao_p);
+
+    ///@brief Creates one Gaolette per spec in a single round trip, the Gao process maps the whole batch at once.
+    ///
+    /// Batches larger than protocol::MAX_BATCH are split into several requests that are all in flight together.
+    /// @param specs Performance specifications of the Gaolettes to be created.
+    /// @param gao_p Orchestrator instance holding the Gao process to create the Gaolettes on.
+    /// @return one entry per spec, in the same order; a failed item does not fail the batch.
+    inline std::vector<Batch_Entry> create_gaolettes(std::span<const Perf_Spec> specs, const Orchestrator& gao_p);
+
+    ///@brief Destroys every Gaolette in gaolettes in a single round trip.
+    ///
+    /// Destroyed Gaolettes are updated in place like destroy_gaolette does.
+    /// @param gaolettes the Gaolette instances to destroy.
+    /// @param gao_p Orchestrator instance holding the Gao process to destroy the Gaolettes on.
+    /// @return one code per Gaolette, in the same order; 0 on success, otherwise the protocol::Status of the failure.
+    inline std::vector<int> destroy_gaolettes(std::span<Gaolette> gaolettes, const Orchestrator& gao_p);
+
+    ///@brief Creates a Gaolette on the shard of group picked by its placement policy.
+    ///
+    /// @return the created Gaolette instance, its id is group wide.
+    /// @throws exceptions::Failed_To_Create_Gaolette if creation fails.
+    inline Gaolette create_gaolette(Perf_Spec spec, const Orchestrator_Group& group);
+
+    ///@brief Creates a Gaolette on the shard key hashes to, so related Gaolettes can be kept together.
+    inline Gaolette create_gaolette(Perf_Spec spec, const Orchestrator_Group& group, std::uint64_t key);
+
+    ///@brief destroy_gaolette routed to the shard gaolette lives on.
+    inline int destroy_gaolette(Gaolette& gaolette, const Orchestrator_Group& group);
+
+    ///@brief fetch_state routed to the shard gaolette lives on.
+    inline void fetch_state(Gaolette& gaolette, const Orchestrator_Group& group);
+
+    ///@brief resize_gaolette routed to the shard gaolette lives on.
+    inline int resize_gaolette(Gaolette& gaolette, std::size_t size, const Orchestrator_Group& group);
+
+    ///@brief clone_gaolette on the shard source lives on, the clone's id is group wide.
+    inline Gaolette clone_gaolette(const Gaolette& source, const Orchestrator_Group& group);
+
+    ///@brief share_gaolette routed to the shard gaolette lives on.
+    inline Gaolette_Memory share_gaolette(const Gaolette& gaolette, const Orchestrator_Group& group);
+
+    ///@brief create_gaolettes spread over the shards of group, every shard's batch is in flight at the same time.
+    inline std::vector<Batch_Entry> create_gaolettes(std::span<const Perf_Spec> specs, const Orchestrator_Group& group);
+
+    ///@brief destroy_gaolettes routed to the shards the Gaolettes live on, all shards work at the same time.
+    inline std::vector<int> destroy_gaolettes(std::span<Gaolette> gaolettes, const Orchestrator_Group& group);
+}
+
+namespace Gao::exceptions {
+    Failed_To_Create_Gaolette::Failed_To_Create_Gaolette(int code) : code(code) {
+        msg_.emplace_back("Gaolette creation failed with error code: " + std::to_string(code));
+
+        switch (code) {
+            case -1: msg_.emplace_back("Unknown error occurred during Gaolette creation.");
+            case 1:  msg_.emplace_back("Invalid performance specification provided.");
+            case 2:  msg_.emplace_back("Insufficient system resources to create Gaolette.");
+            case 3:  msg_.emplace_back("Permission denied to create Gaolette.");
+            default: msg_.emplace_back("Unrecognized error code.");
+        };
+    }
+
+    const char *Failed_To_Create_Gaolette::what() const noexcept {
+            return msg_.data()->c_str();
+    }
+}
+
+namespace Gao {
+    inline State unpack_state(std::uint8_t state_code);
+
+    std::filesystem::path Orchestrator::get_gao_binary() {
+        // the environment is only consulted once, every later spawn reuses the resolved path
+        static const std::filesystem::path binary = [] {
+            const char* dir = std::getenv("GAO_BIN_DIR");
+            if (dir == nullptr) {
+                throw std::runtime_error("GAO_BIN_DIR is not set");
+            }
+#if defined(__x86_64__)
+            arch_ = "x86_64";
+#elif defined(__i386__)
+            arch_ = "i386";
+#elif defined(__arm__)
+            arch_ = "arm";
+#elif defined(__aarch64__)
+            arch_ = "aarch64";
+#endif
+            return std::filesystem::path(dir) / arch_;
+        }();
+        return binary;
+    }
+
+    void Orchestrator::set_logging(const bool enabled, const logging::Sink sink, const int fd) {
+        logs_.stop();
+        logs_.set_sink(sink, fd);
+        logging_.store(enabled, std::memory_order_relaxed);
+        if (enabled) {
+            logs_.start();
+        }
+    }
+
+    void Orchestrator::dump_logs() const noexcept {
+        logs_.drain();
+    }
+
+    void Orchestrator::print_log() const noexcept {
+        logs_.drain(1);
+    }
+
+    bool Orchestrator::open_shared_memory(int& memfd, const int hangup_fd) {
+        constexpr std::size_t size = ring::shared_size(ring::DEFAULT_CAPACITY);
+
+        memfd = ::memfd_create("gao-transport", MFD_CLOEXEC);
+        if (memfd == -1) {
+            return false;
+        }
+        if (::ftruncate(memfd, static_cast<off_t>(size)) == -1) {
+            close_shared_memory(memfd);
+            return false;
+        }
+
+        shared_ = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+        if (shared_ == MAP_FAILED) {
+            shared_ = nullptr;
+            close_shared_memory(memfd);
+            return false;
+        }
+
+        for (int& doorbell : doorbells_) {
+            doorbell = ::eventfd(0, EFD_CLOEXEC);
+            if (doorbell == -1) {
+                close_shared_memory(memfd);
+                return false;
+            }
+        }
+
+        channel_ = ring::Channel::host(ring::initialize(shared_, ring::DEFAULT_CAPACITY), doorbells_, hangup_fd);
+        return true;
+    }
+
+    void Orchestrator::close_shared_memory(int& memfd) noexcept {
+        if (memfd != -1) {
+            close(memfd);
+            memfd = -1;
+        }
+        if (shared_ != nullptr) {
+            ::munmap(shared_, ring::shared_size(ring::DEFAULT_CAPACITY));
+            shared_ = nullptr;
+        }
+        for (int& doorbell : doorbells_) {
+            if (doorbell != -1) {
+                close(doorbell);
+                doorbell = -1;
+            }
+        }
+    }
+
+    Orchestrator::Orchestrator(bool terminate_with_parent, protocol::Transport transport,
+                               const std::span<const Warm_Pool_Class> warm_pool,
+                               const std::string_view listen_name,
+                               const Runtime_Options& runtime) {    // NOLINT : issue with actions_ initialization
+        posix_spawn_file_actions_init(&actions_);
+        if (transport == protocol::Transport::EMBEDDED) {
+            socket_ = -1;
+            start_embedded(warm_pool, listen_name, runtime);
+            return;
+        }
+
+        int sv[2]; // socket pair
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) == -1) {
+            posix_spawn_file_actions_destroy(&actions_);
+            throw std::runtime_error("socketpair failed");
+        }
+        socket_ = sv[0];
+
+        // duplicate the child's socket to stdin/stdout
+        posix_spawn_file_actions_adddup2(&actions_, sv[1], STDIN_FILENO);
+        posix_spawn_file_actions_adddup2(&actions_, sv[1], STDOUT_FILENO);
+
+        const std::string binary = get_gao_binary().string();
+        std::vector<char*> argv = {const_cast<char*>(binary.c_str())};
+
+        // the socket stays the fallback whenever the rings can't be set up on our side
+        int memfd = -1;
+        if (transport == protocol::Transport::SHARED_MEMORY && open_shared_memory(memfd, socket_)) {
+            posix_spawn_file_actions_adddup2(&actions_, memfd, ring::MEMFD_FILENO);
+            posix_spawn_file_actions_adddup2(&actions_, doorbells_[0], ring::TO_GAO_DATA_FILENO);
+            posix_spawn_file_actions_adddup2(&actions_, doorbells_[1], ring::TO_GAO_SPACE_FILENO);
+            posix_spawn_file_actions_adddup2(&actions_, doorbells_[2], ring::TO_HOST_DATA_FILENO);
+            posix_spawn_file_actions_adddup2(&actions_, doorbells_[3], ring::TO_HOST_SPACE_FILENO);
+            argv.push_back(const_cast<char*>(ring::SHARED_MEMORY_FLAG));
+        }
+
+        // without the descriptor socket the Gao process refuses share_gaolette, everything else still works
+        int descriptors[2] = {-1, -1};
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, descriptors) == 0) {
+            descriptors_ = descriptors[0];
+            posix_spawn_file_actions_adddup2(&actions_, descriptors[1], protocol::DESCRIPTOR_FILENO);
+            argv.push_back(const_cast<char*>(protocol::DESCRIPTOR_FLAG));
+        }
+
+        std::vector<std::string> options;
+        options.reserve(warm_pool.size() + 4);
+        for (const Warm_Pool_Class& warm : warm_pool) {
+            options.push_back("--warm-pool=" + std::to_string(warm.size_) + ":" + std::to_string(warm.count_));
+            argv.push_back(options.back().data());
+        }
+        if (!listen_name.empty()) {
+            options.push_back("--listen=" + std::string(listen_name));
+            argv.push_back(options.back().data());
+        }
+        if (runtime.workers_ != 0) {
+            options.push_back("--workers=" + std::to_string(runtime.workers_));
+            argv.push_back(options.back().data());
+        }
+        if (runtime.pin_workers_) {
+            options.push_back("--pin-workers");
+            argv.push_back(options.back().data());
+        }
+        if (runtime.io_uring_) {
+            options.push_back("--io-uring");
+            argv.push_back(options.back().data());
+        }
+        argv.push_back(nullptr);
+
+        status_ = posix_spawn(&pid_, binary.c_str(),
+                             &actions_, nullptr,
+                             argv.data(), environ);
+
+        // we can now close the child's end on the parent as it only needs it's end of the socket
+        close(sv[1]);
+        if (descriptors[1] != -1) {
+            close(descriptors[1]);
+        }
+        if (memfd != -1) {
+            close(memfd);   // the mapping keeps the memfd alive
+        }
+
+        if (status_ != 0) {
+            pid_ = 0;
+            close_shared_memory(memfd);
+            close(socket_);
+            if (descriptors_ != -1) {
+                close(descriptors_);
+            }
+            posix_spawn_file_actions_destroy(&actions_);
+            throw std::runtime_error("posix_spawn failed");
+        }
+
+        // the Gao process always announces the transport it attached to over the socket
+        protocol::Hello_Payload accepted{};
+        if (!await_hello(accepted)) {
+            close_shared_memory(memfd);
+            close(socket_);
+            if (descriptors_ != -1) {
+                close(descriptors_);
+            }
+            waitpid(pid_, &status_, 0);
+            posix_spawn_file_actions_destroy(&actions_);
+            throw std::runtime_error("handshake with Gao process failed");
+        }
+
+        if (accepted.transport == static_cast<std::uint8_t>(protocol::Transport::SHARED_MEMORY) && shared_ != nullptr) {
+            transport_ = protocol::Transport::SHARED_MEMORY;
+        } else {
+            if (transport == protocol::Transport::SHARED_MEMORY) {
+                log(Log_Type::GENERIC_WARNING, Log_Prio::ANY,
+                    "Gao process {} can't use the shared memory transport, falling back to the socket", pid_);
+            }
+            close_shared_memory(memfd);
+        }
+    }
+
+    void Orchestrator::start_embedded(const std::span<const Warm_Pool_Class> warm_pool,
+                                      const std::string_view listen_name, const Runtime_Options& runtime) {
+        if (gao_embedded_run == nullptr) {
+            posix_spawn_file_actions_destroy(&actions_);
+            throw std::runtime_error("the embedded Gao runtime is not linked in");
+        }
+        if (embedded_in_use_.exchange(true, std::memory_order_acquire)) {
+            posix_spawn_file_actions_destroy(&actions_);
+            throw std::runtime_error("the embedded Gao runtime already serves another Orchestrator");
+        }
+
+        embedded_hangup_ = ::eventfd(0, EFD_CLOEXEC);
+        embedded_exit_ = ::eventfd(0, EFD_CLOEXEC);
+        int memfd = -1;
+        if (embedded_hangup_ == -1 || embedded_exit_ == -1 || !open_shared_memory(memfd, embedded_exit_)) {
+            for (const int fd : {embedded_hangup_, embedded_exit_}) {
+                if (fd != -1) {
+                    close(fd);
+                }
+            }
+            embedded_in_use_.store(false, std::memory_order_release);
+            posix_spawn_file_actions_destroy(&actions_);
+            throw std::runtime_error("setting up the embedded Gao runtime failed");
+        }
+        close(memfd);   // only ever mapped here, the mapping keeps it alive
+        transport_ = protocol::Transport::EMBEDDED;
+
+        int descriptors[2] = {-1, -1};
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, descriptors) == 0) {
+            descriptors_ = descriptors[0];
+            embedded_descriptors_ = descriptors[1];
+        }
+
+        // the destructor only tears down a running thread, anything failing up to its start is undone here
+        try {
+            // the thread keeps its own copies, the caller's spans may be gone before it reads them
+            std::vector<embedded::Warm_Class> warm;
+            warm.reserve(warm_pool.size());
+            for (const Warm_Pool_Class& each : warm_pool) {
+                warm.push_back(embedded::Warm_Class{each.size_, each.count_});
+            }
+            embedded::Options options{};
+            options.block = static_cast<ring::Shared_Block*>(shared_);
+            std::copy(std::begin(doorbells_), std::end(doorbells_), options.doorbells);
+            options.hangup_fd = embedded_hangup_;
+            options.descriptor_fd = embedded_descriptors_;
+            options.workers = runtime.workers_;
+            options.pin_workers = runtime.pin_workers_;
+            options.io_uring = runtime.io_uring_;
+
+            embedded_ = std::thread([options, warm = std::move(warm), name = std::string(listen_name),
+                                     exit = embedded_exit_]() mutable {
+                options.warm_pool = warm.data();
+                options.warm_pool_count = static_cast<std::uint32_t>(warm.size());
+                options.listen_name = name.empty() ? nullptr : name.c_str();
+                if (gao_embedded_run(&options) == -1) {
+                    std::cerr << "embedded Gao runtime failed" << std::endl;
+                }
+                ::eventfd_write(exit, 1);
+            });
+        } catch (...) {
+            for (int* fd : {&descriptors_, &embedded_descriptors_, &embedded_hangup_, &embedded_exit_}) {
+                if (*fd != -1) {
+                    close(*fd);
+                    *fd = -1;
+                }
+            }
+            memfd = -1;
+            close_shared_memory(memfd);
+            embedded_in_use_.store(false, std::memory_order_release);
+            posix_spawn_file_actions_destroy(&actions_);
+            throw;
+        }
+    }
+
+    Orchestrator::Orchestrator(const int socket) : socket_(socket) {
+        posix_spawn_file_actions_init(&actions_);
+    }
+
+    std::unique_ptr<Orchestrator> Orchestrator::connect(const std::string_view listen_name) {
+        sockaddr_un address{};
+        if (listen_name.empty() || listen_name.size() >= sizeof(address.sun_path) - 1) {
+            throw std::runtime_error("invalid listen name");
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path + 1, listen_name.data(), listen_name.size());   // abstract namespace
+
+        const int socket = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (socket == -1) {
+            throw std::runtime_error("socket failed");
+        }
+        const auto length = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + listen_name.size());
+        if (::connect(socket, reinterpret_cast<sockaddr*>(&address), length) == -1) {
+            close(socket);
+            throw std::runtime_error("connecting to Gao process failed");
+        }
+
+        // owns socket from here on, the destructor closes it if the handshake fails
+        std::unique_ptr<Orchestrator> orchestrator(new Orchestrator(socket));
+        protocol::Hello_Payload hello{};
+        if (!orchestrator->await_hello(hello)) {
+            throw std::runtime_error("handshake with Gao process failed");
+        }
+        return orchestrator;
+    }
+
+    bool Orchestrator::await_hello(protocol::Hello_Payload& hello) const {
+        std::string payload;
+        protocol::Frame_Header header{};
+        try {
+            header = read_frame(payload);
+        } catch (const std::runtime_error&) {
+            return false;
+        }
+        if (header.opcode != static_cast<std::uint16_t>(protocol::Opcode::HELLO)
+            || payload.size() != sizeof(protocol::Hello_Payload)) {
+            return false;
+        }
+        std::memcpy(&hello, payload.data(), sizeof(hello));
+        return true;
+    }
+
+    Orchestrator::~Orchestrator() {
+        posix_spawn_file_actions_destroy(&actions_);
+        if (embedded_.joinable()) {
+            // the runtime finishes what it is running, its last replies are never read
+            ::eventfd_write(embedded_hangup_, 1);
+            embedded_.join();
+            close(embedded_hangup_);
+            close(embedded_exit_);
+            if (embedded_descriptors_ != -1) {
+                close(embedded_descriptors_);
+            }
+            embedded_in_use_.store(false, std::memory_order_release);
+        }
+        if (socket_ != -1) {
+            close(socket_);
+        }
+        if (descriptors_ != -1) {
+            close(descriptors_);
+        }
+        for (const auto& [request_id, fd] : descriptors_received_) {
+            close(fd);
+        }
+        if (pid_ > 0) {
+            // on stderr, stdout belongs to the program the Orchestrator is part of
+            if (waitpid(pid_, &status_, 0) > 0) {
+                if (WIFEXITED(status_)) {
+                    std::cerr << "Exited with status " << WEXITSTATUS(status_) << std::endl;
+                } else if (WIFSIGNALED(status_)) {
+                    std::cerr << "Killed by signal " << WTERMSIG(status_) << std::endl;
+                } else {
+                    std::cerr << "Exited with unknown status" << std::endl;
+                }
+            }
+        }
+        int memfd = -1;
+        close_shared_memory(memfd);
+    }
+
+    protocol::Transport Orchestrator::transport() const noexcept {
+        return transport_;
+    }
+
+    std::size_t Orchestrator::read_some(void *dst, const std::size_t len) const {
+        while (true) {
+            const ssize_t nread = transport_ != protocol::Transport::SOCKET
+                ? channel_.read_some(dst, len)
+                : ::read(socket_, dst, len);
+            if (nread == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error("read failed");
+            }
+            return static_cast<std::size_t>(nread);
+        }
+    }
+
+    bool Orchestrator::fill(const std::size_t want) const {
+        while (in_end_ - in_begin_ < want) {
+            // out of room behind in_begin_, move the lookahead to the front and grow if that's not enough
+            if (in_buffer_.size() - in_begin_ < want) {
+                std::memmove(in_buffer_.data(), in_buffer_.data() + in_begin_, in_end_ - in_begin_);
+                in_end_ -= in_begin_;
+                in_begin_ = 0;
+                if (in_buffer_.size() < want) {
+                    in_buffer_.resize(std::max(want, in_buffer_.size() * 2));
+                }
+            }
+
+            const std::size_t nread = read_some(in_buffer_.data() + in_end_, in_buffer_.size() - in_end_);
+            if (nread == 0) {  // EOF
+                return false;
+            }
+            in_end_ += nread;
+        }
+        return true;
+    }
+
+    void Orchestrator::consume(const std::size_t n) const noexcept {
+        in_begin_ += n;
+        if (in_begin_ == in_end_) {
+            in_begin_ = in_end_ = 0;
+        }
+    }
+
+    bool Orchestrator::readable() const {
+        if (in_end_ != in_begin_) {
+            return true;
+        }
+        if (transport_ != protocol::Transport::SOCKET) {
+            return channel_.readable();
+        }
+        pollfd pfd{socket_, POLLIN, 0};
+        return ::poll(&pfd, 1, 0) > 0;
+    }
+
+    int Orchestrator::write_frame(const protocol::Frame_Header& header, const void* payload) const {
+        if (transport_ != protocol::Transport::SOCKET) {
+            if (write_ring(&header, sizeof(header)) == -1 || write_ring(payload, header.length) == -1) {
+                return -1;
+            }
+            return static_cast<int>(sizeof(header) + header.length);
+        }
+
+        iovec iov[2] = {
+            {const_cast<protocol::Frame_Header*>(&header), sizeof(header)},
+            {const_cast<void*>(payload), header.length}
+        };
+        const size_t total = sizeof(header) + header.length;
+        size_t written = 0;
+        int iov_idx = 0;
+
+        while (written < total) {
+            ssize_t n = ::writev(socket_, iov + iov_idx, 2 - iov_idx);
+            if (n == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -1;
+            }
+            written += n;
+
+            // advance past whatever writev managed to flush
+            while (iov_idx < 2 && static_cast<size_t>(n) >= iov[iov_idx].iov_len) {
+                n -= static_cast<ssize_t>(iov[iov_idx].iov_len);
+                ++iov_idx;
+            }
+            if (iov_idx < 2) {
+                iov[iov_idx].iov_base = static_cast<char*>(iov[iov_idx].iov_base) + n;
+                iov[iov_idx].iov_len -= n;
+            }
+        }
+        return static_cast<int>(written);
+    }
+
+    int Orchestrator::write_ring(const void* src, std::size_t len) const {
+        const auto* bytes = static_cast<const char*>(src);
+        while (len > 0) {
+            const ssize_t n = channel_.write_available(bytes, len);
+            if (n > 0) {
+                bytes += n;
+                len -= static_cast<std::size_t>(n);
+            } else if (!await_ring_space()) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    bool Orchestrator::await_ring_space() const {
+        std::unique_lock lock(reply_mutex_);
+        // whoever reads takes one frame at a time, the ring may have room again after any of them
+        reply_cv_.wait(lock, [this] { return !reading_ || channel_.writable(); });
+        if (reading_) {
+            return true;
+        }
+        reading_ = true;
+        lock.unlock();
+
+        int woke = -1;
+        try {
+            while (true) {
+                if (in_end_ == in_buffer_.size()) {
+                    std::memmove(in_buffer_.data(), in_buffer_.data() + in_begin_, in_end_ - in_begin_);
+                    in_end_ -= in_begin_;
+                    in_begin_ = 0;
+                    if (in_end_ == in_buffer_.size()) {
+                        in_buffer_.resize(in_buffer_.size() * 2);
+                    }
+                }
+                const ssize_t nread = channel_.read_available(in_buffer_.data() + in_end_,
+                                                              in_buffer_.size() - in_end_);
+                if (nread == -1) {
+                    break;
+                }
+                in_end_ += static_cast<std::size_t>(nread);
+            }
+            // both rings had their doorbells announced by the calls that came back empty handed
+            woke = channel_.wait_writable();
+        } catch (...) {
+            lock.lock();
+            reading_ = false;
+            reply_cv_.notify_all();
+            throw;
+        }
+
+        // the frames read are filed by the next pump of whoever waits for them
+        lock.lock();
+        reading_ = false;
+        reply_cv_.notify_all();
+        return woke > 0;
+    }
+
+    protocol::Frame_Header Orchestrator::read_frame(std::string &payload) const {
+        protocol::Frame_Header header{};
+        if (!fill(sizeof(header))) {
+            log(Log_Type::GENERIC_FAILURE, Log_Prio::ANY, "Gao process {} closed the connection", pid_);
+            throw std::runtime_error("Gao process closed the connection");
+        }
+        std::memcpy(&header, in_buffer_.data() + in_begin_, sizeof(header));
+        if (protocol::validate(header) != protocol::Status::OK) {
+            log(Log_Type::GENERIC_FAILURE, Log_Prio::ANY, "malformed frame (opcode {}, {} bytes) from Gao process {}",
+                header.opcode, header.length, pid_);
+            throw std::runtime_error("malformed frame received from Gao process");
+        }
+
+        if (!fill(sizeof(header) + header.length)) {
+            log(Log_Type::GENERIC_FAILURE, Log_Prio::ANY, "Gao process {} closed the connection", pid_);
+            throw std::runtime_error("Gao process closed the connection");
+        }
+        payload.assign(in_buffer_.data() + in_begin_ + sizeof(header), header.length);
+        consume(sizeof(header) + header.length);
+        return header;
+    }
+
+    bool Orchestrator::pump(std::unique_lock<std::mutex>& lock, const bool block) const {
+        if (!block && !readable()) {
+            return false;
+        }
+
+        reading_ = true;
+        lock.unlock();
+
+        Reply reply;
+        try {
+            reply.header = read_frame(reply.payload);
+        } catch (...) {
+            lock.lock();
+            reading_ = false;
+            reply_cv_.notify_all();
+            throw;
+        }
+
+        lock.lock();
+        reading_ = false;
+        log(Log_Type::GENERIC_NOTICE, Log_Prio::ONLY_IF_LOGGING, "received frame {} (opcode {}, status {}, {} bytes)",
+            reply.header.request_id, reply.header.opcode, reply.header.status, reply.header.length);
+        if (reply.header.flags & protocol::FLAG_REPLY) {
+            const Send_Stamp& stamp = send_stamps_[reply.header.request_id % SEND_STAMPS];
+            if (stamp.request_id.load(std::memory_order_acquire) == reply.header.request_id) {
+                round_trips_[std::min<std::uint32_t>(reply.header.opcode, protocol::STATS_OPCODES - 1)]
+                    .record_since(stamp.sent.load(std::memory_order_relaxed));
+            }
+            if (discarded_.erase(reply.header.request_id) == 0) {
+                replies_.insert_or_assign(reply.header.request_id, std::move(reply));
+            }
+        } else if (reply.header.opcode == static_cast<std::uint16_t>(protocol::Opcode::STATE_CHANGED)) {
+            const std::size_t count = reply.payload.size() / sizeof(protocol::State_Change);
+            for (std::size_t i = 0; i < count; ++i) {
+                protocol::State_Change change{};
+                std::memcpy(&change, reply.payload.data() + i * sizeof(change), sizeof(change));
+                // a shut down Gaolette is never folded into what follows, that is a new Gaolette reusing the id
+                const auto [it, fresh] = notified_.try_emplace(change.id, notifications_.size());
+                if (!fresh && notifications_[it->second].state
+                              != static_cast<std::uint8_t>(protocol::State_Code::SHUT_DOWN)) {
+                    notifications_[it->second].state = change.state;
+                    continue;
+                }
+                it->second = notifications_.size();
+                notifications_.push_back(change);
+            }
+        }
+        reply_cv_.notify_all();
+        return true;
+    }
+
+    std::uint32_t Orchestrator::send_request(const protocol::Opcode opcode, const void *payload,
+                                             const std::uint32_t length) const {
+        std::uint32_t id = request_id_.fetch_add(1, std::memory_order_relaxed);
+        if (id == 0) {  // 0 is never used as a request id, skip it on wrap around
+            id = request_id_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // stamped before the write, the reply may be read before write_frame even returns
+        Send_Stamp& stamp = send_stamps_[id % SEND_STAMPS];
+        stamp.sent.store(stats::now(), std::memory_order_relaxed);
+        stamp.request_id.store(id, std::memory_order_release);
+
+        std::lock_guard lock(write_mutex_);
+        if (write_frame(protocol::make_header(opcode, id, length), payload) == -1) {
+            log(Log_Type::GENERIC_FAILURE, Log_Prio::ANY, "writing request {} (opcode {}) failed with errno {}",
+                id, static_cast<std::uint16_t>(opcode), errno);
+            throw std::runtime_error("write failed");
+        }
+        log(Log_Type::GENERIC_NOTICE, Log_Prio::ONLY_IF_LOGGING, "sent request {} (opcode {}, {} bytes)",
+            id, static_cast<std::uint16_t>(opcode), length);
+        return id;
+    }
+
+    Orchestrator::Reply Orchestrator::wait_reply(const std::uint32_t request_id) const {
+        std::unique_lock lock(reply_mutex_);
+        while (true) {
+            if (auto it = replies_.find(request_id); it != replies_.end()) {
+                Reply reply = std::move(it->second);
+                replies_.erase(it);
+                return reply;
+            }
+
+            // somebody else is already reading, they will wake us once they filed their frame
+            if (reading_) {
+                reply_cv_.wait(lock);
+            } else {
+                pump(lock, true);
+            }
+        }
+    }
+
+    bool Orchestrator::reply_ready(const std::uint32_t request_id) const {
+        std::unique_lock lock(reply_mutex_);
+        while (!replies_.contains(request_id) && !reading_ && pump(lock, false)) {}
+        return replies_.contains(request_id);
+    }
+
+    void Orchestrator::discard_reply(const std::uint32_t request_id) const noexcept {
+        std::lock_guard lock(reply_mutex_);
+        if (replies_.erase(request_id) == 0) {
+            discarded_.insert(request_id);
+        }
+    }
+
+    Orchestrator::Reply Orchestrator::request(const protocol::Opcode opcode, const void *payload,
+                                              const std::uint32_t length) const {
+        return wait_reply(send_request(opcode, payload, length));
+    }
+
+    std::uint64_t Orchestrator::subscribe(const gaolette_id_t id, State_Callback callback) const {
+        std::lock_guard lock(subscription_mutex_);
+        std::vector<Subscriber>& subscribers = subscribers_[id];
+
+        // the Gao process only needs to hear about the first subscriber of a Gaolette
+        if (subscribers.empty()) {
+            const protocol::Id_Payload payload{id};
+            const Reply reply = request(protocol::Opcode::SUBSCRIBE, &payload, sizeof(payload));
+            if (reply.header.status != static_cast<std::uint16_t>(protocol::Status::OK)) {
+                subscribers_.erase(id);
+                log(Log_Type::GENERIC_WARNING, Log_Prio::ONLY_IF_LOGGING, "subscribing to Gaolette {} failed with status {}",
+                    id, reply.header.status);
+                throw std::runtime_error("Failed to subscribe to Gaolette state changes");
+            }
+        }
+
+        const std::uint64_t handle = next_subscription_++;
+        subscribers.push_back(Subscriber{handle, std::make_shared<const State_Callback>(std::move(callback))});
+        subscriptions_.emplace(handle, id);
+        return handle;
+    }
+
+    void Orchestrator::unsubscribe(const std::uint64_t subscription) const {
+        std::lock_guard lock(subscription_mutex_);
+        const auto handle = subscriptions_.find(subscription);
+        if (handle == subscriptions_.end()) {
+            return;
+        }
+        const gaolette_id_t id = handle->second;
+        subscriptions_.erase(handle);
+
+        std::vector<Subscriber>& subscribers = subscribers_[id];
+        std::erase_if(subscribers, [subscription](const Subscriber& s) { return s.handle == subscription; });
+        if (subscribers.empty()) {
+            subscribers_.erase(id);
+            // UNKNOWN_GAOLETTE just means the Gaolette, and with it the subscription, is gone already
+            const protocol::Id_Payload payload{id};
+            request(protocol::Opcode::UNSUBSCRIBE, &payload, sizeof(payload));
+        }
+    }
+
+    std::size_t Orchestrator::dispatch_notifications(const bool block) const {
+        std::vector<protocol::State_Change> changes;
+        {
+            std::unique_lock lock(reply_mutex_);
+            while (!reading_ && pump(lock, false)) {}
+            while (block && notifications_.empty()) {
+                if (reading_) {
+                    reply_cv_.wait(lock);
+                } else {
+                    pump(lock, true);
+                }
+            }
+            changes.swap(notifications_);
+            notified_.clear();
+        }
+
+        std::vector<std::shared_ptr<const State_Callback>> callbacks;
+        for (const protocol::State_Change& change : changes) {
+            const State state = unpack_state(change.state);
+            callbacks.clear();
+            {
+                std::lock_guard lock(subscription_mutex_);
+                for (const gaolette_id_t key : {change.id, protocol::ALL_GAOLETTES}) {
+                    if (auto it = subscribers_.find(key); it != subscribers_.end()) {
+                        for (const Subscriber& subscriber : it->second) {
+                            callbacks.push_back(subscriber.callback);
+                        }
+                    }
+                }
+                // the Gao process ended the subscriptions to this Gaolette along with it
+                if (state == State::ShutDown) {
+                    if (auto it = subscribers_.find(change.id); it != subscribers_.end()) {
+                        for (const Subscriber& subscriber : it->second) {
+                            subscriptions_.erase(subscriber.handle);
+                        }
+                        subscribers_.erase(it);
+                    }
+                }
+            }
+            for (const auto& callback : callbacks) {
+                (*callback)(change.id, state);
+            }
+        }
+        return changes.size();
+    }
+
+    protocol::Latency_Summary Orchestrator::round_trip_stats(const protocol::Opcode opcode) const noexcept {
+        return round_trips_[std::min<std::uint32_t>(static_cast<std::uint16_t>(opcode),
+                                                    protocol::STATS_OPCODES - 1)].summary();
+    }
+
+    protocol::Stats_Payload Orchestrator::fetch_stats() const {
+        const Reply reply = request(protocol::Opcode::GET_STATS, nullptr, 0);
+        if (reply.header.status != static_cast<std::uint16_t>(protocol::Status::OK)
+            || reply.payload.size() != sizeof(protocol::Stats_Payload)) {
+            throw std::runtime_error("Failed to fetch Gao process statistics");
+        }
+        protocol::Stats_Payload stats{};
+        std::memcpy(&stats, reply.payload.data(), sizeof(stats));
+        return stats;
+    }
+
+    int Orchestrator::take_descriptor(const std::uint32_t request_id) const {
+        if (descriptors_ == -1) {
+            throw std::runtime_error("Orchestrator has no descriptor socket");
+        }
+
+        // messages for other requests are filed for them, every one is sent ahead of its reply so this never
+        // waits for long
+        std::lock_guard lock(descriptor_mutex_);
+        while (true) {
+            if (const auto found = descriptors_received_.find(request_id); found != descriptors_received_.end()) {
+                const int fd = found->second;
+                descriptors_received_.erase(found);
+                return fd;
+            }
+
+            protocol::Descriptor_Message message{};
+            iovec data{&message, sizeof(message)};
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+            msghdr header{};
+            header.msg_iov = &data;
+            header.msg_iovlen = 1;
+            header.msg_control = control;
+            header.msg_controllen = sizeof(control);
+            const ssize_t n = ::recvmsg(descriptors_, &header, MSG_CMSG_CLOEXEC);
+            if (n == -1 && errno == EINTR) {
+                continue;
+            }
+            const cmsghdr* rights = n == sizeof(message) ? CMSG_FIRSTHDR(&header) : nullptr;
+            if (rights == nullptr || rights->cmsg_level != SOL_SOCKET || rights->cmsg_type != SCM_RIGHTS
+                || rights->cmsg_len != CMSG_LEN(sizeof(int))) {
+                throw std::runtime_error("Failed to receive a descriptor from Gao process");
+            }
+            int fd = -1;
+            std::memcpy(&fd, CMSG_DATA(rights), sizeof(fd));
+            descriptors_received_.emplace(message.request_id, fd);
+        }
+    }
+
+    Gaolette_Window::Gaolette_Window(void* mapping, const std::size_t mapping_size, const std::size_t skew,
+                                     const std::size_t size) noexcept
+        : mapping_(mapping), mapping_size_(mapping_size), data_(static_cast<std::byte*>(mapping) + skew),
+          size_(size) {}
+
+    Gaolette_Window::Gaolette_Window(Gaolette_Window&& other) noexcept
+        : mapping_(std::exchange(other.mapping_, nullptr)), mapping_size_(std::exchange(other.mapping_size_, 0)),
+          data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+
+    Gaolette_Window& Gaolette_Window::operator=(Gaolette_Window&& other) noexcept {
+        if (this != &other) {
+            if (mapping_ != nullptr) {
+                ::munmap(mapping_, mapping_size_);
+            }
+            mapping_ = std::exchange(other.mapping_, nullptr);
+            mapping_size_ = std::exchange(other.mapping_size_, 0);
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+        }
+        return *this;
+    }
+
+    Gaolette_Window::~Gaolette_Window() {
+        if (mapping_ != nullptr) {
+            ::munmap(mapping_, mapping_size_);
+        }
+    }
+
+    std::byte* Gaolette_Window::data() const noexcept {
+        return data_;
+    }
+
+    std::size_t Gaolette_Window::size() const noexcept {
+        return size_;
+    }
+
+    Gaolette_Memory::Gaolette_Memory(const int fd, const std::size_t size, const bool writable) noexcept
+        : fd_(fd), size_(size), writable_(writable) {}
+
+    Gaolette_Memory::Gaolette_Memory(Gaolette_Memory&& other) noexcept
+        : fd_(std::exchange(other.fd_, -1)), size_(std::exchange(other.size_, 0)),
+          writable_(std::exchange(other.writable_, false)) {}
+
+    Gaolette_Memory& Gaolette_Memory::operator=(Gaolette_Memory&& other) noexcept {
+        if (this != &other) {
+            if (fd_ != -1) {
+                close(fd_);
+            }
+            fd_ = std::exchange(other.fd_, -1);
+            size_ = std::exchange(other.size_, 0);
+            writable_ = std::exchange(other.writable_, false);
+        }
+        return *this;
+    }
+
+    Gaolette_Memory::~Gaolette_Memory() {
+        if (fd_ != -1) {
+            close(fd_);
+        }
+    }
+
+    int Gaolette_Memory::fd() const noexcept {
+        return fd_;
+    }
+
+    std::size_t Gaolette_Memory::size() const noexcept {
+        return size_;
+    }
+
+    bool Gaolette_Memory::writable() const noexcept {
+        return writable_;
+    }
+
+    Gaolette_Window Gaolette_Memory::map(const std::size_t offset, const std::size_t length) const {
+        if (offset > size_ || length > size_ - offset) {
+            throw std::out_of_range("Gaolette window reaches past its memory");
+        }
+        static const auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        const std::size_t skew = offset % page;
+        const std::size_t mapping_size = length + skew == 0 ? page : length + skew;
+        void* mapping = ::mmap(nullptr, mapping_size, PROT_READ | (writable_ ? PROT_WRITE : 0), MAP_SHARED, fd_,
+                               static_cast<off_t>(offset - skew));
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("Failed to map Gaolette memory");
+        }
+        return {mapping, mapping_size, skew, length};
+    }
+
+    std::size_t Gaolette_Memory::splice_from(const int fd, std::size_t offset, const std::size_t length) const {
+        if (offset > size_ || length > size_ - offset) {
+            throw std::out_of_range("Gaolette splice reaches past its memory");
+        }
+        if (!writable_) {
+            throw std::runtime_error("Gaolette memory is read-only");
+        }
+
+        // splice needs a pipe on one end, anything else is routed through one of our own
+        struct stat info{};
+        const bool pipe = ::fstat(fd, &info) == 0 && S_ISFIFO(info.st_mode);
+        int through[2] = {-1, -1};
+        if (!pipe && ::pipe2(through, O_CLOEXEC) == -1) {
+            throw std::runtime_error("Failed to create a pipe for splicing");
+        }
+
+        const auto splice_some = [](const int from, const int to, loff_t* to_offset, const std::size_t count) {
+            ssize_t n;
+            do {
+                n = ::splice(from, nullptr, to, to_offset, count, SPLICE_F_MOVE);
+            } while (n == -1 && errno == EINTR);
+            return n;
+        };
+
+        auto target = static_cast<loff_t>(offset);
+        std::size_t moved = 0;
+        bool failed = false;
+        while (moved < length && !failed) {
+            if (pipe) {
+                const ssize_t n = splice_some(fd, fd_, &target, length - moved);
+                if (n <= 0) {
+                    failed = n == -1;
+                    break;
+                }
+                moved += static_cast<std::size_t>(n);
+                continue;
+            }
+            // whatever went into our pipe is drained into the memfd before reading more
+            ssize_t in = splice_some(fd, through[1], nullptr, length - moved);
+            if (in <= 0) {
+                failed = in == -1;
+                break;
+            }
+            while (in > 0) {
+                const ssize_t out = splice_some(through[0], fd_, &target, static_cast<std::size_t>(in));
+                if (out <= 0) {
+                    failed = true;
+                    break;
+                }
+                in -= out;
+                moved += static_cast<std::size_t>(out);
+            }
+        }
+        if (!pipe) {
+            close(through[0]);
+            close(through[1]);
+        }
+        if (failed) {
+            throw std::runtime_error("Failed to splice into Gaolette memory");
+        }
+        return moved;
+    }
+
+    Orchestrator_Pool::Orchestrator_Pool(const std::size_t capacity, const bool terminate_with_parent,
+                                         const protocol::Transport transport,
+                                         const std::span<const Warm_Pool_Class> warm_pool,
+                                         const Runtime_Options& runtime)
+        : capacity_(capacity), terminate_with_parent_(terminate_with_parent), transport_(transport),
+          warm_pool_(warm_pool.begin(), warm_pool.end()), runtime_(runtime) {
+        ready_.reserve(capacity_);
+        for (std::size_t i = 0; i < capacity_; ++i) {
+            ready_.push_back(spawn());
+        }
+        refiller_ = std::thread(&Orchestrator_Pool::refill, this);
+    }
+
+    Orchestrator_Pool::~Orchestrator_Pool() {
+        {
+            std::lock_guard lock(mutex_);
+            stopping_ = true;
+        }
+        refill_cv_.notify_all();
+        refiller_.join();
+    }
+
+    std::unique_ptr<Orchestrator> Orchestrator_Pool::spawn() const {
+        return std::make_unique<Orchestrator>(terminate_with_parent_, transport_, warm_pool_, std::string_view{},
+                                              runtime_);
+    }
+
+    void Orchestrator_Pool::refill() {
+        std::unique_lock lock(mutex_);
+        while (true) {
+            refill_cv_.wait(lock, [this] { return stopping_ || ready_.size() < capacity_; });
+            if (stopping_) {
+                return;
+            }
+
+            // spawning takes milliseconds, acquire() must not wait on it
+            lock.unlock();
+            std::unique_ptr<Orchestrator> spawned;
+            try {
+                spawned = spawn();
+            } catch (const std::exception&) {
+                // the system is out of processes, memory or threads, back off instead of spinning on it
+                lock.lock();
+                refill_cv_.wait_for(lock, std::chrono::milliseconds(100), [this] { return stopping_; });
+                continue;
+            }
+            lock.lock();
+            ready_.push_back(std::move(spawned));
+        }
     }
 
-    /// @enum State
-    /// @brief Possible states a Gaolette may present itself.
-    ///
-    /// Allows Gao to restrict and place constraints on what the user may
-    /// do to a Gaolette at any given time.
-    enum class State {
-        Operational, ///< the Gaolette is open for read/write
-        ShutDown, ///< the Gaolette is closed for read/write (Gaolette has been killed)
-        Locked, ///< the Gaolette is locked and is read-only
-        Operating, ///< the Gaolette is running code and is open for read/write for console
-        Illformed ///< the Gaolette is ill-formed and cannot be used
-    };
+    std::unique_ptr<Orchestrator> Orchestrator_Pool::acquire() {
+        {
+            std::lock_guard lock(mutex_);
+            if (!ready_.empty()) {
+                std::unique_ptr<Orchestrator> leased = std::move(ready_.back());
+                ready_.pop_back();
+                refill_cv_.notify_one();
+                return leased;
+            }
+        }
+        return spawn();
+    }
 
-    // I kept the State::Operating to write/read in
-    // case the code operating in the Gaolette requires I/O
+    std::size_t Orchestrator_Pool::ready() const {
+        std::lock_guard lock(mutex_);
+        return ready_.size();
+    }
 
-    /// @enum Memory_Policy
-    /// @brief Specifies ability for Gaolette to expand/contract when needed
-    enum class Memory_Policy {
-        // defines contraction/expansion policies of the Gaolette's memory
-        STATIC,    ///< fixed size, no contraction/expansion
-        DYNAMIC    ///< allow contraction/expansion within limits
-    };
+    Orchestrator_Group::Orchestrator_Group(const std::size_t shards, const Placement placement,
+                                           const bool terminate_with_parent, const protocol::Transport transport,
+                                           const std::span<const Warm_Pool_Class> warm_pool,
+                                           const Runtime_Options& runtime)
+        : placement_(placement) {
+        if (shards == 0 || shards > MAX_SHARDS) {
+            throw std::invalid_argument("Orchestrator_Group needs between 1 and MAX_SHARDS shards");
+        }
+        shards_.reserve(shards);
+        for (std::size_t i = 0; i < shards; ++i) {
+            shards_.push_back(std::make_unique<Shard>());
+            shards_.back()->orchestrator = std::make_unique<Orchestrator>(terminate_with_parent, transport, warm_pool,
+                                                                          std::string_view{}, runtime);
+        }
+    }
 
-    /// @struct Perf_Spec
-    /// @brief Performance Specification for Gaolette instance.
-    ///
-    /// Specifies constraints for the Gaolette instance if needed.
-    /// All fields have default values if not specified.
-    struct Perf_Spec {
-        // basic performance specification
-        std::size_t size_;           ///< total memory delegated to the sandbox in bytes
-        Memory_Policy memory_policy_;
-        std::size_t max_memory_usage_;    ///< in bytes
-        std::size_t max_cpu_cores_;
+    Orchestrator_Group::Orchestrator_Group(std::vector<std::unique_ptr<Orchestrator>> orchestrators,
+                                           const Placement placement)
+        : placement_(placement) {
+        if (orchestrators.empty() || orchestrators.size() > MAX_SHARDS) {
+            throw std::invalid_argument("Orchestrator_Group needs between 1 and MAX_SHARDS shards");
+        }
+        shards_.reserve(orchestrators.size());
+        for (std::unique_ptr<Orchestrator>& orchestrator : orchestrators) {
+            if (orchestrator == nullptr) {
+                throw std::invalid_argument("Orchestrator_Group can't shard onto a null Orchestrator");
+            }
+            shards_.push_back(std::make_unique<Shard>());
+            shards_.back()->orchestrator = std::move(orchestrator);
+        }
+    }
 
-        // extended process/resource limits
-        /*std::size_t max_open_files_;
-        std::size_t max_threads_;
-        std::size_t max_stack_size_;
-        std::size_t max_runtime_ms_;
-        std::size_t max_cpu_time_ms_;
+    std::size_t Orchestrator_Group::size() const noexcept {
+        return shards_.size();
+    }
 
-        // security and isolation
-        bool allow_network_;
-        bool allow_filesystem_;
-        bool restrict_privileges_;
-        std::vector<std::string> allowed_syscalls_;
-        std::vector<std::string> allowed_env_vars_;
+    const Orchestrator& Orchestrator_Group::shard(const std::size_t index) const {
+        if (index >= shards_.size()) {
+            throw std::out_of_range("Gaolette does not belong to this Orchestrator_Group");
+        }
+        return *shards_[index]->orchestrator;
+    }
 
-        // scheduling and priorities
-        int cpu_priority_;
-        int io_priority_;
-        std::vector<int> cpu_affinity_;
+    std::size_t Orchestrator_Group::place(const Perf_Spec&) const noexcept {
+        // a racing placement may pick the same shard, the counters only need to be roughly right
+        std::size_t best = 0;
+        for (std::size_t i = 1; i < shards_.size(); ++i) {
+            if (placement_ == Placement::MOST_HEADROOM) {
+                if (shards_[i]->bytes.load(std::memory_order_relaxed)
+                    < shards_[best]->bytes.load(std::memory_order_relaxed)) {
+                    best = i;
+                }
+            } else if (shards_[i]->live.load(std::memory_order_relaxed)
+                       < shards_[best]->live.load(std::memory_order_relaxed)) {
+                best = i;
+            }
+        }
+        return best;
+    }
 
-        // sandboxing features
-        std::string chroot_dir_;
-        std::vector<std::string> allowed_mounts_;
-        bool enable_seccomp_;
-        bool enable_cgroups_;*/
-    };
+    std::size_t Orchestrator_Group::place(std::uint64_t key) const noexcept {
+        // jump consistent hash (Lamping & Veach)
+        std::int64_t bucket = -1;
+        std::int64_t next = 0;
+        while (next < static_cast<std::int64_t>(shards_.size())) {
+            bucket = next;
+            key = key * 2862933555777941757ULL + 1;
+            next = static_cast<std::int64_t>(static_cast<double>(bucket + 1)
+                                             * (static_cast<double>(std::int64_t{1} << 31)
+                                                / static_cast<double>((key >> 33) + 1)));
+        }
+        return static_cast<std::size_t>(bucket);
+    }
 
-    /// Gaolette ID type used to reference some Gaolette.
-    /// -1 specifies an ill-formed gaolette
-    using gaolette_id_t = int;
+    void Orchestrator_Group::account(const std::size_t shard, const Perf_Spec& spec, const int delta) const noexcept {
+        const std::size_t bytes = spec.memory_policy_ == Memory_Policy::DYNAMIC
+            ? std::max(spec.size_, spec.max_memory_usage_) : spec.size_;
+        if (delta > 0) {
+            shards_[shard]->live.fetch_add(1, std::memory_order_relaxed);
+            shards_[shard]->bytes.fetch_add(bytes, std::memory_order_relaxed);
+        } else {
+            shards_[shard]->live.fetch_sub(1, std::memory_order_relaxed);
+            shards_[shard]->bytes.fetch_sub(bytes, std::memory_order_relaxed);
+        }
+    }
 
-    /// @struct Gaolette
-    /// @brief Gaolette instance
-    ///
-    /// Represents a Gaolette instance.
-    struct Gaolette {
-        gaolette_id_t id;
-        State state;
-        Perf_Spec perf_spec;
-    };
+    std::size_t Orchestrator_Group::load(const std::size_t shard) const noexcept {
+        return shards_[shard]->live.load(std::memory_order_relaxed);
+    }
 
-    extern char **environ;
+    gaolette_id_t Orchestrator_Group::global_id(const std::size_t shard, const gaolette_id_t local) {
+        if (local < 0 || local > (std::numeric_limits<gaolette_id_t>::max() >> SHARD_BITS)) {
+            throw std::runtime_error("Gaolette id does not fit a group wide id");
+        }
+        return static_cast<gaolette_id_t>((static_cast<unsigned>(local) << SHARD_BITS) | shard);
+    }
 
-    /// @class Orchestrator
-    /// @brief Low-level controller for a Gao process, aka the gateway API that links Gao processes to the Gao API.
-    ///
-    /// Base of all base.
-    /// Handles IPC with the Gao process and manages its lifecycle.
-    class Orchestrator {
-        pid_t pid_ = 0;
-        int status_ = 0;
-        static const char* arch_;
-        posix_spawn_file_actions_t actions_;
-        int socket_;
-        bool logging_ = false;
+    std::size_t Orchestrator_Group::shard_of(const gaolette_id_t id) noexcept {
+        return static_cast<std::size_t>(static_cast<unsigned>(id) & (MAX_SHARDS - 1));
+    }
 
-        static std::filesystem::path get_gao_binary();
+    gaolette_id_t Orchestrator_Group::local_id(const gaolette_id_t id) noexcept {
+        return id < 0 ? -1 : id >> SHARD_BITS;
+    }
 
-        // NOTICE improve logging, its so ass rn
+    inline protocol::Perf_Spec_Payload pack_perf_spec(const Perf_Spec& spec) {
+        protocol::Perf_Spec_Payload packed{};
+        packed.size = spec.size_;
+        packed.max_memory_usage = spec.max_memory_usage_;
+        packed.max_cpu_cores = static_cast<std::uint32_t>(spec.max_cpu_cores_);
+        packed.memory_policy = static_cast<std::uint8_t>(spec.memory_policy_);
+        packed.page_size = static_cast<std::uint8_t>(spec.page_size_);
+        packed.numa_policy = static_cast<std::uint8_t>(spec.numa_policy_);
+        packed.numa_node = spec.numa_node_;
+        return packed;
+    }
 
-        enum class Log_Type {
-            GENERIC_SUCCESS,
-            GENERIC_FAILURE,
-            GENERIC_NOTICE,
-            GENERIC_WARNING,
+    inline Page_Size unpack_page_size(const std::uint8_t page_size_code) {
+        switch (page_size_code) {
+            case 0: return Page_Size::DEFAULT;
+            case 1: return Page_Size::TRANSPARENT_HUGE;
+            case 2: return Page_Size::EXPLICIT_HUGE;
+            default:
+                throw std::runtime_error("Unknown page size code received from Gaolette");
+        }
+    }
 
-        };
+    inline State unpack_state(const std::uint8_t state_code) {
+        switch (state_code) {
+            case 0: return State::Operational;
+            case 1: return State::ShutDown;
+            case 2: return State::Locked;
+            case 3: return State::Operating;
+            case 4: return State::Illformed;
+            default:
+                throw std::runtime_error("Unknown state code received from Gaolette");
+        }
+    }
 
-        /// Log priority, specifies whether a log is to be printed regardless of the logging_ member
-        enum class Log_Prio {
-            ONLY_IF_LOGGING, /// only if logging_ is true
-            ANY /// will always be printed if dump_logs/print_log is invoked
-        };
+    inline void expect_reply(const Orchestrator::Reply& reply, const protocol::Opcode opcode) {
+        if (reply.header.opcode != static_cast<std::uint16_t>(opcode)) {
+            throw std::runtime_error("Invalid response from Gao process");
+        }
+    }
 
-        struct Log {
-            std::string msg;
-            std::string time;
-            Log_Type type;
-            Log_Prio prio;
+    inline Gaolette finish_create_gaolette(const Orchestrator::Reply& reply, const Perf_Spec& spec,
+                                           const protocol::Opcode opcode = protocol::Opcode::CREATE) {
+        expect_reply(reply, opcode);
+        if (reply.header.status != static_cast<std::uint16_t>(protocol::Status::OK)) {
+            throw exceptions::Failed_To_Create_Gaolette(reply.header.status);
+        }
+        if (reply.payload.size() != sizeof(protocol::Created_Payload)) {
+            throw std::runtime_error("Invalid response from Gaolette creation");
+        }
 
-            explicit Log(Log_Type type, const std::string& msg_, Log_Prio p);
-        };
+        protocol::Created_Payload created{};
+        std::memcpy(&created, reply.payload.data(), sizeof(created));
+        Gaolette gaolette{created.id, State::Operational, spec};
+        gaolette.perf_spec.page_size_ = unpack_page_size(created.page_size);
+        return gaolette;
+    }
 
-        std::vector<Log> logs_;
+    inline int finish_destroy_gaolette(const Orchestrator::Reply& reply, Gaolette& gaolette) {
+        expect_reply(reply, protocol::Opcode::DESTROY);
+        if (reply.header.status == static_cast<std::uint16_t>(protocol::Status::OK)) {
+            gaolette.id = -1;
+            gaolette.state = State::ShutDown;
+            return 0; // success
+        }
 
-        ///@brief Add to logs_ regardless of logging_ because of Log_Prio
-        /// @param log Log object that would be added to logs_
-        void log(const Log& log);
+        return -1; // failure
+    }
 
-        ///@brief Dumps all logs in logs_
-        /// @param clear whether to clear logs_ after execution
-        void dump_logs(bool clear = true);
+    inline void finish_fetch_state(const Orchestrator::Reply& reply, Gaolette& gaolette) {
+        expect_reply(reply, protocol::Opcode::GET_STATE);
+        if (reply.header.status != static_cast<std::uint16_t>(protocol::Status::OK)
+            || reply.payload.size() != sizeof(protocol::State_Payload)) {
+            throw std::runtime_error("Failed to fetch Gaolette state");
+        }
 
-        ///@brief Prints oldest log in logs_
-        ///@param clear whether to clear logs_ after execution
-        void print_log(bool clear = true);
+        protocol::State_Payload state{};
+        std::memcpy(&state, reply.payload.data(), sizeof(state));
+        gaolette.state = unpack_state(state.state);
+    }
 
+    inline Gaolette create_gaolette(Perf_Spec spec, const Orchestrator &gao_p) {
+        const protocol::Perf_Spec_Payload packed = pack_perf_spec(spec);
+        return finish_create_gaolette(gao_p.request(protocol::Opcode::CREATE, &packed, sizeof(packed)), spec);
+    }
 
-    public:
-        /// @brief Constructor and initializer for Orchestrator instances and Gao processes respectively.
-        ///
-        /// Initializes and modifies Gao processes on launch to ensure IPC
-        /// @param terminate_with_parent whether the child process should after the death of the parent
-        /// continue and become an orphan (possibly adopted by reaper) or terminate with the parent.
-        explicit Orchestrator(bool terminate_with_parent = true);
+    inline int destroy_gaolette(Gaolette& gaolette, const Orchestrator& gao_p) {
+        const protocol::Id_Payload id{gaolette.id};
+        return finish_destroy_gaolette(gao_p.request(protocol::Opcode::DESTROY, &id, sizeof(id)), gaolette);
+    }
 
-        /// Destructor for Orchestrator instances and Gao processes.
-        ~Orchestrator();
+    inline int resize_gaolette(Gaolette& gaolette, const std::size_t size, const Orchestrator& gao_p) {
+        const protocol::Resize_Payload resize{gaolette.id, 0, size};
+        const Orchestrator::Reply reply = gao_p.request(protocol::Opcode::RESIZE, &resize, sizeof(resize));
+        expect_reply(reply, protocol::Opcode::RESIZE);
+        if (reply.header.status != static_cast<std::uint16_t>(protocol::Status::OK)) {
+            return -1; // failure
+        }
 
-        ///@brief reads from socket_ into a buffer until either the buffer is maxed out or it hits a newline.
-        ///@return the read line as a std::string, empty string on error.
-        [[nodiscard]] std::string read_line() const;
+        gaolette.perf_spec.size_ = size;
+        return 0; // success
+    }
 
-        ///@brief writes a line to the Gao process via writing to socket_.
-        ///
-        /// @param line the line to write, a newline is appended automatically.
-        /// @return number of bytes written, -1 on error.
-        int write_line(const std::string& line) const; // NOLINT
-    };
+    inline void fetch_state(Gaolette& gaolette, const Orchestrator& gao_p) {
+        const protocol::Id_Payload id{gaolette.id};
+        finish_fetch_state(gao_p.request(protocol::Opcode::GET_STATE, &id, sizeof(id)), gaolette);
+    }
 
-    std::filesystem::path Orchestrator::get_gao_binary() {
-#if defined(__x86_64__)
-        arch_ = "x86_64";
-        return std::string(std::getenv("GAO_BIN_DIR")) + std::string("/x86_64");
-#elif defined(__i386__)
-        arch_ = "i386";
-        return std::string(std::getenv("GAO_BIN_DIR")) + std::string("/i386");
-#elif defined(__arm__)
-        arch_ = "arm";
-        return {std::getenv("GAO_BIN_DIR") + std::string("/arm")};
-#elif defined(__aarch64__)
-        arch_ = "aarch64";
-        return {std::getenv("GAO_BIN_DIR") + std::string("/aarch64")};
-#endif
+    inline Gaolette clone_gaolette(const Gaolette& source, const Orchestrator& gao_p) {
+        const protocol::Id_Payload id{source.id};
+        return finish_create_gaolette(gao_p.request(protocol::Opcode::CLONE, &id, sizeof(id)), source.perf_spec,
+                                      protocol::Opcode::CLONE);
     }
 
-    Orchestrator::Log::Log(const Log_Type type, const std::string &msg_, const Log_Prio p) : msg(msg_), type(type), prio(p) {
-        switch (type) {
-            case Log_Type::GENERIC_SUCCESS:
-                msg = "[" + colors::SUCCESS + "SUCCESS" + colors::RESET + "] " + msg_;
-                break;
-            case Log_Type::GENERIC_FAILURE:
-                msg = "[" + colors::ERROR + "FAILURE" + colors::RESET + "] " + msg_;
-                break;
-            case Log_Type::GENERIC_NOTICE:
-                msg = "[" + colors::NOTICE + "NOTICE" + colors::RESET + "] " + msg_;
-                break;
-            case Log_Type::GENERIC_WARNING:
-                msg = "[" + colors::WARNING + "WARNING" + colors::RESET + "] " + msg_;
-                break;
+    inline Gaolette_Memory share_gaolette(const Gaolette& gaolette, const Orchestrator& gao_p) {
+        const protocol::Id_Payload id{gaolette.id};
+        const std::uint32_t request_id = gao_p.send_request(protocol::Opcode::SHARE, &id, sizeof(id));
+        const Orchestrator::Reply reply = gao_p.wait_reply(request_id);
+        expect_reply(reply, protocol::Opcode::SHARE);
+        if (reply.header.status != static_cast<std::uint16_t>(protocol::Status::OK)
+            || reply.payload.size() != sizeof(protocol::Shared_Payload)) {
+            throw std::runtime_error("Failed to share Gaolette memory");
         }
+
+        protocol::Shared_Payload shared{};
+        std::memcpy(&shared, reply.payload.data(), sizeof(shared));
+        return {gao_p.take_descriptor(request_id), shared.size, shared.writable != 0};
     }
 
-    void Orchestrator::log(const Log &log) {
-        logs_.emplace_back(log);
+    inline Pending<Gaolette> create_gaolette_async(Perf_Spec spec, const Orchestrator& gao_p) {
+        const protocol::Perf_Spec_Payload packed = pack_perf_spec(spec);
+        const std::uint32_t id = gao_p.send_request(protocol::Opcode::CREATE, &packed, sizeof(packed));
+        return Pending<Gaolette>(gao_p, id, [spec](Orchestrator::Reply& reply) {
+            return finish_create_gaolette(reply, spec);
+        });
     }
 
-    void Orchestrator::dump_logs(const bool clear) {
-        for (const auto& log : logs_) {
-            if (log.prio == Log_Prio::ANY || (log.prio == Log_Prio::ONLY_IF_LOGGING && logging_)) {
-                std::cout << log.msg << "\n";
-            }
-        }
-        if (clear) {
-            logs_.clear();
-        }
+    inline Pending<int> destroy_gaolette_async(Gaolette& gaolette, const Orchestrator& gao_p) {
+        const protocol::Id_Payload id{gaolette.id};
+        const std::uint32_t request_id = gao_p.send_request(protocol::Opcode::DESTROY, &id, sizeof(id));
+        return Pending<int>(gao_p, request_id, [&gaolette](Orchestrator::Reply& reply) {
+            return finish_destroy_gaolette(reply, gaolette);
+        });
     }
 
-    void Orchestrator::print_log(bool clear) {
-        if (logs_[0].prio == Log_Prio::ANY || (logs_[0].prio == Log_Prio::ONLY_IF_LOGGING && logging_)) {
-            std::cout << logs_[0].msg << "\n";
-        }
-        if (clear) {
-            // erase logs_[0]
-            logs_.erase(logs_.begin());
-        }
+    inline Pending<void> fetch_state_async(Gaolette& gaolette, const Orchestrator& gao_p) {
+        const protocol::Id_Payload id{gaolette.id};
+        const std::uint32_t request_id = gao_p.send_request(protocol::Opcode::GET_STATE, &id, sizeof(id));
+        return Pending<void>(gao_p, request_id, [&gaolette](Orchestrator::Reply& reply) {
+            finish_fetch_state(reply, gaolette);
+        });
     }
 
-    Orchestrator::Orchestrator(bool terminate_with_parent) {    // NOLINT : issue with actions_ initialization
-        int sv[2]; // socket pair
-        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == -1) {
-            throw std::runtime_error("socketpair failed");
+    inline std::vector<Pending<void>> send_create_gaolettes(const std::span<const Perf_Spec> specs,
+                                                            const Orchestrator& gao_p,
+                                                            const std::span<Batch_Entry> entries) {
+        std::vector<protocol::Perf_Spec_Payload> packed;
+        packed.reserve(specs.size());
+        for (const Perf_Spec& spec : specs) {
+            packed.push_back(pack_perf_spec(spec));
         }
-        posix_spawn_file_actions_init(&actions_);
 
-        // duplicate the child's socket to stdin/stdout
-        posix_spawn_file_actions_adddup2(&actions_, sv[1], STDIN_FILENO);
-        posix_spawn_file_actions_adddup2(&actions_, sv[1], STDOUT_FILENO);
+        std::vector<Pending<void>> chunks;
+        for (std::size_t first = 0; first < packed.size(); first += protocol::MAX_BATCH) {
+            const std::size_t count = std::min<std::size_t>(protocol::MAX_BATCH, packed.size() - first);
+            const std::uint32_t request_id = gao_p.send_request(protocol::Opcode::CREATE_BATCH, packed.data() + first,
+                                                                count * sizeof(protocol::Perf_Spec_Payload));
+
+            chunks.emplace_back(gao_p, request_id, [entries, specs, first, count](Orchestrator::Reply& reply) {
+                expect_reply(reply, protocol::Opcode::CREATE_BATCH);
+                if (reply.header.status != static_cast<std::uint16_t>(protocol::Status::OK)
+                    || reply.payload.size() != count * sizeof(protocol::Batch_Result)) {
+                    throw std::runtime_error("Invalid response from batch Gaolette creation");
+                }
 
-        status_ = posix_spawn(&pid_, get_gao_binary().c_str(),
-                             &actions_, nullptr,
-                             nullptr, environ);
-        if (status_ != 0) {
-            throw std::runtime_error("posix_spawn failed");
+                for (std::size_t i = 0; i < count; ++i) {
+                    protocol::Batch_Result result{};
+                    std::memcpy(&result, reply.payload.data() + i * sizeof(result), sizeof(result));
+                    if (result.status == static_cast<std::uint16_t>(protocol::Status::OK)) {
+                        entries[first + i] = Batch_Entry{Gaolette{result.id, State::Operational, specs[first + i]}, 0};
+                        entries[first + i].gaolette.perf_spec.page_size_ = unpack_page_size(result.page_size);
+                    } else {
+                        entries[first + i] = Batch_Entry{Gaolette{-1, State::Illformed, specs[first + i]}, result.status};
+                    }
+                }
+            });
         }
+        return chunks;
+    }
 
-        socket_ = sv[0];
+    inline std::vector<Batch_Entry> create_gaolettes(const std::span<const Perf_Spec> specs, const Orchestrator& gao_p) {
+        std::vector<Batch_Entry> entries(specs.size());
 
-        // we can now close the child's end on the parent as it only needs it's end of the socket
-        close(sv[1]);
+        // every chunk is sent before waiting on any of them
+        for (Pending<void>& chunk : send_create_gaolettes(specs, gao_p, entries)) {
+            chunk.get();
+        }
+        return entries;
     }
 
-    Orchestrator::~Orchestrator() {
-        posix_spawn_file_actions_destroy(&actions_);
-        if (socket_ != -1) {
-            close(socket_);
+    inline std::vector<Pending<void>> send_destroy_gaolettes(const std::span<Gaolette> gaolettes,
+                                                             const Orchestrator& gao_p, const std::span<int> codes) {
+        std::vector<protocol::Id_Payload> ids;
+        ids.reserve(gaolettes.size());
+        for (const Gaolette& gaolette : gaolettes) {
+            ids.push_back(protocol::Id_Payload{gaolette.id});
         }
-        if (pid_ > 0) {
-            if (waitpid(pid_, &status_, 0) > 0) {
-                if (WIFEXITED(status_)) {
-                    std::cout << "Exited with status " << WEXITSTATUS(status_) << std::endl;
-                } else if (WIFSIGNALED(status_)) {
-                    std::cout << "Killed by signal " << WTERMSIG(status_) << std::endl;
-                } else {
-                    std::cout << "Exited with unknown status" << std::endl;
+
+        std::vector<Pending<void>> chunks;
+        for (std::size_t first = 0; first < ids.size(); first += protocol::MAX_BATCH) {
+            const std::size_t count = std::min<std::size_t>(protocol::MAX_BATCH, ids.size() - first);
+            const std::uint32_t request_id = gao_p.send_request(protocol::Opcode::DESTROY_BATCH, ids.data() + first,
+                                                                count * sizeof(protocol::Id_Payload));
+
+            chunks.emplace_back(gao_p, request_id, [codes, gaolettes, first, count](Orchestrator::Reply& reply) {
+                expect_reply(reply, protocol::Opcode::DESTROY_BATCH);
+                if (reply.header.status != static_cast<std::uint16_t>(protocol::Status::OK)
+                    || reply.payload.size() != count * sizeof(protocol::Batch_Result)) {
+                    throw std::runtime_error("Invalid response from batch Gaolette destruction");
                 }
-            }
+
+                for (std::size_t i = 0; i < count; ++i) {
+                    protocol::Batch_Result result{};
+                    std::memcpy(&result, reply.payload.data() + i * sizeof(result), sizeof(result));
+                    codes[first + i] = result.status;
+                    if (result.status == static_cast<std::uint16_t>(protocol::Status::OK)) {
+                        gaolettes[first + i].id = -1;
+                        gaolettes[first + i].state = State::ShutDown;
+                    }
+                }
+            });
         }
+        return chunks;
     }
 
+    inline std::vector<int> destroy_gaolettes(const std::span<Gaolette> gaolettes, const Orchestrator& gao_p) {
+        std::vector<int> codes(gaolettes.size());
+        for (Pending<void>& chunk : send_destroy_gaolettes(gaolettes, gao_p, codes)) {
+            chunk.get();
+        }
+        return codes;
+    }
 
-    std::string Orchestrator::read_line() const {
-        constexpr size_t BUF_SIZE = 1024;
-        char* buf = new char[BUF_SIZE];  // caller must delete[]
-        size_t len = 0;
+    inline Gaolette create_gaolette_on_shard(const Perf_Spec& spec, const Orchestrator_Group& group,
+                                             const std::size_t shard) {
+        group.account(shard, spec, 1);
+        Gaolette gaolette;
+        try {
+            gaolette = create_gaolette(spec, group.shard(shard));
+        } catch (...) {
+            group.account(shard, spec, -1);
+            throw;
+        }
+        gaolette.id = Orchestrator_Group::global_id(shard, gaolette.id);
+        return gaolette;
+    }
 
-        while (true) {
-            ssize_t nread = ::read(socket_, buf + len, BUF_SIZE - len - 1);
-            if (nread == -1) {
-                delete[] buf;
-                throw std::runtime_error("read failed");
-            }
-            if (nread == 0) {  // EOF
-                break;
-            }
-            len += nread;
+    inline Gaolette create_gaolette(Perf_Spec spec, const Orchestrator_Group& group) {
+        return create_gaolette_on_shard(spec, group, group.place(spec));
+    }
 
-            // stop if newline is seen
-            if (buf[len - 1] == '\n') {
-                buf[len - 1] = '\0';
-                std::string temp = buf;
-                delete[] buf;
-                return temp;
-            }
+    inline Gaolette create_gaolette(Perf_Spec spec, const Orchestrator_Group& group, const std::uint64_t key) {
+        return create_gaolette_on_shard(spec, group, group.place(key));
+    }
 
-            // safety: stop if buffer full (no newline)
-            if (len >= BUF_SIZE - 1) {
-                buf[len] = '\0';
-                std::string temp = buf;
-                delete[] buf;
-                return temp;
-            }
+    inline int destroy_gaolette(Gaolette& gaolette, const Orchestrator_Group& group) {
+        const std::size_t shard = Orchestrator_Group::shard_of(gaolette.id);
+        if (gaolette.id < 0 || shard >= group.size()) {
+            return -1; // failure
         }
 
-        // no newline before EOF
-        buf[len] = '\0';
-        std::string temp = buf;
-        delete[] buf;
-        return temp;
+        Gaolette local = gaolette;
+        local.id = Orchestrator_Group::local_id(gaolette.id);
+        if (destroy_gaolette(local, group.shard(shard)) == -1) {
+            return -1; // failure
+        }
+        group.account(shard, gaolette.perf_spec, -1);
+        gaolette.id = local.id;
+        gaolette.state = local.state;
+        return 0; // success
     }
 
-    int Orchestrator::write_line(const std::string &line) const {
-        return static_cast<int>(write(socket_, (line + "\n").c_str(), strlen(line.c_str())));
+    inline void fetch_state(Gaolette& gaolette, const Orchestrator_Group& group) {
+        Gaolette local = gaolette;
+        local.id = Orchestrator_Group::local_id(gaolette.id);
+        fetch_state(local, group.shard(Orchestrator_Group::shard_of(gaolette.id)));
+        gaolette.state = local.state;
     }
 
-    ///@brief Creates a Gaolette on the Gao process held by the gao_p Orchestrator instance.
-    ///
-    /// @param spec Performance specification for the Gaolette to be created.
-    /// @param gao_p Orchestrator instance holding the Gao process to create the Gaolette on.
-    /// @return the created Gaolette instance.
-    /// @throws exceptions::Failed_To_Create_Gaolette if creation fails.
-    inline Gaolette create_gaolette(Perf_Spec spec, const Orchestrator& gao_p) {
-        std::string gao_instruction = "crt:";
-        gao_instruction.append(std::to_string(spec.size_) + ",");
-        gao_instruction.append(std::to_string(static_cast<int>(spec.memory_policy_)) + ",");
-        gao_instruction.append(std::to_string(spec.max_memory_usage_) + ",");
-        gao_instruction.append(std::to_string(spec.max_cpu_cores_));
+    inline int resize_gaolette(Gaolette& gaolette, const std::size_t size, const Orchestrator_Group& group) {
+        const std::size_t shard = Orchestrator_Group::shard_of(gaolette.id);
+        if (gaolette.id < 0 || shard >= group.size()) {
+            return -1; // failure
+        }
 
-        gao_p.write_line(gao_instruction);  // NOLINT
+        Gaolette local = gaolette;
+        local.id = Orchestrator_Group::local_id(gaolette.id);
+        if (resize_gaolette(local, size, group.shard(shard)) == -1) {
+            return -1; // failure
+        }
+        gaolette.perf_spec.size_ = local.perf_spec.size_;
+        return 0; // success
+    }
 
-        // we need to wait until read_line contains valid buffer space that we can read
-        const std::string response = gao_p.read_line();
-        if (response.empty() || response.substr(0, 2) == "-1") {
-            throw std::runtime_error("Gaolette creation failed"); // change to custom error
+    inline Gaolette clone_gaolette(const Gaolette& source, const Orchestrator_Group& group) {
+        const std::size_t shard = Orchestrator_Group::shard_of(source.id);
+        if (source.id < 0 || shard >= group.size()) {
+            throw exceptions::Failed_To_Create_Gaolette(static_cast<int>(protocol::Status::UNKNOWN_GAOLETTE));
         }
 
-        // response comes in the form:
-        // OK:<gaolette_id_t>
-        // or
-        // ERR:<error_code>
-        if (response.substr(0, 3) == "ERR") {
-            int error_code = std::stoi(response.substr(4));
-            throw exceptions::Failed_To_Create_Gaolette(error_code);
+        Gaolette local = source;
+        local.id = Orchestrator_Group::local_id(source.id);
+        group.account(shard, source.perf_spec, 1);
+        Gaolette clone;
+        try {
+            clone = clone_gaolette(local, group.shard(shard));
+        } catch (...) {
+            group.account(shard, source.perf_spec, -1);
+            throw;
         }
+        clone.id = Orchestrator_Group::global_id(shard, clone.id);
+        return clone;
+    }
 
-        if (response.substr(0, 2) == "OK") {
-            //parse until ,
-            gaolette_id_t id = std::stoi(response.substr(3));
-            return Gaolette{id, State::Operational, spec};
+    inline Gaolette_Memory share_gaolette(const Gaolette& gaolette, const Orchestrator_Group& group) {
+        const std::size_t shard = Orchestrator_Group::shard_of(gaolette.id);
+        if (gaolette.id < 0 || shard >= group.size()) {
+            throw std::runtime_error("Failed to share Gaolette memory");
         }
 
-        throw std::runtime_error("Invalid response from Gaolette creation");
+        Gaolette local = gaolette;
+        local.id = Orchestrator_Group::local_id(gaolette.id);
+        return share_gaolette(local, group.shard(shard));
     }
 
-    ///@brief Destroys a Gaolette held by the gao_p Orchestrator instance.
-    ///
-    /// @param gaolette the Gaolette instance to destroy.
-    /// @param gao_p Orchestrator instance holding the Gao process to destroy the Gaolette on.
-    /// @return 0 on success, -1 on failure.
-    inline int destroy_gaolette(Gaolette& gaolette, const Orchestrator& gao_p) {
-        std::string gao_instruction = "del:";
-        gao_instruction.append(std::to_string(gaolette.id));
-        gao_p.write_line(gao_instruction);  // NOLINT
-        std::string response = gao_p.read_line();
-        if (response.substr(0, 2) == "OK") {
-            gaolette.id = -1;
-            gaolette.state = State::ShutDown;
-            return 0; // success
+    inline std::vector<Batch_Entry> create_gaolettes(const std::span<const Perf_Spec> specs,
+                                                     const Orchestrator_Group& group) {
+        // place every item first, then hand each shard its share in one go
+        std::vector<std::vector<Perf_Spec>> shard_specs(group.size());
+        std::vector<std::vector<std::size_t>> shard_items(group.size());
+        for (std::size_t i = 0; i < specs.size(); ++i) {
+            const std::size_t shard = group.place(specs[i]);
+            group.account(shard, specs[i], 1);
+            shard_specs[shard].push_back(specs[i]);
+            shard_items[shard].push_back(i);
         }
 
-        return -1; // failure
+        std::vector<std::vector<Batch_Entry>> shard_entries(group.size());
+        std::vector<Pending<void>> chunks;
+        for (std::size_t shard = 0; shard < group.size(); ++shard) {
+            shard_entries[shard].resize(shard_specs[shard].size());
+            for (Pending<void>& chunk : send_create_gaolettes(shard_specs[shard], group.shard(shard),
+                                                              shard_entries[shard])) {
+                chunks.push_back(std::move(chunk));
+            }
+        }
+        for (Pending<void>& chunk : chunks) {
+            chunk.get();
+        }
+
+        std::vector<Batch_Entry> entries(specs.size());
+        for (std::size_t shard = 0; shard < group.size(); ++shard) {
+            for (std::size_t i = 0; i < shard_items[shard].size(); ++i) {
+                Batch_Entry& entry = shard_entries[shard][i];
+                if (entry.error_code == 0) {
+                    entry.gaolette.id = Orchestrator_Group::global_id(shard, entry.gaolette.id);
+                } else {
+                    group.account(shard, shard_specs[shard][i], -1);
+                }
+                entries[shard_items[shard][i]] = entry;
+            }
+        }
+        return entries;
     }
 
-    ///@brief Updates state of Gaolette instance held by gao_p Orchestrator instance.
-    ///
-    ///@param gaolette the Gaolette instance to update.
-    ///@param gao_p Orchestrator instance holding the Gao process to query the Gaolette state from.
-    ///@return void, gaolette.state is updated in place.
-    inline void fetch_state(Gaolette& gaolette, const Orchestrator& gao_p) {
-        gao_p.write_line(std::string("get:state"));
-        std::string response = gao_p.read_line();
-        if (response.substr(0, 2) == "OK") {
-            switch (int state_code = std::stoi(response.substr(3))) { //NOLINT
-                case 0:
-                    gaolette.state = State::Operational;
-                    break;
-                case 1:
+    inline std::vector<int> destroy_gaolettes(const std::span<Gaolette> gaolettes, const Orchestrator_Group& group) {
+        std::vector<int> codes(gaolettes.size(), static_cast<int>(protocol::Status::UNKNOWN_GAOLETTE));
+        std::vector<std::vector<Gaolette>> shard_gaolettes(group.size());
+        std::vector<std::vector<std::size_t>> shard_items(group.size());
+        for (std::size_t i = 0; i < gaolettes.size(); ++i) {
+            const std::size_t shard = Orchestrator_Group::shard_of(gaolettes[i].id);
+            if (gaolettes[i].id < 0 || shard >= group.size()) {
+                continue;
+            }
+            Gaolette local = gaolettes[i];
+            local.id = Orchestrator_Group::local_id(gaolettes[i].id);
+            shard_gaolettes[shard].push_back(local);
+            shard_items[shard].push_back(i);
+        }
+
+        std::vector<std::vector<int>> shard_codes(group.size());
+        std::vector<Pending<void>> chunks;
+        for (std::size_t shard = 0; shard < group.size(); ++shard) {
+            shard_codes[shard].resize(shard_gaolettes[shard].size());
+            for (Pending<void>& chunk : send_destroy_gaolettes(shard_gaolettes[shard], group.shard(shard),
+                                                               shard_codes[shard])) {
+                chunks.push_back(std::move(chunk));
+            }
+        }
+        for (Pending<void>& chunk : chunks) {
+            chunk.get();
+        }
+
+        for (std::size_t shard = 0; shard < group.size(); ++shard) {
+            for (std::size_t i = 0; i < shard_items[shard].size(); ++i) {
+                Gaolette& gaolette = gaolettes[shard_items[shard][i]];
+                codes[shard_items[shard][i]] = shard_codes[shard][i];
+                if (shard_codes[shard][i] == static_cast<int>(protocol::Status::OK)) {
+                    group.account(shard, gaolette.perf_spec, -1);
+                    gaolette.id = -1;
                     gaolette.state = State::ShutDown;
-                    break;
-                case 2:
-                    gaolette.state = State::Locked;
-                    break;
-                case 3:
-                    gaolette.state = State::Operating;
-                    break;
-                case 4:
-                    gaolette.state = State::Illformed;
-                    break;
-                default:
-                    throw std::runtime_error("Unknown state code received from Gaolette");
+                }
             }
-        } else {
-            throw std::runtime_error("Failed to fetch Gaolette state");
         }
+        return codes;
     }
 }
 
-#endif //GAO_HPP
\ No newline at end of file
+#endif //GAO_HPP
@@ -1,8 +1,64 @@
 #include "src/header/comm.hpp"
+#include "src/header/init_gaolette.hpp"
+#include "src/header/scheduler.hpp"
 
-int main() {
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char** argv) {
     // Gao runtime -> main loop
     // specifies all Gao options that are customizable
     // all arguments are accessible via the command line
 
+    Gao::protocol::Transport transport = Gao::protocol::Transport::SOCKET;
+    size_t reservation = DEFAULT_GAOLETTE_RESERVATION;
+    uint32_t workers = 0;
+    bool pin_workers = false;
+    const char* listen_name = nullptr;
+    Io_Backend backend = Io_Backend::EPOLL;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], Gao::ring::SHARED_MEMORY_FLAG) == 0) {
+            transport = Gao::protocol::Transport::SHARED_MEMORY;
+        } else if (strncmp(argv[i], "--reserve=", 10) == 0) {
+            reservation = strtoull(argv[i] + 10, nullptr, 10);
+        } else if (strncmp(argv[i], "--workers=", 10) == 0) {
+            workers = static_cast<uint32_t>(strtoul(argv[i] + 10, nullptr, 10));
+        } else if (strcmp(argv[i], "--pin-workers") == 0) {
+            pin_workers = true;
+        } else if (strncmp(argv[i], "--listen=", 9) == 0) {
+            listen_name = argv[i] + 9;
+        } else if (strcmp(argv[i], "--io-uring") == 0) {
+            backend = Io_Backend::IO_URING;
+        } else if (strcmp(argv[i], Gao::protocol::DESCRIPTOR_FLAG) == 0) {
+            Comm::attach_descriptors(Gao::protocol::DESCRIPTOR_FILENO);
+        }
+    }
+
+    // without a reservation Gaolettes are simply mapped one by one
+    reserve_gaolette_space(reservation);
+
+    // --warm-pool=<bytes>:<count>, once per size class, sizes are only known after the reservation
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--warm-pool=", 12) == 0) {
+            char* count = nullptr;
+            const size_t size = strtoull(argv[i] + 12, &count, 10);
+            if (*count == ':') {
+                configure_warm_pool(size, static_cast<uint32_t>(strtoul(count + 1, nullptr, 10)));
+            }
+        }
+    }
+
+    // Gaolette work only gets worker threads when asked for, the control loop itself stays single threaded
+    // --pin-workers spreads them one per CPU over the CPUs the runtime may use
+    if (workers != 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        const bool pinned = pin_workers && sched_getaffinity(0, sizeof(cpus), &cpus) == 0;
+        gaolette_scheduler.start(workers, pinned ? &cpus : nullptr);
+    }
+
+    const int result = Comm::run(transport, listen_name, backend);
+    gaolette_scheduler.stop();
+    return result;
 }
\ No newline at end of file
@@ -3,9 +3,22 @@
 //
 
 #include "header/comm.hpp"
+#include "header/dispatch.hpp"
+#include "header/init_gaolette.hpp"
+#include "header/stats.hpp"
+#include "header/uring.hpp"
 
 #include <cstdlib>
 #include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 
 void* operator new(size_t size, nothrow_t const&) noexcept {
     return ::malloc(size);
@@ -44,42 +57,1162 @@ void Comm::set_status(Comm_Status status) noexcept {
     }
 }
 
-[[nodiscard]] Pair<char*, ssize_t> Comm::read_line() noexcept {
-    constexpr size_t BUF_SIZE = 1024;
-    char* buf = new(::nothrow) char[BUF_SIZE];  // caller must delete[]
-    size_t len = 0;
+namespace {
+    constexpr size_t INITIAL_RECV_CAPACITY = 64 * 1024;
+    constexpr size_t SEND_HIGH_WATER = 4 << 20;    // no further requests are read while this much is queued
+    constexpr uint32_t MAX_PENDING_REPLIES = 1024;  // nor while this many requests are still running on workers
 
-    while (true) {
-        ssize_t nread = ::read(0, buf + len, BUF_SIZE - len - 1);
-        if (nread == -1) {
-            delete[] buf;
-            return Pair<char*, ssize_t>{nullptr, -1};
+    // io_uring backend: multishot receives land in URING_BUFFERS provided buffers of URING_BUFFER_SIZE bytes
+    constexpr uint32_t URING_ENTRIES = 1024;
+    constexpr uint16_t URING_BUFFER_GROUP = 0;
+    constexpr uint32_t URING_BUFFERS = 512;
+    constexpr uint32_t URING_BUFFER_SIZE = 16 * 1024;
+
+    // what a completion belongs to, kept in the low bits of user_data next to the 8 byte aligned source
+    enum Operation : uint64_t {
+        RECEIVE = 0,
+        SEND = 1,
+        ACCEPT = 2,
+        DOORBELL = 3,
+        HANGUP = 4,
+        CANCEL = 5,
+        REPLIES = 6,
+        SPACE = 7
+    };
+    constexpr uint64_t OPERATION_MASK = 7;
+
+    Reactor reactor;
+    Uring uring;
+    bool use_uring = false;
+    bool running = false;
+    Gao::ring::Channel channel;
+
+    Connection host;            // the Orchestrator that spawned us, the runtime exits once it hangs up
+    Event_Source host_hangup;   // fd 0 while the rings carry the host's traffic, it only turns readable on hang up
+    Event_Source host_space;    // the space doorbell of the host's ring, rung once it has room for queued replies
+    Event_Source listener;
+    Event_Source reply_source;  // finished jobs of parallel dispatch wait to be sent
+    int descriptors = -1;       // SOCK_SEQPACKET socket memfds are handed to the host over, see Comm::share
+    bool accept_stalled = false;        // multishot accept ended on running out of descriptors or memory
+    Connection* accepted = nullptr;     // controllers connected through listener
+    Connection* current = nullptr;      // connection whose request is being dispatched, replies go there
+    Connection* dirty = nullptr;        // connections the Uring loop looks at once the current batch is done
+    Connection* watchers[MAX_WATCHERS]; // Active connections by watcher slot
+    char* notification_buffer = nullptr;    // STATE_CHANGED payload being assembled
+    size_t notification_capacity = 0;
+
+    int set_nonblocking(int fd) noexcept {
+        const int flags = ::fcntl(fd, F_GETFL);
+        return flags == -1 ? -1 : ::fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    }
+
+    // grows buffer to hold at least need bytes, returns -1 on allocation failure
+    int reserve(char*& buffer, size_t& capacity, size_t need) noexcept {
+        if (need <= capacity) {
+            return 0;
         }
-        if (nread == 0) {  // EOF
-            break;
+        size_t grown = capacity == 0 ? INITIAL_RECV_CAPACITY : capacity;
+        while (grown < need) {
+            grown *= 2;
+        }
+        auto* resized = static_cast<char*>(::realloc(buffer, grown));
+        if (resized == nullptr) {
+            return -1;
+        }
+        buffer = resized;
+        capacity = grown;
+        return 0;
+    }
+
+    // a peer that doesn't read its replies, or keeps the workers busy, stops being served until they drained
+    bool backed_up(const Connection& connection) noexcept {
+        return connection.queued() >= SEND_HIGH_WATER || connection.pending_replies >= MAX_PENDING_REPLIES;
+    }
+
+    // runs the requests buffered for connection until it runs dry or is backed up,
+    // returns -1 once the connection is to be dropped
+    int serve_buffered(Connection& connection) noexcept {
+        Gao::protocol::Frame_Header header{};
+        const char* payload = nullptr;
+        // one reading of the clock for everything that arrived together, later frames of the burst
+        // are charged for waiting behind the earlier ones
+        const uint64_t received = Gao::stats::now();
+
+        while (!backed_up(connection)) {
+            const int framed = connection.next_frame(header, payload);
+            if (framed != 1) {
+                return framed;
+            }
+            runtime_stats.requests.fetch_add(1, std::memory_order_relaxed);
+            if (dispatch_parallel(header, payload, &connection, received) == 1) {
+                runtime_stats.offloaded.fetch_add(1, std::memory_order_relaxed);
+                ++connection.pending_replies;
+                continue;
+            }
+            current = &connection;
+            dispatch(header, payload, received);
+            current = nullptr;
+            if (connection.closed) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    // runs every complete request of connection and reads more until the peer has nothing left to send,
+    // returns -1 once the connection is to be dropped
+    int service(Connection& connection) noexcept {
+        while (true) {
+            if (connection.flush() == -1) {
+                return -1;
+            }
+            // flushing resumes it on EPOLLOUT or the ring's space doorbell, delivering replies once enough came back
+            if (backed_up(connection)) {
+                return 0;
+            }
+            if (serve_buffered(connection) == -1) {
+                return -1;
+            }
+            if (backed_up(connection)) {
+                continue;
+            }
+
+            const ssize_t nread = connection.receive();
+            if (nread == 0) {
+                return -1;
+            }
+            if (nread == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return errno == EAGAIN ? 0 : -1;
+            }
+        }
+    }
+
+    void unlink(Connection* connection) noexcept {
+        if (connection->prev != nullptr) {
+            connection->prev->next = connection->next;
+        } else {
+            accepted = connection->next;
+        }
+        if (connection->next != nullptr) {
+            connection->next->prev = connection->prev;
+        }
+    }
+
+    // queues connection for the Uring loop to look at once the current batch is done
+    void mark_dirty(Connection& connection) noexcept {
+        if (!connection.dirty) {
+            connection.dirty = true;
+            connection.next_dirty = dirty;
+            dirty = &connection;
+        }
+    }
+
+    // turns connection Passive again, its slot may go to the next subscriber
+    void release_watcher_slot(Connection& connection) noexcept {
+        if (connection.watcher_slot == -1) {
+            return;
+        }
+        forget_watcher(static_cast<uint32_t>(connection.watcher_slot));
+        watchers[connection.watcher_slot] = nullptr;
+        connection.watcher_slot = -1;
+        connection.status = Comm_Status::Passive;
+    }
+
+    void close_connection(Connection* connection) noexcept {
+        if (connection == &host) {
+            reactor.stop();
+            running = false;
+            return;
+        }
+        release_watcher_slot(*connection);
+        unlink(connection);
+        ::close(connection->fd);    // never duplicated, closing also unwatches it
+        if (connection->pending_replies != 0) {
+            // workers still hold requests of it, deliver_replies frees it once the last reply came back
+            connection->fd = -1;
+            connection->closed = true;
+            return;
+        }
+        connection->~Connection();
+        ::operator delete(connection, nothrow);    // pairs with the new (nothrow) of adopt
+    }
+
+    // drops a connection from outside its own event, under epoll it may still have one waiting in the current
+    // batch; shutting it down makes the reactor report it, and it is closed from there
+    void condemn(Connection& connection) noexcept {
+        if (&connection == &host) {
+            close_connection(&connection);
+            return;
+        }
+        connection.closed = true;
+        ::shutdown(connection.fd, SHUT_RDWR);
+    }
+
+    int compare_changes(const void* lhs, const void* rhs) noexcept {
+        const auto* a = static_cast<const State_Change_Record*>(lhs);
+        const auto* b = static_cast<const State_Change_Record*>(rhs);
+        if (a->id != b->id) {
+            return a->id < b->id ? -1 : 1;
+        }
+        return a->sequence < b->sequence ? -1 : (a->sequence > b->sequence ? 1 : 0);
+    }
+
+    // writes one STATE_CHANGED frame carrying the count changes assembled in notification_buffer
+    void push_changes(Connection& connection, uint32_t count) noexcept {
+        const auto length = static_cast<uint32_t>(count * sizeof(Gao::protocol::State_Change));
+        const Gao::protocol::Frame_Header header = Gao::protocol::make_header(
+            Gao::protocol::Opcode::STATE_CHANGED, 0, length);
+        connection.send(&header, sizeof(header), notification_buffer, length);
+    }
+
+    // pushes the state changes recorded since the last call to the Active connections watching them;
+    // a Gaolette that changed several times since is reported once, with its latest state
+    void publish_state_changes() noexcept {
+        State_Change_Record* changes = nullptr;
+        const uint32_t count = take_state_changes(changes);
+        if (count == 0) {
+            return;
+        }
+        if (count > 1) {
+            ::qsort(changes, count, sizeof(State_Change_Record), compare_changes);
+        }
+
+        // every change but the last one of each Gaolette is dropped, watchers accumulate over all of them;
+        // SHUT_DOWN is never folded into what follows, that is a new Gaolette reusing the id
+        uint32_t kept = 0;
+        uint64_t watched = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            if (kept != 0 && changes[kept - 1].id == changes[i].id
+                && changes[kept - 1].state != Gao::protocol::State_Code::SHUT_DOWN) {
+                changes[i].watchers |= changes[kept - 1].watchers;
+                --kept;
+            }
+            changes[kept++] = changes[i];
+            watched |= changes[i].watchers;
+        }
+
+        constexpr uint32_t per_frame = Gao::protocol::MAX_PAYLOAD / sizeof(Gao::protocol::State_Change);
+        const size_t need = (kept < per_frame ? kept : per_frame) * sizeof(Gao::protocol::State_Change);
+        if (reserve(notification_buffer, notification_capacity, need) == -1) {
+            return;
+        }
+        auto* out = reinterpret_cast<Gao::protocol::State_Change*>(notification_buffer);
+
+        for (uint32_t slot = 0; slot < MAX_WATCHERS; ++slot) {
+            const uint64_t bit = uint64_t{1} << slot;
+            if ((watched & bit) == 0 || watchers[slot] == nullptr) {
+                continue;
+            }
+            Connection& connection = *watchers[slot];
+            uint32_t batched = 0;
+            for (uint32_t i = 0; i < kept && !connection.closed; ++i) {
+                if ((changes[i].watchers & bit) == 0) {
+                    continue;
+                }
+                out[batched++] = Gao::protocol::State_Change{changes[i].id, static_cast<uint8_t>(changes[i].state), {}};
+                if (batched == per_frame) {
+                    push_changes(connection, batched);
+                    batched = 0;
+                }
+            }
+            if (batched != 0) {
+                push_changes(connection, batched);
+            }
+            if (use_uring) {
+                mark_dirty(connection);
+            } else if (connection.closed) {
+                condemn(connection);
+            }
+        }
+    }
+
+    void on_connection_ready(Event_Source* source, uint32_t) noexcept {
+        auto* connection = static_cast<Connection*>(source);
+        if (connection->ring) {
+            eventfd_t count;
+            ::eventfd_read(connection->fd, &count);
+        }
+        if (service(*connection) == -1) {
+            close_connection(connection);
+        }
+        publish_state_changes();
+    }
+
+    void on_host_space(Event_Source* source, uint32_t) noexcept {
+        eventfd_t count;
+        ::eventfd_read(source->fd, &count);
+        on_connection_ready(&host, 0);
+    }
+
+    void on_host_hangup(Event_Source*, uint32_t) noexcept {
+        reactor.stop();
+        running = false;
+    }
+
+    int say_hello(Connection& connection, Gao::protocol::Transport transport) noexcept {
+        const Gao::protocol::Hello_Payload hello{static_cast<uint8_t>(transport), {}};
+        const Gao::protocol::Frame_Header header = Gao::protocol::make_header(
+            Gao::protocol::Opcode::HELLO, 0, sizeof(hello));
+        return connection.send(&header, sizeof(header), &hello, sizeof(hello));
+    }
+
+    // takes over a freshly accepted socket, nullptr if it is refused or can't be served
+    Connection* adopt(int fd) noexcept {
+        // abstract sockets are reachable from the whole network namespace, only serve our own user
+        ucred peer{};
+        socklen_t peer_length = sizeof(peer);
+        if (::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &peer_length) == -1 || peer.uid != ::geteuid()) {
+            ::close(fd);
+            return nullptr;
+        }
+
+        auto* connection = new (nothrow) Connection();
+        if (connection == nullptr) {
+            ::close(fd);
+            return nullptr;
+        }
+        connection->fd = fd;
+        connection->out_fd = fd;
+        connection->ready = &on_connection_ready;
+        connection->queue_sends = use_uring;
+        connection->next = accepted;
+        if (accepted != nullptr) {
+            accepted->prev = connection;
+        }
+        accepted = connection;
+        return connection;
+    }
+
+    void on_listener_ready(Event_Source*, uint32_t) noexcept {
+        while (true) {
+            // out of descriptors leaves the connection in the backlog, it is picked up with the next one
+            const int fd = ::accept4(listener.fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd == -1) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                return;
+            }
+
+            Connection* connection = adopt(fd);
+            if (connection != nullptr && (say_hello(*connection, Gao::protocol::Transport::SOCKET) == -1
+                                          || reactor.watch(connection, EPOLLIN | EPOLLOUT | EPOLLRDHUP) == -1)) {
+                close_connection(connection);
+            }
+        }
+    }
+
+    // the io_uring backend, every operation queued here goes out with the next Uring::submit
+
+    uint64_t tag(Event_Source* source, Operation operation) noexcept {
+        return reinterpret_cast<uint64_t>(source) | operation;
+    }
+
+    void arm_receive(Connection& connection) noexcept {
+        io_uring_sqe* sqe = uring.next_sqe();
+        if (sqe == nullptr) {
+            connection.closed = true;
+            return;
+        }
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = connection.fd;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = URING_BUFFER_GROUP;
+        sqe->user_data = tag(&connection, RECEIVE);
+        connection.receiving = true;
+        ++connection.in_flight;
+    }
+
+    void cancel_receive(Connection& connection) noexcept {
+        io_uring_sqe* sqe = uring.next_sqe();
+        if (sqe == nullptr) {
+            return;     // tried again with the next completion
+        }
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = tag(&connection, RECEIVE);
+        sqe->user_data = tag(&connection, CANCEL);
+        connection.cancelling = true;
+        ++connection.in_flight;
+    }
+
+    void arm_send(Connection& connection) noexcept {
+        // what is left of the last send goes out before anything queued since
+        if (connection.flight_begin == connection.flight_end) {
+            char* buffer = connection.flight_buffer;
+            const size_t capacity = connection.flight_capacity;
+            connection.flight_buffer = connection.send_buffer;
+            connection.flight_capacity = connection.send_capacity;
+            connection.flight_begin = connection.send_begin;
+            connection.flight_end = connection.send_end;
+            connection.send_buffer = buffer;
+            connection.send_capacity = capacity;
+            connection.send_begin = connection.send_end = 0;
+        }
+
+        io_uring_sqe* sqe = uring.next_sqe();
+        if (sqe == nullptr) {
+            connection.closed = true;
+            return;
+        }
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = connection.out_fd;
+        sqe->addr = reinterpret_cast<uint64_t>(connection.flight_buffer + connection.flight_begin);
+        sqe->len = static_cast<uint32_t>(connection.flight_end - connection.flight_begin);
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = tag(&connection, SEND);
+        connection.sending = true;
+        ++connection.in_flight;
+    }
+
+    void arm_accept() noexcept {
+        io_uring_sqe* sqe = uring.next_sqe();
+        if (sqe == nullptr) {
+            accept_stalled = true;
+            return;
+        }
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = listener.fd;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        sqe->user_data = tag(&listener, ACCEPT);
+        accept_stalled = false;
+    }
+
+    void arm_poll(Event_Source& source, Operation operation, uint32_t events, bool multishot) noexcept {
+        io_uring_sqe* sqe = uring.next_sqe();
+        if (sqe == nullptr) {
+            running = false;
+            return;
+        }
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = source.fd;
+        sqe->poll32_events = events;
+        sqe->len = multishot ? IORING_POLL_ADD_MULTI : 0;
+        sqe->user_data = tag(&source, operation);
+    }
+
+    // serves what arrived for connection and decides whether it keeps receiving
+    void progress(Connection& connection) noexcept {
+        if (!connection.closed && serve_buffered(connection) == -1) {
+            connection.closed = true;
+        }
+        if (!connection.closed) {
+            if (backed_up(connection)) {
+                if (connection.receiving && !connection.cancelling) {
+                    cancel_receive(connection);
+                }
+            } else if (!connection.receiving) {
+                arm_receive(connection);
+            }
+        }
+        mark_dirty(connection);
+    }
+
+    // sends the replies of finished jobs and resumes the connections that were waiting on them
+    void deliver_replies() noexcept {
+        Dispatch_Job* job = take_replies();
+        while (job != nullptr) {
+            Dispatch_Job* next = job->link;
+            auto& connection = *static_cast<Connection*>(job->connection);
+            const bool resume = connection.pending_replies-- == MAX_PENDING_REPLIES && running;
+
+            if (connection.fd == -1) {
+                // dropped while the request ran
+                if (connection.pending_replies == 0) {
+                    connection.~Connection();
+                    ::operator delete(&connection, nothrow);
+                }
+            } else {
+                connection.send(&job->reply, sizeof(job->reply), job->reply_payload, job->reply.length);
+                if (use_uring && !connection.ring) {
+                    if (resume) {
+                        progress(connection);
+                    } else {
+                        mark_dirty(connection);
+                    }
+                } else if (connection.closed || (resume && service(connection) == -1)) {
+                    condemn(connection);
+                }
+            }
+            release_job(job);
+            job = next;
+        }
+    }
+
+    void on_replies_ready(Event_Source*, uint32_t) noexcept {
+        deliver_replies();
+        publish_state_changes();
+    }
+
+    void complete(Event_Source* source, Operation operation, int32_t result, uint32_t flags) noexcept {
+        const bool more = (flags & IORING_CQE_F_MORE) != 0;
+
+        switch (operation) {
+            case RECEIVE: {
+                auto& connection = *static_cast<Connection*>(source);
+                if (!more) {
+                    connection.receiving = false;
+                    --connection.in_flight;
+                }
+                if (result > 0) {
+                    const auto id = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+                    if (!connection.closed && connection.append(uring.buffer(id), result) == -1) {
+                        connection.closed = true;
+                    }
+                    uring.recycle(id);
+                } else if (result != -ENOBUFS && result != -ECANCELED) {
+                    connection.closed = true;   // EOF or error
+                }
+                progress(connection);
+                break;
+            }
+            case SEND: {
+                auto& connection = *static_cast<Connection*>(source);
+                connection.sending = false;
+                --connection.in_flight;
+                if (result < 0) {
+                    connection.closed = true;
+                } else {
+                    connection.flight_begin += result;
+                    if (connection.flight_begin == connection.flight_end) {
+                        connection.flight_begin = connection.flight_end = 0;
+                    }
+                }
+                progress(connection);
+                break;
+            }
+            case CANCEL: {
+                auto& connection = *static_cast<Connection*>(source);
+                connection.cancelling = false;
+                --connection.in_flight;
+                progress(connection);
+                break;
+            }
+            case ACCEPT: {
+                if (result >= 0) {
+                    if (Connection* connection = adopt(result)) {
+                        if (say_hello(*connection, Gao::protocol::Transport::SOCKET) == -1) {
+                            connection->closed = true;
+                        }
+                        progress(*connection);
+                    }
+                }
+                if (!more) {
+                    // out of descriptors or memory, accepting resumes once a connection goes away
+                    if (result == -EMFILE || result == -ENFILE || result == -ENOMEM) {
+                        accept_stalled = true;
+                    } else {
+                        arm_accept();
+                    }
+                }
+                break;
+            }
+            case DOORBELL: {
+                on_connection_ready(&host, 0);
+                if (!more && running) {
+                    arm_poll(host, DOORBELL, POLLIN, true);
+                }
+                break;
+            }
+            case SPACE: {
+                on_host_space(&host_space, 0);
+                if (!more && running) {
+                    arm_poll(host_space, SPACE, POLLIN, true);
+                }
+                break;
+            }
+            case HANGUP:
+                running = false;
+                break;
+            case REPLIES: {
+                deliver_replies();
+                if (!more && running) {
+                    arm_poll(reply_source, REPLIES, POLLIN, true);
+                }
+                break;
+            }
+        }
+    }
+
+    // sends what got queued during the batch and frees connections nothing is in flight for anymore
+    void settle() noexcept {
+        publish_state_changes();
+        while (dirty != nullptr) {
+            Connection& connection = *dirty;
+            dirty = connection.next_dirty;
+            connection.dirty = false;
+
+            if (connection.closed) {
+                if (&connection == &host) {
+                    running = false;
+                    continue;
+                }
+                // fails whatever is still in flight, its completions bring us back here
+                if (!connection.shut_down) {
+                    ::shutdown(connection.fd, SHUT_RDWR);
+                    connection.shut_down = true;
+                }
+                if (connection.in_flight == 0 && connection.pending_replies == 0) {
+                    close_connection(&connection);
+                    if (accept_stalled) {
+                        arm_accept();
+                    }
+                }
+                continue;
+            }
+            // the host's rings are written right away, what didn't fit goes out as their space doorbell rings
+            if (!connection.ring && !connection.sending && connection.queued() != 0) {
+                arm_send(connection);
+                if (connection.closed) {
+                    mark_dirty(connection);
+                }
+            }
+        }
+    }
+
+    // sets up the Uring backend, false leaves everything to the Reactor
+    bool start_uring(Gao::protocol::Transport transport) noexcept {
+        // multishot receives need a socket to receive from
+        int type = 0;
+        socklen_t length = sizeof(type);
+        if (transport == Gao::protocol::Transport::SOCKET
+            && (::getsockopt(host.fd, SOL_SOCKET, SO_TYPE, &type, &length) == -1 || type != SOCK_STREAM)) {
+            return false;
+        }
+        if (uring.init(URING_ENTRIES) == -1
+            || uring.provide_buffers(URING_BUFFER_GROUP, URING_BUFFERS, URING_BUFFER_SIZE) == -1) {
+            uring.close();
+            return false;
+        }
+
+        use_uring = true;
+        running = true;
+        if (transport != Gao::protocol::Transport::SOCKET) {
+            arm_poll(host, DOORBELL, POLLIN, true);
+            arm_poll(host_space, SPACE, POLLIN, true);
+            arm_poll(host_hangup, HANGUP, POLLIN | POLLRDHUP, false);
+        } else {
+            host.queue_sends = true;
+            arm_receive(host);
         }
-        len += nread;
+        if (listener.fd != -1) {
+            arm_accept();
+        }
+        if (reply_source.fd != -1) {
+            arm_poll(reply_source, REPLIES, POLLIN, true);
+        }
+        return true;
+    }
+
+    int run_uring(bool (*idle)() noexcept) noexcept {
+        bool idle_pending = idle != nullptr;
+
+        while (running) {
+            settle();
+            if (!running || uring.submit(idle_pending ? 0 : 1) == -1) {
+                break;
+            }
+
+            bool completed = false;
+            while (io_uring_cqe* cqe = uring.peek()) {
+                const uint64_t data = cqe->user_data;
+                const int32_t result = cqe->res;
+                const uint32_t flags = cqe->flags;
+                uring.advance();
+                complete(reinterpret_cast<Event_Source*>(data & ~OPERATION_MASK),
+                         static_cast<Operation>(data & OPERATION_MASK), result, flags);
+                completed = true;
+            }
+            if (completed) {
+                idle_pending = idle != nullptr;
+            } else if (idle_pending) {
+                idle_pending = idle();
+            }
+        }
+
+        // closing the ring cancels everything still in flight, nothing refers to the connections after it
+        uring.close();
+        return 0;
+    }
+
+    // sets up the Reactor backend, a listener that can't be watched is given up on rather than the host
+    int watch_sources(bool rings) noexcept {
+        if (reactor.init() == -1) {
+            return -1;
+        }
+        if (rings) {
+            if (reactor.watch(&host, EPOLLIN) == -1 || reactor.watch(&host_space, EPOLLIN) == -1
+                || reactor.watch(&host_hangup, EPOLLIN | EPOLLRDHUP) == -1) {
+                return -1;
+            }
+        } else if (reactor.watch(&host, EPOLLIN | EPOLLOUT | EPOLLRDHUP) == -1) {
+            return -1;
+        }
+        if (listener.fd != -1 && reactor.watch(&listener, EPOLLIN) == -1) {
+            ::close(listener.fd);
+            listener.fd = -1;
+        }
+        if (reply_source.fd != -1 && reactor.watch(&reply_source, EPOLLIN) == -1) {
+            return -1;
+        }
+        return 0;
+    }
+
+    // serves the host, set up by Comm::run or Comm::run_embedded, and every connected controller until the host
+    // hangs up; only the host connection's buffers outlive it, so it may run again
+    int serve(Gao::protocol::Transport transport, Io_Backend backend) noexcept {
+        const bool rings = transport != Gao::protocol::Transport::SOCKET;
+
+        // with workers around, requests run on them and the loop only moves bytes
+        if (gaolette_scheduler.worker_count() != 0 && start_parallel_dispatch() == 0) {
+            reply_source.fd = reply_fd();
+            reply_source.ready = &on_replies_ready;
+        }
+
+        // the warm pool is topped up while nothing is ready, never in front of a request
+        constexpr auto idle = []() noexcept { return refill_warm_pool(); };
 
-        // stop if newline is seen
-        for (size_t i = 0; i < len; ++i) {
-            if (buf[i] == '\n') {
-                buf[i] = '\0';
-                return Pair<char*, ssize_t>{buf, static_cast<ssize_t>(i)};
+        int result = 0;
+        running = true;
+        if (backend == Io_Backend::IO_URING && start_uring(transport)) {
+            // the rings only ring once we announced we are waiting, whatever came before is read right away
+            if (rings) {
+                on_connection_ready(&host, 0);
             }
+            result = run_uring(idle);
+        } else if (watch_sources(rings) == -1) {
+            result = -1;
+        } else if (service(host) != -1) {   // whatever the host sent before we watched for it
+            result = reactor.run(idle);
         }
 
-        // safety: stop if buffer full (no newline)
-        if (len >= BUF_SIZE - 1) {
-            buf[len] = '\0';
-            return Pair<char*, ssize_t>{buf, static_cast<ssize_t>(len)};
+        // also where a backend that failed to set up ends, so an embedded runtime may run again;
+        // replies of requests still running are sent where they still can be, they also free dropped connections
+        running = false;
+        drain_jobs();
+        deliver_replies();
+        stop_parallel_dispatch();
+
+        while (accepted != nullptr) {
+            close_connection(accepted);
+        }
+        if (listener.fd != -1) {
+            ::close(listener.fd);
+            listener.fd = -1;
         }
+        release_watcher_slot(host);
+        reply_source.fd = -1;
+        descriptors = -1;
+        use_uring = false;
+        reactor.close();
+        release_all_gaolettes();
+        return result;
+    }
+}
+
+Connection::~Connection() {
+    ::free(recv_buffer);
+    ::free(aligned_buffer);
+    ::free(send_buffer);
+    ::free(flight_buffer);
+}
+
+ssize_t Connection::receive() noexcept {
+    // out of room behind recv_begin, move the lookahead to the front
+    if (recv_end == recv_capacity && recv_begin != 0) {
+        memmove(recv_buffer, recv_buffer + recv_begin, recv_end - recv_begin);
+        recv_end -= recv_begin;
+        recv_begin = 0;
+    }
+    if (recv_end == recv_capacity && reserve(recv_buffer, recv_capacity, recv_capacity + 1) == -1) {
+        return -1;
     }
 
-    // no newline before EOF
-    buf[len] = '\0';
-    return Pair<char*, ssize_t>{buf, static_cast<ssize_t>(len)};
+    const ssize_t nread = ring ? channel.read_available(recv_buffer + recv_end, recv_capacity - recv_end)
+                               : ::read(fd, recv_buffer + recv_end, recv_capacity - recv_end);
+    if (nread > 0) {
+        recv_end += nread;
+    }
+    return nread;
 }
 
-int Comm::write_line(const char* line) noexcept {
-    return ::write(1, line, strlen(line));
-}
\ No newline at end of file
+int Connection::append(const char* data, size_t length) noexcept {
+    if (recv_capacity - recv_end < length && recv_begin != 0) {
+        memmove(recv_buffer, recv_buffer + recv_begin, recv_end - recv_begin);
+        recv_end -= recv_begin;
+        recv_begin = 0;
+    }
+    if (reserve(recv_buffer, recv_capacity, recv_end + length) == -1) {
+        return -1;
+    }
+    memcpy(recv_buffer + recv_end, data, length);
+    recv_end += length;
+    return 0;
+}
+int Connection::next_frame(Gao::protocol::Frame_Header& header, const char*& payload) noexcept {
+    const size_t buffered = recv_end - recv_begin;
+    if (buffered < sizeof(header)) {
+        return 0;
+    }
+    memcpy(&header, recv_buffer + recv_begin, sizeof(header));
+    if (header.magic != Gao::protocol::MAGIC || header.length > Gao::protocol::MAX_PAYLOAD) {
+        return -1;
+    }
+
+    const size_t frame = sizeof(header) + header.length;
+    if (buffered < frame) {
+        // make sure receive has room for the whole frame
+        return reserve(recv_buffer, recv_capacity, frame);
+    }
+
+    payload = recv_buffer + recv_begin + sizeof(header);
+
+    // only the batches are used in place, a misaligned one is copied out; everything else is memcpy'd from
+    // wherever it lies, moving the lookahead for it would cost a pass over the buffer per frame
+    const auto opcode = static_cast<Gao::protocol::Opcode>(header.opcode);
+    if ((opcode == Gao::protocol::Opcode::CREATE_BATCH || opcode == Gao::protocol::Opcode::DESTROY_BATCH)
+        && (recv_begin + sizeof(header)) % alignof(uint64_t) != 0) {
+        if (reserve(aligned_buffer, aligned_capacity, header.length) == -1) {
+            return -1;
+        }
+        memcpy(aligned_buffer, payload, header.length);
+        payload = aligned_buffer;
+    }
+
+    recv_begin += frame;
+    if (recv_begin == recv_end) {
+        recv_begin = recv_end = 0;
+    }
+    return 1;
+}
+
+int Connection::send(const void* first, size_t first_length, const void* second, size_t second_length) noexcept {
+    if (closed) {
+        return -1;
+    }
+
+    iovec iov[2] = {
+        {const_cast<void*>(first), first_length},
+        {const_cast<void*>(second), second_length}
+    };
+    const size_t total = first_length + second_length;
+    size_t written = 0;
+
+    // anything already queued goes out first, the new bytes line up behind it;
+    // under io_uring everything is queued and sent in one go once the batch of requests is done
+    if (queue_sends) {
+        mark_dirty(*this);
+    }
+    while (!queue_sends && send_end == send_begin && written < total) {
+        int iov_idx = 0;
+        size_t skip = written;
+        while (iov_idx < 2 && skip >= iov[iov_idx].iov_len) {
+            skip -= iov[iov_idx].iov_len;
+            ++iov_idx;
+        }
+        iovec rest[2] = {iov[0], iov[1]};
+        rest[iov_idx].iov_base = static_cast<char*>(rest[iov_idx].iov_base) + skip;
+        rest[iov_idx].iov_len -= skip;
+
+        const ssize_t n = transmit(rest + iov_idx, 2 - iov_idx);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                break;
+            }
+            closed = true;
+            return -1;
+        }
+        written += n;
+    }
+
+    if (written < total) {
+        const size_t remaining = total - written;
+        if (send_begin != 0) {
+            memmove(send_buffer, send_buffer + send_begin, send_end - send_begin);
+            send_end -= send_begin;
+            send_begin = 0;
+        }
+        if (reserve(send_buffer, send_capacity, send_end + remaining) == -1) {
+            closed = true;
+            return -1;
+        }
+        for (const iovec& part : iov) {
+            const size_t skip = written < part.iov_len ? written : part.iov_len;
+            memcpy(send_buffer + send_end, static_cast<const char*>(part.iov_base) + skip, part.iov_len - skip);
+            send_end += part.iov_len - skip;
+            written -= skip;
+        }
+    }
+    return static_cast<int>(total);
+}
+
+int Connection::flush() noexcept {
+    while (send_begin != send_end) {
+        const iovec queued_bytes{send_buffer + send_begin, send_end - send_begin};
+        const ssize_t n = transmit(&queued_bytes, 1);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                return 0;
+            }
+            closed = true;
+            return -1;
+        }
+        send_begin += n;
+    }
+    send_begin = send_end = 0;
+    return 0;
+}
+
+ssize_t Connection::transmit(const iovec* iov, int count) noexcept {
+    if (!ring) {
+        return ::writev(out_fd, iov, count);
+    }
+    // the ring takes what fits, a short count like the socket's once it is full
+    size_t written = 0;
+    for (int i = 0; i < count; ++i) {
+        if (iov[i].iov_len == 0) {
+            continue;
+        }
+        const ssize_t n = channel.write_available(iov[i].iov_base, iov[i].iov_len);
+        if (n == -1) {
+            return written != 0 ? static_cast<ssize_t>(written) : -1;
+        }
+        written += n;
+        if (static_cast<size_t>(n) < iov[i].iov_len) {
+            break;
+        }
+    }
+    return static_cast<ssize_t>(written);
+}
+
+size_t Connection::queued() const noexcept {
+    return send_end - send_begin + flight_end - flight_begin;
+}
+
+int Comm::write_frame(const Gao::protocol::Frame_Header& header, const void* payload) noexcept {
+    // on a worker, the reply travels back to the I/O thread with its job
+    if (Dispatch_Job* job = running_job()) {
+        return job->keep_reply(header, payload);
+    }
+    if (current == nullptr) {
+        return -1;
+    }
+    return current->send(&header, sizeof(header), payload, header.length);
+}
+
+int Comm::reply(const Gao::protocol::Frame_Header& request, Gao::protocol::Status status,
+                const void* payload, uint32_t length) noexcept {
+    const Gao::protocol::Frame_Header header = Gao::protocol::make_header(
+        static_cast<Gao::protocol::Opcode>(request.opcode), request.request_id, length,
+        Gao::protocol::FLAG_REPLY, status);
+    if (status != Gao::protocol::Status::OK) {
+        runtime_stats.failures.fetch_add(1, std::memory_order_relaxed);
+    }
+    return write_frame(header, payload);
+}
+
+int Comm::subscribe(int32_t id) noexcept {
+    using Gao::protocol::Status;
+
+    if (current == nullptr) {
+        return -static_cast<int>(Status::BAD_REQUEST);
+    }
+    Connection& connection = *current;
+    if (connection.watcher_slot == -1) {
+        for (uint32_t slot = 0; slot < MAX_WATCHERS && connection.watcher_slot == -1; ++slot) {
+            if (watchers[slot] == nullptr) {
+                watchers[slot] = &connection;
+                connection.watcher_slot = static_cast<int>(slot);
+            }
+        }
+        if (connection.watcher_slot == -1) {
+            return -static_cast<int>(Status::NO_RESOURCES);
+        }
+        connection.status = Comm_Status::Active;
+    }
+    if (watch_gaolette(id, static_cast<uint32_t>(connection.watcher_slot)) == -1) {
+        return -static_cast<int>(Status::UNKNOWN_GAOLETTE);
+    }
+    return 0;
+}
+
+int Comm::unsubscribe(int32_t id) noexcept {
+    using Gao::protocol::Status;
+
+    if (current == nullptr) {
+        return -static_cast<int>(Status::BAD_REQUEST);
+    }
+    // a Passive connection has nothing to end, the Gaolette may still be worth an answer
+    if (current->watcher_slot == -1) {
+        return id == Gao::protocol::ALL_GAOLETTES || find_gaolette(id) != nullptr
+                   ? 0 : -static_cast<int>(Status::UNKNOWN_GAOLETTE);
+    }
+    if (unwatch_gaolette(id, static_cast<uint32_t>(current->watcher_slot)) == -1) {
+        return -static_cast<int>(Status::UNKNOWN_GAOLETTE);
+    }
+    return 0;
+}
+
+int Comm::share(uint32_t request_id, int fd) noexcept {
+    using Gao::protocol::Status;
+
+    // only the host has a descriptor socket, the memory of its Gaolettes is not for every controller to map
+    if (current != &host || descriptors == -1) {
+        return -static_cast<int>(Status::PERMISSION_DENIED);
+    }
+
+    Gao::protocol::Descriptor_Message message{request_id};
+    iovec data{&message, sizeof(message)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr header{};
+    header.msg_iov = &data;
+    header.msg_iovlen = 1;
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+    cmsghdr* rights = CMSG_FIRSTHDR(&header);
+    rights->cmsg_level = SOL_SOCKET;
+    rights->cmsg_type = SCM_RIGHTS;
+    rights->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(rights), &fd, sizeof(int));
+
+    // a host that leaves descriptors unclaimed until the socket is full gets no more of them
+    if (::sendmsg(descriptors, &header, MSG_DONTWAIT | MSG_NOSIGNAL) == -1) {
+        return -static_cast<int>(Status::NO_RESOURCES);
+    }
+    return 0;
+}
+
+int Comm::attach_descriptors(int fd) noexcept {
+    int type = 0;
+    socklen_t length = sizeof(type);
+    if (::getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &length) == -1 || type != SOCK_SEQPACKET) {
+        return -1;
+    }
+    descriptors = fd;
+    return 0;
+}
+
+int Comm::attach_shared_memory() noexcept {
+    struct stat info{};
+    if (::fstat(Gao::ring::MEMFD_FILENO, &info) == -1) {
+        return -1;
+    }
+
+    const size_t size = static_cast<size_t>(info.st_size);
+    void* memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, Gao::ring::MEMFD_FILENO, 0);
+    ::close(Gao::ring::MEMFD_FILENO);   // the mapping keeps the memfd alive
+    if (memory == MAP_FAILED) {
+        return -1;
+    }
+
+    Gao::ring::Shared_Block* block = Gao::ring::attach(memory, size);
+    if (block == nullptr) {
+        ::munmap(memory, size);
+        return -1;
+    }
+
+    // the host never writes to the socket once the rings are in use, so it only turns readable on hang up
+    channel = Gao::ring::Channel::gao(block, 0);
+    return 0;
+}
+
+int Comm::listen(const char* name) noexcept {
+    sockaddr_un address{};
+    const size_t length = strlen(name);
+    if (length == 0 || length >= sizeof(address.sun_path) - 1) {
+        return -1;
+    }
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path + 1, name, length);     // leading NUL: abstract namespace, nothing on disk
+
+    listener.fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listener.fd == -1) {
+        return -1;
+    }
+    listener.ready = &on_listener_ready;
+    const auto address_length = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + length);
+    if (::bind(listener.fd, reinterpret_cast<sockaddr*>(&address), address_length) == -1
+        || ::listen(listener.fd, SOMAXCONN) == -1) {
+        ::close(listener.fd);
+        listener.fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+int Comm::run(Gao::protocol::Transport transport, const char* listen_name, Io_Backend backend) noexcept {
+    // a controller hanging up mid reply must not take the runtime with it
+    ::signal(SIGPIPE, SIG_IGN);
+
+    if (transport == Gao::protocol::Transport::SHARED_MEMORY && attach_shared_memory() == -1) {
+        transport = Gao::protocol::Transport::SOCKET;
+    }
+
+    // listening before the HELLO, so the host may hand out the name as soon as its handshake is done;
+    // a name that can't be bound doesn't take the host down with it
+    if (listen_name != nullptr) {
+        Comm::listen(listen_name);
+    }
+
+    // the HELLO always goes over the socket and is written before anything turns non-blocking
+    host.fd = 0;
+    host.out_fd = 1;
+    host.ready = &on_connection_ready;
+    if (say_hello(host, transport) == -1) {
+        return -1;
+    }
+
+    const bool shared_memory = transport == Gao::protocol::Transport::SHARED_MEMORY;
+    if (shared_memory) {
+        host.ring = true;
+        host.fd = channel.data_doorbell();
+        host_space.fd = channel.space_doorbell();
+        host_space.ready = &on_host_space;
+        host_hangup.fd = 0;
+        host_hangup.ready = &on_host_hangup;
+    }
+    if (set_nonblocking(host.fd) == -1 || set_nonblocking(shared_memory ? host_space.fd : host.out_fd) == -1) {
+        return -1;
+    }
+    return serve(transport, backend);
+}
+
+int Comm::run_embedded(Gao::ring::Shared_Block* block, const int (&doorbells)[Gao::ring::DOORBELL_COUNT],
+                       int hangup_fd, const char* listen_name, Io_Backend backend) noexcept {
+    // whatever an earlier run left behind, the host connection is reused
+    host.closed = false;
+    host.pending_replies = 0;
+    host.recv_begin = host.recv_end = 0;
+    host.send_begin = host.send_end = 0;
+    current = nullptr;
+
+    // nothing to announce, the Orchestrator set up the rings itself; hangup_fd turns readable once it is done
+    channel = Gao::ring::Channel::gao(block, doorbells, hangup_fd);
+    host.ring = true;
+    host.fd = channel.data_doorbell();
+    host.out_fd = -1;
+    host.ready = &on_connection_ready;
+    host_space.fd = channel.space_doorbell();
+    host_space.ready = &on_host_space;
+    host_hangup.fd = hangup_fd;
+    host_hangup.ready = &on_host_hangup;
+    // under io_uring the doorbell is drained once before anything rang it
+    if (set_nonblocking(host.fd) == -1 || set_nonblocking(host_space.fd) == -1) {
+        return -1;
+    }
+    // only serve closes the listener, nothing may fail between the two
+    if (listen_name != nullptr) {
+        Comm::listen(listen_name);
+    }
+    return serve(Gao::protocol::Transport::EMBEDDED, backend);
+}
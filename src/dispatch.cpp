@@ -0,0 +1,489 @@
+//
+// Created by David Yang on 2026-10-17.
+//
+
+#include "header/dispatch.hpp"
+#include "header/comm.hpp"
+#include "header/init_gaolette.hpp"
+#include "header/stats.hpp"
+#include "header/util.hpp"
+
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <atomic>
+
+using namespace Gao::protocol;
+
+namespace {
+    int on_create(const Frame_Header& header, const char* payload) noexcept {
+        if (header.length != sizeof(Perf_Spec_Payload)) {
+            return Comm::reply(header, Status::BAD_REQUEST);
+        }
+        Perf_Spec_Payload spec{};
+        memcpy(&spec, payload, sizeof(spec));
+
+        const int id = init_gaolette(spec);
+        if (id < 0) {
+            return Comm::reply(header, static_cast<Status>(-id));
+        }
+        // records never go away, but a peer guessing ids may have destroyed this one already
+        const Gaolette_Record* record = find_gaolette(id);
+        const Created_Payload reply{id, record != nullptr ? record->spec.page_size : spec.page_size, {}};
+        return Comm::reply(header, Status::OK, &reply, sizeof(reply));
+    }
+
+    int on_destroy(const Frame_Header& header, const char* payload) noexcept {
+        if (header.length != sizeof(Id_Payload)) {
+            return Comm::reply(header, Status::BAD_REQUEST);
+        }
+        Id_Payload id{};
+        memcpy(&id, payload, sizeof(id));
+
+        if (release_gaolette(id.id) == -1) {
+            return Comm::reply(header, Status::UNKNOWN_GAOLETTE);
+        }
+        return Comm::reply(header, Status::OK);
+    }
+
+    int on_create_batch(const Frame_Header& header, const char* payload) noexcept {
+        const uint32_t count = header.length / sizeof(Perf_Spec_Payload);
+        if (header.length % sizeof(Perf_Spec_Payload) != 0 || count > MAX_BATCH) {
+            return Comm::reply(header, Status::BAD_REQUEST);
+        }
+
+        // Comm hands out batch payloads 8 byte aligned, so the specs can be used in place
+        static Batch_Result results[MAX_BATCH];
+        init_gaolettes(reinterpret_cast<const Perf_Spec_Payload*>(payload), count, results);
+        return Comm::reply(header, Status::OK, results, count * sizeof(Batch_Result));
+    }
+
+    int on_destroy_batch(const Frame_Header& header, const char* payload) noexcept {
+        const uint32_t count = header.length / sizeof(Id_Payload);
+        if (header.length % sizeof(Id_Payload) != 0 || count > MAX_BATCH) {
+            return Comm::reply(header, Status::BAD_REQUEST);
+        }
+
+        static Batch_Result results[MAX_BATCH];
+        release_gaolettes(reinterpret_cast<const Id_Payload*>(payload), count, results);
+        return Comm::reply(header, Status::OK, results, count * sizeof(Batch_Result));
+    }
+
+    int on_resize(const Frame_Header& header, const char* payload) noexcept {
+        if (header.length != sizeof(Resize_Payload)) {
+            return Comm::reply(header, Status::BAD_REQUEST);
+        }
+        Resize_Payload resize{};
+        memcpy(&resize, payload, sizeof(resize));
+
+        const int result = resize_gaolette(resize.id, resize.size);
+        return Comm::reply(header, static_cast<Status>(-result));
+    }
+
+    int on_clone(const Frame_Header& header, const char* payload) noexcept {
+        if (header.length != sizeof(Id_Payload)) {
+            return Comm::reply(header, Status::BAD_REQUEST);
+        }
+        Id_Payload source{};
+        memcpy(&source, payload, sizeof(source));
+
+        const int id = clone_gaolette(source.id);
+        if (id < 0) {
+            return Comm::reply(header, static_cast<Status>(-id));
+        }
+        const Gaolette_Record* record = find_gaolette(id);
+        const Created_Payload reply{id, record != nullptr ? record->spec.page_size : uint8_t{0}, {}};
+        return Comm::reply(header, Status::OK, &reply, sizeof(reply));
+    }
+
+    int on_share(const Frame_Header& header, const char* payload) noexcept {
+        if (header.length != sizeof(Id_Payload)) {
+            return Comm::reply(header, Status::BAD_REQUEST);
+        }
+        Id_Payload id{};
+        memcpy(&id, payload, sizeof(id));
+
+        const int fd = share_gaolette(id.id);
+        if (fd < 0) {
+            return Comm::reply(header, static_cast<Status>(-fd));
+        }
+        // the memfd goes out first, so it is there by the time the host reads the reply
+        const Gaolette_Record* record = find_gaolette(id.id);
+        const int shared = Comm::share(header.request_id, fd);
+        if (shared < 0) {
+            return Comm::reply(header, static_cast<Status>(-shared));
+        }
+        const Shared_Payload reply{record->committed, record->state != State_Code::LOCKED, {}};
+        return Comm::reply(header, Status::OK, &reply, sizeof(reply));
+    }
+
+    int on_get_state(const Frame_Header& header, const char* payload) noexcept {
+        if (header.length != sizeof(Id_Payload)) {
+            return Comm::reply(header, Status::BAD_REQUEST);
+        }
+        Id_Payload id{};
+        memcpy(&id, payload, sizeof(id));
+
+        const Gaolette_Record* record = find_gaolette(id.id);
+        if (record == nullptr) {
+            return Comm::reply(header, Status::UNKNOWN_GAOLETTE);
+        }
+        const State_Payload reply{static_cast<uint8_t>(record->state), {}};
+        return Comm::reply(header, Status::OK, &reply, sizeof(reply));
+    }
+
+    int on_subscribe(const Frame_Header& header, const char* payload, bool subscribe) noexcept {
+        if (header.length != sizeof(Id_Payload)) {
+            return Comm::reply(header, Status::BAD_REQUEST);
+        }
+        Id_Payload id{};
+        memcpy(&id, payload, sizeof(id));
+
+        const int result = subscribe ? Comm::subscribe(id.id) : Comm::unsubscribe(id.id);
+        return Comm::reply(header, static_cast<Status>(-result));
+    }
+
+    int on_get_stats(const Frame_Header& header) noexcept {
+        if (header.length != 0) {
+            return Comm::reply(header, Status::BAD_REQUEST);
+        }
+        // too big for the stack of a worker, but GET_STATS only ever runs on the I/O thread
+        static Stats_Payload reply;
+        snapshot_stats(reply);
+        return Comm::reply(header, Status::OK, &reply, sizeof(reply));
+    }
+
+    int execute_request(const Frame_Header& header, const char* payload) noexcept {
+        const Status valid = validate(header);
+        if (valid != Status::OK) {
+            return Comm::reply(header, valid);
+        }
+
+        switch (static_cast<Opcode>(header.opcode)) {
+            case Opcode::CREATE:
+                return on_create(header, payload);
+            case Opcode::DESTROY:
+                return on_destroy(header, payload);
+            case Opcode::GET_STATE:
+                return on_get_state(header, payload);
+            case Opcode::CREATE_BATCH:
+                return on_create_batch(header, payload);
+            case Opcode::DESTROY_BATCH:
+                return on_destroy_batch(header, payload);
+            case Opcode::RESIZE:
+                return on_resize(header, payload);
+            case Opcode::SUBSCRIBE:
+                return on_subscribe(header, payload, true);
+            case Opcode::UNSUBSCRIBE:
+                return on_subscribe(header, payload, false);
+            case Opcode::GET_STATS:
+                return on_get_stats(header);
+            case Opcode::CLONE:
+                return on_clone(header, payload);
+            case Opcode::SHARE:
+                return on_share(header, payload);
+            default:
+                return Comm::reply(header, Status::BAD_REQUEST);
+        }
+    }
+
+    // parallel dispatch: commands naming a Gaolette queue on the lane its id hashes to, a lane runs as a single
+    // task at a time so they keep their order; CREATE names no existing Gaolette and runs as a task of its own
+    constexpr uint32_t LANES = 64;
+    constexpr int LANE_BATCH = 32;      // jobs a lane runs before it requeues itself behind other tasks
+
+    struct Lane : Task {
+        util::Spin_Lock lock;
+        Dispatch_Job* head = nullptr;
+        Dispatch_Job* tail = nullptr;
+        bool active = false;    // a task is queued or running for the lane
+    };
+
+    Lane lanes[LANES];
+    bool parallel = false;
+    int replies = -1;
+    std::atomic<Dispatch_Job*> finished{nullptr};
+    std::atomic<uint32_t> outstanding{0};   // handed to workers, not yet finished
+    Dispatch_Job* spare_jobs = nullptr;     // released jobs, I/O thread only
+
+    thread_local Dispatch_Job* running = nullptr;
+
+    void finish(Dispatch_Job* job) noexcept {
+        Dispatch_Job* head = finished.load(std::memory_order_relaxed);
+        do {
+            job->link = head;
+        } while (!finished.compare_exchange_weak(head, job, std::memory_order_release, std::memory_order_relaxed));
+        // the I/O thread is only woken for the first reply it hasn't seen, it takes all of them at once
+        if (head == nullptr) {
+            ::eventfd_write(replies, 1);
+        }
+        if (outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            util::futex_wake(&outstanding, 1);
+        }
+    }
+
+    void execute(Dispatch_Job* job) noexcept {
+        running = job;
+        if (dispatch(job->request, job->request_payload, job->received) == -1) {
+            job->reply = make_header(static_cast<Opcode>(job->request.opcode), job->request.request_id, 0,
+                                     FLAG_REPLY, Status::NO_RESOURCES);
+        }
+        running = nullptr;
+        finish(job);
+    }
+
+    void run_job(Task* task) noexcept {
+        execute(static_cast<Dispatch_Job*>(task));
+    }
+
+    Dispatch_Job* pop(Lane& lane) noexcept {
+        util::Lock_Guard guard(lane.lock);
+        Dispatch_Job* job = lane.head;
+        if (job == nullptr) {
+            lane.active = false;
+            return nullptr;
+        }
+        lane.head = job->link;
+        if (lane.head == nullptr) {
+            lane.tail = nullptr;
+        }
+        return job;
+    }
+
+    void run_lane(Task* task) noexcept {
+        auto& lane = *static_cast<Lane*>(task);
+        do {
+            for (int i = 0; i < LANE_BATCH; ++i) {
+                Dispatch_Job* job = pop(lane);
+                if (job == nullptr) {
+                    return;
+                }
+                execute(job);
+            }
+            // a busy lane yields to other work instead of keeping its worker to itself
+        } while (gaolette_scheduler.submit(&lane) == -1);
+    }
+
+    Dispatch_Job* acquire_job() noexcept {
+        if (spare_jobs != nullptr) {
+            Dispatch_Job* job = spare_jobs;
+            spare_jobs = job->link;
+            return job;
+        }
+        return new (nothrow) Dispatch_Job();
+    }
+
+    // copies the request into a fresh job, nullptr on allocation failure
+    Dispatch_Job* make_job(const Frame_Header& header, const char* payload, void* connection,
+                           const uint64_t received) noexcept {
+        Dispatch_Job* job = acquire_job();
+        if (job == nullptr) {
+            return nullptr;
+        }
+        job->run = &run_job;
+        job->connection = connection;
+        job->link = nullptr;
+        job->request = header;
+        job->received = received;
+        memcpy(job->request_payload, payload, header.length);
+        return job;
+    }
+
+    bool idle(Lane& lane) noexcept {
+        util::Lock_Guard guard(lane.lock);
+        return !lane.active;
+    }
+
+    void enqueue(Lane& lane, Dispatch_Job* job) noexcept {
+        bool start = false;
+        {
+            util::Lock_Guard guard(lane.lock);
+            if (lane.tail != nullptr) {
+                lane.tail->link = job;
+            } else {
+                lane.head = job;
+            }
+            lane.tail = job;
+            start = !lane.active;
+            lane.active = true;
+        }
+        // the injection queue is full, the lane is worked off right here instead
+        if (start && gaolette_scheduler.submit(&lane) == -1) {
+            while (Dispatch_Job* next = pop(lane)) {
+                execute(next);
+            }
+        }
+    }
+
+    // id of the Gaolette a request names, -1 if it names none or is malformed
+    int32_t target_of(const Frame_Header& header, const char* payload) noexcept {
+        switch (static_cast<Opcode>(header.opcode)) {
+            case Opcode::DESTROY:
+            case Opcode::GET_STATE:
+            case Opcode::CLONE: {
+                if (header.length != sizeof(Id_Payload)) {
+                    return -1;
+                }
+                Id_Payload id{};
+                memcpy(&id, payload, sizeof(id));
+                return id.id;
+            }
+            case Opcode::RESIZE: {
+                if (header.length != sizeof(Resize_Payload)) {
+                    return -1;
+                }
+                Resize_Payload resize{};
+                memcpy(&resize, payload, sizeof(resize));
+                return resize.id;
+            }
+            default:
+                return -1;
+        }
+    }
+}
+
+int Dispatch_Job::keep_reply(const Frame_Header& header, const void* payload) noexcept {
+    if (header.length > MAX_JOB_PAYLOAD) {
+        return -1;
+    }
+    reply = header;
+    if (header.length != 0) {
+        memcpy(reply_payload, payload, header.length);
+    }
+    return static_cast<int>(sizeof(header) + header.length);
+}
+
+int start_parallel_dispatch() noexcept {
+    if (parallel || gaolette_scheduler.worker_count() == 0) {
+        return -1;
+    }
+    replies = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (replies == -1) {
+        return -1;
+    }
+    for (Lane& lane : lanes) {
+        lane.run = &run_lane;
+    }
+    parallel = true;
+    return 0;
+}
+
+void stop_parallel_dispatch() noexcept {
+    if (!parallel) {
+        return;
+    }
+    parallel = false;
+    ::close(replies);
+    replies = -1;
+    while (spare_jobs != nullptr) {
+        Dispatch_Job* job = spare_jobs;
+        spare_jobs = job->link;
+        job->~Dispatch_Job();
+        ::operator delete(job, nothrow);    // pairs with the new (nothrow) of acquire_job
+    }
+}
+
+int dispatch_parallel(const Frame_Header& header, const char* payload, void* connection,
+                      const uint64_t received) noexcept {
+    if (!parallel || validate(header) != Status::OK) {
+        return 0;
+    }
+
+    switch (static_cast<Opcode>(header.opcode)) {
+        case Opcode::CREATE: {
+            if (header.length != sizeof(Perf_Spec_Payload)) {
+                return 0;
+            }
+            Dispatch_Job* job = make_job(header, payload, connection, received);
+            if (job == nullptr) {
+                return 0;
+            }
+            outstanding.fetch_add(1, std::memory_order_relaxed);
+            if (gaolette_scheduler.submit(job) == -1) {
+                execute(job);
+            }
+            return 1;
+        }
+        case Opcode::DESTROY:
+        case Opcode::GET_STATE:
+        case Opcode::RESIZE:
+        case Opcode::CLONE: {
+            // CLONE locks its source the first time, the clone itself takes a fresh id like CREATE
+            const int32_t id = target_of(header, payload);
+            if (id < 0) {
+                return 0;
+            }
+            Lane& lane = lanes[static_cast<uint32_t>(id) % LANES];
+            // reading a state is cheaper than handing it off, as long as nothing for the Gaolette is pending
+            if (header.opcode == static_cast<uint16_t>(Opcode::GET_STATE) && idle(lane)) {
+                return 0;
+            }
+            Dispatch_Job* job = make_job(header, payload, connection, received);
+            if (job == nullptr) {
+                return 0;
+            }
+            outstanding.fetch_add(1, std::memory_order_relaxed);
+            enqueue(lane, job);
+            return 1;
+        }
+        case Opcode::DESTROY_BATCH:
+        case Opcode::SHARE:
+            // DESTROY_BATCH touches any number of Gaolettes and SHARE needs the requesting connection, both wait
+            // for every command in flight
+            drain_jobs();
+            return 0;
+        default:
+            // CREATE_BATCH only takes fresh ids and the allocator's locks, SUBSCRIBE needs the requesting
+            // connection, GET_STATS replies with more than a job holds, everything else only replies
+            return 0;
+    }
+}
+
+Dispatch_Job* running_job() noexcept {
+    return running;
+}
+
+int reply_fd() noexcept {
+    return replies;
+}
+
+Dispatch_Job* take_replies() noexcept {
+    if (!parallel) {
+        return nullptr;
+    }
+    eventfd_t count;
+    ::eventfd_read(replies, &count);
+
+    // finished jobs are pushed newest first
+    Dispatch_Job* job = finished.exchange(nullptr, std::memory_order_acquire);
+    Dispatch_Job* ordered = nullptr;
+    while (job != nullptr) {
+        Dispatch_Job* next = job->link;
+        job->link = ordered;
+        ordered = job;
+        job = next;
+    }
+    return ordered;
+}
+
+void release_job(Dispatch_Job* job) noexcept {
+    job->link = spare_jobs;
+    spare_jobs = job;
+}
+
+void drain_jobs() noexcept {
+    uint32_t count;
+    while ((count = outstanding.load(std::memory_order_acquire)) != 0) {
+        util::futex_wait(&outstanding, count);
+    }
+}
+
+int dispatch(const Frame_Header& header, const char* payload, const uint64_t received) noexcept {
+    const uint64_t start = Gao::stats::now();
+    const uint32_t slot = stats_slot(header.opcode);
+    runtime_stats.queue[slot].record(start - received);
+    const int result = execute_request(header, payload);
+    runtime_stats.execute[slot].record_since(start);
+    return result;
+}
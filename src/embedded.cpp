@@ -0,0 +1,54 @@
+//
+// Created by David Yang on 2026-10-17.
+//
+
+// Gao runtime hosted on a thread of the Orchestrator's process, see Gao_Embedded.hpp.
+
+#include <Gao_Embedded.hpp>
+
+#include "header/comm.hpp"
+#include "header/init_gaolette.hpp"
+#include "header/scheduler.hpp"
+
+#include <atomic>
+#include <sched.h>
+#include <signal.h>
+
+namespace {
+    std::atomic<bool> serving = false;  // the runtime's state is process wide, one host at a time
+}
+
+extern "C" int gao_embedded_run(const Gao::embedded::Options* options) noexcept {
+    if (options == nullptr || options->block == nullptr || serving.exchange(true, std::memory_order_acquire)) {
+        return -1;
+    }
+
+    // SIGPIPE belongs to the host process; blocked here, a controller hanging up mid reply only fails the write
+    sigset_t pipe;
+    sigemptyset(&pipe);
+    sigaddset(&pipe, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe, nullptr);
+
+    // a runtime that served an earlier host keeps its reservation and the warm classes it already has
+    reserve_gaolette_space(DEFAULT_GAOLETTE_RESERVATION);
+    for (uint32_t i = 0; i < options->warm_pool_count; ++i) {
+        configure_warm_pool(options->warm_pool[i].size, options->warm_pool[i].count);
+    }
+
+    // the workers only live as long as this run, the next host brings its own count; pinned, they spread over
+    // the CPUs this thread may use, which it inherited from the Orchestrator's
+    if (options->workers != 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        const bool pinned = options->pin_workers && sched_getaffinity(0, sizeof(cpus), &cpus) == 0;
+        gaolette_scheduler.start(options->workers, pinned ? &cpus : nullptr);
+    }
+
+    Comm::attach_descriptors(options->descriptor_fd);
+    const int result = Comm::run_embedded(options->block, options->doorbells, options->hangup_fd,
+                                          options->listen_name,
+                                          options->io_uring ? Io_Backend::IO_URING : Io_Backend::EPOLL);
+    gaolette_scheduler.stop();
+    serving.store(false, std::memory_order_release);
+    return result;
+}
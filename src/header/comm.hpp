@@ -11,9 +11,15 @@
 #include <unistd.h>
 #include <stddef.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <stdlib.h>
 #include <pthread.h>
 
+#include <Gao_Protocol.hpp>
+#include <Gao_Ring.hpp>
+
+#include "reactor.hpp"
+
 struct nothrow_t {
     explicit nothrow_t() = default;
 };
@@ -58,6 +64,86 @@ enum class Comm_Status {
     Passive  // only transmits when necessary
 };
 
+/// One peer speaking the frame protocol: the host on fd 0/1 or its rings, or a controller that connected to the
+/// listening socket. Nothing blocks, requests are buffered until a whole frame is in and replies the socket
+/// (or the host's ring) won't take right away wait in the send buffer until it has room again.
+struct Connection : Event_Source {
+    int out_fd = -1;        // fd for everyone but the host, which is read from fd 0 and written to fd 1
+    bool ring = false;      // traffic goes through the shared memory rings, fd is their data doorbell then
+    bool closed = false;    // set once a write failed, the connection is dropped after the current request
+    uint32_t pending_replies = 0;   // requests running on workers, the connection outlives its socket until 0
+    Comm_Status status = Comm_Status::Passive;  // Active once subscribed, state changes are pushed to it then
+    int watcher_slot = -1;          // its bit in Gaolette_Record::watchers while Active
+
+    // bytes past the current frame are kept as lookahead, the buffer only grows for frames that don't fit
+    char* recv_buffer = nullptr;
+    size_t recv_capacity = 0;
+    size_t recv_begin = 0;
+    size_t recv_end = 0;
+    char* aligned_buffer = nullptr;     // batch payloads that weren't 8 byte aligned in recv_buffer
+    size_t aligned_capacity = 0;
+
+    char* send_buffer = nullptr;
+    size_t send_capacity = 0;
+    size_t send_begin = 0;
+    size_t send_end = 0;
+
+    // replies queued by send go out from the Uring loop instead of being written right away, send_buffer
+    // collects new ones while the kernel still works through flight_buffer
+    bool queue_sends = false;
+    bool sending = false;           // a send of flight_buffer is in flight
+    bool receiving = false;         // a multishot receive is armed
+    bool cancelling = false;        // the receive is being cancelled because too many replies are queued
+    bool shut_down = false;
+    bool dirty = false;             // on the list of connections the Uring loop looks at after each batch
+    uint32_t in_flight = 0;         // operations whose last completion is yet to come, freed only at 0
+    char* flight_buffer = nullptr;
+    size_t flight_capacity = 0;
+    size_t flight_begin = 0;
+    size_t flight_end = 0;
+    Connection* next_dirty = nullptr;
+
+    Connection* prev = nullptr;     // links of the accepted connections
+    Connection* next = nullptr;
+
+    Connection() = default;
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+    ~Connection();
+
+    /// Reads whatever is available into the receive buffer.
+    /// Returns the number of bytes read, 0 on EOF, -1 on error (EAGAIN once drained).
+    ssize_t receive() noexcept;
+
+    /// Appends length received bytes to the receive buffer. Returns -1 on allocation failure.
+    int append(const char* data, size_t length) noexcept;
+
+    /// Takes the next whole frame out of the receive buffer, payload is pointed at its payload and stays valid
+    /// until the next receive. Only the payloads of CREATE_BATCH and DESTROY_BATCH are 8 byte aligned.
+    /// Returns 1 for a frame, 0 if more bytes are needed, -1 on bad magic, an oversized payload
+    /// or allocation failure (the stream can no longer be trusted in any of those cases).
+    int next_frame(Gao::protocol::Frame_Header& header, const char*& payload) noexcept;
+
+    /// Writes both buffers in order, queueing whatever the socket doesn't take right away.
+    /// Returns -1 on error, the connection is marked closed then.
+    int send(const void* first, size_t first_length, const void* second, size_t second_length) noexcept;
+
+    /// Writes queued bytes until the socket stops taking them. Returns -1 on error.
+    int flush() noexcept;
+
+    /// One writev to the socket or the ring, whichever the connection uses; -1 with EAGAIN once it is full.
+    ssize_t transmit(const iovec* iov, int count) noexcept;
+
+    [[nodiscard]] size_t queued() const noexcept;
+};
+
+/// How Comm waits for its descriptors.
+enum class Io_Backend {
+    EPOLL,      // Reactor, readiness based with a read or write syscall per ready descriptor
+    IO_URING    // Uring, multishot receives into provided buffers and one io_uring_enter per loop iteration,
+                // falls back to EPOLL on kernels that lack any of it
+};
+
 class Comm {
     // by default, Gao is passive and only receives incoming packets.
     // transmission by Gao only occurs at program outputs and errors
@@ -68,9 +154,53 @@ public:
     Comm_Status get_status() noexcept;
     void set_status(Comm_Status status) noexcept;
 
-    static Pair<char*, ssize_t> read_line() noexcept;
-
-    static int write_line(const char* line) noexcept;
+    /// Writes header followed by header.length bytes of payload to the connection whose request is being
+    /// dispatched. Returns the number of bytes written or queued, -1 on error.
+    static int write_frame(const Gao::protocol::Frame_Header& header, const void* payload) noexcept;
+
+    /// Replies to request with status and an optional payload.
+    static int reply(const Gao::protocol::Frame_Header& request, Gao::protocol::Status status,
+                     const void* payload = nullptr, uint32_t length = 0) noexcept;
+
+    /// Subscribes the connection whose request is being dispatched to the state changes of the Gaolette id,
+    /// or of every Gaolette for Gao::protocol::ALL_GAOLETTES, turning it Active.
+    /// Returns 0, or the negated Gao::protocol::Status explaining the failure.
+    static int subscribe(int32_t id) noexcept;
+
+    /// Ends a subscription made by subscribe. Returns 0, or the negated Gao::protocol::Status.
+    static int unsubscribe(int32_t id) noexcept;
+
+    /// Hands fd to the connection whose request is being dispatched, ahead of the reply to request_id, as a
+    /// Gao::protocol::Descriptor_Message on the descriptor socket. Only the host has one.
+    /// Returns 0, or the negated Gao::protocol::Status explaining the failure.
+    static int share(uint32_t request_id, int fd) noexcept;
+
+    /// Uses fd, a SOCK_SEQPACKET socket to the host, for share until the host hangs up.
+    /// Returns -1 if fd is no such socket, share is refused then.
+    static int attach_descriptors(int fd) noexcept;
+
+    /// Maps the rings the host installed at spawn time, see Gao_Ring.hpp.
+    /// Returns -1 if they are missing or unusable, the socket is used in that case.
+    static int attach_shared_memory() noexcept;
+
+    /// Binds the abstract Unix socket name further controllers connect to, only processes of the same user
+    /// are accepted. Returns -1 on error.
+    static int listen(const char* name) noexcept;
+
+    /// Main loop of the Gao runtime: announces the transport in use, then serves the host and every connected
+    /// controller from a single epoll reactor until the host hangs up. With gaolette_scheduler running, requests
+    /// are executed on its workers and only their replies come back to the loop, see dispatch_parallel.
+    /// Returns 0 once the host hangs up, -1 if the reactor can't be set up.
+    static int run(Gao::protocol::Transport transport = Gao::protocol::Transport::SOCKET,
+                   const char* listen_name = nullptr, Io_Backend backend = Io_Backend::EPOLL) noexcept;
+
+    /// Main loop of a runtime hosted on a thread of the Orchestrator's process, see Gao_Embedded.hpp: serves the
+    /// rings in block, with doorbells ordered as the *_FILENO constants, until hangup_fd turns readable.
+    /// There is no HELLO, otherwise requests are served as with run. May run again once it returned.
+    /// Returns 0 once the host hangs up, -1 if the reactor can't be set up.
+    static int run_embedded(Gao::ring::Shared_Block* block, const int (&doorbells)[Gao::ring::DOORBELL_COUNT],
+                            int hangup_fd, const char* listen_name = nullptr,
+                            Io_Backend backend = Io_Backend::EPOLL) noexcept;
 };
 
 #endif // COMM_HPP
\ No newline at end of file
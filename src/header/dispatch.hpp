@@ -0,0 +1,69 @@
+//
+// Created by David Yang on 2026-10-17.
+//
+
+#ifndef DISPATCH_HPP
+#define DISPATCH_HPP
+
+// Executes requests received by Comm and sends their replies.
+
+#include <stdint.h>
+
+#include <Gao_Protocol.hpp>
+
+#include "scheduler.hpp"
+
+/// Executes the request described by header and payload and writes its reply to the host.
+/// received is the Gao::stats::now() the request was read at, its wait is recorded in runtime_stats.
+/// Returns -1 if the reply could not be written.
+int dispatch(const Gao::protocol::Frame_Header& header, const char* payload, uint64_t received) noexcept;
+
+/// Largest payload of a request handed to a worker and of the reply it captures, batches are never handed out.
+constexpr uint32_t MAX_JOB_PAYLOAD = 32;
+
+/// A request running on gaolette_scheduler with its own copy of the payload. The reply is captured here
+/// instead of being written, the I/O thread sends it once take_replies hands the job back.
+struct Dispatch_Job : Task {
+    void* connection = nullptr;     // whoever submitted the request, opaque to the dispatcher
+    Dispatch_Job* link = nullptr;   // queue of its lane, then the list of finished jobs
+    Gao::protocol::Frame_Header request{};
+    Gao::protocol::Frame_Header reply{};
+    uint64_t received = 0;          // Gao::stats::now() the request was read at
+    alignas(8) char request_payload[MAX_JOB_PAYLOAD];
+    alignas(8) char reply_payload[MAX_JOB_PAYLOAD];
+
+    /// Stores the reply frame. Returns -1 if its payload doesn't fit.
+    int keep_reply(const Gao::protocol::Frame_Header& header, const void* payload) noexcept;
+};
+
+/// Starts handing requests to gaolette_scheduler, which must be running with at least one worker.
+/// Commands for the same Gaolette run in the order they arrived, everything else runs in parallel.
+/// Returns -1 on error, every request is dispatched inline then.
+int start_parallel_dispatch() noexcept;
+
+/// Frees what start_parallel_dispatch set up, every job must have been taken and released by then.
+void stop_parallel_dispatch() noexcept;
+
+/// Hands the request to a worker unless it is better run right away; connection comes back with the reply.
+/// received is passed on to dispatch.
+/// Returns 1 if the request was queued, 0 if the caller has to dispatch it inline (any job it had to be
+/// ordered after has finished by then).
+int dispatch_parallel(const Gao::protocol::Frame_Header& header, const char* payload, void* connection,
+                      uint64_t received) noexcept;
+
+/// The job whose request the calling worker is running, nullptr on the I/O thread.
+Dispatch_Job* running_job() noexcept;
+
+/// eventfd that turns readable once finished jobs wait for take_replies, -1 unless dispatching in parallel.
+int reply_fd() noexcept;
+
+/// Takes every finished job, oldest first, linked through link. I/O thread only.
+Dispatch_Job* take_replies() noexcept;
+
+/// Recycles a job returned by take_replies. I/O thread only.
+void release_job(Dispatch_Job* job) noexcept;
+
+/// Waits until every job handed to a worker has finished, its reply may still wait for take_replies.
+void drain_jobs() noexcept;
+
+#endif //DISPATCH_HPP
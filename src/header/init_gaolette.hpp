@@ -7,12 +7,140 @@
 
 // initializes Gaolettes
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include <Gao_Protocol.hpp>
+
 // status of new Gaolettes
 enum class Creation_Status {
     SUC_INIT_GAOLETTE,
     FAIL_INIT_GAOLETTE
 };
 
-// void* section_memory()
+/// What a Gaolette's memory is mapped from.
+enum class Backing : uint8_t {
+    ANONYMOUS,  // private anonymous memory, every Gaolette starts out with it
+    IMAGE,      // shared mapping of the record's image_fd, a memfd the host may map too and clones map privately
+    CLONE       // private mapping of another Gaolette's image, written pages are the clone's own
+};
+
+/// Runtime side bookkeeping for a single Gaolette.
+/// Records never move, in_use publishes the other fields to lookups on any thread.
+struct Gaolette_Record {
+    void* base;         // start of the Gaolette's mapping
+    size_t size;        // mapped bytes, page aligned, covers max_memory_usage for DYNAMIC Gaolettes
+    size_t committed;   // accessible bytes from base, page aligned, equal to size unless DYNAMIC
+    Gao::protocol::Perf_Spec_Payload spec;     // page_size, numa_policy and numa_node hold what is actually used
+    Gao::protocol::State_Code state;
+    Backing backing;
+    int image_fd;       // memfd holding the Gaolette's contents once it has been cloned or shared, -1 until then
+    bool exported;      // image_fd has been handed to the host, which may write to it for as long as it holds it
+    std::atomic<bool> in_use;
+    std::atomic<uint64_t> watchers;     // subscriber slots told about its state changes, see watch_gaolette
+};
+
+/// Subscriber slots state changes can be reported to, one bit of Gaolette_Record::watchers each.
+constexpr uint32_t MAX_WATCHERS = 64;
+
+/// A state change recorded for the subscribers in watchers.
+struct State_Change_Record {
+    int32_t id;
+    Gao::protocol::State_Code state;
+    uint32_t sequence;      // order the changes were recorded in
+    uint64_t watchers;      // slots subscribed at the time of the change
+};
+
+/// Address space reserved for Gaolettes at startup unless overridden on the command line.
+constexpr size_t DEFAULT_GAOLETTE_RESERVATION = static_cast<size_t>(1) << 38;  // 256 GiB
+
+/// Reserves the address space Gaolettes are carved from, see util::Allocator.
+/// Returns -1 on error, Gaolettes are then mapped one by one.
+int reserve_gaolette_space(size_t reservation) noexcept;
+
+/// Sections off at least size bytes of fresh read/write memory, size receives the bytes actually handed out.
+/// page_size asks for the pages to back it with and receives the ones actually used, huge pages fall back
+/// to transparent huge pages and those to regular pages.
+/// Returns nullptr on failure.
+void* section_memory(size_t& size, Gao::protocol::Page_Size_Code& page_size) noexcept;
+
+/// Releases memory previously handed out by section_memory.
+/// Returns -1 on error.
+int release_memory(void* base, size_t size) noexcept;
+
+/// Validates spec and sections off memory for a new Gaolette.
+/// The record's spec.page_size tells which pages ended up backing it.
+/// Returns the new Gaolette's id, or the negated Gao::protocol::Status explaining the failure.
+int init_gaolette(const Gao::protocol::Perf_Spec_Payload& spec) noexcept;
+
+/// Creates count (at most Gao::protocol::MAX_BATCH) Gaolettes, mapping memory for the whole batch with a single
+/// mmap where possible.
+/// results[i] receives the id or failure of specs[i].
+void init_gaolettes(const Gao::protocol::Perf_Spec_Payload* specs, uint32_t count,
+                    Gao::protocol::Batch_Result* results) noexcept;
+
+/// Releases the Gaolette's memory and frees its id.
+/// Returns -1 if id does not name a live Gaolette.
+int release_gaolette(int id) noexcept;
+
+/// Releases count Gaolettes, unmapping address-adjacent Gaolettes with a single munmap.
+/// results[i] receives the outcome for ids[i].
+void release_gaolettes(const Gao::protocol::Id_Payload* ids, uint32_t count,
+                       Gao::protocol::Batch_Result* results) noexcept;
+
+/// Grows or shrinks a DYNAMIC Gaolette in place, its base never moves.
+/// Pages past the new size are handed back to the kernel and made inaccessible, pages regrown before the kernel
+/// got around to taking them may still hold their old contents, those of a clone may read as its source's again.
+/// Locked Gaolettes can't be resized.
+/// Returns 0, or the negated Gao::protocol::Status explaining the failure.
+int resize_gaolette(int id, uint64_t size) noexcept;
+
+/// Creates a Gaolette sharing the pages of the Gaolette id copy-on-write, in time independent of its size.
+/// The first clone moves the source's contents into a memfd image, copying the pages it ever touched once, and
+/// locks the source read-only so the image stays what every clone starts from; later clones only map the image.
+/// A source shared with the host gets a copy of its image instead, the host keeps the one it maps.
+/// Sources backed by explicit huge pages can't be cloned.
+/// Returns the clone's id, or the negated Gao::protocol::Status explaining the failure.
+int clone_gaolette(int id) noexcept;
+
+/// Moves the Gaolette id into a memfd image unless it already is, so the host can map its memory, and marks the
+/// image as handed out. The first share copies the pages it ever touched once; the Gaolette's memory is the
+/// image's from then on, shrinking punches the pages out of it. The image of a locked Gaolette is sealed against
+/// writes. Sources backed by explicit huge pages can't be shared.
+/// Returns the image's memfd, still owned by the record, or the negated Gao::protocol::Status explaining the failure.
+int share_gaolette(int id) noexcept;
+
+/// Keeps count prefaulted regions ready for STATIC Gaolettes of size bytes with regular pages, so creating one
+/// takes no page faults and destroying one scrubs its memory back into the pool.
+/// Must be called after reserve_gaolette_space, returns -1 if the class exists or no more classes fit.
+int configure_warm_pool(size_t size, uint32_t count) noexcept;
+
+/// Maps and prefaults one region missing from the warm pool.
+/// Returns false once the pool is full or out of memory, true if there may be more to do.
+bool refill_warm_pool() noexcept;
+
+/// Returns the record of a live Gaolette, nullptr if id does not name one.
+/// Takes no lock, safe from any thread; the fields may only be relied on by whoever runs the Gaolette's commands.
+Gaolette_Record* find_gaolette(int id) noexcept;
+
+/// Subscribes slot to the state changes of the Gaolette id, or of every Gaolette, including the ones created later,
+/// for Gao::protocol::ALL_GAOLETTES. A subscription to a single Gaolette ends once it is released.
+/// Returns -1 if id does not name a live Gaolette.
+int watch_gaolette(int id, uint32_t slot) noexcept;
+
+/// Ends a subscription made by watch_gaolette. Returns -1 if id does not name a live Gaolette.
+int unwatch_gaolette(int id, uint32_t slot) noexcept;
+
+/// Ends every subscription of slot, so it can be handed to another subscriber.
+void forget_watcher(uint32_t slot) noexcept;
+
+/// Takes the state changes recorded since the last call, nothing is recorded while nobody watches.
+/// changes points at them until the next call. Returns their number.
+uint32_t take_state_changes(State_Change_Record*& changes) noexcept;
+
+/// Releases every live Gaolette, used on shutdown.
+void release_all_gaolettes() noexcept;
 
 #endif //INIT_GAOLETTE_HPP
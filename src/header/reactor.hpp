@@ -0,0 +1,71 @@
+//
+// Created by David Yang on 2026-10-17.
+//
+
+#ifndef REACTOR_HPP
+#define REACTOR_HPP
+
+// edge-triggered epoll loop driving every descriptor of the Gao runtime from a single thread
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+
+/// Something the Reactor watches. ready is called with the epoll events seen on fd since the last call.
+/// Watching is edge-triggered, so ready has to consume everything fd has to offer (until EAGAIN) or it won't
+/// be called again for what is left; fd must therefore be non-blocking.
+struct Event_Source {
+    int fd = -1;
+    void (*ready)(Event_Source* source, uint32_t events) noexcept = nullptr;
+};
+
+/// A timerfd backed Event_Source, ready is called once per expiry batch.
+struct Timer : Event_Source {
+    /// Opens the timerfd. Returns -1 on error.
+    int open() noexcept;
+
+    /// Expires first after delay_ns and then every interval_ns, 0 for a one-shot timer.
+    /// Arming with a delay of 0 disarms it. Returns -1 on error.
+    int arm(uint64_t delay_ns, uint64_t interval_ns = 0) noexcept;
+
+    /// Number of expiries since the last call, to be called from ready so the next expiry triggers again.
+    uint64_t expirations() noexcept;
+
+    void close() noexcept;
+};
+
+class Reactor {
+    static constexpr int MAX_EVENTS = 256;
+
+    int epoll_fd_ = -1;
+    bool stopping_ = false;
+
+public:
+    Reactor() = default;
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+    ~Reactor();
+
+    /// Returns -1 on error or if already initialized.
+    int init() noexcept;
+
+    /// Starts watching source->fd for events (EPOLLIN, EPOLLOUT, ...), always edge-triggered.
+    /// source must stay alive until unwatched. Returns -1 on error.
+    int watch(Event_Source* source, uint32_t events) noexcept;
+
+    /// Stops watching source->fd, must come before closing a descriptor that has been duplicated.
+    int unwatch(Event_Source* source) noexcept;
+
+    /// Dispatches events until stop is called or epoll fails, returns -1 in the latter case.
+    /// idle runs whenever no descriptor is ready and returns whether it has more to do,
+    /// the loop only sleeps once it returned false.
+    int run(bool (*idle)() noexcept = nullptr) noexcept;
+
+    /// Makes run return after the events currently being dispatched.
+    void stop() noexcept;
+
+    /// Stops watching everything, init may be called again afterwards.
+    void close() noexcept;
+};
+
+#endif //REACTOR_HPP
@@ -0,0 +1,177 @@
+//
+// Created by David Yang on 2026-10-17.
+//
+
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+// work-stealing scheduler running Gaolette work on the runtime's worker threads
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "thread.hpp"
+#include "util.hpp"
+
+struct Task_Group;
+
+/// A unit of work, owned by whoever submitted it until run returns.
+struct Task {
+    void (*run)(Task* task) noexcept;
+    Task_Group* group = nullptr;    // caps how many of the group's tasks run at once, nullptr for no cap
+    Task* next = nullptr;           // link while parked on its group
+    bool holds_slot = false;        // admitted into one of its group's limit slots, retire gives it back
+};
+
+/// Tasks of one Gaolette, at most limit of them run at the same time.
+/// Tasks beyond the limit are parked here and handed to the worker finishing one of the group's tasks,
+/// so a capped group never makes other workers spin. The next Gaolette with the same id reuses the group
+/// while tasks of the last one may still be queued, limit and node may change under them.
+struct Task_Group {
+    std::atomic<uint32_t> limit{0};     // 0 for no cap
+    std::atomic<int> node{-1};          // NUMA node whose workers run the tasks, -1 for any, see Scheduler::submit
+    uint32_t running = 0;
+    Task* parked_head = nullptr;
+    Task* parked_tail = nullptr;
+    util::Spin_Lock lock;
+
+    /// Claims a slot for task, parks it and returns false if the group is at its limit.
+    /// Sets task->holds_slot, only tasks holding a slot are retired.
+    bool admit(Task* task) noexcept;
+
+    /// Gives back the slot of a finished task, returns a parked task that inherits it or nullptr.
+    Task* retire() noexcept;
+};
+
+/// Chase-Lev work-stealing deque, the owner pushes and pops at the bottom, thieves steal from the top.
+class Work_Deque {
+    struct Array {
+        int64_t capacity;
+        Array* retired;     // arrays outgrown before this one, freed with the deque
+        std::atomic<Task*> slots[1];
+    };
+
+    alignas(64) std::atomic<int64_t> top_{0};
+    alignas(64) std::atomic<int64_t> bottom_{0};
+    std::atomic<Array*> array_{nullptr};
+
+    static Array* allocate(int64_t capacity) noexcept;
+    Array* grow(Array* array, int64_t bottom, int64_t top) noexcept;
+
+public:
+    static constexpr int64_t INITIAL_CAPACITY = 256;
+
+    Work_Deque() = default;
+    Work_Deque(const Work_Deque&) = delete;
+    Work_Deque& operator=(const Work_Deque&) = delete;
+    ~Work_Deque();
+
+    /// Returns -1 on allocation failure.
+    int init() noexcept;
+
+    /// Owner only. Returns -1 if the deque is full and can't grow.
+    int push(Task* task) noexcept;
+
+    /// Owner only, newest task first. Returns nullptr if empty.
+    Task* pop() noexcept;
+
+    /// Any thread, oldest task first. Returns nullptr if empty or another thief won the race.
+    Task* steal() noexcept;
+};
+
+/// Bounded lock-free multi-producer/multi-consumer queue taking tasks submitted from outside the workers.
+class Injection_Queue {
+    struct Cell {
+        std::atomic<uint64_t> sequence;
+        Task* task;
+    };
+
+    Cell* cells_ = nullptr;
+    uint64_t mask_ = 0;
+    alignas(64) std::atomic<uint64_t> enqueue_{0};
+    alignas(64) std::atomic<uint64_t> dequeue_{0};
+
+public:
+    Injection_Queue() = default;
+    Injection_Queue(const Injection_Queue&) = delete;
+    Injection_Queue& operator=(const Injection_Queue&) = delete;
+    ~Injection_Queue();
+
+    /// capacity must be a power of two, initializing again with the same capacity is a no-op.
+    /// Returns -1 on error.
+    int init(uint64_t capacity) noexcept;
+
+    /// Returns -1 if the queue is full.
+    int push(Task* task) noexcept;
+
+    /// Returns nullptr if the queue is empty.
+    Task* pop() noexcept;
+};
+
+/// Work-stealing scheduler: every worker owns a Work_Deque, tasks submitted by a worker go to its own deque,
+/// everything else goes through the Injection_Queue. Idle workers steal from each other before sleeping.
+class Scheduler {
+    struct Worker {
+        Work_Deque deque;
+        Thread thread;
+        uint64_t victim_seed = 0;
+        int cpu = -1;       // the CPU it is pinned to
+        int node = -1;      // NUMA node of cpu
+    };
+
+    Worker* workers_ = nullptr;
+    uint32_t worker_count_ = 0;
+    Injection_Queue injection_;
+
+    // with workers pinned over several NUMA nodes, tasks of a group living on a node wait in that node's queue
+    // for its workers; nullptr for nodes without workers
+    Injection_Queue* node_queues_[util::MAX_NUMA_NODES] = {};
+    uint64_t worker_nodes_ = 0;
+    std::atomic<uint32_t> next_node_{0};
+
+    // sleeping workers wait on epoch_ changing, submitters only bump and wake it when someone sleeps
+    alignas(64) std::atomic<uint32_t> epoch_{0};
+    std::atomic<uint32_t> sleepers_{0};
+    std::atomic<bool> stopping_{false};
+
+    void work(uint32_t index) noexcept;
+    Task* find_task(uint32_t index) noexcept;
+    void execute(Task* task) noexcept;
+    void wake() noexcept;
+
+public:
+    static constexpr uint64_t INJECTION_CAPACITY = 1 << 16;
+
+    Scheduler() = default;
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+    ~Scheduler();
+
+    /// Starts workers threads. With cpus, worker i is pinned to the i-th CPU of the set, wrapping around,
+    /// so workers keep their caches instead of migrating. Returns -1 on error or if already started.
+    int start(uint32_t workers, const cpu_set_t* cpus = nullptr) noexcept;
+
+    /// Stops and joins the workers once their current tasks return, tasks not yet started are dropped.
+    void stop() noexcept;
+
+    /// Queues task, which must stay alive until it ran. A task whose group has a node is left to the workers
+    /// on that node, others only take it once they have nothing else to do.
+    /// Returns -1 if the scheduler isn't running or the task can't be queued.
+    int submit(Task* task) noexcept;
+
+    [[nodiscard]] uint32_t worker_count() const noexcept;
+
+    /// NUMA nodes workers are pinned on, bit n for node n; 0 unless they span several nodes.
+    [[nodiscard]] uint64_t worker_nodes() const noexcept;
+
+    /// One of worker_nodes, taking turns so groups spread evenly over them. Returns -1 if there are none.
+    int next_worker_node() noexcept;
+};
+
+/// Runs the work of every Gaolette, started when the runtime is given --workers=<n> or, hosted on a thread,
+/// Options::workers; see Runtime_Options.
+extern Scheduler gaolette_scheduler;
+
+#endif //SCHEDULER_HPP
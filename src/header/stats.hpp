@@ -0,0 +1,38 @@
+//
+// Created by David Yang on 2026-10-17.
+//
+
+#ifndef STATS_HPP
+#define STATS_HPP
+
+// latency histograms and counters of the runtime, reported by GET_STATS
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include <Gao_Protocol.hpp>
+#include <Gao_Stats.hpp>
+
+/// Everything the runtime measures, recorded from the I/O thread and the workers alike.
+struct Runtime_Stats {
+    Gao::stats::Histogram queue[Gao::protocol::STATS_OPCODES];      // read until execution starts, per opcode
+    Gao::stats::Histogram execute[Gao::protocol::STATS_OPCODES];    // execution including the reply, per opcode
+    Gao::stats::Histogram map;         // section_memory
+    Gao::stats::Histogram unmap;       // release_memory
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> failures{0};
+    std::atomic<uint64_t> offloaded{0};     // requests handed to a worker by dispatch_parallel
+};
+
+extern Runtime_Stats runtime_stats;
+
+/// Histogram index of opcode, opcodes without room of their own share the last slot.
+inline uint32_t stats_slot(uint16_t opcode) noexcept {
+    return opcode < Gao::protocol::STATS_OPCODES ? opcode : Gao::protocol::STATS_OPCODES - 1;
+}
+
+/// Summarizes runtime_stats into the reply to GET_STATS.
+void snapshot_stats(Gao::protocol::Stats_Payload& payload) noexcept;
+
+#endif //STATS_HPP
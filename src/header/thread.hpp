@@ -6,23 +6,94 @@
 #define THREAD_HPP
 
 #include <pthread.h>
+#include <sched.h>
+
+#include <atomic>
+#include <concepts>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 /// Gao's own thread library for threading
+///
+/// Nothing in here allocates or throws, a Thread that could not be started is simply not joinable.
+
+/// How a Thread is set up at creation, the defaults inherit everything from the creating thread.
+struct Thread_Options {
+    const cpu_set_t* affinity = nullptr;    // CPUs the thread may run on, nullptr to inherit
+    int policy = -1;                        // SCHED_OTHER, SCHED_FIFO, ... -1 to inherit
+    int priority = 0;                       // sched_priority under policy, ignored when inheriting
+    bool detach_on_destroy = false;         // whether the destructor detaches a joinable thread instead of joining
+};
 
 class Thread {
-    pthread_t thread_;
-    bool joined_or_detached_;
-    // NOTE function signature might be off, more signatures exists as well, make a separate function type to handle all forms of functions
-    template <typename Ret, typename... Args>
-    Ret (*func_pointer_)(Args...) = nullptr;
+    pthread_t thread_{};
+    bool joinable_ = false;
+    bool detach_on_destroy_ = false;
+
+    // handed to the new thread, which moves the callable onto its own stack and then releases the creator,
+    // so the callable never needs storage beyond the creator's stack frame, whatever its size
+    struct Start {
+        void (*run)(Start* start) noexcept;
+        void* callable;
+        std::atomic<uint32_t> taken{0};
+    };
+
+    template <typename Callable>
+    static void run(Start* start) noexcept {
+        Callable callable(std::move(*static_cast<Callable*>(start->callable)));
+        release(start);     // start and the creator's callable are gone from here on
+        std::apply([](auto& function, auto&... args) { function(args...); }, callable);
+    }
+
+    static void release(Start* start) noexcept;
+    static void* trampoline(void* start) noexcept;
+    void launch(Start& start, const Thread_Options& options) noexcept;
+
+    template <typename Function>
+    static constexpr bool is_callable = !std::same_as<std::decay_t<Function>, Thread>
+                                        && !std::same_as<std::decay_t<Function>, Thread_Options>;
+
 public:
-    void join();
-    void detach();
-    void joinable() const;
+    /// A Thread that runs nothing and is not joinable.
+    Thread() = default;
 
-    template <typename Ret, typename... Args>
-    Thread(Ret (*func_pointer)(Args...), Args... args);
+    /// Runs function(args...) on a new thread, arguments are copied/moved into it.
+    /// The Thread is not joinable if it could not be started.
+    template <typename Function, typename... Args> requires is_callable<Function>
+    explicit Thread(Function&& function, Args&&... args) noexcept
+        : Thread(Thread_Options{}, std::forward<Function>(function), std::forward<Args>(args)...) {}
+
+    /// As above, set up according to options; the Thread is not joinable if any of them can't be applied.
+    template <typename Function, typename... Args>
+    Thread(const Thread_Options& options, Function&& function, Args&&... args) noexcept;
+
+    Thread(Thread&& other) noexcept;
+    Thread& operator=(Thread&& other) noexcept;
+    Thread(const Thread&) = delete;
+    Thread& operator=(const Thread&) = delete;
+
+    /// Returns -1 on error or if the thread is not joinable.
+    int join() noexcept;
+    int detach() noexcept;
+    [[nodiscard]] bool joinable() const noexcept;
+
+    /// Pins the thread to cpus. Returns -1 on error.
+    int set_affinity(const cpu_set_t& cpus) noexcept;
+
+    /// Joins or detaches a thread that is still joinable, as chosen by Thread_Options::detach_on_destroy.
     ~Thread();
 };
 
+template <typename Function, typename... Args>
+Thread::Thread(const Thread_Options& options, Function&& function, Args&&... args) noexcept
+    : detach_on_destroy_(options.detach_on_destroy) {
+    using Callable = std::tuple<std::decay_t<Function>, std::decay_t<Args>...>;
+    static_assert(std::is_nothrow_move_constructible_v<Callable>, "Thread moves its callable without throwing");
+
+    Callable callable(std::forward<Function>(function), std::forward<Args>(args)...);
+    Start start{&run<Callable>, &callable};
+    launch(start, options);
+}
+
 #endif //THREAD_HPP
@@ -0,0 +1,87 @@
+//
+// Created by David Yang on 2026-10-17.
+//
+
+#ifndef URING_HPP
+#define URING_HPP
+
+// io_uring through raw syscalls, an alternative to the epoll Reactor that batches every submission of a loop
+// iteration into the io_uring_enter that also waits for the next completions
+
+#include <stddef.h>
+#include <stdint.h>
+#include <linux/io_uring.h>
+
+/// Submission and completion queues of one io_uring instance plus a ring of provided receive buffers,
+/// meant to be driven by a single thread.
+class Uring {
+    int fd_ = -1;
+
+    void* rings_ = nullptr;     // submission and completion rings share one mapping
+    size_t rings_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    uint32_t* sq_head_ = nullptr;
+    uint32_t* sq_tail_ = nullptr;
+    uint32_t* sq_array_ = nullptr;
+    uint32_t sq_mask_ = 0;
+    uint32_t sq_entries_ = 0;
+    uint32_t sq_local_tail_ = 0;    // sqes handed out, published to the kernel by submit
+
+    uint32_t* cq_head_ = nullptr;
+    uint32_t* cq_tail_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+    uint32_t cq_mask_ = 0;
+
+    io_uring_buf_ring* buffer_ring_ = nullptr;  // provided buffers the kernel picks from for multishot receives
+    char* buffer_memory_ = nullptr;
+    size_t buffer_mapping_size_ = 0;
+    uint32_t buffer_count_ = 0;
+    uint32_t buffer_size_ = 0;
+    uint16_t buffer_tail_ = 0;
+
+    // publishes the sqes handed out since the last call
+    uint32_t publish() noexcept;
+
+public:
+    Uring() = default;
+    Uring(const Uring&) = delete;
+    Uring& operator=(const Uring&) = delete;
+    ~Uring();
+
+    /// Whether the kernel has everything init and provide_buffers need: multishot receive,
+    /// provided buffer rings and multishot accept, all there since Linux 6.0.
+    [[nodiscard]] static bool supported() noexcept;
+
+    /// Sets up a ring with entries submission slots. Returns -1 on error.
+    int init(uint32_t entries) noexcept;
+
+    /// Registers count buffers of size bytes as group, count must be a power of two. Returns -1 on error.
+    int provide_buffers(uint16_t group, uint32_t count, uint32_t size) noexcept;
+
+    /// A zeroed sqe to fill in, submitting what is queued first if the submission queue is full.
+    /// Returns nullptr if it can't be made room for.
+    io_uring_sqe* next_sqe() noexcept;
+
+    /// Submits everything queued and waits for at least wait completions.
+    /// Returns -1 on error, 0 if interrupted.
+    int submit(uint32_t wait) noexcept;
+
+    /// The oldest completion not yet consumed, nullptr if there is none.
+    [[nodiscard]] io_uring_cqe* peek() noexcept;
+
+    /// Consumes the completion returned by peek.
+    void advance() noexcept;
+
+    /// Data of the provided buffer id, as reported by a completion carrying IORING_CQE_F_BUFFER.
+    [[nodiscard]] const char* buffer(uint16_t id) const noexcept;
+
+    /// Hands provided buffer id back to the kernel once its data has been copied out.
+    void recycle(uint16_t id) noexcept;
+
+    /// Tears the ring down, which cancels everything still in flight.
+    void close() noexcept;
+};
+
+#endif //URING_HPP
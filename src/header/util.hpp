@@ -5,16 +5,140 @@
 #ifndef UTIL_HPP
 #define UTIL_HPP
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
 /// @brief utilities for Gao
 ///
 /// ALL utility functions don't throw
 ///
 /// ALL throwable functions return -1 on error
 namespace util {
+    /// @brief Page level region manager handing out Gaolette memory from one address space reservation.
+    ///
+    /// reserve() maps a single PROT_NONE range up front. Blocks are carved from it by a buddy allocator whose
+    /// bookkeeping lives outside the reservation, so allocate()/deallocate() never enter the kernel.
+    /// Pages are only made accessible by commit() and handed back to the kernel by decommit().
     class Allocator {
+        static constexpr size_t MIN_BLOCK_SHIFT = 16;   // 64 KiB, smallest block handed out
+        static constexpr size_t BASE_ALIGNMENT = static_cast<size_t>(1) << 30;  // blocks are aligned to their size
+                                                                                 // up to 1 GiB, fit for huge pages
+        static constexpr int MAX_ORDERS = 40;
+        static constexpr uint32_t NIL = UINT32_MAX;
+
+        char* base_ = nullptr;
+        size_t reservation_ = 0;
+        int max_order_ = 0;
+
+        // per min-block bookkeeping, only meaningful at the first block of a buddy block
+        uint8_t* state_ = nullptr;      // FREE/USED bit and order
+        uint32_t* next_ = nullptr;      // free list links
+        uint32_t* prev_ = nullptr;
+        size_t meta_size_ = 0;
+        uint32_t free_head_[MAX_ORDERS] = {};
+
+        static int order_for(size_t size) noexcept;
+        void push_free(uint32_t block, int order) noexcept;
+        void remove_free(uint32_t block, int order) noexcept;
+
+    public:
+        Allocator() = default;
+        Allocator(const Allocator&) = delete;
+        Allocator& operator=(const Allocator&) = delete;
+        ~Allocator();
+
+        /// Reserves reservation bytes (rounded down to a power of two) of inaccessible address space.
+        /// Returns -1 on error or if already reserved.
+        int reserve(size_t reservation) noexcept;
+
+        [[nodiscard]] bool reserved() const noexcept;
+
+        /// Whether ptr lies inside the reservation.
+        [[nodiscard]] bool owns(const void* ptr) const noexcept;
+
+        /// Hands out a block of at least size bytes, the block stays inaccessible until committed.
+        /// Returns nullptr if the reservation is exhausted.
+        void* allocate(size_t size) noexcept;
+
+        /// Returns a block handed out by allocate to the free lists, its pages must be decommitted.
+        void deallocate(void* block) noexcept;
+
+        /// Size of the block allocate would hand out for size bytes.
+        [[nodiscard]] static size_t fit(size_t size) noexcept;
+
+        /// Size of the block starting at block, as handed out by allocate.
+        [[nodiscard]] size_t block_size(const void* block) const noexcept;
+
+        /// Makes size bytes at ptr readable and writable, pages are faulted in on first touch.
+        /// Returns -1 on error.
+        static int commit(void* ptr, size_t size) noexcept;
+
+        /// Drops the pages backing size bytes at ptr and makes them inaccessible again.
+        /// Returns -1 on error.
+        static int decommit(void* ptr, size_t size) noexcept;
 
+        /// decommit for blocks something else has been mapped over, such as a file: maps fresh inaccessible
+        /// address space back in its place.
+        /// Returns -1 on error.
+        static int discard(void* ptr, size_t size) noexcept;
     };
 
+    /// Rounds size up to whole pages.
+    size_t page_round(size_t size) noexcept;
+
+    /// Rounds size up to a multiple of granule, which must be a power of two.
+    size_t round_up(size_t size, size_t granule) noexcept;
+
+    /// Default huge page size of the system as reported by /proc/meminfo, 2 MiB if it can't be read.
+    size_t huge_page_size() noexcept;
+
+    /// Whether transparent huge pages can back memory advised with MADV_HUGEPAGE.
+    bool transparent_huge_pages() noexcept;
+
+    /// NUMA nodes told apart, node masks are a single word.
+    constexpr int MAX_NUMA_NODES = 64;
+
+    /// Online NUMA nodes below MAX_NUMA_NODES, bit n for node n; just node 0 without NUMA support.
+    uint64_t numa_nodes() noexcept;
+
+    /// NUMA node cpu belongs to, -1 if unknown.
+    int numa_node_of_cpu(int cpu) noexcept;
+
+    /// Sets the memory policy mode, an MPOL_* constant, over the nodes in mask for size bytes at base.
+    /// Pages already faulted in stay where they are. Returns -1 on error.
+    int bind_memory(void* base, size_t size, int mode, uint64_t nodes) noexcept;
+
+    /// Test-and-test-and-set lock for short critical sections that never enter the kernel while held.
+    class Spin_Lock {
+        std::atomic_flag flag_ = ATOMIC_FLAG_INIT;
+
+    public:
+        void lock() noexcept;
+        void unlock() noexcept;
+    };
+
+    /// Holds a Spin_Lock for the lifetime of the guard.
+    class Lock_Guard {
+        Spin_Lock& lock_;
+
+    public:
+        explicit Lock_Guard(Spin_Lock& lock) noexcept : lock_(lock) {
+            lock_.lock();
+        }
+        ~Lock_Guard() {
+            lock_.unlock();
+        }
+        Lock_Guard(const Lock_Guard&) = delete;
+        Lock_Guard& operator=(const Lock_Guard&) = delete;
+    };
+
+    /// Sleeps while word still holds expected, may return spuriously.
+    void futex_wait(std::atomic<uint32_t>* word, uint32_t expected) noexcept;
+
+    /// Wakes up to count threads sleeping on word.
+    void futex_wake(std::atomic<uint32_t>* word, int count) noexcept;
 }
 
 
@@ -2,4 +2,1105 @@
 // Created by David Yang on 2025-10-10.
 //
 
-#include "header/init_gaolette.hpp"
\ No newline at end of file
+#include "header/comm.hpp"
+#include "header/init_gaolette.hpp"
+#include "header/scheduler.hpp"
+#include "header/stats.hpp"
+#include "header/util.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/mempolicy.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <atomic>
+
+namespace {
+    // Gaolette table, ids index into fixed size chunks that never move once published, so lookups from any
+    // thread take no lock; ids are handed out and recycled through free_ids under id_lock.
+    // A record is only ever changed by the command currently running for its id, see dispatch_parallel.
+    constexpr int CHUNK_SHIFT = 10;
+    constexpr int CHUNK_SIZE = 1 << CHUNK_SHIFT;
+    constexpr int MAX_CHUNKS = 4096;    // 4 Mi Gaolettes
+
+    struct Chunk {
+        Gaolette_Record records[CHUNK_SIZE];
+        Task_Group groups[CHUNK_SIZE];     // kept across id reuse, tasks may outlive their Gaolette
+    };
+
+    std::atomic<Chunk*> chunks[MAX_CHUNKS];
+    std::atomic<int> used{0};     // slots ever handed out
+    util::Spin_Lock id_lock;
+    int* free_ids = nullptr;      // sized for every slot of every chunk, so freeing an id never allocates
+    int free_count = 0;
+
+    // Gaolette memory is carved from here once reserve_gaolette_space succeeded, plain mmap otherwise
+    util::Allocator regions;
+    util::Spin_Lock regions_lock;
+
+    using util::page_round;
+
+    // state changes waiting for Comm to report them, swapped with spare_changes whenever they are taken
+    std::atomic<uint64_t> watching_all{0};     // slots subscribed to every Gaolette
+    util::Spin_Lock changes_lock;
+    State_Change_Record* changes = nullptr;
+    uint32_t change_count = 0;
+    uint32_t change_capacity = 0;
+    State_Change_Record* spare_changes = nullptr;
+    uint32_t spare_capacity = 0;
+    uint32_t change_sequence = 0;
+
+    // records a change for whoever watches the Gaolette, a change that can't be stored is not reported
+    void record_change(int id, uint64_t watchers, Gao::protocol::State_Code state) noexcept {
+        watchers |= watching_all.load(std::memory_order_acquire);
+        if (watchers == 0) {
+            return;
+        }
+        util::Lock_Guard guard(changes_lock);
+        if (change_count == change_capacity) {
+            const uint32_t grown = change_capacity == 0 ? 64 : change_capacity * 2;
+            auto* resized = static_cast<State_Change_Record*>(
+                ::realloc(changes, grown * sizeof(State_Change_Record)));
+            if (resized == nullptr) {
+                return;
+            }
+            changes = resized;
+            change_capacity = grown;
+        }
+        changes[change_count++] = State_Change_Record{id, state, change_sequence++, watchers};
+    }
+
+    // warm pool, per size class a stack of committed and prefaulted regions ready to become Gaolettes
+    struct Warm_Class {
+        size_t size;        // bytes section_memory grants the Gaolettes served by this class
+        void** regions;
+        uint32_t count;
+        uint32_t target;    // regions kept ready
+        uint32_t pending;   // regions being scrubbed or prefaulted that will take a slot
+    };
+
+    constexpr int MAX_WARM_CLASSES = 16;
+    Warm_Class warm_classes[MAX_WARM_CLASSES];
+    int warm_class_count = 0;   // only changed before the runtime starts serving
+    util::Spin_Lock warm_lock;
+
+    // bytes section_memory grants a request of size bytes backed by regular pages
+    size_t granted_size(size_t size) noexcept {
+        return regions.reserved() ? util::Allocator::fit(page_round(size)) : page_round(size);
+    }
+
+    Warm_Class* find_warm_class(size_t granted) noexcept {
+        for (int i = 0; i < warm_class_count; ++i) {
+            if (warm_classes[i].size == granted) {
+                return &warm_classes[i];
+            }
+        }
+        return nullptr;
+    }
+
+    // faults every page of size bytes at base in for writing
+    void prefault(void* base, size_t size) noexcept {
+#ifdef MADV_POPULATE_WRITE
+        if (::madvise(base, size, MADV_POPULATE_WRITE) == 0) {
+            return;
+        }
+#endif
+        const size_t page = static_cast<size_t>(::getpagesize());
+        auto* bytes = static_cast<volatile char*>(base);
+        for (size_t offset = 0; offset < size; offset += page) {
+            bytes[offset] = 0;
+        }
+    }
+
+    Gaolette_Record& record_of(int id) noexcept {
+        return chunks[id >> CHUNK_SHIFT].load(std::memory_order_acquire)->records[id & (CHUNK_SIZE - 1)];
+    }
+
+    Task_Group& group_of(int id) noexcept {
+        return chunks[id >> CHUNK_SHIFT].load(std::memory_order_acquire)->groups[id & (CHUNK_SIZE - 1)];
+    }
+
+    int allocate_id() noexcept {
+        util::Lock_Guard guard(id_lock);
+        if (free_count > 0) {
+            return free_ids[--free_count];
+        }
+
+        const int id = used.load(std::memory_order_relaxed);
+        if ((id & (CHUNK_SIZE - 1)) == 0) {
+            const int chunk = id >> CHUNK_SHIFT;
+            if (chunk == MAX_CHUNKS) {
+                return -1;
+            }
+            auto* new_free = static_cast<int*>(::realloc(free_ids, (id + CHUNK_SIZE) * sizeof(int)));
+            if (new_free == nullptr) {
+                return -1;
+            }
+            free_ids = new_free;
+            auto* fresh = new (nothrow) Chunk();
+            if (fresh == nullptr) {
+                return -1;
+            }
+            chunks[chunk].store(fresh, std::memory_order_release);
+        }
+        used.store(id + 1, std::memory_order_release);
+        return id;
+    }
+
+    void free_id(int id) noexcept {
+        util::Lock_Guard guard(id_lock);
+        free_ids[free_count++] = id;
+    }
+
+    void* allocate_region(size_t size) noexcept {
+        util::Lock_Guard guard(regions_lock);
+        return regions.allocate(size);
+    }
+
+    void deallocate_region(void* base) noexcept {
+        util::Lock_Guard guard(regions_lock);
+        regions.deallocate(base);
+    }
+
+    using Gao::protocol::Memory_Policy_Code;
+    using Gao::protocol::Numa_Policy_Code;
+    using Gao::protocol::Page_Size_Code;
+
+    bool is_dynamic(const Gao::protocol::Perf_Spec_Payload& spec) noexcept {
+        return spec.memory_policy == static_cast<uint8_t>(Memory_Policy_Code::DYNAMIC);
+    }
+
+    bool valid_spec(const Gao::protocol::Perf_Spec_Payload& spec) noexcept {
+        if (spec.size == 0 || spec.memory_policy > static_cast<uint8_t>(Memory_Policy_Code::DYNAMIC)
+            || spec.page_size > static_cast<uint8_t>(Page_Size_Code::EXPLICIT_HUGE)
+            || spec.numa_policy > static_cast<uint8_t>(Numa_Policy_Code::LOCAL_TO_WORKERS)) {
+            return false;
+        }
+        return !is_dynamic(spec) || spec.max_memory_usage >= spec.size;
+    }
+
+    // bytes of address space a Gaolette occupies, DYNAMIC ones get room to grow up to their limit
+    size_t span_of(const Gao::protocol::Perf_Spec_Payload& spec) noexcept {
+        return page_round(is_dynamic(spec) ? spec.max_memory_usage : spec.size);
+    }
+
+    // protection changes of hugetlb mappings must cover whole huge pages
+    size_t granule_of(const Gao::protocol::Perf_Spec_Payload& spec) noexcept {
+        return spec.page_size == static_cast<uint8_t>(Page_Size_Code::EXPLICIT_HUGE) ? util::huge_page_size()
+                                                                                     : static_cast<size_t>(::getpagesize());
+    }
+
+    // section_memory hands out accessible memory, DYNAMIC Gaolettes only keep their initial size of it
+    // Returns -1 on error.
+    int trim_to_size(const Gaolette_Record& record) noexcept {
+        if (record.committed == record.size) {
+            return 0;
+        }
+        return ::mprotect(static_cast<char*>(record.base) + record.committed, record.size - record.committed,
+                          PROT_NONE);
+    }
+
+    // drops the pages of a shrinking Gaolette, MADV_FREE lets the kernel take them lazily under pressure
+    int reclaim(char* base, size_t size) noexcept {
+#ifdef MADV_FREE
+        if (::madvise(base, size, MADV_FREE) == 0) {
+            return 0;
+        }
+        if (errno != EINVAL) {
+            return -1;
+        }
+#endif
+        return ::madvise(base, size, MADV_DONTNEED);
+    }
+
+    // a NUMA policy only means something with several nodes to choose from
+    bool multiple_nodes() noexcept {
+        const uint64_t nodes = util::numa_nodes();
+        return (nodes & (nodes - 1)) != 0;
+    }
+
+    // node the memory and tasks of a Gaolette made to spec live on, -1 for wherever they happen to run
+    int home_node(const Gao::protocol::Perf_Spec_Payload& spec) noexcept {
+        if (!multiple_nodes()) {
+            return -1;
+        }
+        switch (static_cast<Numa_Policy_Code>(spec.numa_policy)) {
+            case Numa_Policy_Code::PREFERRED:
+                return spec.numa_node < util::MAX_NUMA_NODES
+                       && (util::numa_nodes() & (uint64_t{1} << spec.numa_node)) != 0 ? spec.numa_node : -1;
+            case Numa_Policy_Code::LOCAL_TO_WORKERS:
+                return gaolette_scheduler.next_worker_node();
+            default:
+                return -1;
+        }
+    }
+
+    // sets the NUMA policy of spec on size fresh bytes at base, nothing may have faulted them in yet
+    // Returns the policy in effect, FIRST_TOUCH if there is no node to prefer or the kernel refused.
+    Numa_Policy_Code place_memory(void* base, size_t size, const Gao::protocol::Perf_Spec_Payload& spec,
+                                  int node) noexcept {
+        const auto policy = static_cast<Numa_Policy_Code>(spec.numa_policy);
+        if (policy == Numa_Policy_Code::INTERLEAVE && multiple_nodes()) {
+            return util::bind_memory(base, size, MPOL_INTERLEAVE, util::numa_nodes()) == 0
+                       ? policy : Numa_Policy_Code::FIRST_TOUCH;
+        }
+        if (node == -1) {
+            return Numa_Policy_Code::FIRST_TOUCH;
+        }
+        return util::bind_memory(base, size, MPOL_PREFERRED, uint64_t{1} << node) == 0
+                   ? policy : Numa_Policy_Code::FIRST_TOUCH;
+    }
+
+    // drops the policy place_memory set, a block carved from the reservation would keep it for its next tenant
+    void forget_placement(const Gaolette_Record& record) noexcept {
+        if (record.spec.numa_policy != static_cast<uint8_t>(Numa_Policy_Code::FIRST_TOUCH)
+            && regions.owns(record.base)) {
+            util::bind_memory(record.base, record.size, MPOL_DEFAULT, 0);
+        }
+    }
+
+    // hands out a warm region for spec if one is ready, size receives its size
+    void* take_warm(const Gao::protocol::Perf_Spec_Payload& spec, size_t& size) noexcept {
+        // warm regions are already faulted in wherever the pool happened to run
+        if (is_dynamic(spec) || spec.page_size != static_cast<uint8_t>(Page_Size_Code::DEFAULT)
+            || (spec.numa_policy != static_cast<uint8_t>(Numa_Policy_Code::FIRST_TOUCH) && multiple_nodes())) {
+            return nullptr;
+        }
+        Warm_Class* warm = find_warm_class(granted_size(spec.size));
+        if (warm == nullptr) {
+            return nullptr;
+        }
+        util::Lock_Guard guard(warm_lock);
+        if (warm->count == 0) {
+            return nullptr;
+        }
+        size = warm->size;
+        return warm->regions[--warm->count];
+    }
+
+    // copies and scrubs of a Gaolette's memory run in SPREAD_CHUNK pieces on the thread running its command and
+    // on helpers from its Task_Group, which run on the workers of its node; with the command's thread taking one
+    // of them, at most max_cpu_cores threads work on a Gaolette at once
+    constexpr size_t SPREAD_CHUNK = size_t{2} << 20;
+    constexpr uint32_t MAX_SPREAD_HELPERS = 15;
+
+    struct Spread;
+
+    struct Spread_Helper : Task {
+        Spread* spread;
+    };
+
+    // lives until the command's thread and every helper let go of it, a helper may only get to run once
+    // all of the work is done
+    struct Spread {
+        char* to;
+        const char* from;   // nullptr to zero to instead
+        size_t size;
+        uint64_t chunks;
+        std::atomic<uint64_t> next{0};          // next chunk to claim
+        std::atomic<uint32_t> remaining{0};     // chunks not done yet, the command's thread waits on it
+        std::atomic<uint32_t> references{0};
+        Spread_Helper helpers[MAX_SPREAD_HELPERS];
+    };
+
+    void copy_or_zero(char* to, const char* from, size_t size) noexcept {
+        if (from != nullptr) {
+            ::memcpy(to, from, size);
+        } else {
+            ::memset(to, 0, size);
+        }
+    }
+
+    void work_through(Spread& spread) noexcept {
+        uint64_t chunk;
+        while ((chunk = spread.next.fetch_add(1, std::memory_order_relaxed)) < spread.chunks) {
+            const size_t offset = chunk * SPREAD_CHUNK;
+            const size_t length = spread.size - offset < SPREAD_CHUNK ? spread.size - offset : SPREAD_CHUNK;
+            copy_or_zero(spread.to + offset, spread.from != nullptr ? spread.from + offset : nullptr, length);
+            if (spread.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                util::futex_wake(&spread.remaining, 1);
+            }
+        }
+    }
+
+    void let_go(Spread* spread) noexcept {
+        if (spread->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            spread->~Spread();
+            ::free(spread);
+        }
+    }
+
+    void run_spread_helper(Task* task) noexcept {
+        Spread* spread = static_cast<Spread_Helper*>(task)->spread;
+        work_through(*spread);
+        let_go(spread);
+    }
+
+    // copy_or_zero for size bytes of the Gaolette id's memory, spread over the workers its Task_Group allows;
+    // the calling thread works through it as well and never waits for a helper that hasn't started
+    void spread_work(int id, char* to, const char* from, size_t size) noexcept {
+        Task_Group& group = group_of(id);
+        const uint64_t chunks = (size + SPREAD_CHUNK - 1) / SPREAD_CHUNK;
+        uint64_t helpers = gaolette_scheduler.worker_count();
+        const uint32_t limit = group.limit.load(std::memory_order_relaxed);
+        if (limit != 0 && helpers >= limit) {
+            helpers = limit - 1;
+        }
+        if (helpers >= chunks) {
+            helpers = chunks == 0 ? 0 : chunks - 1;
+        }
+        if (helpers > MAX_SPREAD_HELPERS) {
+            helpers = MAX_SPREAD_HELPERS;
+        }
+
+        auto* spread = helpers != 0 && chunks <= UINT32_MAX ? static_cast<Spread*>(::malloc(sizeof(Spread))) : nullptr;
+        if (spread == nullptr) {
+            copy_or_zero(to, from, size);
+            return;
+        }
+        new (spread) Spread();
+        spread->to = to;
+        spread->from = from;
+        spread->size = size;
+        spread->chunks = chunks;
+        spread->remaining.store(static_cast<uint32_t>(chunks), std::memory_order_relaxed);
+        spread->references.store(static_cast<uint32_t>(helpers) + 1, std::memory_order_relaxed);
+        for (uint32_t i = 0; i < helpers; ++i) {
+            Spread_Helper& helper = spread->helpers[i];
+            helper.run = &run_spread_helper;
+            helper.group = &group;
+            helper.spread = spread;
+            if (gaolette_scheduler.submit(&helper) == -1) {
+                // the queues are full, whatever wasn't handed out is done here
+                spread->references.fetch_sub(static_cast<uint32_t>(helpers) - i, std::memory_order_relaxed);
+                break;
+            }
+        }
+
+        work_through(*spread);
+        uint32_t remaining;
+        while ((remaining = spread->remaining.load(std::memory_order_acquire)) != 0) {
+            util::futex_wait(&spread->remaining, remaining);
+        }
+        let_go(spread);
+    }
+
+    // scrubs the memory of the dying Gaolette id and keeps it warm if its class is short of regions
+    // Returns false if the memory has to be released instead.
+    bool keep_warm(int id, const Gaolette_Record& record) noexcept {
+        if (record.committed != record.size || record.backing != Backing::ANONYMOUS
+            || record.spec.page_size != static_cast<uint8_t>(Page_Size_Code::DEFAULT)
+            || record.spec.numa_policy != static_cast<uint8_t>(Numa_Policy_Code::FIRST_TOUCH)) {
+            return false;
+        }
+        Warm_Class* warm = find_warm_class(record.size);
+        if (warm == nullptr) {
+            return false;
+        }
+        {
+            util::Lock_Guard guard(warm_lock);
+            if (warm->count + warm->pending == warm->target) {
+                return false;
+            }
+            ++warm->pending;
+        }
+        // zeroing keeps the pages faulted in, the next tenant must not see any of this one's data;
+        // the slot is claimed up front so scrubbing happens outside the lock
+        spread_work(id, static_cast<char*>(record.base), nullptr, record.size);
+        util::Lock_Guard guard(warm_lock);
+        --warm->pending;
+        warm->regions[warm->count++] = record.base;
+        return true;
+    }
+
+    // fills in the record of id and publishes it to lookups once its memory is placed and trimmed to size
+    // Returns -1 if trimming failed, the memory and id are still the caller's then.
+    int install(int id, void* base, size_t size, const Gao::protocol::Perf_Spec_Payload& spec,
+                Page_Size_Code page_size, Backing backing = Backing::ANONYMOUS) noexcept {
+        Gaolette_Record& record = record_of(id);
+        record.base = base;
+        record.size = size;
+        record.committed = size;
+        record.spec = spec;
+        record.spec.page_size = static_cast<uint8_t>(page_size);
+        record.state = Gao::protocol::State_Code::OPERATIONAL;
+        record.backing = backing;
+        record.image_fd = -1;
+        record.exported = false;
+        if (is_dynamic(spec)) {
+            record.committed = util::round_up(spec.size, granule_of(record.spec));
+        }
+
+        // the Gaolette's tasks follow its memory, interleaved memory is as close to one node as to any other
+        const int node = home_node(spec);
+        const Numa_Policy_Code numa_policy = place_memory(base, size, spec, node);
+        record.spec.numa_policy = static_cast<uint8_t>(numa_policy);
+        record.spec.numa_node = node == -1 ? 0 : static_cast<uint8_t>(node);
+        Task_Group& group = group_of(id);
+        // helpers of the last Gaolette with this id may still be queued, they keep the slots they were admitted to
+        group.limit.store(spec.max_cpu_cores, std::memory_order_relaxed);
+        group.node.store(numa_policy == Numa_Policy_Code::INTERLEAVE || numa_policy == Numa_Policy_Code::FIRST_TOUCH
+                             ? -1 : node, std::memory_order_relaxed);
+        if (trim_to_size(record) == -1) {
+            forget_placement(record);
+            return -1;
+        }
+        record.watchers.store(0, std::memory_order_relaxed);
+        record.in_use.store(true, std::memory_order_release);
+        record_change(id, 0, record.state);
+        return 0;
+    }
+
+    // withdraws the record from lookups, its memory has been dealt with by the caller
+    void retire(int id, Gaolette_Record& record) noexcept {
+        record.state = Gao::protocol::State_Code::SHUT_DOWN;
+        record.in_use.store(false, std::memory_order_release);
+        // subscriptions to a single Gaolette end with it
+        record_change(id, record.watchers.exchange(0, std::memory_order_acq_rel), record.state);
+        free_id(id);
+    }
+
+    struct Span {
+        char* base;
+        size_t size;
+        bool owned;     // carved from regions
+    };
+
+    int compare_spans(const void* lhs, const void* rhs) noexcept {
+        const char* a = static_cast<const Span*>(lhs)->base;
+        const char* b = static_cast<const Span*>(rhs)->base;
+        return a < b ? -1 : (a > b ? 1 : 0);
+    }
+
+    // section_memory without the bookkeeping
+    void* map_memory(size_t& size, Page_Size_Code& page_size) noexcept {
+        if (page_size == Page_Size_Code::EXPLICIT_HUGE) {
+            const size_t rounded = util::round_up(size, util::huge_page_size());
+            void* base = ::mmap(nullptr, rounded, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (base != MAP_FAILED) {
+                size = rounded;
+                return base;
+            }
+            // the huge page pool is empty or absent, transparent huge pages are the next best thing
+            page_size = Page_Size_Code::TRANSPARENT_HUGE;
+        }
+        if (page_size == Page_Size_Code::TRANSPARENT_HUGE) {
+            if (util::transparent_huge_pages()) {
+                size = util::round_up(size, util::huge_page_size());
+            } else {
+                page_size = Page_Size_Code::DEFAULT;
+            }
+        }
+
+        void* base = nullptr;
+        if (regions.reserved()) {
+            base = allocate_region(size);
+            if (base == nullptr) {
+                return nullptr;
+            }
+
+            // the whole block is committed so neighbouring Gaolettes share one VMA instead of alternating
+            // protections, its pages are still only faulted in once touched; the block is ours, so this
+            // runs outside the lock
+            size = regions.block_size(base);
+            if (util::Allocator::commit(base, size) == -1) {
+                deallocate_region(base);
+                return nullptr;
+            }
+        } else {
+            size = page_round(size);
+            base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (base == MAP_FAILED) {
+                return nullptr;
+            }
+        }
+
+        // carved blocks of huge page size are aligned to it, the advice stays with the range once released
+        // which at worst lets a later Gaolette carved from it use huge pages too
+        if (page_size == Page_Size_Code::TRANSPARENT_HUGE && ::madvise(base, size, MADV_HUGEPAGE) == -1) {
+            page_size = Page_Size_Code::DEFAULT;
+        }
+        return base;
+    }
+
+    // release_memory for memory an image is mapped over
+    // Returns -1 on error.
+    int release_mapped(void* base, size_t size) noexcept {
+        const uint64_t start = Gao::stats::now();
+        int result;
+        if (regions.owns(base)) {
+            // decommitting would leave the image mapped for the next Gaolette carved from the block,
+            // a block that can't be replaced with fresh address space is leaked instead
+            result = util::Allocator::discard(base, size);
+            if (result == 0) {
+                deallocate_region(base);
+            }
+        } else {
+            result = ::munmap(base, size);
+        }
+        runtime_stats.unmap.record_since(start);
+        return result;
+    }
+
+    // releases the memory of a withdrawn record that isn't kept warm, along with its image
+    void release_record(Gaolette_Record& record) noexcept {
+        if (record.backing == Backing::ANONYMOUS) {
+            forget_placement(record);
+            release_memory(record.base, record.size);
+        } else {
+            release_mapped(record.base, record.size);
+        }
+        // clones still mapping the image keep it alive
+        if (record.image_fd != -1) {
+            ::close(record.image_fd);
+            record.image_fd = -1;
+        }
+    }
+
+    // copies the committed pages of the Gaolette id to the same offsets of to, skipping what reads as zero anyway as far as
+    // the kernel tells: pages an anonymous Gaolette never touched, /proc/self/pagemap knows them, and holes in its
+    // image; a clone's own pages can't be told from its source's and are all copied
+    void copy_contents(int id, const Gaolette_Record& record, char* to) noexcept {
+        constexpr uint64_t PRESENT = uint64_t{1} << 63;
+        constexpr uint64_t SWAPPED = uint64_t{1} << 62;
+        constexpr size_t BATCH = 512;
+
+        const char* from = static_cast<const char*>(record.base);
+        if (record.backing == Backing::IMAGE) {
+            const auto end = static_cast<off_t>(record.committed);
+            off_t data = ::lseek(record.image_fd, 0, SEEK_DATA);
+            while (data != -1 && data < end) {
+                off_t hole = ::lseek(record.image_fd, data, SEEK_HOLE);
+                hole = hole == -1 || hole > end ? end : hole;
+                spread_work(id, to + data, from + data, static_cast<size_t>(hole - data));
+                data = hole < end ? ::lseek(record.image_fd, hole, SEEK_DATA) : -1;
+            }
+            return;     // ENXIO once there is no data left
+        }
+
+        const int pagemap = record.backing == Backing::ANONYMOUS ? ::open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC)
+                                                                 : -1;
+        if (pagemap == -1) {
+            spread_work(id, to, from, record.committed);
+            return;
+        }
+
+        const size_t page = static_cast<size_t>(::getpagesize());
+        const size_t pages = record.committed / page;
+        const off_t first = static_cast<off_t>(reinterpret_cast<uintptr_t>(from) / page * sizeof(uint64_t));
+        uint64_t entries[BATCH];
+        size_t run = 0;     // first page of the run of touched pages not copied yet
+        for (size_t at = 0; at < pages; at += BATCH) {
+            const size_t count = pages - at < BATCH ? pages - at : BATCH;
+            if (::pread(pagemap, entries, count * sizeof(uint64_t), first + static_cast<off_t>(at * sizeof(uint64_t)))
+                != static_cast<ssize_t>(count * sizeof(uint64_t))) {
+                break;  // the rest is copied whole
+            }
+            for (size_t i = 0; i < count; ++i) {
+                if ((entries[i] & (PRESENT | SWAPPED)) != 0) {
+                    continue;
+                }
+                if (run < at + i) {
+                    spread_work(id, to + run * page, from + run * page, (at + i - run) * page);
+                }
+                run = at + i + 1;
+            }
+        }
+        if (run < pages) {
+            spread_work(id, to + run * page, from + run * page, (pages - run) * page);
+        }
+        ::close(pagemap);
+    }
+
+    // moves the contents of the Gaolette id into a fresh memfd image, mapped shared and writable in place of its
+    // memory; an image it already had is left to whoever else still holds it
+    // Returns -1 on error, the Gaolette is left as it was then.
+    int make_image(int id, Gaolette_Record& record) noexcept {
+        const int image = ::memfd_create("gaolette", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        if (image == -1) {
+            return -1;
+        }
+        if (::ftruncate(image, static_cast<off_t>(record.size)) == -1) {
+            ::close(image);
+            return -1;
+        }
+
+        // the image is filled through a mapping of its own that then replaces the Gaolette's in one go, so
+        // nothing is lost if any step fails; the mapping takes the Gaolette's NUMA policy and huge pages along
+        void* mapping = ::mmap(nullptr, record.size, PROT_READ | PROT_WRITE, MAP_SHARED, image, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(image);
+            return -1;
+        }
+        char* copy = static_cast<char*>(mapping);
+        place_memory(copy, record.size, record.spec, group_of(id).node);
+        if (record.spec.page_size == static_cast<uint8_t>(Page_Size_Code::TRANSPARENT_HUGE)) {
+            ::madvise(copy, record.size, MADV_HUGEPAGE);
+        }
+        copy_contents(id, record, copy);
+
+        if ((record.committed != record.size
+             && ::mprotect(copy + record.committed, record.size - record.committed, PROT_NONE) == -1)
+            || ::mremap(copy, record.size, record.size, MREMAP_MAYMOVE | MREMAP_FIXED, record.base) == MAP_FAILED) {
+            ::munmap(copy, record.size);
+            ::close(image);
+            return -1;
+        }
+
+        if (record.image_fd != -1) {
+            ::close(record.image_fd);
+        }
+        record.backing = Backing::IMAGE;
+        record.image_fd = image;
+        record.exported = false;
+        return 0;
+    }
+
+    // turns the Gaolette id read-only and locked for the rest of its life, so its image stays what every clone
+    // of it starts from; an image the host may still write to is left to it and replaced by a copy first
+    // Returns -1 on error, the Gaolette is still writable then.
+    int lock_image(int id, Gaolette_Record& record) noexcept {
+        if ((record.backing != Backing::IMAGE || record.exported) && make_image(id, record) == -1) {
+            return -1;
+        }
+        if (::mprotect(record.base, record.committed, PROT_READ) == -1) {
+            return -1;
+        }
+        // nothing is written to it from here on, sealed it can be shared without anyone writing to it either;
+        // kernels without F_SEAL_FUTURE_WRITE leave it unsealed and it is never shared
+        ::fcntl(record.image_fd, F_ADD_SEALS, F_SEAL_FUTURE_WRITE | F_SEAL_GROW | F_SEAL_SHRINK);
+
+        record.state = Gao::protocol::State_Code::LOCKED;
+        record_change(id, record.watchers.load(std::memory_order_acquire), record.state);
+        return 0;
+    }
+
+    // maps a private copy-on-write view of size bytes of image, over a block of the reservation if there is one
+    // Returns nullptr on failure.
+    void* map_image(int image, size_t size) noexcept {
+        const uint64_t start = Gao::stats::now();
+        void* base = nullptr;
+        if (regions.reserved()) {
+            base = allocate_region(size);
+            if (base != nullptr
+                && ::mmap(base, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, image, 0) == MAP_FAILED) {
+                release_mapped(base, size);
+                base = nullptr;
+            }
+        } else {
+            base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, image, 0);
+            if (base == MAP_FAILED) {
+                base = nullptr;
+            }
+        }
+        runtime_stats.map.record_since(start);
+        return base;
+    }
+}
+
+int reserve_gaolette_space(size_t reservation) noexcept {
+    return regions.reserve(reservation);
+}
+
+void* section_memory(size_t& size, Gao::protocol::Page_Size_Code& page_size) noexcept {
+    const uint64_t start = Gao::stats::now();
+    void* base = map_memory(size, page_size);
+    runtime_stats.map.record_since(start);
+    return base;
+}
+
+int release_memory(void* base, size_t size) noexcept {
+    const uint64_t start = Gao::stats::now();
+    int result;
+    if (regions.owns(base)) {
+        result = util::Allocator::decommit(base, size);
+        deallocate_region(base);
+    } else {
+        result = ::munmap(base, page_round(size));
+    }
+    runtime_stats.unmap.record_since(start);
+    return result;
+}
+
+int init_gaolette(const Gao::protocol::Perf_Spec_Payload& spec) noexcept {
+    using Gao::protocol::Status;
+
+    if (!valid_spec(spec)) {
+        return -static_cast<int>(Status::INVALID_SPEC);
+    }
+
+    const int id = allocate_id();
+    if (id == -1) {
+        return -static_cast<int>(Status::NO_RESOURCES);
+    }
+
+    size_t size = span_of(spec);
+    auto page_size = static_cast<Page_Size_Code>(spec.page_size);
+    void* base = take_warm(spec, size);
+    if (base == nullptr) {
+        base = section_memory(size, page_size);
+    }
+    if (base == nullptr) {
+        free_id(id);
+        return -static_cast<int>(Status::NO_RESOURCES);
+    }
+
+    if (install(id, base, size, spec, page_size) == -1) {
+        release_memory(base, size);
+        free_id(id);
+        return -static_cast<int>(Status::NO_RESOURCES);
+    }
+    return id;
+}
+
+void init_gaolettes(const Gao::protocol::Perf_Spec_Payload* specs, uint32_t count,
+                    Gao::protocol::Batch_Result* results) noexcept {
+    using Gao::protocol::Status;
+
+    // hand out ids and warm regions first so the memory of every remaining item can be mapped in one go
+    static bool warm[Gao::protocol::MAX_BATCH];
+    size_t total = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        results[i] = {-1, static_cast<uint16_t>(Status::OK), 0, 0};
+        warm[i] = false;
+        if (!valid_spec(specs[i])) {
+            results[i].status = static_cast<uint16_t>(Status::INVALID_SPEC);
+            continue;
+        }
+        results[i].id = allocate_id();
+        if (results[i].id == -1) {
+            results[i].status = static_cast<uint16_t>(Status::NO_RESOURCES);
+            continue;
+        }
+
+        size_t size = 0;
+        if (void* base = take_warm(specs[i], size)) {
+            install(results[i].id, base, size, specs[i], Page_Size_Code::DEFAULT);     // STATIC, nothing to trim
+            warm[i] = true;
+        } else if (specs[i].page_size == static_cast<uint8_t>(Page_Size_Code::DEFAULT)) {
+            total += span_of(specs[i]);
+        }
+    }
+
+    // carving from the reservation is already a userspace affair, otherwise map the whole batch at once
+    // and if even that fails, fall back to mapping item by item; huge page items always get their own mapping
+    char* batch = nullptr;
+    if (!regions.reserved() && total != 0) {
+        auto page_size = Page_Size_Code::DEFAULT;
+        batch = static_cast<char*>(section_memory(total, page_size));
+    }
+    size_t offset = 0;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        if (results[i].id == -1 || warm[i]) {
+            continue;
+        }
+        size_t size = span_of(specs[i]);
+        auto page_size = static_cast<Page_Size_Code>(specs[i].page_size);
+        void* base = nullptr;
+        if (batch != nullptr && page_size == Page_Size_Code::DEFAULT) {
+            base = batch + offset;
+            offset += size;
+        } else {
+            base = section_memory(size, page_size);
+        }
+
+        if (base == nullptr) {
+            free_id(results[i].id);
+            results[i] = {-1, static_cast<uint16_t>(Status::NO_RESOURCES), 0, 0};
+            continue;
+        }
+        if (install(results[i].id, base, size, specs[i], page_size) == -1) {
+            release_memory(base, size);
+            free_id(results[i].id);
+            results[i] = {-1, static_cast<uint16_t>(Status::NO_RESOURCES), 0, 0};
+            continue;
+        }
+        results[i].page_size = static_cast<uint8_t>(page_size);
+    }
+}
+
+int release_gaolette(int id) noexcept {
+    Gaolette_Record* record = find_gaolette(id);
+    if (record == nullptr) {
+        return -1;
+    }
+
+    // withdrawn before its memory goes, lookups never see a record whose memory is being torn down
+    record->in_use.store(false, std::memory_order_release);
+    if (!keep_warm(id, *record)) {
+        release_record(*record);
+    }
+    retire(id, *record);
+    return 0;
+}
+
+void release_gaolettes(const Gao::protocol::Id_Payload* ids, uint32_t count,
+                       Gao::protocol::Batch_Result* results) noexcept {
+    using Gao::protocol::Status;
+
+    auto* spans = static_cast<Span*>(::malloc(count * sizeof(Span)));
+    size_t span_count = 0;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        Gaolette_Record* record = find_gaolette(ids[i].id);
+        if (record == nullptr) {
+            results[i] = {ids[i].id, static_cast<uint16_t>(Status::UNKNOWN_GAOLETTE), 0, 0};
+            continue;
+        }
+        results[i] = {ids[i].id, static_cast<uint16_t>(Status::OK), 0, 0};
+        record->in_use.store(false, std::memory_order_release);
+
+        if (keep_warm(ids[i].id, *record)) {
+            // back in the warm pool, nothing to release
+        } else if (spans == nullptr || record->backing != Backing::ANONYMOUS) {
+            // no scratch space to coalesce with or an image to let go of, release right away
+            release_record(*record);
+        } else {
+            forget_placement(*record);
+            spans[span_count++] = Span{static_cast<char*>(record->base), record->size, regions.owns(record->base)};
+        }
+        retire(ids[i].id, *record);
+    }
+
+    if (spans == nullptr) {
+        return;
+    }
+
+    // Gaolettes next to each other in memory are decommitted/unmapped as a single run
+    ::qsort(spans, span_count, sizeof(Span), compare_spans);
+    for (size_t i = 0; i < span_count;) {
+        char* base = spans[i].base;
+        size_t size = spans[i].size;
+        const bool owned = spans[i].owned;
+        for (++i; i < span_count && spans[i].base == base + size && spans[i].owned == owned; ++i) {
+            size += spans[i].size;
+        }
+        if (owned) {
+            util::Allocator::decommit(base, size);
+        } else {
+            ::munmap(base, size);
+        }
+    }
+    {
+        util::Lock_Guard guard(regions_lock);
+        for (size_t i = 0; i < span_count; ++i) {
+            if (spans[i].owned) {
+                regions.deallocate(spans[i].base);
+            }
+        }
+    }
+    ::free(spans);
+}
+
+int resize_gaolette(int id, uint64_t size) noexcept {
+    using Gao::protocol::Status;
+
+    Gaolette_Record* record = find_gaolette(id);
+    if (record == nullptr) {
+        return -static_cast<int>(Status::UNKNOWN_GAOLETTE);
+    }
+    if (!is_dynamic(record->spec) || size == 0 || size > record->spec.max_memory_usage) {
+        return -static_cast<int>(Status::INVALID_SPEC);
+    }
+    if (record->state == Gao::protocol::State_Code::LOCKED) {
+        return -static_cast<int>(Status::PERMISSION_DENIED);
+    }
+
+    const size_t committed = util::round_up(size, granule_of(record->spec));
+    char* base = static_cast<char*>(record->base);
+    if (committed > record->committed) {
+        if (::mprotect(base + record->committed, committed - record->committed, PROT_READ | PROT_WRITE) == -1) {
+            return -static_cast<int>(Status::NO_RESOURCES);
+        }
+    } else if (committed < record->committed) {
+        // a failed reclaim only costs memory, the tail is made inaccessible regardless; an image only gives
+        // its pages back once they are punched out of it
+        if (record->backing == Backing::IMAGE) {
+            ::madvise(base + committed, record->committed - committed, MADV_REMOVE);
+        } else {
+            reclaim(base + committed, record->committed - committed);
+        }
+        if (::mprotect(base + committed, record->committed - committed, PROT_NONE) == -1) {
+            return -static_cast<int>(Status::NO_RESOURCES);
+        }
+    }
+
+    record->committed = committed;
+    record->spec.size = size;
+    return 0;
+}
+
+int clone_gaolette(int id) noexcept {
+    using Gao::protocol::Status;
+
+    Gaolette_Record* source = find_gaolette(id);
+    if (source == nullptr) {
+        return -static_cast<int>(Status::UNKNOWN_GAOLETTE);
+    }
+    // memfds of hugetlbfs pages would have to come out of the same small pool as the source's
+    if (source->spec.page_size == static_cast<uint8_t>(Page_Size_Code::EXPLICIT_HUGE)) {
+        return -static_cast<int>(Status::INVALID_SPEC);
+    }
+    if (source->state != Gao::protocol::State_Code::LOCKED && lock_image(id, *source) == -1) {
+        return -static_cast<int>(Status::NO_RESOURCES);
+    }
+
+    const int clone = allocate_id();
+    if (clone == -1) {
+        return -static_cast<int>(Status::NO_RESOURCES);
+    }
+    void* base = map_image(source->image_fd, source->size);
+    if (base == nullptr) {
+        free_id(clone);
+        return -static_cast<int>(Status::NO_RESOURCES);
+    }
+
+    // the clone has its source's spec and size, but a NUMA placement of its own for the pages it writes
+    auto page_size = static_cast<Page_Size_Code>(source->spec.page_size);
+    if (page_size == Page_Size_Code::TRANSPARENT_HUGE && ::madvise(base, source->size, MADV_HUGEPAGE) == -1) {
+        page_size = Page_Size_Code::DEFAULT;
+    }
+    if (install(clone, base, source->size, source->spec, page_size, Backing::CLONE) == -1) {
+        release_mapped(base, source->size);
+        free_id(clone);
+        return -static_cast<int>(Status::NO_RESOURCES);
+    }
+    return clone;
+}
+
+int share_gaolette(int id) noexcept {
+    using Gao::protocol::Status;
+
+    Gaolette_Record* record = find_gaolette(id);
+    if (record == nullptr) {
+        return -static_cast<int>(Status::UNKNOWN_GAOLETTE);
+    }
+    if (record->spec.page_size == static_cast<uint8_t>(Page_Size_Code::EXPLICIT_HUGE)) {
+        return -static_cast<int>(Status::INVALID_SPEC);
+    }
+    if (record->state == Gao::protocol::State_Code::LOCKED) {
+        // whoever maps a locked image must not be able to write to it, see lock_image
+        const int seals = ::fcntl(record->image_fd, F_GET_SEALS);
+        return seals != -1 && (seals & F_SEAL_FUTURE_WRITE) != 0 ? record->image_fd
+                                                                 : -static_cast<int>(Status::PERMISSION_DENIED);
+    }
+    if (record->backing != Backing::IMAGE && make_image(id, *record) == -1) {
+        return -static_cast<int>(Status::NO_RESOURCES);
+    }
+    record->exported = true;
+    return record->image_fd;
+}
+
+int configure_warm_pool(size_t size, uint32_t count) noexcept {
+    if (size == 0 || count == 0 || warm_class_count == MAX_WARM_CLASSES) {
+        return -1;
+    }
+    const size_t granted = granted_size(size);
+    if (find_warm_class(granted) != nullptr) {
+        return -1;
+    }
+
+    auto* stack = static_cast<void**>(::malloc(count * sizeof(void*)));
+    if (stack == nullptr) {
+        return -1;
+    }
+    warm_classes[warm_class_count++] = Warm_Class{granted, stack, 0, count, 0};
+    return 0;
+}
+
+bool refill_warm_pool() noexcept {
+    for (int i = 0; i < warm_class_count; ++i) {
+        Warm_Class& warm = warm_classes[i];
+        {
+            util::Lock_Guard guard(warm_lock);
+            if (warm.count + warm.pending == warm.target) {
+                continue;
+            }
+            ++warm.pending;
+        }
+
+        size_t size = warm.size;
+        auto page_size = Page_Size_Code::DEFAULT;
+        void* base = section_memory(size, page_size);
+        if (base != nullptr) {
+            prefault(base, size);
+        }
+        util::Lock_Guard guard(warm_lock);
+        --warm.pending;
+        if (base == nullptr) {
+            return false;   // out of memory, try again once Gaolettes have been released
+        }
+        warm.regions[warm.count++] = base;
+        return true;
+    }
+    return false;
+}
+
+Gaolette_Record* find_gaolette(int id) noexcept {
+    if (id < 0 || id >= used.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    Gaolette_Record& record = record_of(id);
+    return record.in_use.load(std::memory_order_acquire) ? &record : nullptr;
+}
+
+int watch_gaolette(int id, uint32_t slot) noexcept {
+    if (id == Gao::protocol::ALL_GAOLETTES) {
+        watching_all.fetch_or(uint64_t{1} << slot, std::memory_order_acq_rel);
+        return 0;
+    }
+    Gaolette_Record* record = find_gaolette(id);
+    if (record == nullptr) {
+        return -1;
+    }
+    record->watchers.fetch_or(uint64_t{1} << slot, std::memory_order_acq_rel);
+    return 0;
+}
+
+int unwatch_gaolette(int id, uint32_t slot) noexcept {
+    if (id == Gao::protocol::ALL_GAOLETTES) {
+        watching_all.fetch_and(~(uint64_t{1} << slot), std::memory_order_acq_rel);
+        return 0;
+    }
+    Gaolette_Record* record = find_gaolette(id);
+    if (record == nullptr) {
+        return -1;
+    }
+    record->watchers.fetch_and(~(uint64_t{1} << slot), std::memory_order_acq_rel);
+    return 0;
+}
+
+void forget_watcher(uint32_t slot) noexcept {
+    const uint64_t keep = ~(uint64_t{1} << slot);
+    watching_all.fetch_and(keep, std::memory_order_acq_rel);
+    const int count = used.load(std::memory_order_acquire);
+    for (int id = 0; id < count; ++id) {
+        record_of(id).watchers.fetch_and(keep, std::memory_order_acq_rel);
+    }
+}
+
+uint32_t take_state_changes(State_Change_Record*& taken) noexcept {
+    util::Lock_Guard guard(changes_lock);
+    State_Change_Record* buffer = changes;
+    const uint32_t capacity = change_capacity;
+    const uint32_t count = change_count;
+    changes = spare_changes;
+    change_capacity = spare_capacity;
+    change_count = 0;
+    spare_changes = buffer;
+    spare_capacity = capacity;
+    taken = buffer;
+    return count;
+}
+
+void release_all_gaolettes() noexcept {
+    const int count = used.load(std::memory_order_acquire);
+    for (int id = 0; id < count; ++id) {
+        release_gaolette(id);
+    }
+}
@@ -0,0 +1,102 @@
+//
+// Created by David Yang on 2026-10-17.
+//
+
+#include "header/reactor.hpp"
+
+#include <errno.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+int Timer::open() noexcept {
+    fd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    return fd == -1 ? -1 : 0;
+}
+
+int Timer::arm(uint64_t delay_ns, uint64_t interval_ns) noexcept {
+    itimerspec spec{};
+    spec.it_value.tv_sec = static_cast<time_t>(delay_ns / 1000000000);
+    spec.it_value.tv_nsec = static_cast<long>(delay_ns % 1000000000);
+    spec.it_interval.tv_sec = static_cast<time_t>(interval_ns / 1000000000);
+    spec.it_interval.tv_nsec = static_cast<long>(interval_ns % 1000000000);
+    return ::timerfd_settime(fd, 0, &spec, nullptr);
+}
+
+uint64_t Timer::expirations() noexcept {
+    uint64_t count = 0;
+    if (::read(fd, &count, sizeof(count)) != sizeof(count)) {
+        return 0;
+    }
+    return count;
+}
+
+void Timer::close() noexcept {
+    if (fd != -1) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+Reactor::~Reactor() {
+    if (epoll_fd_ != -1) {
+        ::close(epoll_fd_);
+    }
+}
+
+int Reactor::init() noexcept {
+    if (epoll_fd_ != -1) {
+        return -1;
+    }
+    epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    return epoll_fd_ == -1 ? -1 : 0;
+}
+
+int Reactor::watch(Event_Source* source, uint32_t events) noexcept {
+    epoll_event event{};
+    event.events = events | EPOLLET;
+    event.data.ptr = source;
+    return ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, source->fd, &event);
+}
+
+int Reactor::unwatch(Event_Source* source) noexcept {
+    return ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, source->fd, nullptr);
+}
+
+int Reactor::run(bool (*idle)() noexcept) noexcept {
+    epoll_event events[MAX_EVENTS];
+    bool idle_pending = idle != nullptr;
+    stopping_ = false;
+
+    while (!stopping_) {
+        // only poll while there is idle work left, it runs exactly when nothing is ready
+        const int ready = ::epoll_wait(epoll_fd_, events, MAX_EVENTS, idle_pending ? 0 : -1);
+        if (ready == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (ready == 0) {
+            idle_pending = idle != nullptr && idle();
+            continue;
+        }
+
+        for (int i = 0; i < ready && !stopping_; ++i) {
+            auto* source = static_cast<Event_Source*>(events[i].data.ptr);
+            source->ready(source, events[i].events);
+        }
+        idle_pending = idle != nullptr;
+    }
+    return 0;
+}
+
+void Reactor::stop() noexcept {
+    stopping_ = true;
+}
+
+void Reactor::close() noexcept {
+    if (epoll_fd_ != -1) {
+        ::close(epoll_fd_);
+        epoll_fd_ = -1;
+    }
+}
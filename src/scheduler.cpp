@@ -0,0 +1,480 @@
+//
+// Created by David Yang on 2026-10-17.
+//
+
+#include "header/scheduler.hpp"
+#include "header/util.hpp"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <bit>
+
+Scheduler gaolette_scheduler;
+
+namespace {
+    // worker the calling thread is, submissions from a worker of the same scheduler skip the injection queue
+    thread_local const void* current_scheduler = nullptr;
+    thread_local uint32_t current_worker = 0;
+
+    constexpr int STEAL_ATTEMPTS = 4;   // rounds over all victims before going to sleep
+
+    uint64_t next_random(uint64_t& seed) noexcept {
+        // xorshift64, only used to spread thieves over victims
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        return seed;
+    }
+}
+
+bool Task_Group::admit(Task* task) noexcept {
+    task->holds_slot = false;
+    if (limit.load(std::memory_order_relaxed) == 0) {
+        return true;
+    }
+
+    util::Lock_Guard guard(lock);
+    if (running < limit.load(std::memory_order_relaxed)) {
+        ++running;
+        task->holds_slot = true;
+        return true;
+    }
+    task->next = nullptr;
+    if (parked_tail != nullptr) {
+        parked_tail->next = task;
+    } else {
+        parked_head = task;
+    }
+    parked_tail = task;
+    return false;
+}
+
+Task* Task_Group::retire() noexcept {
+    // whatever the limit is by now, the slot was taken under the one in force at admission
+    util::Lock_Guard guard(lock);
+    Task* next = parked_head;
+    if (next != nullptr) {
+        // the parked task takes over the finished task's slot, running stays the same
+        parked_head = next->next;
+        if (parked_head == nullptr) {
+            parked_tail = nullptr;
+        }
+        next->holds_slot = true;
+    } else {
+        --running;
+    }
+    return next;
+}
+
+Work_Deque::Array* Work_Deque::allocate(int64_t capacity) noexcept {
+    auto* array = static_cast<Array*>(::malloc(sizeof(Array) + (capacity - 1) * sizeof(std::atomic<Task*>)));
+    if (array == nullptr) {
+        return nullptr;
+    }
+    array->capacity = capacity;
+    array->retired = nullptr;
+    return array;
+}
+
+Work_Deque::~Work_Deque() {
+    Array* array = array_.load(std::memory_order_relaxed);
+    while (array != nullptr) {
+        Array* retired = array->retired;
+        ::free(array);
+        array = retired;
+    }
+}
+
+int Work_Deque::init() noexcept {
+    Array* array = allocate(INITIAL_CAPACITY);
+    if (array == nullptr) {
+        return -1;
+    }
+    array_.store(array, std::memory_order_relaxed);
+    return 0;
+}
+
+Work_Deque::Array* Work_Deque::grow(Array* array, int64_t bottom, int64_t top) noexcept {
+    Array* grown = allocate(array->capacity * 2);
+    if (grown == nullptr) {
+        return nullptr;
+    }
+    for (int64_t i = top; i < bottom; ++i) {
+        grown->slots[i & (grown->capacity - 1)].store(array->slots[i & (array->capacity - 1)].load(
+            std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    // thieves may still be reading the old array, it is only freed with the deque
+    grown->retired = array;
+    array_.store(grown, std::memory_order_release);
+    return grown;
+}
+
+int Work_Deque::push(Task* task) noexcept {
+    const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    const int64_t top = top_.load(std::memory_order_acquire);
+    Array* array = array_.load(std::memory_order_relaxed);
+
+    if (bottom - top > array->capacity - 1) {
+        array = grow(array, bottom, top);
+        if (array == nullptr) {
+            return -1;
+        }
+    }
+    array->slots[bottom & (array->capacity - 1)].store(task, std::memory_order_relaxed);
+    bottom_.store(bottom + 1, std::memory_order_release);
+    return 0;
+}
+
+Task* Work_Deque::pop() noexcept {
+    const int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    Array* array = array_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Task* task = array->slots[bottom & (array->capacity - 1)].load(std::memory_order_relaxed);
+    if (top == bottom) {
+        // last task, race the thieves for it
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            task = nullptr;
+        }
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return task;
+}
+
+Task* Work_Deque::steal() noexcept {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t bottom = bottom_.load(std::memory_order_acquire);
+
+    if (top >= bottom) {
+        return nullptr;
+    }
+    Array* array = array_.load(std::memory_order_acquire);
+    Task* task = array->slots[top & (array->capacity - 1)].load(std::memory_order_relaxed);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    return task;
+}
+
+Injection_Queue::~Injection_Queue() {
+    ::free(cells_);
+}
+
+int Injection_Queue::init(uint64_t capacity) noexcept {
+    if (cells_ != nullptr) {
+        return mask_ + 1 == capacity ? 0 : -1;
+    }
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+        return -1;
+    }
+    cells_ = static_cast<Cell*>(::malloc(capacity * sizeof(Cell)));
+    if (cells_ == nullptr) {
+        return -1;
+    }
+    for (uint64_t i = 0; i < capacity; ++i) {
+        new (&cells_[i].sequence) std::atomic<uint64_t>(i);
+        cells_[i].task = nullptr;
+    }
+    mask_ = capacity - 1;
+    return 0;
+}
+
+int Injection_Queue::push(Task* task) noexcept {
+    uint64_t position = enqueue_.load(std::memory_order_relaxed);
+    while (true) {
+        Cell& cell = cells_[position & mask_];
+        const uint64_t sequence = cell.sequence.load(std::memory_order_acquire);
+        const auto difference = static_cast<int64_t>(sequence - position);
+        if (difference == 0) {
+            if (enqueue_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                cell.task = task;
+                cell.sequence.store(position + 1, std::memory_order_release);
+                return 0;
+            }
+        } else if (difference < 0) {
+            return -1;  // full
+        } else {
+            position = enqueue_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+Task* Injection_Queue::pop() noexcept {
+    uint64_t position = dequeue_.load(std::memory_order_relaxed);
+    while (true) {
+        Cell& cell = cells_[position & mask_];
+        const uint64_t sequence = cell.sequence.load(std::memory_order_acquire);
+        const auto difference = static_cast<int64_t>(sequence - (position + 1));
+        if (difference == 0) {
+            if (dequeue_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                Task* task = cell.task;
+                cell.sequence.store(position + mask_ + 1, std::memory_order_release);
+                return task;
+            }
+        } else if (difference < 0) {
+            return nullptr;     // empty
+        } else {
+            position = dequeue_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+Scheduler::~Scheduler() {
+    stop();
+}
+
+int Scheduler::start(uint32_t workers, const cpu_set_t* cpus) noexcept {
+    if (workers_ != nullptr || workers == 0) {
+        return -1;
+    }
+    if (injection_.init(INJECTION_CAPACITY) == -1) {
+        return -1;
+    }
+
+    workers_ = static_cast<Worker*>(::malloc(workers * sizeof(Worker)));
+    if (workers_ == nullptr) {
+        return -1;
+    }
+    worker_count_ = workers;
+    stopping_.store(false, std::memory_order_relaxed);
+
+    for (uint32_t i = 0; i < workers; ++i) {
+        new (&workers_[i]) Worker();
+    }
+    for (uint32_t i = 0; i < workers; ++i) {
+        workers_[i].victim_seed = 0x9e3779b97f4a7c15ULL * (i + 1);
+        if (workers_[i].deque.init() == -1) {
+            stop();
+            return -1;
+        }
+    }
+    const int cpu_count = cpus != nullptr ? CPU_COUNT(cpus) : 0;
+    if (cpus != nullptr && cpu_count == 0) {
+        stop();
+        return -1;
+    }
+
+    int cpu = -1;
+    uint64_t nodes = 0;
+    for (uint32_t i = 0; cpus != nullptr && i < workers; ++i) {
+        do {
+            cpu = (cpu + 1) % CPU_SETSIZE;
+        } while (!CPU_ISSET(cpu, cpus));
+        workers_[i].cpu = cpu;
+        workers_[i].node = util::numa_node_of_cpu(cpu);
+        if (workers_[i].node >= 0 && workers_[i].node < util::MAX_NUMA_NODES) {
+            nodes |= uint64_t{1} << workers_[i].node;
+        } else {
+            workers_[i].node = -1;
+        }
+    }
+    // a single node has nothing to keep apart
+    if ((nodes & (nodes - 1)) != 0) {
+        for (int node = 0; node < util::MAX_NUMA_NODES; ++node) {
+            if ((nodes & (uint64_t{1} << node)) == 0) {
+                continue;
+            }
+            auto* queue = static_cast<Injection_Queue*>(::malloc(sizeof(Injection_Queue)));
+            if (queue == nullptr) {
+                stop();
+                return -1;
+            }
+            node_queues_[node] = new (queue) Injection_Queue();
+            if (queue->init(INJECTION_CAPACITY) == -1) {
+                stop();
+                return -1;
+            }
+        }
+        worker_nodes_ = nodes;
+    } else {
+        for (uint32_t i = 0; i < workers; ++i) {
+            workers_[i].node = -1;
+        }
+    }
+
+    // deques and queues are all set up before any worker may take from them
+    for (uint32_t i = 0; i < workers; ++i) {
+        cpu_set_t pinned;
+        Thread_Options options;
+        if (workers_[i].cpu != -1) {
+            CPU_ZERO(&pinned);
+            CPU_SET(workers_[i].cpu, &pinned);
+            options.affinity = &pinned;
+        }
+        workers_[i].thread = Thread(options, [this, i] { work(i); });
+        if (!workers_[i].thread.joinable()) {
+            stop();
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void Scheduler::stop() noexcept {
+    if (workers_ == nullptr) {
+        return;
+    }
+    stopping_.store(true, std::memory_order_seq_cst);
+    epoch_.fetch_add(1, std::memory_order_seq_cst);
+    util::futex_wake(&epoch_, static_cast<int>(worker_count_));
+
+    for (uint32_t i = 0; i < worker_count_; ++i) {
+        workers_[i].thread.join();
+    }
+    for (uint32_t i = 0; i < worker_count_; ++i) {
+        workers_[i].~Worker();
+    }
+    ::free(workers_);
+    workers_ = nullptr;
+    worker_count_ = 0;
+
+    for (Injection_Queue*& queue : node_queues_) {
+        if (queue != nullptr) {
+            queue->~Injection_Queue();
+            ::free(queue);
+            queue = nullptr;
+        }
+    }
+    worker_nodes_ = 0;
+}
+
+uint32_t Scheduler::worker_count() const noexcept {
+    return worker_count_;
+}
+
+uint64_t Scheduler::worker_nodes() const noexcept {
+    return worker_nodes_;
+}
+
+int Scheduler::next_worker_node() noexcept {
+    const uint64_t nodes = worker_nodes_;
+    if (nodes == 0) {
+        return -1;
+    }
+    // the turn-th set bit of nodes
+    uint32_t turn = next_node_.fetch_add(1, std::memory_order_relaxed) % static_cast<uint32_t>(std::popcount(nodes));
+    uint64_t rest = nodes;
+    while (turn-- != 0) {
+        rest &= rest - 1;
+    }
+    return std::countr_zero(rest);
+}
+
+int Scheduler::submit(Task* task) noexcept {
+    if (workers_ == nullptr || stopping_.load(std::memory_order_relaxed)) {
+        return -1;
+    }
+
+    // a worker keeps what it spawns close, everyone else goes through the injection queue; a task meant for
+    // another node than the submitter's waits for that node's workers, unless its queue is full
+    Worker* self = current_scheduler == this ? &workers_[current_worker] : nullptr;
+    const int node = task->group != nullptr ? task->group->node.load(std::memory_order_relaxed) : -1;
+    int queued = -1;
+    if (node >= 0 && node < util::MAX_NUMA_NODES && node_queues_[node] != nullptr
+        && (self == nullptr || self->node != node)) {
+        queued = node_queues_[node]->push(task);
+    }
+    if (queued == -1) {
+        queued = self != nullptr ? self->deque.push(task) : injection_.push(task);
+    }
+    if (queued == -1) {
+        return -1;
+    }
+    wake();
+    return 0;
+}
+
+void Scheduler::wake() noexcept {
+    epoch_.fetch_add(1, std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_seq_cst) != 0) {
+        util::futex_wake(&epoch_, 1);
+    }
+}
+
+Task* Scheduler::find_task(uint32_t index) noexcept {
+    Worker& self = workers_[index];
+    if (Task* task = self.deque.pop()) {
+        return task;
+    }
+    if (self.node != -1) {
+        if (Task* task = node_queues_[self.node]->pop()) {
+            return task;
+        }
+    }
+    if (Task* task = injection_.pop()) {
+        return task;
+    }
+
+    for (int attempt = 0; attempt < STEAL_ATTEMPTS && worker_count_ > 1; ++attempt) {
+        const auto first = static_cast<uint32_t>(next_random(self.victim_seed) % worker_count_);
+        for (uint32_t offset = 0; offset < worker_count_; ++offset) {
+            const uint32_t victim = (first + offset) % worker_count_;
+            if (victim == index) {
+                continue;
+            }
+            if (Task* task = workers_[victim].deque.steal()) {
+                return task;
+            }
+        }
+    }
+
+    // wake only ever picks some sleeper, so whoever woke up takes a task left to another node rather than
+    // leave it waiting for workers that may all be asleep
+    for (Injection_Queue* queue : node_queues_) {
+        if (queue != nullptr) {
+            if (Task* task = queue->pop()) {
+                return task;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void Scheduler::execute(Task* task) noexcept {
+    if (task->group != nullptr && !task->group->admit(task)) {
+        return;     // parked, whoever finishes one of the group's tasks runs it
+    }
+
+    while (task != nullptr) {
+        Task_Group* group = task->group;
+        const bool holds_slot = group != nullptr && task->holds_slot;
+        task->run(task);    // task may be gone once run returns
+        task = holds_slot ? group->retire() : nullptr;
+    }
+}
+
+void Scheduler::work(uint32_t index) noexcept {
+    current_scheduler = this;
+    current_worker = index;
+
+    while (!stopping_.load(std::memory_order_acquire)) {
+        if (Task* task = find_task(index)) {
+            execute(task);
+            continue;
+        }
+
+        // announce the nap, then look once more so a submission racing with it can't be missed
+        const uint32_t epoch = epoch_.load(std::memory_order_seq_cst);
+        sleepers_.fetch_add(1, std::memory_order_seq_cst);
+        if (Task* task = find_task(index)) {
+            sleepers_.fetch_sub(1, std::memory_order_relaxed);
+            execute(task);
+            continue;
+        }
+        if (!stopping_.load(std::memory_order_acquire)) {
+            util::futex_wait(&epoch_, epoch);
+        }
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    current_scheduler = nullptr;
+}
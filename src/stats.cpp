@@ -0,0 +1,19 @@
+//
+// Created by David Yang on 2026-10-17.
+//
+
+#include "header/stats.hpp"
+
+Runtime_Stats runtime_stats;
+
+void snapshot_stats(Gao::protocol::Stats_Payload& payload) noexcept {
+    for (uint32_t i = 0; i < Gao::protocol::STATS_OPCODES; ++i) {
+        payload.queue[i] = runtime_stats.queue[i].summary();
+        payload.execute[i] = runtime_stats.execute[i].summary();
+    }
+    payload.map = runtime_stats.map.summary();
+    payload.unmap = runtime_stats.unmap.summary();
+    payload.requests = runtime_stats.requests.load(std::memory_order_relaxed);
+    payload.failures = runtime_stats.failures.load(std::memory_order_relaxed);
+    payload.offloaded = runtime_stats.offloaded.load(std::memory_order_relaxed);
+}
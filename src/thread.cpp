@@ -2,8 +2,99 @@
 // Created by David Yang on 2025-10-10.
 //
 #include "header/thread.hpp"
+#include "header/util.hpp"
 
-template<typename Ret, typename... Args>
-Thread::Thread(Ret (*func_pointer)(Args...), Args... args) : func_pointer_(func_pointer(args)) {
+void Thread::release(Start* start) noexcept {
+    start->taken.store(1, std::memory_order_release);
+    util::futex_wake(&start->taken, 1);
+}
+
+void* Thread::trampoline(void* start) noexcept {
+    Start* handed = static_cast<Start*>(start);
+    handed->run(handed);
+    return nullptr;
+}
+
+void Thread::launch(Start& start, const Thread_Options& options) noexcept {
+    pthread_attr_t attributes;
+    if (pthread_attr_init(&attributes) != 0) {
+        return;
+    }
+
+    bool configured = true;
+    if (options.affinity != nullptr) {
+        configured = pthread_attr_setaffinity_np(&attributes, sizeof(cpu_set_t), options.affinity) == 0;
+    }
+    if (configured && options.policy != -1) {
+        sched_param parameters{};
+        parameters.sched_priority = options.priority;
+        configured = pthread_attr_setinheritsched(&attributes, PTHREAD_EXPLICIT_SCHED) == 0
+                     && pthread_attr_setschedpolicy(&attributes, options.policy) == 0
+                     && pthread_attr_setschedparam(&attributes, &parameters) == 0;
+    }
+
+    // e.g. EPERM for a real time policy without CAP_SYS_NICE, the thread is not started at all then
+    if (configured && pthread_create(&thread_, &attributes, &Thread::trampoline, &start) == 0) {
+        joinable_ = true;
+        // the callable lives in our caller's frame until the new thread has moved it out
+        while (start.taken.load(std::memory_order_acquire) == 0) {
+            util::futex_wait(&start.taken, 0);
+        }
+    }
+    pthread_attr_destroy(&attributes);
+}
+
+Thread::Thread(Thread&& other) noexcept
+    : thread_(other.thread_), joinable_(other.joinable_), detach_on_destroy_(other.detach_on_destroy_) {
+    other.joinable_ = false;
+}
+
+Thread& Thread::operator=(Thread&& other) noexcept {
+    if (this != &other) {
+        if (detach_on_destroy_) {
+            detach();
+        } else {
+            join();
+        }
+        thread_ = other.thread_;
+        joinable_ = other.joinable_;
+        detach_on_destroy_ = other.detach_on_destroy_;
+        other.joinable_ = false;
+    }
+    return *this;
+}
+
+int Thread::join() noexcept {
+    if (!joinable_) {
+        return -1;
+    }
+    joinable_ = false;
+    return pthread_join(thread_, nullptr) == 0 ? 0 : -1;
+}
+
+int Thread::detach() noexcept {
+    if (!joinable_) {
+        return -1;
+    }
+    joinable_ = false;
+    return pthread_detach(thread_) == 0 ? 0 : -1;
+}
+
+bool Thread::joinable() const noexcept {
+    return joinable_;
+}
+
+int Thread::set_affinity(const cpu_set_t& cpus) noexcept {
+    if (!joinable_) {
+        return -1;
+    }
+    return pthread_setaffinity_np(thread_, sizeof(cpu_set_t), &cpus) == 0 ? 0 : -1;
+}
 
+Thread::~Thread() {
+    if (detach_on_destroy_) {
+        detach();
+    } else {
+        join();
+    }
 }
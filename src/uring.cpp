@@ -0,0 +1,231 @@
+//
+// Created by David Yang on 2026-10-17.
+//
+
+#include "header/uring.hpp"
+#include "header/util.hpp"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include <atomic>
+
+namespace {
+    int io_uring_setup(uint32_t entries, io_uring_params* params) noexcept {
+        return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int io_uring_enter(int fd, uint32_t submit, uint32_t wait, uint32_t flags) noexcept {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, fd, submit, wait, flags, nullptr, 0));
+    }
+
+    int io_uring_register(int fd, uint32_t opcode, void* argument, uint32_t count) noexcept {
+        return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, argument, count));
+    }
+
+    // the rings are shared with the kernel, its side of every index is read and written atomically
+    uint32_t load_acquire(uint32_t* index) noexcept {
+        return std::atomic_ref<uint32_t>(*index).load(std::memory_order_acquire);
+    }
+
+    void store_release(uint32_t* index, uint32_t value) noexcept {
+        std::atomic_ref<uint32_t>(*index).store(value, std::memory_order_release);
+    }
+
+    template <typename T>
+    T* at(void* base, uint32_t offset) noexcept {
+        return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+    }
+}
+
+Uring::~Uring() {
+    close();
+}
+
+bool Uring::supported() noexcept {
+    static const bool available = [] {
+        utsname name{};
+        if (::uname(&name) == -1) {
+            return false;
+        }
+        char* minor = nullptr;
+        const long major = ::strtol(name.release, &minor, 10);
+        return major >= 6 && *minor == '.';
+    }();
+    return available;
+}
+
+int Uring::init(uint32_t entries) noexcept {
+    if (fd_ != -1 || !supported()) {
+        return -1;
+    }
+
+    // only this thread submits, and completion work is deferred to our own io_uring_enter instead of
+    // interrupting whatever we are doing; older kernels get a plain ring
+    io_uring_params params{};
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+    params.cq_entries = entries * 4;
+    fd_ = io_uring_setup(entries, &params);
+    if (fd_ == -1 && errno == EINVAL) {
+        params = io_uring_params{};
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = entries * 4;
+        fd_ = io_uring_setup(entries, &params);
+    }
+    if (fd_ == -1) {
+        return -1;
+    }
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) == 0 || (params.features & IORING_FEAT_NODROP) == 0) {
+        close();
+        return -1;
+    }
+
+    const size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    const size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    rings_size_ = sq_size > cq_size ? sq_size : cq_size;
+    rings_ = ::mmap(nullptr, rings_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                    IORING_OFF_SQ_RING);
+    if (rings_ == MAP_FAILED) {
+        rings_ = nullptr;
+        close();
+        return -1;
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                        IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        close();
+        return -1;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    sq_head_ = at<uint32_t>(rings_, params.sq_off.head);
+    sq_tail_ = at<uint32_t>(rings_, params.sq_off.tail);
+    sq_array_ = at<uint32_t>(rings_, params.sq_off.array);
+    sq_mask_ = *at<uint32_t>(rings_, params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+    sq_local_tail_ = *sq_tail_;
+
+    cq_head_ = at<uint32_t>(rings_, params.cq_off.head);
+    cq_tail_ = at<uint32_t>(rings_, params.cq_off.tail);
+    cqes_ = at<io_uring_cqe>(rings_, params.cq_off.cqes);
+    cq_mask_ = *at<uint32_t>(rings_, params.cq_off.ring_mask);
+
+    // sqes are always handed out in ring order, so the indirection array is the identity
+    for (uint32_t i = 0; i < sq_entries_; ++i) {
+        sq_array_[i] = i;
+    }
+    return 0;
+}
+
+int Uring::provide_buffers(uint16_t group, uint32_t count, uint32_t size) noexcept {
+    if (fd_ == -1 || buffer_ring_ != nullptr || count == 0 || (count & (count - 1)) != 0 || count > 32768) {
+        return -1;
+    }
+
+    // the ring of descriptors has to be page aligned, the buffers follow it in the same mapping
+    const size_t ring_size = util::page_round(count * sizeof(io_uring_buf));
+    buffer_mapping_size_ = ring_size + static_cast<size_t>(count) * size;
+    void* memory = ::mmap(nullptr, buffer_mapping_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return -1;
+    }
+
+    io_uring_buf_reg registration{};
+    registration.ring_addr = reinterpret_cast<uint64_t>(memory);
+    registration.ring_entries = count;
+    registration.bgid = group;
+    if (io_uring_register(fd_, IORING_REGISTER_PBUF_RING, &registration, 1) == -1) {
+        ::munmap(memory, buffer_mapping_size_);
+        return -1;
+    }
+
+    buffer_ring_ = static_cast<io_uring_buf_ring*>(memory);
+    buffer_memory_ = static_cast<char*>(memory) + ring_size;
+    buffer_count_ = count;
+    buffer_size_ = size;
+    buffer_tail_ = 0;
+    for (uint32_t id = 0; id < count; ++id) {
+        recycle(static_cast<uint16_t>(id));
+    }
+    return 0;
+}
+
+io_uring_sqe* Uring::next_sqe() noexcept {
+    if (sq_local_tail_ - load_acquire(sq_head_) == sq_entries_) {
+        if (submit(0) == -1 || sq_local_tail_ - load_acquire(sq_head_) == sq_entries_) {
+            return nullptr;
+        }
+    }
+    io_uring_sqe* sqe = &sqes_[sq_local_tail_ & sq_mask_];
+    ::memset(sqe, 0, sizeof(*sqe));
+    ++sq_local_tail_;
+    return sqe;
+}
+
+uint32_t Uring::publish() noexcept {
+    const uint32_t pending = sq_local_tail_ - *sq_tail_;
+    store_release(sq_tail_, sq_local_tail_);
+    return pending;
+}
+
+int Uring::submit(uint32_t wait) noexcept {
+    // always entered, deferred completions are only posted from within io_uring_enter
+    if (io_uring_enter(fd_, publish(), wait, IORING_ENTER_GETEVENTS) == -1) {
+        // EINTR, or EBUSY/EAGAIN while completions are backed up, both cleared by reaping what is there
+        return errno == EINTR || errno == EBUSY || errno == EAGAIN ? 0 : -1;
+    }
+    return 0;
+}
+
+io_uring_cqe* Uring::peek() noexcept {
+    const uint32_t head = *cq_head_;
+    if (head == load_acquire(cq_tail_)) {
+        return nullptr;
+    }
+    return &cqes_[head & cq_mask_];
+}
+
+void Uring::advance() noexcept {
+    store_release(cq_head_, *cq_head_ + 1);
+}
+
+const char* Uring::buffer(uint16_t id) const noexcept {
+    return buffer_memory_ + static_cast<size_t>(id) * buffer_size_;
+}
+
+void Uring::recycle(uint16_t id) noexcept {
+    // bufs is declared as a flexible array behind an empty struct, which C++ gives a size, so the
+    // ring is indexed by hand; entry 0 starts at the ring like it does in C
+    io_uring_buf& entry = reinterpret_cast<io_uring_buf*>(buffer_ring_)[buffer_tail_ & (buffer_count_ - 1)];
+    entry.addr = reinterpret_cast<uint64_t>(buffer(id));
+    entry.len = buffer_size_;
+    entry.bid = id;
+    ++buffer_tail_;
+    std::atomic_ref<uint16_t>(buffer_ring_->tail).store(buffer_tail_, std::memory_order_release);
+}
+
+void Uring::close() noexcept {
+    if (sqes_ != nullptr) {
+        ::munmap(sqes_, sqes_size_);
+        sqes_ = nullptr;
+    }
+    if (rings_ != nullptr) {
+        ::munmap(rings_, rings_size_);
+        rings_ = nullptr;
+    }
+    if (fd_ != -1) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    // unregistered along with the ring
+    if (buffer_ring_ != nullptr) {
+        ::munmap(buffer_ring_, buffer_mapping_size_);
+        buffer_ring_ = nullptr;
+    }
+}
@@ -2,4 +2,357 @@
 // Created by David Yang on 2025-10-10.
 //
 
-#include "header/util.hpp"
\ No newline at end of file
+#include "header/util.hpp"
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace util {
+    namespace {
+        constexpr uint8_t FREE = 0x80;
+        constexpr uint8_t USED = 0x40;
+        constexpr uint8_t ORDER_MASK = 0x3f;
+
+        int ceil_log2(size_t n) noexcept {
+            int order = 0;
+            while ((static_cast<size_t>(1) << order) < n) {
+                ++order;
+            }
+            return order;
+        }
+
+        // reads a small procfs/sysfs file into buffer as a NUL terminated string, returns -1 on error
+        ssize_t read_file(const char* path, char* buffer, size_t capacity) noexcept {
+            const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+            if (fd == -1) {
+                return -1;
+            }
+            size_t total = 0;
+            while (total + 1 < capacity) {
+                const ssize_t n = ::read(fd, buffer + total, capacity - 1 - total);
+                if (n <= 0) {
+                    break;
+                }
+                total += static_cast<size_t>(n);
+            }
+            ::close(fd);
+            buffer[total] = '\0';
+            return static_cast<ssize_t>(total);
+        }
+
+        // calls add with every number of a sysfs list such as "0-3,8,10-11"
+        template <typename Add>
+        void parse_list(const char* list, Add add) noexcept {
+            char* end = nullptr;
+            while (*list >= '0' && *list <= '9') {
+                const unsigned long first = ::strtoul(list, &end, 10);
+                unsigned long last = first;
+                if (*end == '-') {
+                    last = ::strtoul(end + 1, &end, 10);
+                }
+                for (unsigned long n = first; n <= last; ++n) {
+                    add(n);
+                }
+                list = *end == ',' ? end + 1 : end;
+            }
+        }
+    }
+
+    size_t page_round(size_t size) noexcept {
+        static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        return (size + page - 1) & ~(page - 1);
+    }
+
+    size_t round_up(size_t size, size_t granule) noexcept {
+        return (size + granule - 1) & ~(granule - 1);
+    }
+
+    size_t huge_page_size() noexcept {
+        static const size_t size = [] {
+            char buffer[4096];
+            if (read_file("/proc/meminfo", buffer, sizeof(buffer)) > 0) {
+                if (const char* line = ::strstr(buffer, "Hugepagesize:")) {
+                    const size_t kib = ::strtoull(line + sizeof("Hugepagesize:") - 1, nullptr, 10);
+                    if (kib != 0 && (kib & (kib - 1)) == 0) {
+                        return kib * 1024;
+                    }
+                }
+            }
+            return static_cast<size_t>(2) << 20;
+        }();
+        return size;
+    }
+
+    bool transparent_huge_pages() noexcept {
+        static const bool available = [] {
+            char buffer[128];
+            if (read_file("/sys/kernel/mm/transparent_hugepage/enabled", buffer, sizeof(buffer)) <= 0) {
+                return false;
+            }
+            return ::strstr(buffer, "[never]") == nullptr;
+        }();
+        return available;
+    }
+
+    uint64_t numa_nodes() noexcept {
+        static const uint64_t nodes = [] {
+            char buffer[256];
+            uint64_t online = 0;
+            if (read_file("/sys/devices/system/node/online", buffer, sizeof(buffer)) > 0) {
+                parse_list(buffer, [&](unsigned long node) {
+                    if (node < MAX_NUMA_NODES) {
+                        online |= uint64_t{1} << node;
+                    }
+                });
+            }
+            return online != 0 ? online : uint64_t{1};
+        }();
+        return nodes;
+    }
+
+    int numa_node_of_cpu(int cpu) noexcept {
+        // every node lists its CPUs, they are all looked up at once
+        struct Table {
+            int8_t node[CPU_SETSIZE];
+        };
+        static const Table table = [] {
+            Table result;
+            ::memset(result.node, -1, sizeof(result.node));
+            for (int node = 0; node < MAX_NUMA_NODES; ++node) {
+                char path[64];
+                char buffer[1024];
+                if ((numa_nodes() & (uint64_t{1} << node)) == 0) {
+                    continue;
+                }
+                ::snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+                if (read_file(path, buffer, sizeof(buffer)) > 0) {
+                    parse_list(buffer, [&](unsigned long each) {
+                        if (each < CPU_SETSIZE) {
+                            result.node[each] = static_cast<int8_t>(node);
+                        }
+                    });
+                }
+            }
+            return result;
+        }();
+        return cpu >= 0 && cpu < CPU_SETSIZE ? table.node[cpu] : -1;
+    }
+
+    int bind_memory(void* base, size_t size, int mode, uint64_t nodes) noexcept {
+        // the kernel reads one bit less than maxnode says
+        const unsigned long mask = nodes;
+        const unsigned long max_node = mode == MPOL_DEFAULT ? 0 : MAX_NUMA_NODES + 1;
+        return static_cast<int>(::syscall(SYS_mbind, base, size, mode, mode == MPOL_DEFAULT ? nullptr : &mask,
+                                          max_node, 0));
+    }
+
+    void Spin_Lock::lock() noexcept {
+        int spins = 0;
+        while (flag_.test_and_set(std::memory_order_acquire)) {
+            while (flag_.test(std::memory_order_relaxed)) {
+                // the holder may be preempted, give it the CPU instead of burning the time slice
+                if (++spins == 64) {
+                    ::sched_yield();
+                    spins = 0;
+                }
+            }
+        }
+    }
+
+    void Spin_Lock::unlock() noexcept {
+        flag_.clear(std::memory_order_release);
+    }
+
+    void futex_wait(std::atomic<uint32_t>* word, uint32_t expected) noexcept {
+        ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+    }
+
+    void futex_wake(std::atomic<uint32_t>* word, int count) noexcept {
+        ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+    }
+
+    Allocator::~Allocator() {
+        if (base_ != nullptr) {
+            ::munmap(base_, reservation_);
+            ::munmap(next_, meta_size_);
+        }
+    }
+
+    int Allocator::order_for(size_t size) noexcept {
+        return ceil_log2((size + (static_cast<size_t>(1) << MIN_BLOCK_SHIFT) - 1) >> MIN_BLOCK_SHIFT);
+    }
+
+    void Allocator::push_free(uint32_t block, int order) noexcept {
+        state_[block] = FREE | static_cast<uint8_t>(order);
+        prev_[block] = NIL;
+        next_[block] = free_head_[order];
+        if (free_head_[order] != NIL) {
+            prev_[free_head_[order]] = block;
+        }
+        free_head_[order] = block;
+    }
+
+    void Allocator::remove_free(uint32_t block, int order) noexcept {
+        if (prev_[block] != NIL) {
+            next_[prev_[block]] = next_[block];
+        } else {
+            free_head_[order] = next_[block];
+        }
+        if (next_[block] != NIL) {
+            prev_[next_[block]] = prev_[block];
+        }
+        state_[block] = 0;
+    }
+
+    int Allocator::reserve(size_t reservation) noexcept {
+        if (base_ != nullptr || reservation < (static_cast<size_t>(1) << MIN_BLOCK_SHIFT)) {
+            return -1;
+        }
+
+        // the buddy system wants a power of two number of blocks
+        int order = 0;
+        while ((static_cast<size_t>(2) << (order + MIN_BLOCK_SHIFT)) <= reservation && order + 1 < MAX_ORDERS
+               && (static_cast<size_t>(2) << order) <= NIL) {
+            ++order;
+        }
+        reservation = static_cast<size_t>(1) << (order + MIN_BLOCK_SHIFT);
+        const size_t blocks = static_cast<size_t>(1) << order;
+
+        // over-reserve so the start can be aligned, then hand the slack on either side back
+        const size_t alignment = reservation < BASE_ALIGNMENT ? reservation : BASE_ALIGNMENT;
+        void* mapping = ::mmap(nullptr, reservation + alignment, PROT_NONE,
+                               MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (mapping == MAP_FAILED) {
+            return -1;
+        }
+        char* base = static_cast<char*>(mapping);
+        char* aligned = reinterpret_cast<char*>(round_up(reinterpret_cast<uintptr_t>(base), alignment));
+        if (aligned != base) {
+            ::munmap(base, aligned - base);
+        }
+        if (aligned + reservation != base + reservation + alignment) {
+            ::munmap(aligned + reservation, base + alignment - aligned);
+        }
+
+        // bookkeeping is only faulted in for blocks that are actually used
+        meta_size_ = page_round(blocks * (sizeof(uint8_t) + 2 * sizeof(uint32_t)));
+        void* meta = ::mmap(nullptr, meta_size_, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (meta == MAP_FAILED) {
+            ::munmap(aligned, reservation);
+            return -1;
+        }
+
+        base_ = aligned;
+        reservation_ = reservation;
+        max_order_ = order;
+        next_ = static_cast<uint32_t*>(meta);
+        prev_ = next_ + blocks;
+        state_ = reinterpret_cast<uint8_t*>(prev_ + blocks);
+
+        for (uint32_t& head : free_head_) {
+            head = NIL;
+        }
+        push_free(0, max_order_);
+        return 0;
+    }
+
+    bool Allocator::reserved() const noexcept {
+        return base_ != nullptr;
+    }
+
+    bool Allocator::owns(const void* ptr) const noexcept {
+        const char* p = static_cast<const char*>(ptr);
+        return base_ != nullptr && p >= base_ && p < base_ + reservation_;
+    }
+
+    size_t Allocator::fit(size_t size) noexcept {
+        return static_cast<size_t>(1) << (order_for(size) + MIN_BLOCK_SHIFT);
+    }
+
+    void* Allocator::allocate(size_t size) noexcept {
+        if (base_ == nullptr || size == 0) {
+            return nullptr;
+        }
+
+        const int order = order_for(size);
+        int found = order;
+        while (found <= max_order_ && free_head_[found] == NIL) {
+            ++found;
+        }
+        if (found > max_order_) {
+            return nullptr;
+        }
+
+        const uint32_t block = free_head_[found];
+        remove_free(block, found);
+
+        // split until the block is just big enough, upper halves go back on the free lists
+        while (found > order) {
+            --found;
+            push_free(block + (static_cast<uint32_t>(1) << found), found);
+        }
+
+        state_[block] = USED | static_cast<uint8_t>(order);
+        return base_ + (static_cast<size_t>(block) << MIN_BLOCK_SHIFT);
+    }
+
+    void Allocator::deallocate(void* ptr) noexcept {
+        if (!owns(ptr)) {
+            return;
+        }
+
+        uint32_t block = static_cast<uint32_t>((static_cast<char*>(ptr) - base_) >> MIN_BLOCK_SHIFT);
+        if ((state_[block] & USED) == 0) {
+            return;
+        }
+        int order = state_[block] & ORDER_MASK;
+        state_[block] = 0;
+
+        // merge with the buddy for as long as it is free and whole
+        while (order < max_order_) {
+            const uint32_t buddy = block ^ (static_cast<uint32_t>(1) << order);
+            if (state_[buddy] != (FREE | order)) {
+                break;
+            }
+            remove_free(buddy, order);
+            block = block < buddy ? block : buddy;
+            ++order;
+        }
+        push_free(block, order);
+    }
+
+    size_t Allocator::block_size(const void* ptr) const noexcept {
+        if (!owns(ptr)) {
+            return 0;
+        }
+        const auto block = static_cast<uint32_t>((static_cast<const char*>(ptr) - base_) >> MIN_BLOCK_SHIFT);
+        return static_cast<size_t>(1) << ((state_[block] & ORDER_MASK) + MIN_BLOCK_SHIFT);
+    }
+
+    int Allocator::commit(void* ptr, size_t size) noexcept {
+        return ::mprotect(ptr, page_round(size), PROT_READ | PROT_WRITE);
+    }
+
+    int Allocator::decommit(void* ptr, size_t size) noexcept {
+        size = page_round(size);
+        if (::madvise(ptr, size, MADV_DONTNEED) == -1) {
+            return -1;
+        }
+        return ::mprotect(ptr, size, PROT_NONE);
+    }
+
+    int Allocator::discard(void* ptr, size_t size) noexcept {
+        void* mapping = ::mmap(ptr, page_round(size), PROT_NONE,
+                               MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+        return mapping == MAP_FAILED ? -1 : 0;
+    }
+}
@@ -0,0 +1,144 @@
+//
+// Created by David Yang on 2026-10-17.
+//
+
+// util::Allocator: blocks split down to the requested size, merge back with their buddies and run out once the
+// reservation is used up.
+
+#include "check.hpp"
+
+#include <util.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+    constexpr std::size_t BLOCK = std::size_t{64} << 10;   // smallest block handed out
+    constexpr std::size_t RESERVATION = 16 * BLOCK;
+
+    bool aligned_to_size(const util::Allocator& allocator, const void* block) {
+        return reinterpret_cast<std::uintptr_t>(block) % allocator.block_size(block) == 0;
+    }
+
+    void test_fit() {
+        CHECK(util::Allocator::fit(1) == BLOCK);
+        CHECK(util::Allocator::fit(BLOCK) == BLOCK);
+        CHECK(util::Allocator::fit(BLOCK + 1) == 2 * BLOCK);
+        CHECK(util::Allocator::fit(5 * BLOCK) == 8 * BLOCK);
+    }
+
+    void test_reserve() {
+        util::Allocator allocator;
+        CHECK(!allocator.reserved());
+        CHECK(allocator.allocate(BLOCK) == nullptr);
+        CHECK(allocator.reserve(BLOCK - 1) == -1);
+
+        // rounded down to a power of two, the remainder is never handed out
+        CHECK(allocator.reserve(RESERVATION + BLOCK) == 0);
+        CHECK(allocator.reserved());
+        CHECK(allocator.reserve(RESERVATION) == -1);
+        void* whole = allocator.allocate(RESERVATION);
+        CHECK(whole != nullptr);
+        CHECK(allocator.allocate(BLOCK) == nullptr);
+        allocator.deallocate(whole);
+    }
+
+    void test_split() {
+        util::Allocator allocator;
+        CHECK(allocator.reserve(RESERVATION) == 0);
+        CHECK(allocator.allocate(0) == nullptr);
+
+        // the first small block splits the reservation, the upper halves stay free for larger requests
+        void* small = allocator.allocate(1);
+        CHECK(small != nullptr);
+        CHECK(allocator.block_size(small) == BLOCK);
+        void* half = allocator.allocate(RESERVATION / 2);
+        CHECK(half != nullptr);
+        CHECK(allocator.block_size(half) == RESERVATION / 2);
+        CHECK(allocator.allocate(RESERVATION / 2) == nullptr);
+        void* quarter = allocator.allocate(RESERVATION / 4);
+        CHECK(quarter != nullptr);
+
+        for (void* block : {small, half, quarter}) {
+            CHECK(allocator.owns(block));
+            CHECK(aligned_to_size(allocator, block));
+        }
+        // none of them overlap
+        const auto* low = static_cast<const char*>(small);
+        const auto* upper = static_cast<const char*>(half);
+        const auto* middle = static_cast<const char*>(quarter);
+        CHECK(upper >= low + BLOCK || upper + RESERVATION / 2 <= low);
+        CHECK(middle + RESERVATION / 4 <= upper || middle >= upper + RESERVATION / 2);
+        CHECK(middle >= low + BLOCK || middle + RESERVATION / 4 <= low);
+
+        allocator.deallocate(small);
+        allocator.deallocate(quarter);
+        allocator.deallocate(half);
+        CHECK(allocator.allocate(RESERVATION) != nullptr);
+    }
+
+    void test_exhaustion_and_merge() {
+        util::Allocator allocator;
+        CHECK(allocator.reserve(RESERVATION) == 0);
+
+        std::vector<void*> blocks;
+        while (void* block = allocator.allocate(BLOCK)) {
+            blocks.push_back(block);
+        }
+        CHECK(blocks.size() == RESERVATION / BLOCK);
+        CHECK(allocator.allocate(1) == nullptr);
+
+        // freeing every other block leaves nothing larger than a single block to merge into
+        for (std::size_t i = 0; i < blocks.size(); i += 2) {
+            allocator.deallocate(blocks[i]);
+        }
+        CHECK(allocator.allocate(2 * BLOCK) == nullptr);
+        void* single = allocator.allocate(BLOCK);
+        const auto reused = static_cast<std::size_t>(std::find(blocks.begin(), blocks.end(), single) - blocks.begin());
+        CHECK(reused < blocks.size() && reused % 2 == 0);
+        allocator.deallocate(single);
+
+        // the odd ones complete every buddy pair, all the way up to the whole reservation
+        for (std::size_t i = 1; i < blocks.size(); i += 2) {
+            allocator.deallocate(blocks[i]);
+        }
+        void* whole = allocator.allocate(RESERVATION);
+        CHECK(whole != nullptr);
+        CHECK(allocator.block_size(whole) == RESERVATION);
+
+        // foreign and repeated frees are ignored
+        int outside = 0;
+        allocator.deallocate(&outside);
+        allocator.deallocate(whole);
+        allocator.deallocate(whole);
+        CHECK(allocator.allocate(RESERVATION) == whole);
+    }
+
+    void test_commit() {
+        util::Allocator allocator;
+        CHECK(allocator.reserve(RESERVATION) == 0);
+        auto* block = static_cast<unsigned char*>(allocator.allocate(2 * BLOCK));
+        CHECK(block != nullptr);
+
+        CHECK(util::Allocator::commit(block, 2 * BLOCK) == 0);
+        std::memset(block, 0xab, 2 * BLOCK);
+        CHECK(util::Allocator::decommit(block, 2 * BLOCK) == 0);
+
+        // pages come back zeroed once committed again
+        CHECK(util::Allocator::commit(block, 2 * BLOCK) == 0);
+        CHECK(block[0] == 0 && block[2 * BLOCK - 1] == 0);
+        CHECK(util::Allocator::decommit(block, 2 * BLOCK) == 0);
+        allocator.deallocate(block);
+    }
+}
+
+int main() {
+    test_fit();
+    test_reserve();
+    test_split();
+    test_exhaustion_and_merge();
+    test_commit();
+    return check::result();
+}
@@ -0,0 +1,34 @@
+//
+// Created by David Yang on 2026-10-17.
+//
+
+#ifndef GAO_TESTS_CHECK_HPP
+#define GAO_TESTS_CHECK_HPP
+
+// Checks shared by the unit tests. Unlike assert they survive NDEBUG, a failed check is reported and the test
+// carries on, main returns check::result() so ctest sees whether any of them failed.
+
+#include <cstdio>
+
+namespace check {
+    inline int failures = 0;
+
+    inline void report(const bool passed, const char* condition, const char* file, const int line) {
+        if (!passed) {
+            ++failures;
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, condition);
+        }
+    }
+
+    inline int result() {
+        if (failures != 0) {
+            std::fprintf(stderr, "%d check(s) failed\n", failures);
+            return 1;
+        }
+        return 0;
+    }
+}
+
+#define CHECK(condition) ::check::report(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
+
+#endif //GAO_TESTS_CHECK_HPP
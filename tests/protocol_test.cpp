@@ -0,0 +1,205 @@
+//
+// Created by David Yang on 2026-10-17.
+//
+
+// Round trips against the Gao_Runtime found through GAO_BIN_DIR, over the socket and the shared memory rings,
+// and against the embedded runtime; each with and without workers: every command answers with its own opcode and
+// request id, malformed requests are turned away without losing the connection, pipelined replies are claimed
+// in any order, replies keep flowing while the requests pile up behind them and pushed state changes are
+// coalesced until dispatched.
+
+#include "check.hpp"
+
+#include <single_include/Gao.hpp>
+
+#include <cstring>
+#include <vector>
+
+namespace {
+    using namespace Gao;
+
+    constexpr std::size_t SIZE = std::size_t{1} << 20;
+
+    Perf_Spec spec(const Memory_Policy policy = Memory_Policy::STATIC, const std::size_t max = SIZE) {
+        return Perf_Spec{SIZE, policy, max, 1, Page_Size::DEFAULT, Numa_Policy::FIRST_TOUCH, 0};
+    }
+
+    bool answers(const Orchestrator::Reply& reply, const protocol::Opcode opcode, const std::uint32_t request_id,
+                 const protocol::Status status) {
+        return reply.header.magic == protocol::MAGIC && (reply.header.flags & protocol::FLAG_REPLY) != 0
+               && reply.header.opcode == static_cast<std::uint16_t>(opcode) && reply.header.request_id == request_id
+               && reply.header.status == static_cast<std::uint16_t>(status) && reply.payload.size() == reply.header.length;
+    }
+
+    void test_lifecycle(const Orchestrator& gao) {
+        Gaolette gaolette = create_gaolette(spec(), gao);
+        CHECK(gaolette.id >= 0);
+        CHECK(gaolette.state == State::Operational);
+        fetch_state(gaolette, gao);
+        CHECK(gaolette.state == State::Operational);
+
+        Gaolette dynamic = create_gaolette(spec(Memory_Policy::DYNAMIC, 4 * SIZE), gao);
+        CHECK(resize_gaolette(dynamic, 3 * SIZE, gao) == 0);
+        CHECK(resize_gaolette(dynamic, 8 * SIZE, gao) == -1);
+        CHECK(resize_gaolette(gaolette, 2 * SIZE, gao) == -1);
+
+        const gaolette_id_t id = gaolette.id;
+        CHECK(destroy_gaolette(gaolette, gao) == 0);
+        CHECK(gaolette.state == State::ShutDown);
+        gaolette.id = id;
+        CHECK(destroy_gaolette(gaolette, gao) == -1);
+        CHECK(destroy_gaolette(dynamic, gao) == 0);
+    }
+
+    void test_malformed(const Orchestrator& gao) {
+        const protocol::Id_Payload unknown{1 << 24};
+        std::uint32_t request = gao.send_request(protocol::Opcode::GET_STATE, &unknown, sizeof(unknown));
+        CHECK(answers(gao.wait_reply(request), protocol::Opcode::GET_STATE, request,
+                      protocol::Status::UNKNOWN_GAOLETTE));
+
+        const char short_payload[2] = {};
+        request = gao.send_request(protocol::Opcode::GET_STATE, short_payload, sizeof(short_payload));
+        CHECK(answers(gao.wait_reply(request), protocol::Opcode::GET_STATE, request, protocol::Status::BAD_REQUEST));
+
+        request = gao.send_request(static_cast<protocol::Opcode>(200), nullptr, 0);
+        CHECK(answers(gao.wait_reply(request), static_cast<protocol::Opcode>(200), request,
+                      protocol::Status::BAD_REQUEST));
+
+        // still served after all of the above
+        Gaolette gaolette = create_gaolette(spec(), gao);
+        CHECK(destroy_gaolette(gaolette, gao) == 0);
+    }
+
+    void test_pipelined(const Orchestrator& gao) {
+        std::vector<Gaolette> gaolettes;
+        for (int i = 0; i < 8; ++i) {
+            gaolettes.push_back(create_gaolette(spec(), gao));
+        }
+
+        // small frames leave the batch behind them at every possible alignment in the Gao process' buffer
+        std::vector<std::uint32_t> states;
+        for (int i = 0; i < 1000; ++i) {
+            const protocol::Id_Payload id{gaolettes[i % gaolettes.size()].id};
+            states.push_back(gao.send_request(protocol::Opcode::GET_STATE, &id, sizeof(id)));
+        }
+        const std::vector<protocol::Perf_Spec_Payload> specs(3, protocol::Perf_Spec_Payload{SIZE, SIZE, 1, 0, 0, 0, 0});
+        const std::uint32_t batch = gao.send_request(protocol::Opcode::CREATE_BATCH, specs.data(),
+                                                     static_cast<std::uint32_t>(specs.size() * sizeof(specs[0])));
+
+        // claimed newest first, every reply is filed until its caller asks for it
+        const Orchestrator::Reply created = gao.wait_reply(batch);
+        CHECK(answers(created, protocol::Opcode::CREATE_BATCH, batch, protocol::Status::OK));
+        CHECK(created.payload.size() == specs.size() * sizeof(protocol::Batch_Result));
+        for (auto it = states.rbegin(); it != states.rend(); ++it) {
+            const Orchestrator::Reply reply = gao.wait_reply(*it);
+            CHECK(answers(reply, protocol::Opcode::GET_STATE, *it, protocol::Status::OK));
+            protocol::State_Payload state{};
+            std::memcpy(&state, reply.payload.data(), sizeof(state));
+            CHECK(state.state == static_cast<std::uint8_t>(protocol::State_Code::OPERATIONAL));
+        }
+
+        std::vector<protocol::Batch_Result> results(specs.size());
+        std::memcpy(results.data(), created.payload.data(), created.payload.size());
+        for (const protocol::Batch_Result& result : results) {
+            CHECK(result.status == static_cast<std::uint16_t>(protocol::Status::OK));
+            CHECK(result.id >= 0);
+            gaolettes.push_back(Gaolette{result.id, State::Operational, spec()});
+        }
+
+        for (const int code : destroy_gaolettes(gaolettes, gao)) {
+            CHECK(code == 0);
+        }
+        for (const Gaolette& gaolette : gaolettes) {
+            CHECK(gaolette.state == State::ShutDown);
+        }
+    }
+
+    // each reply is twice the size of its request, both rings fill up long before the first reply is claimed
+    void test_flooded(const Orchestrator& gao) {
+        const std::vector<protocol::Id_Payload> unknown(protocol::MAX_BATCH, protocol::Id_Payload{1 << 24});
+        std::vector<std::uint32_t> batches;
+        for (int i = 0; i < 16; ++i) {
+            batches.push_back(gao.send_request(protocol::Opcode::DESTROY_BATCH, unknown.data(),
+                                               static_cast<std::uint32_t>(unknown.size() * sizeof(unknown[0]))));
+        }
+        for (const std::uint32_t batch : batches) {
+            const Orchestrator::Reply reply = gao.wait_reply(batch);
+            CHECK(answers(reply, protocol::Opcode::DESTROY_BATCH, batch, protocol::Status::OK));
+            CHECK(reply.payload.size() == unknown.size() * sizeof(protocol::Batch_Result));
+        }
+    }
+
+    void test_notifications(const Orchestrator& gao) {
+        constexpr int CYCLES = 50;
+        int operational = 0;
+        int shut_down = 0;
+        const std::uint64_t subscription = gao.subscribe(protocol::ALL_GAOLETTES, [&](gaolette_id_t, const State state) {
+            ++(state == State::ShutDown ? shut_down : operational);
+        });
+
+        // pushed along with the replies and only dispatched at the end, each Gaolette's creation is folded into
+        // its shutdown; the shutdowns themselves are kept, every one of them ends another Gaolette
+        for (int i = 0; i < CYCLES; ++i) {
+            Gaolette gaolette = create_gaolette(spec(), gao);
+            CHECK(destroy_gaolette(gaolette, gao) == 0);
+        }
+        // a round trip, every change pushed before its reply is filed by the time it returns
+        CHECK(gao.fetch_stats().requests > 0);
+        while (shut_down < CYCLES) {
+            gao.dispatch_notifications(true);
+        }
+        CHECK(shut_down == CYCLES);
+        CHECK(operational <= 1);
+        gao.unsubscribe(subscription);
+    }
+
+    // before is taken as the Gao process came up, the embedded runtime keeps counting across Orchestrators
+    void test_stats(const Orchestrator& gao, const protocol::Stats_Payload& before, const Runtime_Options& runtime) {
+        const protocol::Stats_Payload stats = gao.fetch_stats();
+        CHECK(stats.requests > 1000);
+        CHECK(stats.failures >= 3);
+        CHECK(stats.execute[static_cast<std::uint16_t>(protocol::Opcode::CREATE)].count >= 1);
+        CHECK(gao.round_trip_stats(protocol::Opcode::GET_STATE).count >= 1000);
+
+        // with workers every CREATE and DESTROY runs on one of them, without any nothing leaves the control loop
+        const std::uint16_t create = static_cast<std::uint16_t>(protocol::Opcode::CREATE);
+        const std::uint64_t offloaded = stats.offloaded - before.offloaded;
+        if (runtime.workers_ != 0) {
+            CHECK(offloaded >= stats.execute[create].count - before.execute[create].count);
+        } else {
+            CHECK(offloaded == 0);
+        }
+    }
+}
+
+int main() {
+    struct Setup {
+        protocol::Transport transport;
+        Runtime_Options runtime;
+    };
+    const Setup setups[] = {
+        {protocol::Transport::SOCKET, {}},
+        {protocol::Transport::SHARED_MEMORY, {}},
+        {protocol::Transport::EMBEDDED, {}},
+        {protocol::Transport::SOCKET, {.workers_ = 2}},
+        {protocol::Transport::SHARED_MEMORY, {.workers_ = 2}},
+        {protocol::Transport::EMBEDDED, {.workers_ = 2}},
+        {protocol::Transport::SOCKET, {.workers_ = 3, .pin_workers_ = true}},
+        {protocol::Transport::EMBEDDED, {.workers_ = 3, .pin_workers_ = true}},
+        {protocol::Transport::SOCKET, {.io_uring_ = true}},
+        {protocol::Transport::SHARED_MEMORY, {.workers_ = 2, .io_uring_ = true}},
+        {protocol::Transport::EMBEDDED, {.workers_ = 2, .io_uring_ = true}},
+    };
+    for (const Setup& setup : setups) {
+        const Orchestrator gao(true, setup.transport, {}, {}, setup.runtime);
+        CHECK(gao.transport() == setup.transport);
+        const protocol::Stats_Payload before = gao.fetch_stats();
+        test_lifecycle(gao);
+        test_malformed(gao);
+        test_pipelined(gao);
+        test_flooded(gao);
+        test_notifications(gao);
+        test_stats(gao, before, setup.runtime);
+    }
+    return check::result();
+}
@@ -0,0 +1,270 @@
+//
+// Created by David Yang on 2026-10-17.
+//
+
+// Work_Deque and Injection_Queue hand every task out exactly once while several threads push, pop and steal at
+// the same time; the Scheduler keeps a Task_Group's tasks within its limit, also across a change of limit.
+
+#include "check.hpp"
+
+#include <scheduler.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct Counted : Task {
+        std::atomic<int> taken{0};
+    };
+
+    void take(Task* task) {
+        static_cast<Counted*>(task)->taken.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool each_taken_once(const std::unique_ptr<Counted[]>& tasks, const std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i) {
+            if (tasks[i].taken.load(std::memory_order_relaxed) != 1) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void test_deque_owner() {
+        Work_Deque deque;
+        CHECK(deque.init() == 0);
+        CHECK(deque.pop() == nullptr);
+        CHECK(deque.steal() == nullptr);
+
+        // grows past its initial capacity, the owner takes the newest and a thief the oldest
+        constexpr int COUNT = 4 * Work_Deque::INITIAL_CAPACITY;
+        auto tasks = std::make_unique<Counted[]>(COUNT);
+        for (int i = 0; i < COUNT; ++i) {
+            CHECK(deque.push(&tasks[i]) == 0);
+        }
+        CHECK(deque.pop() == &tasks[COUNT - 1]);
+        CHECK(deque.steal() == &tasks[0]);
+        int left = 0;
+        while (deque.pop() != nullptr) {
+            ++left;
+        }
+        CHECK(left == COUNT - 2);
+    }
+
+    void test_deque_contention() {
+        constexpr std::size_t COUNT = 200000;
+        constexpr std::size_t BURST = 1000;
+        constexpr int THIEVES = 3;
+
+        Work_Deque deque;
+        CHECK(deque.init() == 0);
+        auto tasks = std::make_unique<Counted[]>(COUNT);
+        std::atomic<bool> done{false};
+
+        std::vector<std::thread> thieves;
+        for (int i = 0; i < THIEVES; ++i) {
+            thieves.emplace_back([&] {
+                while (!done.load(std::memory_order_acquire)) {
+                    if (Task* task = deque.steal()) {
+                        take(task);
+                    }
+                }
+                while (Task* task = deque.steal()) {
+                    take(task);
+                }
+            });
+        }
+
+        // the owner pushes in bursts and pops part of each, racing the thieves for the last task every time
+        for (std::size_t pushed = 0; pushed < COUNT; pushed += BURST) {
+            for (std::size_t i = pushed; i < pushed + BURST; ++i) {
+                CHECK(deque.push(&tasks[i]) == 0);
+            }
+            for (std::size_t i = 0; i < BURST / 2; ++i) {
+                if (Task* task = deque.pop()) {
+                    take(task);
+                }
+            }
+        }
+        while (Task* task = deque.pop()) {
+            take(task);
+        }
+        done.store(true, std::memory_order_release);
+        for (std::thread& thief : thieves) {
+            thief.join();
+        }
+        CHECK(each_taken_once(tasks, COUNT));
+    }
+
+    void test_injection_queue() {
+        Injection_Queue small;
+        CHECK(small.init(3) == -1);
+        CHECK(small.init(4) == 0);
+        CHECK(small.init(4) == 0);
+        Counted one;
+        for (int i = 0; i < 4; ++i) {
+            CHECK(small.push(&one) == 0);
+        }
+        CHECK(small.push(&one) == -1);
+        for (int i = 0; i < 4; ++i) {
+            CHECK(small.pop() == &one);
+        }
+        CHECK(small.pop() == nullptr);
+
+        constexpr std::size_t PER_PRODUCER = 50000;
+        constexpr int PRODUCERS = 4;
+        constexpr int CONSUMERS = 4;
+        constexpr std::size_t COUNT = PER_PRODUCER * PRODUCERS;
+
+        Injection_Queue queue;
+        CHECK(queue.init(1024) == 0);
+        auto tasks = std::make_unique<Counted[]>(COUNT);
+        std::atomic<std::size_t> consumed{0};
+
+        std::vector<std::thread> threads;
+        for (int p = 0; p < PRODUCERS; ++p) {
+            threads.emplace_back([&, p] {
+                for (std::size_t i = p * PER_PRODUCER; i < (p + 1) * PER_PRODUCER; ++i) {
+                    while (queue.push(&tasks[i]) == -1) {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        for (int c = 0; c < CONSUMERS; ++c) {
+            threads.emplace_back([&] {
+                while (consumed.load(std::memory_order_relaxed) < COUNT) {
+                    if (Task* task = queue.pop()) {
+                        take(task);
+                        consumed.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        CHECK(queue.pop() == nullptr);
+        CHECK(each_taken_once(tasks, COUNT));
+    }
+
+    struct Capped : Task {
+        std::atomic<int>* running;
+        std::atomic<int>* most;
+        std::atomic<int>* finished;
+    };
+
+    void run_capped(Task* task) noexcept {
+        const auto* capped = static_cast<Capped*>(task);
+        const int now = capped->running->fetch_add(1, std::memory_order_acq_rel) + 1;
+        int most = capped->most->load(std::memory_order_relaxed);
+        while (now > most && !capped->most->compare_exchange_weak(most, now, std::memory_order_relaxed)) {}
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        capped->running->fetch_sub(1, std::memory_order_acq_rel);
+        capped->finished->fetch_add(1, std::memory_order_release);
+    }
+
+    void test_group_limit() {
+        constexpr int COUNT = 64;
+        Scheduler scheduler;
+        CHECK(scheduler.start(4) == 0);
+        CHECK(scheduler.worker_count() == 4);
+
+        Task_Group group;
+        group.limit = 2;
+        std::atomic<int> running{0};
+        std::atomic<int> most{0};
+        std::atomic<int> finished{0};
+        auto tasks = std::make_unique<Capped[]>(COUNT);
+        for (int i = 0; i < COUNT; ++i) {
+            tasks[i].run = &run_capped;
+            tasks[i].group = &group;
+            tasks[i].running = &running;
+            tasks[i].most = &most;
+            tasks[i].finished = &finished;
+            CHECK(scheduler.submit(&tasks[i]) == 0);
+        }
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (finished.load(std::memory_order_acquire) != COUNT && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        CHECK(finished.load(std::memory_order_acquire) == COUNT);
+        CHECK(most.load(std::memory_order_relaxed) <= 2);
+        CHECK(most.load(std::memory_order_relaxed) >= 1);
+        scheduler.stop();
+        CHECK(scheduler.submit(&tasks[0]) == -1);
+    }
+    struct Gated : Task {
+        std::atomic<bool> started{false};
+        std::atomic<bool> open{false};
+        std::atomic<bool> finished{false};
+    };
+
+    void run_gated(Task* task) noexcept {
+        auto* gated = static_cast<Gated*>(task);
+        gated->started.store(true, std::memory_order_release);
+        while (!gated->open.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        gated->finished.store(true, std::memory_order_release);
+    }
+
+    template <typename Predicate>
+    bool within_seconds(const int seconds, Predicate done) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+        while (!done() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return done();
+    }
+
+    // a group handed to the next Gaolette while a task of the last one still runs: the task gives its slot back
+    // under whatever limit it finds by then, the next tenant's tasks never find the group full
+    void test_group_reuse() {
+        constexpr int COUNT = 16;
+        Scheduler scheduler;
+        CHECK(scheduler.start(2) == 0);
+
+        Task_Group group;
+        group.limit = 1;
+        Gated gated;
+        gated.run = &run_gated;
+        gated.group = &group;
+        CHECK(scheduler.submit(&gated) == 0);
+        CHECK(within_seconds(10, [&] { return gated.started.load(std::memory_order_acquire); }));
+
+        group.limit = 0;
+        gated.open.store(true, std::memory_order_release);
+        CHECK(within_seconds(10, [&] { return gated.finished.load(std::memory_order_acquire); }));
+
+        group.limit = 1;
+        std::atomic<int> running{0};
+        std::atomic<int> most{0};
+        std::atomic<int> finished{0};
+        auto tasks = std::make_unique<Capped[]>(COUNT);
+        for (int i = 0; i < COUNT; ++i) {
+            tasks[i].run = &run_capped;
+            tasks[i].group = &group;
+            tasks[i].running = &running;
+            tasks[i].most = &most;
+            tasks[i].finished = &finished;
+            CHECK(scheduler.submit(&tasks[i]) == 0);
+        }
+        CHECK(within_seconds(10, [&] { return finished.load(std::memory_order_acquire) == COUNT; }));
+        CHECK(most.load(std::memory_order_relaxed) == 1);
+        scheduler.stop();
+    }
+}
+
+int main() {
+    test_deque_owner();
+    test_deque_contention();
+    test_injection_queue();
+    test_group_limit();
+    test_group_reuse();
+    return check::result();
+}